@@ -390,10 +390,11 @@ void Application::CheckAssetsVersion() {
         board.SetPowerSaveLevel(PowerSaveLevel::PERFORMANCE);
         display->SetChatMessage("system", Lang::Strings::PLEASE_WAIT);
 
-        bool success = assets.Download(download_url, [display](int progress, size_t speed) -> void {
-            std::thread([display, progress, speed]() {
-                char buffer[32];
-                snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", progress, speed / 1024);
+        bool success = assets.Download(download_url, [display](const DownloadProgress& progress) -> void {
+            std::thread([display, progress]() {
+                char buffer[48];
+                snprintf(buffer, sizeof(buffer), "%d%% %uKB/s (flash %lums)", progress.progress,
+                         progress.speed / 1024, (unsigned long)progress.flash_write_ms);
                 display->SetChatMessage("system", buffer);
             }).detach();
         });
@@ -524,7 +525,7 @@ void Application::InitializeProtocol() {
         xEventGroupSetBits(event_group_, MAIN_EVENT_ERROR);
     });
     
-    protocol_->OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
+    protocol_->OnIncomingAudio([this](AudioStreamPacketPtr packet) {
         if (GetDeviceState() == kDeviceStateSpeaking) {
             audio_service_.PushPacketToDecodeQueue(std::move(packet));
         }
@@ -991,10 +992,11 @@ bool Application::UpgradeFirmware(const std::string& url, const std::string& ver
     audio_service_.Stop();
     vTaskDelay(pdMS_TO_TICKS(1000));
 
-    bool upgrade_success = Ota::Upgrade(upgrade_url, [display](int progress, size_t speed) {
-        std::thread([display, progress, speed]() {
-            char buffer[32];
-            snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", progress, speed / 1024);
+    bool upgrade_success = Ota::Upgrade(upgrade_url, [display](const DownloadProgress& progress) {
+        std::thread([display, progress]() {
+            char buffer[48];
+            snprintf(buffer, sizeof(buffer), "%d%% %uKB/s (flash %lums)", progress.progress,
+                     progress.speed / 1024, (unsigned long)progress.flash_write_ms);
             display->SetChatMessage("system", buffer);
         }).detach();
     });
@@ -1116,7 +1118,20 @@ void Application::SetAecMode(AecMode mode) {
     });
 }
 
-void Application::AddAudioData(AudioStreamPacket&& packet) {
+void Application::AddAudioData(AudioStreamPacketPtr packet) {
+    // packet->payload contains raw PCM data (int16_t)
+    AddAudioData(std::span<const int16_t>(reinterpret_cast<const int16_t*>(packet->payload.data()),
+                                          packet->payload.size() / sizeof(int16_t)),
+                 packet->sample_rate);
+}
+
+void Application::BeginAudioStream() {
+    std::lock_guard<std::mutex> lock(music_resampler_mutex_);
+    music_resampler_.Reset();
+    music_rate_switch_failed_ = 0;
+}
+
+void Application::AddAudioData(std::span<const int16_t> pcm, int sample_rate) {
     auto codec = Board::GetInstance().GetAudioCodec();
 
     if (GetDeviceState() == kDeviceStateIdle && codec->output_enabled()) {
@@ -1136,82 +1151,64 @@ void Application::AddAudioData(AudioStreamPacket&& packet) {
             }
         }
 
-        // packet.payload contains raw PCM data (int16_t)
-        if (packet.payload.size() >= sizeof(int16_t)) {
-            size_t num_samples = packet.payload.size() / sizeof(int16_t);
-            std::vector<int16_t> pcm_data(num_samples);
-            memcpy(pcm_data.data(), packet.payload.data(), num_samples * sizeof(int16_t));
+        if (pcm.empty()) {
+            return;
+        }
 
-            // Check if sample rate matches, if not, perform simple resampling
-            if (packet.sample_rate != codec->output_sample_rate()) {
+        // Only resampling needs a buffer of its own, otherwise the caller's PCM goes straight to the codec
+        AudioTaskPtr resampled_frame;
 
-                // Validate sample rate parameters
-                if (packet.sample_rate <= 0 || codec->output_sample_rate() <= 0) {
-                    ESP_LOGE(TAG, "Invalid sample rates: %d -> %d",
-                             packet.sample_rate, codec->output_sample_rate());
-                    return;
-                }
+        // Check if sample rate matches, if not, switch the codec rate or resample
+        if (sample_rate != codec->output_sample_rate()) {
 
-                std::vector<int16_t> resampled;
-
-                if (packet.sample_rate > codec->output_sample_rate()) {
-                    ESP_LOGI(TAG, "Music playback: Switching sample rate from %d Hz to %d Hz",
-                             codec->output_sample_rate(), packet.sample_rate);
-
-                    // Try to dynamically switch sample rate
-                    if (codec->SetOutputSampleRate(packet.sample_rate)) {
-                        ESP_LOGI(TAG, "Successfully switched to music playback sample rate: %d Hz",
-                                 packet.sample_rate);
-                        // Giữ nguyên pcm_data
-                    } else {
-                        ESP_LOGW(TAG, "Cannot switch sample rate, continue using current sample rate: %d Hz",
-                                 codec->output_sample_rate());
-                        // Nếu muốn downsample thật sự thì phải implement thêm ở đây
-                    }
-                } else {
-                    // Upsampling: linear interpolation
-                    float upsample_ratio = codec->output_sample_rate() / static_cast<float>(packet.sample_rate);
-                    size_t expected_size = static_cast<size_t>(pcm_data.size() * upsample_ratio + 0.5f);
-                    resampled.reserve(expected_size);
-
-                    for (size_t i = 0; i < pcm_data.size(); ++i) {
-                        resampled.push_back(pcm_data[i]);
-
-                        int interpolation_count = static_cast<int>(upsample_ratio) - 1;
-                        if (interpolation_count > 0 && i + 1 < pcm_data.size()) {
-                            int16_t current = pcm_data[i];
-                            int16_t next = pcm_data[i + 1];
-                            for (int j = 1; j <= interpolation_count; ++j) {
-                                float t = static_cast<float>(j) / (interpolation_count + 1);
-                                int16_t interpolated = static_cast<int16_t>(current + (next - current) * t);
-                                resampled.push_back(interpolated);
-                            }
-                        } else if (interpolation_count > 0) {
-                            for (int j = 1; j <= interpolation_count; ++j) {
-                                resampled.push_back(pcm_data[i]);
-                            }
-                        }
-                    }
+            // Validate sample rate parameters
+            if (sample_rate <= 0 || codec->output_sample_rate() <= 0) {
+                ESP_LOGE(TAG, "Invalid sample rates: %d -> %d",
+                         sample_rate, codec->output_sample_rate());
+                return;
+            }
 
-                    ESP_LOGI(TAG, "Upsampled %d -> %d samples (ratio: %.2f)",
-                             (int)pcm_data.size(), (int)resampled.size(), upsample_ratio);
+            std::lock_guard<std::mutex> lock(music_resampler_mutex_);
+            bool resample = true;
+            if (sample_rate > codec->output_sample_rate() && sample_rate != music_rate_switch_failed_) {
+                ESP_LOGI(TAG, "Music playback: Switching sample rate from %d Hz to %d Hz",
+                         codec->output_sample_rate(), sample_rate);
+
+                // Try to dynamically switch sample rate
+                if (codec->SetOutputSampleRate(sample_rate)) {
+                    ESP_LOGI(TAG, "Successfully switched to music playback sample rate: %d Hz",
+                             sample_rate);
+                    // Giữ nguyên pcm
+                    resample = false;
+                } else {
+                    ESP_LOGW(TAG, "Cannot switch sample rate, downsampling to current sample rate: %d Hz",
+                             codec->output_sample_rate());
+                    // Do not retry the switch on every frame of this stream
+                    music_rate_switch_failed_ = sample_rate;
                 }
+            }
 
-                if (!resampled.empty()) {
-                    pcm_data = std::move(resampled);
+            if (resample) {
+                // Band-limited polyphase resampling, it keeps its history across frames
+                music_resampler_.Configure(sample_rate, codec->output_sample_rate());
+                resampled_frame = AudioFramePool::GetInstance().AcquireTask(music_resampler_.GetOutputSamples(pcm.size()));
+                music_resampler_.Process(pcm, resampled_frame->pcm);
+                pcm = resampled_frame->pcm;
+                if (pcm.empty()) {
+                    return;
                 }
             }
+        }
 
-            // Ensure audio output is enabled
-            if (!codec->output_enabled()) {
-                codec->EnableOutput(true);
-            }
+        // Ensure audio output is enabled
+        if (!codec->output_enabled()) {
+            codec->EnableOutput(true);
+        }
 
-            // Send PCM data to audio codec
-            codec->OutputData(pcm_data);
+        // Send PCM data to audio codec
+        codec->OutputData(pcm);
 
-            audio_service_.UpdateOutputTimestamp();
-        }
+        audio_service_.UpdateOutputTimestamp();
     }
 }
 
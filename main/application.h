@@ -8,6 +8,7 @@
 
 #include <string>
 #include <string_view>
+#include <span>
 #include <functional>
 #include <mutex>
 #include <deque>
@@ -16,6 +17,7 @@
 #include "protocol.h"
 #include "ota.h"
 #include "audio_service.h"
+#include "pcm_resampler.h"
 #include "device_state.h"
 #include "device_state_machine.h"
 
@@ -119,7 +121,12 @@ public:
     AudioService& GetAudioService() { return audio_service_; }
     
     // Receive external audio data (e.g., music/radio playback)
-    void AddAudioData(AudioStreamPacket&& packet);
+    void AddAudioData(AudioStreamPacketPtr packet);
+    // Same as above, but plays PCM borrowed from the caller's decoder buffer without copying it
+    void AddAudioData(std::span<const int16_t> pcm, int sample_rate);
+    // A new music / radio / SD stream starts: drop the resampler history of the previous
+    // one and allow the codec sample rate switch to be tried again
+    void BeginAudioStream();
     
     /**
      * Reset protocol resources (thread-safe)
@@ -143,6 +150,9 @@ private:
     std::string last_error_message_;
     AudioService audio_service_;
     std::unique_ptr<Ota> ota_;
+    std::mutex music_resampler_mutex_;
+    PcmResampler music_resampler_;
+    int music_rate_switch_failed_ = 0;     // Rate the codec refused in the current stream
 
     bool has_server_time_ = false;
     bool aborted_ = false;
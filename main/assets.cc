@@ -6,6 +6,7 @@
 #include "emote_display.h"
 #ifdef HAVE_LVGL
 #include "display/lcd_display.h"
+#include "gif/gif_frame_cache.h"
 #endif
 
 #include <esp_log.h>
@@ -13,6 +14,8 @@
 #include <esp_timer.h>
 #include <cbin_font.h>
 
+#include <cstring>
+
 
 #define TAG "Assets"
 
@@ -48,6 +51,7 @@ bool Assets::InitializePartition() {
     partition_valid_ = false;
     checksum_valid_ = false;
     assets_.clear();
+    v2_index_.Clear();
 
     partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, "assets");
     if (partition_ == nullptr) {
@@ -72,6 +76,13 @@ bool Assets::InitializePartition() {
 
     partition_valid_ = true;
 
+    if (*(const uint32_t*)mmap_root_ == ASSETS_V2_MAGIC) {
+        return InitializeV2();
+    }
+    return InitializeV1();
+}
+
+bool Assets::InitializeV1() {
     uint32_t stored_files = *(uint32_t*)(mmap_root_ + 0);
     uint32_t stored_chksum = *(uint32_t*)(mmap_root_ + 4);
     uint32_t stored_len = *(uint32_t*)(mmap_root_ + 8);
@@ -104,6 +115,14 @@ bool Assets::InitializePartition() {
     return checksum_valid_;
 }
 
+bool Assets::InitializeV2() {
+    if (!v2_index_.Initialize(mmap_root_, partition_->size)) {
+        return false;
+    }
+    checksum_valid_ = true;
+    return true;
+}
+
 bool Assets::Apply() {
     void* ptr = nullptr;
     size_t size = 0;
@@ -147,6 +166,9 @@ bool Assets::Apply() {
     }
 
 #ifdef HAVE_LVGL
+    // Frames recorded from the previous partition may be keyed by addresses the new one reuses
+    GifFrameCache::GetInstance().Clear();
+
     auto& theme_manager = LvglThemeManager::GetInstance();
     auto light_theme = theme_manager.GetTheme("light");
     auto dark_theme = theme_manager.GetTheme("dark");
@@ -166,6 +188,16 @@ bool Assets::Apply() {
             if (dark_theme != nullptr) {
                 dark_theme->set_text_font(text_font);
             }
+
+            cJSON* warmup = cJSON_GetObjectItem(root, "text_font_warmup");
+            if (cJSON_IsString(warmup) && GetAssetData(warmup->valuestring, ptr, size)) {
+                // Codepoint u32 LE, thường gặp nhất trước; v1 không căn 4 byte nên phải copy
+                std::vector<uint32_t> codepoints(size / sizeof(uint32_t));
+                memcpy(codepoints.data(), ptr, codepoints.size() * sizeof(uint32_t));
+                auto display = Board::GetInstance().GetDisplay();
+                DisplayLockGuard lock(display);
+                text_font->Warmup(codepoints.data(), codepoints.size());
+            }
         } else {
             ESP_LOGE(TAG, "The font file %s is not found", fonts_text_file.c_str());
         }
@@ -382,7 +414,7 @@ bool Assets::Apply() {
     return true;
 }
 
-bool Assets::Download(std::string url, std::function<void(int progress, size_t speed)> progress_callback) {
+bool Assets::Download(std::string url, OtaDownloader::ProgressCallback progress_callback) {
     ESP_LOGI(TAG, "Downloading new version of assets from %s", url.c_str());
     
     // 取消当前资源分区的内存映射
@@ -393,115 +425,49 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
     }
     checksum_valid_ = false;
     assets_.clear();
+    v2_index_.Clear();
 
     // 下载新的资源文件
-    auto network = Board::GetInstance().GetNetwork();
-    auto http = network->CreateHttp(0);
-    
-    if (!http->Open("GET", url)) {
-        ESP_LOGE(TAG, "Failed to open HTTP connection");
-        return false;
-    }
-
-    if (http->GetStatusCode() != 200) {
-        ESP_LOGE(TAG, "Failed to get assets, status code: %d", http->GetStatusCode());
-        return false;
-    }
-
-    size_t content_length = http->GetBodyLength();
-    if (content_length == 0) {
-        ESP_LOGE(TAG, "Failed to get content length");
-        return false;
-    }
-
-    if (content_length > partition_->size) {
-        ESP_LOGE(TAG, "Assets file size (%u) is larger than partition size (%lu)", content_length, partition_->size);
-        return false;
-    }
-
     // 定义扇区大小为4KB（ESP32的标准扇区大小）
     const size_t SECTOR_SIZE = esp_partition_get_main_flash_sector_size();
-    
-    // 计算需要擦除的扇区数量
-    size_t sectors_to_erase = (content_length + SECTOR_SIZE - 1) / SECTOR_SIZE; // 向上取整
-    size_t total_erase_size = sectors_to_erase * SECTOR_SIZE;
-    
-    ESP_LOGI(TAG, "Sector size: %u, content length: %u, sectors to erase: %u, total erase size: %u", 
-             SECTOR_SIZE, content_length, sectors_to_erase, total_erase_size);
-    
-    // 写入新的资源文件到分区，一边erase一边写入
-    char buffer[512];
-    size_t total_written = 0;
-    size_t recent_written = 0;
     size_t current_sector = 0;
-    auto last_calc_time = esp_timer_get_time();
-    
-    while (true) {
-        int ret = http->Read(buffer, sizeof(buffer));
-        if (ret < 0) {
-            ESP_LOGE(TAG, "Failed to read HTTP data: %s", esp_err_to_name(ret));
-            return false;
-        }
-
-        if (ret == 0) {
-            break;
-        }
 
+    // 写入新的资源文件到分区，一边erase一边写入 (在下载器的写线程中执行)
+    OtaDownloader downloader(url, partition_->size);
+    downloader.OnWrite([&](size_t offset, const uint8_t* data, size_t length) -> bool {
         // 检查是否需要擦除新的扇区
-        size_t write_end_offset = total_written + ret;
-        size_t needed_sectors = (write_end_offset + SECTOR_SIZE - 1) / SECTOR_SIZE;
-        
-        // 擦除需要的新扇区
-        while (current_sector < needed_sectors) {
-            size_t sector_start = current_sector * SECTOR_SIZE;
-            size_t sector_end = (current_sector + 1) * SECTOR_SIZE;
-            
+        size_t needed_sectors = (offset + length + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        if (needed_sectors > current_sector) {
+            size_t erase_start = current_sector * SECTOR_SIZE;
+            size_t erase_size = (needed_sectors - current_sector) * SECTOR_SIZE;
             // 确保擦除范围不超过分区大小
-            if (sector_end > partition_->size) {
-                ESP_LOGE(TAG, "Sector end (%u) exceeds partition size (%lu)", sector_end, partition_->size);
+            if (erase_start + erase_size > partition_->size) {
+                ESP_LOGE(TAG, "Sector end (%u) exceeds partition size (%lu)", erase_start + erase_size, partition_->size);
                 return false;
             }
-            
-            ESP_LOGD(TAG, "Erasing sector %u (offset: %u, size: %u)", current_sector, sector_start, SECTOR_SIZE);
-            esp_err_t err = esp_partition_erase_range(partition_, sector_start, SECTOR_SIZE);
+            esp_err_t err = esp_partition_erase_range(partition_, erase_start, erase_size);
             if (err != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to erase sector %u at offset %u: %s", current_sector, sector_start, esp_err_to_name(err));
+                ESP_LOGE(TAG, "Failed to erase %u bytes at offset %u: %s", erase_size, erase_start, esp_err_to_name(err));
                 return false;
             }
-            
-            current_sector++;
+            current_sector = needed_sectors;
         }
 
         // 写入数据到分区
-        esp_err_t err = esp_partition_write(partition_, total_written, buffer, ret);
+        esp_err_t err = esp_partition_write(partition_, offset, data, length);
         if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to write to assets partition at offset %u: %s", total_written, esp_err_to_name(err));
+            ESP_LOGE(TAG, "Failed to write to assets partition at offset %u: %s", offset, esp_err_to_name(err));
             return false;
         }
+        return true;
+    });
+    downloader.OnProgress(progress_callback);
 
-        total_written += ret;
-        recent_written += ret;
-
-        // 计算进度和速度
-        if (esp_timer_get_time() - last_calc_time >= 1000000 || total_written == content_length || ret == 0) {
-            size_t progress = total_written * 100 / content_length;
-            size_t speed = recent_written; // 每秒的字节数
-            ESP_LOGI(TAG, "Progress: %u%% (%u/%u), Speed: %u B/s, Sectors erased: %u", 
-                     progress, total_written, content_length, speed, current_sector);
-            if (progress_callback) {
-                progress_callback(progress, speed);
-            }
-            last_calc_time = esp_timer_get_time();
-            recent_written = 0; // 重置最近写入的字节数
-        }
-    }
-    
-    http->Close();
-
-    if (total_written != content_length) {
-        ESP_LOGE(TAG, "Downloaded size (%u) does not match expected size (%u)", total_written, content_length);
+    if (!downloader.Run()) {
+        ESP_LOGE(TAG, "Failed to download assets");
         return false;
     }
+    size_t total_written = downloader.content_length();
 
     ESP_LOGI(TAG, "Assets download completed, total written: %u bytes, total sectors erased: %u", 
              total_written, current_sector);
@@ -516,6 +482,16 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
 }
 
 bool Assets::GetAssetData(const std::string& name, void*& ptr, size_t& size) {
+    if (v2_index_.valid()) {
+        auto entry = v2_index_.FindEntry(name);
+        if (entry == nullptr || !v2_index_.VerifyEntry(entry)) {
+            return false;
+        }
+        ptr = static_cast<void*>(const_cast<char*>(v2_index_.data(entry)));
+        size = entry->size;
+        return true;
+    }
+
     auto asset = assets_.find(name);
     if (asset == assets_.end()) {
         return false;
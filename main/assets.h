@@ -9,6 +9,9 @@
 #include <esp_partition.h>
 #include <model_path.h>
 
+#include "assets_v2.h"
+#include "ota_downloader.h"
+
 
 struct Asset {
     size_t size;
@@ -23,7 +26,7 @@ public:
     }
     ~Assets();
 
-    bool Download(std::string url, std::function<void(int progress, size_t speed)> progress_callback);
+    bool Download(std::string url, OtaDownloader::ProgressCallback progress_callback);
     bool Apply();
     bool GetAssetData(const std::string& name, void*& ptr, size_t& size);
 
@@ -37,6 +40,8 @@ private:
     Assets& operator=(const Assets&) = delete;
 
     bool InitializePartition();
+    bool InitializeV1();
+    bool InitializeV2();
     uint32_t CalculateChecksum(const char* data, uint32_t length);
 
     const esp_partition_t* partition_ = nullptr;
@@ -46,7 +51,10 @@ private:
     bool checksum_valid_ = false;
     std::string default_assets_url_;
     srmodel_list_t* models_list_ = nullptr;
-    std::map<std::string, Asset> assets_;
+    std::map<std::string, Asset> assets_;           // v1 only
+
+    // v2: tra cứu trực tiếp trên mmap, CRC từng file kiểm tra ở lần truy cập đầu
+    AssetsV2Index v2_index_;
 };
 
 #endif
@@ -0,0 +1,136 @@
+#include "assets_v2.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_rom_crc.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define TAG "Assets"
+
+uint32_t AssetsV2Index::HashName(const char* name, size_t length) {
+    uint32_t hash = 0x811C9DC5;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+void AssetsV2Index::Clear() {
+    entries_ = nullptr;
+    count_ = 0;
+    names_ = nullptr;
+    data_ = nullptr;
+    std::lock_guard<std::mutex> lock(verify_mutex_);
+    verify_state_.clear();
+}
+
+bool AssetsV2Index::Initialize(const char* root, size_t partition_size) {
+    Clear();
+    if (partition_size < sizeof(mmap_assets_v2_header)) {
+        ESP_LOGE(TAG, "The partition is too small for an assets v2 header");
+        return false;
+    }
+    auto header = (const mmap_assets_v2_header*)root;
+    uint32_t header_crc = esp_rom_crc32_le(0, (const uint8_t*)header, offsetof(mmap_assets_v2_header, header_crc));
+    if (header_crc != header->header_crc || header->version != 2) {
+        ESP_LOGE(TAG, "Invalid assets v2 header (version %lu)", (unsigned long)header->version);
+        return false;
+    }
+
+    // Giới hạn từng trường trước khi cộng: size_t chỉ 32 bit trên ESP32, names_size lớn sẽ tràn
+    if (header->file_count > partition_size / sizeof(mmap_assets_v2_entry) || header->names_size > partition_size) {
+        ESP_LOGE(TAG, "The assets v2 index does not fit the partition");
+        return false;
+    }
+    size_t index_size = (size_t)header->file_count * sizeof(mmap_assets_v2_entry) + header->names_size;
+    size_t index_end = sizeof(mmap_assets_v2_header) + index_size;
+    if (index_end > header->data_offset || header->data_offset > partition_size ||
+        header->data_size > partition_size - header->data_offset) {
+        ESP_LOGE(TAG, "The assets v2 layout does not fit the partition");
+        return false;
+    }
+
+    auto start_time = esp_timer_get_time();
+    uint32_t index_crc = esp_rom_crc32_le(0, (const uint8_t*)(root + sizeof(mmap_assets_v2_header)), index_size);
+    if (index_crc != header->index_crc) {
+        ESP_LOGE(TAG, "The index CRC (0x%08lx) does not match the stored CRC (0x%08lx)", (unsigned long)index_crc,
+                 (unsigned long)header->index_crc);
+        return false;
+    }
+
+    auto entries = (const mmap_assets_v2_entry*)(root + sizeof(mmap_assets_v2_header));
+    auto names = root + sizeof(mmap_assets_v2_header) + (size_t)header->file_count * sizeof(mmap_assets_v2_entry);
+    if (header->names_size == 0 || names[header->names_size - 1] != '\0') {
+        ESP_LOGE(TAG, "The assets v2 name table is not terminated");
+        return false;
+    }
+    for (uint32_t i = 0; i < header->file_count; i++) {
+        auto& entry = entries[i];
+        if (entry.name_offset >= header->names_size || entry.offset > header->data_size ||
+            entry.size > header->data_size - entry.offset ||
+            (i > 0 && entry.name_hash < entries[i - 1].name_hash)) {
+            ESP_LOGE(TAG, "The assets v2 entry %lu is invalid", (unsigned long)i);
+            return false;
+        }
+    }
+    auto end_time = esp_timer_get_time();
+    ESP_LOGI(TAG, "Assets v2: %lu files, index verified in %d us", (unsigned long)header->file_count,
+             int(end_time - start_time));
+
+    entries_ = entries;
+    count_ = header->file_count;
+    names_ = names;
+    data_ = root + header->data_offset;
+    std::lock_guard<std::mutex> lock(verify_mutex_);
+    verify_state_.assign(count_, 0);
+    return true;
+}
+
+const mmap_assets_v2_entry* AssetsV2Index::FindEntry(const std::string& name) const {
+    uint32_t hash = HashName(name.data(), name.size());
+    auto end = entries_ + count_;
+    auto it = std::lower_bound(entries_, end, hash, [](const mmap_assets_v2_entry& entry, uint32_t hash) {
+        return entry.name_hash < hash;
+    });
+    for (; it != end && it->name_hash == hash; ++it) {
+        if (strcmp(names_ + it->name_offset, name.c_str()) == 0) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+bool AssetsV2Index::VerifyEntry(const mmap_assets_v2_entry* entry) {
+    size_t index = entry - entries_;
+    {
+        std::lock_guard<std::mutex> lock(verify_mutex_);
+        if (index >= verify_state_.size()) {
+            return false;
+        }
+        if (verify_state_[index] != 0) {
+            return verify_state_[index] == 1;
+        }
+    }
+
+    // CRC ngoài lock: file lớn (srmodels) không chặn các luồng khác
+    auto start_time = esp_timer_get_time();
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)(data_ + entry->offset), entry->size);
+    auto end_time = esp_timer_get_time();
+    bool valid = crc == entry->crc;
+    if (valid) {
+        ESP_LOGD(TAG, "Verified %s (%lu bytes) in %d ms", names_ + entry->name_offset, (unsigned long)entry->size,
+                 int((end_time - start_time) / 1000));
+    } else {
+        ESP_LOGE(TAG, "The asset %s is corrupted, CRC 0x%08lx, expected 0x%08lx", names_ + entry->name_offset,
+                 (unsigned long)crc, (unsigned long)entry->crc);
+    }
+
+    std::lock_guard<std::mutex> lock(verify_mutex_);
+    if (index < verify_state_.size()) {
+        verify_state_[index] = valid ? 1 : 2;
+    }
+    return valid;
+}
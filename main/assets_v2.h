@@ -0,0 +1,68 @@
+#ifndef ASSETS_V2_H
+#define ASSETS_V2_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Assets v2: header | entries[file_count] | names | data
+ *
+ * Entries are sorted by (name_hash, name) so a lookup is a binary search straight on the
+ * mmap. Only the header and the index (entries + names) are checked at boot, the CRC32 of
+ * each file is checked the first time it is used. v1 packs start with the file count,
+ * which can never be as large as the magic.
+ *
+ * Written by pack_assets_v2() in scripts/build_default_assets.py.
+ */
+#define ASSETS_V2_MAGIC 0x3253415A   // "ZAS2"
+
+struct mmap_assets_v2_header {
+    uint32_t magic;
+    uint32_t version;             /*!< 2 */
+    uint32_t file_count;
+    uint32_t names_size;          /*!< NUL terminated names after the entry table */
+    uint32_t data_offset;         /*!< From the start of the partition */
+    uint32_t data_size;
+    uint32_t index_crc;           /*!< CRC32 of entries + names */
+    uint32_t header_crc;          /*!< CRC32 of the fields above */
+};
+
+struct mmap_assets_v2_entry {
+    uint32_t name_hash;           /*!< FNV-1a of the name */
+    uint32_t name_offset;         /*!< Into the names block */
+    uint32_t offset;              /*!< Into the data block, 4 byte aligned */
+    uint32_t size;
+    uint32_t crc;                 /*!< CRC32 of the data */
+};
+
+// Index of a v2 pack mapped at root. Lookups are const and lock free, Verify() may be
+// called from several tasks
+class AssetsV2Index {
+public:
+    static uint32_t HashName(const char* name, size_t length);
+
+    // Checks the header and the index against partition_size, false leaves the index empty
+    bool Initialize(const char* root, size_t partition_size);
+    void Clear();
+
+    bool valid() const { return entries_ != nullptr; }
+    uint32_t count() const { return count_; }
+
+    const mmap_assets_v2_entry* FindEntry(const std::string& name) const;
+    // CRC32 of the entry's data, computed once and remembered
+    bool VerifyEntry(const mmap_assets_v2_entry* entry);
+    const char* data(const mmap_assets_v2_entry* entry) const { return data_ + entry->offset; }
+
+private:
+    const mmap_assets_v2_entry* entries_ = nullptr;
+    uint32_t count_ = 0;
+    const char* names_ = nullptr;
+    const char* data_ = nullptr;
+    std::mutex verify_mutex_;
+    std::vector<uint8_t> verify_state_;             // 0 chưa kiểm tra, 1 hợp lệ, 2 lỗi CRC
+};
+
+#endif // ASSETS_V2_H
@@ -0,0 +1,126 @@
+#include "aac_frame_splitter.h"
+
+// Đủ cho header ADTS có CRC (9 byte) và header LOAS (3 byte)
+static constexpr size_t kMaxHeaderBytes = 9;
+
+static const int kSampleRates[13] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350,
+};
+
+static inline bool IsAdtsSync(const uint8_t* p) {
+    // Sync 0xFFF, layer 00
+    return p[0] == 0xFF && (p[1] & 0xF6) == 0xF0;
+}
+
+static inline bool IsLoasSync(const uint8_t* p) {
+    return p[0] == 0x56 && (p[1] & 0xE0) == 0xE0;
+}
+
+void AacFrameSplitter::Reset() {
+    framing_ = Framing::Unknown;
+    locked_ = false;
+    sample_rate_index_ = -1;
+    channels_ = 0;
+}
+
+int AacFrameSplitter::sample_rate() const {
+    return sample_rate_index_ >= 0 ? kSampleRates[sample_rate_index_] : 0;
+}
+
+bool AacFrameSplitter::ParseHeader(const uint8_t* data, Header& header) const {
+    if (IsAdtsSync(data)) {
+        bool has_crc = (data[1] & 0x01) == 0;
+        int profile = data[2] >> 6;
+        int sample_rate_index = (data[2] >> 2) & 0x0F;
+        int channels = ((data[2] & 0x01) << 2) | (data[3] >> 6);
+        size_t frame_length = ((size_t)(data[3] & 0x03) << 11) | ((size_t)data[4] << 3) | (data[5] >> 5);
+        if (profile == 3 || sample_rate_index > 12 || frame_length < (has_crc ? 9u : 7u)) {
+            return false;
+        }
+        header.framing = Framing::Adts;
+        header.frame_length = frame_length;
+        header.sample_rate_index = sample_rate_index;
+        header.channels = channels;
+    } else if (IsLoasSync(data)) {
+        size_t mux_length = ((size_t)(data[1] & 0x1F) << 8) | data[2];
+        if (mux_length == 0) {
+            return false;
+        }
+        header.framing = Framing::Loas;
+        header.frame_length = 3 + mux_length;
+        header.sample_rate_index = -1;
+        header.channels = 0;
+    } else {
+        return false;
+    }
+    return header.frame_length <= max_frame_bytes_;
+}
+
+AacFrameSplitter::Result AacFrameSplitter::Next(const uint8_t* data, size_t available, bool eos, size_t& length) {
+    length = 0;
+    if (available < kMaxHeaderBytes) {
+        if (!eos) {
+            return Result::NeedMore;
+        }
+        length = available;
+        return available > 0 ? Result::Skip : Result::NeedMore;
+    }
+
+    Header header;
+    if (!ParseHeader(data, header)) {
+        locked_ = false;
+        return SkipToSync(data, available, eos, length);
+    }
+    bool same_stream = header.framing == framing_ &&
+                       (header.framing != Framing::Adts ||
+                        (header.sample_rate_index == sample_rate_index_ && header.channels == channels_));
+
+    if (!locked_ || !same_stream) {
+        // Xác nhận bằng header của frame kế tiếp
+        size_t next = header.frame_length;
+        if (available < next + kMaxHeaderBytes) {
+            if (!eos) {
+                return Result::NeedMore;
+            }
+            // Frame cuối của stream: không còn gì để đối chiếu
+            if (available < next) {
+                length = available;
+                return Result::Skip;
+            }
+        } else {
+            Header next_header;
+            if (!ParseHeader(data + next, next_header) || next_header.framing != header.framing ||
+                next_header.sample_rate_index != header.sample_rate_index ||
+                next_header.channels != header.channels) {
+                locked_ = false;
+                return SkipToSync(data, available, eos, length);
+            }
+        }
+        framing_ = header.framing;
+        sample_rate_index_ = header.sample_rate_index;
+        channels_ = header.channels;
+        locked_ = true;
+    }
+
+    if (available < header.frame_length) {
+        if (!eos) {
+            return Result::NeedMore;
+        }
+        length = available;
+        return Result::Skip;
+    }
+    length = header.frame_length;
+    return Result::Frame;
+}
+
+AacFrameSplitter::Result AacFrameSplitter::SkipToSync(const uint8_t* data, size_t available, bool eos, size_t& length) {
+    for (size_t i = 1; i + 1 < available; i++) {
+        if (IsAdtsSync(data + i) || IsLoasSync(data + i)) {
+            length = i;
+            return Result::Skip;
+        }
+    }
+    // Byte cuối có thể là nửa đầu của sync word
+    length = eos ? available : available - 1;
+    return Result::Skip;
+}
@@ -0,0 +1,65 @@
+#ifndef AAC_FRAME_SPLITTER_H
+#define AAC_FRAME_SPLITTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Finds whole AAC frames in a byte stream: ADTS (0xFFF sync) or LOAS/LATM (0x2B7 sync).
+ *
+ * Next() looks at the start of the readable data and reports one whole frame, how many
+ * bytes to drop before the next sync candidate, or that more data is needed. Until it is
+ * locked, a header only counts when the header of the following frame checks out as well
+ * (same framing, sample rate and channels for ADTS), so a 0xFFF inside the payload after a
+ * chunk boundary or a reconnect is not taken for a frame. Once locked each frame header
+ * is still validated, a bad one drops the lock and resyncs.
+ *
+ * Frames longer than max_frame_bytes are treated as corrupt: the caller decodes frames in
+ * place and can only guarantee that many contiguous bytes.
+ */
+class AacFrameSplitter {
+public:
+    enum class Framing : uint8_t {
+        Unknown,
+        Adts,
+        Loas,
+    };
+
+    enum class Result : uint8_t {
+        Frame,       // length = frame size, header included
+        Skip,        // length = bytes to drop before the next sync candidate
+        NeedMore,
+    };
+
+    explicit AacFrameSplitter(size_t max_frame_bytes) : max_frame_bytes_(max_frame_bytes) {}
+
+    void Reset();
+
+    // eos: no more data will follow, a partial frame at the end is skipped
+    Result Next(const uint8_t* data, size_t available, bool eos, size_t& length);
+
+    Framing framing() const { return framing_; }
+    bool locked() const { return locked_; }
+    int sample_rate() const;
+    int channels() const { return channels_; }
+
+private:
+    size_t max_frame_bytes_;
+    Framing framing_ = Framing::Unknown;
+    bool locked_ = false;
+    int sample_rate_index_ = -1;      // ADTS only
+    int channels_ = 0;
+
+    struct Header {
+        Framing framing = Framing::Unknown;
+        size_t frame_length = 0;
+        int sample_rate_index = -1;
+        int channels = 0;
+    };
+
+    // false if data (at least kMaxHeaderBytes) does not start with a valid frame header
+    bool ParseHeader(const uint8_t* data, Header& header) const;
+    Result SkipToSync(const uint8_t* data, size_t available, bool eos, size_t& length);
+};
+
+#endif // AAC_FRAME_SPLITTER_H
@@ -15,6 +15,10 @@ AudioCodec::~AudioCodec() {
 }
 
 void AudioCodec::OutputData(std::vector<int16_t>& data) {
+    OutputData(std::span<const int16_t>(data));
+}
+
+void AudioCodec::OutputData(std::span<const int16_t> data) {
     Write(data.data(), data.size());
 }
 
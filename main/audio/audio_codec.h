@@ -6,6 +6,7 @@
 #include <driver/i2s_std.h>
 
 #include <vector>
+#include <span>
 #include <string>
 #include <functional>
 
@@ -31,6 +32,8 @@ public:
     virtual bool SetOutputSampleRate(int sample_rate);
 
     virtual void OutputData(std::vector<int16_t>& data);
+    // Write borrowed PCM straight to the codec, the caller keeps ownership of the buffer
+    virtual void OutputData(std::span<const int16_t> data);
     virtual bool InputData(std::vector<int16_t>& data);
     virtual void Start();
 
@@ -0,0 +1,188 @@
+#include "audio_frame_pool.h"
+#include "audio_pipeline.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include <esp_log.h>
+
+#define TAG "AudioFramePool"
+
+static void ReserveBytes(AudioStreamPacket* packet, size_t bytes) {
+    packet->payload.reserve(bytes);
+}
+
+static void ReserveBytes(AudioTask* task, size_t bytes) {
+    task->pcm.reserve(bytes / sizeof(int16_t));
+}
+
+static void ResetFrame(AudioStreamPacket* packet) {
+    packet->sample_rate = 0;
+    packet->frame_duration = 0;
+    packet->timestamp = 0;
+    packet->payload.clear();
+}
+
+static void ResetFrame(AudioTask* task) {
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    task->timestamp = 0;
+    task->pcm.clear();
+}
+
+void AudioFrameDeleter::operator()(AudioStreamPacket* packet) const {
+    AudioFramePool::GetInstance().Release(packet);
+}
+
+void AudioFrameDeleter::operator()(AudioTask* task) const {
+    AudioFramePool::GetInstance().Release(task);
+}
+
+int AudioFramePool::ClassForRequest(size_t bytes) {
+    for (size_t i = 0; i < kClassCount; i++) {
+        if (bytes <= kClassBytes[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int AudioFramePool::ClassForCapacity(size_t bytes) {
+    // A frame can serve any request up to its capacity, file it under the largest class it covers
+    if (bytes < kClassBytes[0] || bytes > kClassBytes[kClassCount - 1] * 2) {
+        return -1;
+    }
+    int size_class = kClassCount - 1;
+    while (size_class > 0 && kClassBytes[size_class] > bytes) {
+        size_class--;
+    }
+    return size_class;
+}
+
+// Opus packets are a few hundred bytes and arrive in bursts, keep more of the small ones
+template <typename T>
+size_t AudioFramePool::MaxFree(const FreeLists<T>& pool, int size_class) {
+    return kClassBytes[size_class] <= 1024 ? pool.max_free_small : pool.max_free_large;
+}
+
+template <typename T>
+T* AudioFramePool::Acquire(FreeLists<T>& pool, size_t bytes) {
+    int size_class = ClassForRequest(bytes);
+    T* item = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size_class >= 0 && !pool.lists[size_class].empty()) {
+            item = pool.lists[size_class].back();
+            pool.lists[size_class].pop_back();
+            pool.counters.hits++;
+            pool.counters.free--;
+        } else {
+            pool.counters.misses++;
+        }
+        pool.counters.in_use++;
+        pool.counters.high_water = std::max(pool.counters.high_water, pool.counters.in_use);
+    }
+
+    if (item == nullptr) {
+        item = new T();
+        ReserveBytes(item, size_class >= 0 ? kClassBytes[size_class] : bytes);
+    }
+    return item;
+}
+
+template <typename T>
+void AudioFramePool::Recycle(FreeLists<T>& pool, T* item, size_t capacity_bytes) {
+    int size_class = ClassForCapacity(capacity_bytes);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pool.counters.in_use--;
+        if (size_class >= 0 && pool.lists[size_class].size() < MaxFree(pool, size_class)) {
+            ResetFrame(item);
+            pool.lists[size_class].push_back(item);
+            pool.counters.free++;
+            return;
+        }
+    }
+    delete item;
+}
+
+void AudioFramePool::Initialize(int output_sample_rate) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < (int)kClassCount; i++) {
+            packets_.lists[i].reserve(MaxFree(packets_, i));
+            tasks_.lists[i].reserve(MaxFree(tasks_, i));
+        }
+    }
+
+    // Incoming Opus packets: enough to cover a burst filling the decode queue
+    int opus_class = ClassForRequest(256);
+    // PCM frames: 16kHz encoder input and decoder output at the codec rate
+    int input_class = ClassForRequest(OPUS_FRAME_DURATION_MS * 16000 / 1000 * sizeof(int16_t));
+    int output_class = ClassForRequest(OPUS_FRAME_DURATION_MS * output_sample_rate / 1000 * sizeof(int16_t));
+
+    std::vector<AudioStreamPacketPtr> packets;
+    for (int i = 0; i < MAX_DECODE_PACKETS_IN_QUEUE / 2; i++) {
+        packets.push_back(AcquirePacket(kClassBytes[opus_class]));
+    }
+    std::vector<AudioTaskPtr> tasks;
+    for (int i = 0; i < MAX_ENCODE_TASKS_IN_QUEUE + 2; i++) {
+        tasks.push_back(AcquireTask(kClassBytes[input_class] / sizeof(int16_t)));
+    }
+    if (output_class >= 0) {
+        for (int i = 0; i < MAX_PLAYBACK_TASKS_IN_QUEUE + 2; i++) {
+            tasks.push_back(AcquireTask(kClassBytes[output_class] / sizeof(int16_t)));
+        }
+    }
+    packets.clear();
+    tasks.clear();
+
+    // Preallocation is not a miss
+    std::lock_guard<std::mutex> lock(mutex_);
+    packets_.counters = AudioFramePoolCounters{.free = packets_.counters.free};
+    tasks_.counters = AudioFramePoolCounters{.free = tasks_.counters.free};
+    ESP_LOGI(TAG, "Preallocated %" PRIu32 " packets and %" PRIu32 " PCM frames",
+        packets_.counters.free, tasks_.counters.free);
+}
+
+AudioStreamPacketPtr AudioFramePool::AcquirePacket(size_t payload_bytes) {
+    return AudioStreamPacketPtr(Acquire(packets_, payload_bytes));
+}
+
+AudioTaskPtr AudioFramePool::AcquireTask(size_t samples) {
+    return AudioTaskPtr(Acquire(tasks_, samples * sizeof(int16_t)));
+}
+
+void AudioFramePool::Release(AudioStreamPacket* packet) {
+    if (packet != nullptr) {
+        Recycle(packets_, packet, packet->payload.capacity());
+    }
+}
+
+void AudioFramePool::Release(AudioTask* task) {
+    if (task != nullptr) {
+        Recycle(tasks_, task, task->pcm.capacity() * sizeof(int16_t));
+    }
+}
+
+AudioFramePoolCounters AudioFramePool::packet_counters() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return packets_.counters;
+}
+
+AudioFramePoolCounters AudioFramePool::task_counters() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.counters;
+}
+
+std::string AudioFramePool::ToString() {
+    auto packets = packet_counters();
+    auto tasks = task_counters();
+    char buffer[192];
+    snprintf(buffer, sizeof(buffer),
+        "packets hit=%" PRIu32 " miss=%" PRIu32 " in_use=%" PRIu32 " high_water=%" PRIu32 " free=%" PRIu32
+        ", pcm hit=%" PRIu32 " miss=%" PRIu32 " in_use=%" PRIu32 " high_water=%" PRIu32 " free=%" PRIu32,
+        packets.hits, packets.misses, packets.in_use, packets.high_water, packets.free,
+        tasks.hits, tasks.misses, tasks.in_use, tasks.high_water, tasks.free);
+    return buffer;
+}
@@ -0,0 +1,92 @@
+#ifndef AUDIO_FRAME_POOL_H
+#define AUDIO_FRAME_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "audio_stream_packet.h"
+
+struct AudioTask;
+
+/*
+ * Recycles AudioStreamPacket / AudioTask objects together with the capacity of their
+ * payload / pcm vectors, so steady-state audio does not touch the heap at all.
+ *
+ * Objects are kept on one free list per size class (by vector capacity in bytes) and
+ * come back through AudioFrameDeleter when the owning unique_ptr is destroyed.
+ */
+struct AudioFrameDeleter {
+    void operator()(AudioStreamPacket* packet) const;
+    void operator()(AudioTask* task) const;
+};
+
+using AudioStreamPacketPtr = std::unique_ptr<AudioStreamPacket, AudioFrameDeleter>;
+using AudioTaskPtr = std::unique_ptr<AudioTask, AudioFrameDeleter>;
+
+struct AudioFramePoolCounters {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t in_use = 0;
+    uint32_t high_water = 0;
+    uint32_t free = 0;
+};
+
+class AudioFramePool {
+public:
+    static AudioFramePool& GetInstance() {
+        static AudioFramePool instance;
+        return instance;
+    }
+
+    // Preallocate the frames needed for a conversation at the given codec output rate
+    void Initialize(int output_sample_rate);
+
+    // The returned payload / pcm is empty, with at least the requested capacity reserved
+    AudioStreamPacketPtr AcquirePacket(size_t payload_bytes);
+    AudioTaskPtr AcquireTask(size_t samples);
+
+    AudioFramePoolCounters packet_counters();
+    AudioFramePoolCounters task_counters();
+    std::string ToString();
+
+private:
+    AudioFramePool() = default;
+    AudioFramePool(const AudioFramePool&) = delete;
+    AudioFramePool& operator=(const AudioFramePool&) = delete;
+
+    friend struct AudioFrameDeleter;
+
+    static constexpr std::array<size_t, 6> kClassBytes = {256, 512, 1024, 2048, 4096, 8192};
+    static constexpr size_t kClassCount = kClassBytes.size();
+
+    template <typename T>
+    struct FreeLists {
+        std::array<std::vector<T*>, kClassCount> lists{};
+        AudioFramePoolCounters counters{};
+        size_t max_free_small = 0;
+        size_t max_free_large = 0;
+    };
+
+    std::mutex mutex_;
+    FreeLists<AudioStreamPacket> packets_ = {.max_free_small = 48, .max_free_large = 8};
+    FreeLists<AudioTask> tasks_ = {.max_free_small = 8, .max_free_large = 8};
+
+    static int ClassForRequest(size_t bytes);
+    static int ClassForCapacity(size_t bytes);
+    template <typename T>
+    static size_t MaxFree(const FreeLists<T>& pool, int size_class);
+
+    void Release(AudioStreamPacket* packet);
+    void Release(AudioTask* task);
+    template <typename T>
+    T* Acquire(FreeLists<T>& pool, size_t bytes);
+    template <typename T>
+    void Recycle(FreeLists<T>& pool, T* item, size_t capacity_bytes);
+};
+
+#endif // AUDIO_FRAME_POOL_H
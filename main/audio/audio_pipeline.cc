@@ -0,0 +1,363 @@
+#include "audio_pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+#include <esp_log.h>
+
+#include "sdkconfig.h"
+
+#define TAG "AudioPipeline"
+
+static const char* const kStageNames[kAudioStageCount] = {
+    "decode_q", "decode", "playback_q", "output", "encode_q", "encode", "send_q",
+};
+
+void AudioLatencyRecorder::Record(uint32_t us) {
+    samples_[next_] = us;
+    next_ = (next_ + 1) % kWindow;
+    count_++;
+    if (us > max_) {
+        max_ = us;
+    }
+}
+
+uint32_t AudioLatencyRecorder::Percentile(int percent) const {
+    size_t n = std::min<size_t>(count_, kWindow);
+    if (n == 0) {
+        return 0;
+    }
+    std::array<uint32_t, kWindow> sorted = samples_;
+    size_t rank = (n - 1) * percent / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + n);
+    return sorted[rank];
+}
+
+void AudioLatencyRecorder::Reset() {
+    next_ = 0;
+    count_ = 0;
+    max_ = 0;
+}
+
+std::string AudioPipelineReport::ToString() const {
+    char line[128];
+    std::string out;
+    snprintf(line, sizeof(line), "%" PRIu32 " ms, fps decode=%.1f encode=%.1f playback=%.1f\n",
+        elapsed_ms, decode_fps, encode_fps, playback_fps);
+    out += line;
+    snprintf(line, sizeof(line), "peak depth decode=%u playback=%u encode=%u send=%u, dropped=%" PRIu32 "\n",
+        (unsigned)peak_decode_queue, (unsigned)peak_playback_queue, (unsigned)peak_encode_queue, (unsigned)peak_send_queue,
+        dropped);
+    out += line;
+    for (int i = 0; i < kAudioStageCount; i++) {
+        auto& s = stages[i];
+        if (s.count == 0) {
+            continue;
+        }
+        snprintf(line, sizeof(line), "%-10s n=%-6" PRIu32 " p50=%-6" PRIu32 " p90=%-6" PRIu32 " p99=%-6" PRIu32 " max=%" PRIu32 " us\n",
+            kStageNames[i], s.count, s.p50_us, s.p90_us, s.p99_us, s.max_us);
+        out += line;
+    }
+    return out;
+}
+
+int64_t AudioPipeline::NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AudioPipeline::RecordLatency(AudioPipelineStage stage, int64_t start_us, int64_t end_us) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    latency_[stage].Record(static_cast<uint32_t>(std::max<int64_t>(end_us - start_us, 0)));
+}
+
+static_assert(ENCODE_RING_CAPACITY >= MAX_ENCODE_TASKS_IN_QUEUE, "encode ring too small");
+static_assert(PLAYBACK_RING_CAPACITY >= MAX_PLAYBACK_TASKS_IN_QUEUE, "playback ring too small");
+static_assert(SEND_RING_CAPACITY >= MAX_SEND_PACKETS_IN_QUEUE, "send ring too small");
+static_assert(DECODE_RING_CAPACITY >= MAX_DECODE_PACKETS_IN_QUEUE, "decode ring too small");
+static_assert(DECODE_RING_CAPACITY >= TESTING_RING_CAPACITY, "decode ring must hold the testing queue");
+static_assert(TESTING_RING_CAPACITY >= MAX_TESTING_PACKETS_IN_QUEUE + MAX_ENCODE_TASKS_IN_QUEUE, "testing ring too small");
+
+void AudioPipeline::CountDrop(const char* queue) {
+    uint32_t dropped = ++stats_dropped_;
+    ESP_LOGW(TAG, "%s queue full, frame dropped (%" PRIu32 " dropped)", queue, dropped);
+}
+
+void AudioPipeline::UpdatePeak(std::atomic<size_t>& peak, size_t depth) {
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (depth > current && !peak.compare_exchange_weak(current, depth, std::memory_order_relaxed)) {
+    }
+}
+
+bool AudioPipeline::CodecHasWork() const {
+    return (!encode_ring_.empty() && send_ring_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
+        (!decode_ring_.empty() && playback_ring_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
+}
+
+void AudioPipeline::Start() {
+    stopped_ = false;
+}
+
+void AudioPipeline::Stop() {
+    stopped_ = true;
+    encode_ring_.Flush();
+    decode_ring_.Flush();
+    playback_ring_.Flush();
+    testing_ring_.Flush();
+    codec_wakeup_.Notify();
+    output_wakeup_.Notify();
+    decode_space_wakeup_.Notify();
+    encode_space_wakeup_.Notify();
+}
+
+void AudioPipeline::RunOutputLoop() {
+    while (true) {
+        output_wakeup_.Wait([this]() { return !playback_ring_.empty() || stopped_; });
+        if (stopped_) {
+            break;
+        }
+
+        Queued<AudioTask> entry;
+        if (!playback_ring_.Pop(entry)) {
+            continue;
+        }
+        codec_wakeup_.Notify();
+
+        auto start_us = NowUs();
+        RecordLatency(kAudioStagePlaybackQueue, entry.enqueued_us, start_us);
+        codec_.output(entry.item->pcm);
+        RecordLatency(kAudioStageOutput, start_us, NowUs());
+        debug_statistics_.playback_count++;
+        stats_played_++;
+
+#if CONFIG_USE_SERVER_AEC
+        /* Record the timestamp for server AEC */
+        if (entry.item->timestamp > 0 && !timestamp_ring_.Push(uint32_t(entry.item->timestamp))) {
+            CountDrop("Timestamp");
+        }
+#endif
+    }
+}
+
+void AudioPipeline::RunCodecLoop() {
+    while (true) {
+        codec_wakeup_.Wait([this]() { return stopped_ || CodecHasWork(); });
+        if (stopped_) {
+            break;
+        }
+
+        /* Decode the audio from decode queue */
+        Queued<AudioStreamPacket> packet_entry;
+        if (playback_ring_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE && decode_ring_.Pop(packet_entry)) {
+            decode_space_wakeup_.Notify();
+
+            auto start_us = NowUs();
+            RecordLatency(kAudioStageDecodeQueue, packet_entry.enqueued_us, start_us);
+
+            auto& packet = packet_entry.item;
+            auto task = AudioFramePool::GetInstance().AcquireTask(packet->sample_rate * packet->frame_duration / 1000);
+            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+            task->timestamp = packet->timestamp;
+            bool decoded = codec_.decode(*packet, task->pcm);
+            auto end_us = NowUs();
+            RecordLatency(kAudioStageDecode, start_us, end_us);
+
+            if (!decoded) {
+                ESP_LOGE(TAG, "Failed to decode audio");
+            } else if (playback_ring_.Push({std::move(task), end_us})) {
+                UpdatePeak(peak_playback_queue_, playback_ring_.size());
+                output_wakeup_.Notify();
+            } else {
+                CountDrop("Playback");
+            }
+            debug_statistics_.decode_count++;
+            stats_decoded_++;
+        }
+
+        /* Encode the audio to send queue */
+        Queued<AudioTask> task_entry;
+        if (send_ring_.size() < MAX_SEND_PACKETS_IN_QUEUE && encode_ring_.Pop(task_entry)) {
+            encode_space_wakeup_.Notify();
+
+            auto start_us = NowUs();
+            RecordLatency(kAudioStageEncodeQueue, task_entry.enqueued_us, start_us);
+
+            auto& task = task_entry.item;
+            auto packet = AudioFramePool::GetInstance().AcquirePacket(OPUS_PACKET_RESERVE_BYTES);
+            packet->frame_duration = OPUS_FRAME_DURATION_MS;
+            packet->sample_rate = 16000;
+            packet->timestamp = task->timestamp;
+            if (!codec_.encode(std::move(task->pcm), packet->payload)) {
+                ESP_LOGE(TAG, "Failed to encode audio");
+                continue;
+            }
+            auto end_us = NowUs();
+            RecordLatency(kAudioStageEncode, start_us, end_us);
+
+            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+                if (send_ring_.Push({std::move(packet), end_us})) {
+                    UpdatePeak(peak_send_queue_, send_ring_.size());
+                } else {
+                    CountDrop("Send");
+                }
+                if (on_send_queue_available_) {
+                    on_send_queue_available_();
+                }
+            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
+                if (!testing_ring_.Push({std::move(packet), end_us})) {
+                    CountDrop("Testing");
+                }
+            }
+            debug_statistics_.encode_count++;
+            stats_encoded_++;
+        }
+    }
+}
+
+void AudioPipeline::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
+    // Copy into the pooled buffer rather than adopting the caller's vector, so the pool keeps
+    // its own fixed-size buffers instead of collecting whatever capacity the producer used
+    auto task = AudioFramePool::GetInstance().AcquireTask(pcm.size());
+    task->type = type;
+    task->pcm.assign(pcm.begin(), pcm.end());
+    task->timestamp = 0;
+
+    std::lock_guard<std::mutex> lock(encode_producer_mutex_);
+
+    /* If the task is to send queue, we need to set the timestamp */
+    uint32_t timestamp = 0;
+    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_ring_.empty()) {
+        size_t pending = timestamp_ring_.size();
+        timestamp_ring_.Pop(timestamp);
+        if (pending <= MAX_TIMESTAMPS_IN_QUEUE) {
+            task->timestamp = timestamp;
+        } else {
+            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", (unsigned)pending);
+        }
+    }
+
+    /* Push the task to the encode queue */
+    encode_space_wakeup_.Wait([this]() { return encode_ring_.size() < MAX_ENCODE_TASKS_IN_QUEUE || stopped_; });
+    if (stopped_) {
+        return;
+    }
+    if (!encode_ring_.Push({std::move(task), NowUs()})) {
+        CountDrop("Encode");
+        return;
+    }
+    UpdatePeak(peak_encode_queue_, encode_ring_.size());
+    codec_wakeup_.Notify();
+}
+
+bool AudioPipeline::PushPacketToDecodeQueue(AudioStreamPacketPtr packet, bool wait) {
+    std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+    if (decode_ring_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
+        if (!wait) {
+            return false;
+        }
+        decode_space_wakeup_.Wait([this]() { return decode_ring_.size() < MAX_DECODE_PACKETS_IN_QUEUE || stopped_; });
+        if (stopped_) {
+            return false;
+        }
+    }
+    if (!decode_ring_.Push({std::move(packet), NowUs()})) {
+        CountDrop("Decode");
+        return false;
+    }
+    UpdatePeak(peak_decode_queue_, decode_ring_.size());
+    codec_wakeup_.Notify();
+    return true;
+}
+
+AudioStreamPacketPtr AudioPipeline::PopPacketFromSendQueue() {
+    Queued<AudioStreamPacket> entry;
+    if (!send_ring_.Pop(entry)) {
+        return nullptr;
+    }
+    codec_wakeup_.Notify();
+
+    RecordLatency(kAudioStageSendQueue, entry.enqueued_us, NowUs());
+    return std::move(entry.item);
+}
+
+size_t AudioPipeline::GetTestingQueueSize() {
+    return testing_ring_.size();
+}
+
+void AudioPipeline::MoveTestingQueueToDecodeQueue() {
+    std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+    decode_ring_.Flush();
+    Queued<AudioStreamPacket> entry;
+    while (testing_ring_.Pop(entry)) {
+        entry.enqueued_us = NowUs();
+        if (!decode_ring_.Push(std::move(entry))) {
+            CountDrop("Decode");
+            break;
+        }
+    }
+    testing_ring_.Flush();
+    UpdatePeak(peak_decode_queue_, decode_ring_.size());
+    codec_wakeup_.Notify();
+}
+
+void AudioPipeline::ResetDecodeQueues() {
+    timestamp_ring_.Flush();
+    decode_ring_.Flush();
+    playback_ring_.Flush();
+    testing_ring_.Flush();
+    decode_space_wakeup_.Notify();
+}
+
+bool AudioPipeline::IsIdle() {
+    return encode_ring_.empty() && decode_ring_.empty() && playback_ring_.empty() && testing_ring_.empty();
+}
+
+AudioPipelineReport AudioPipeline::GetReport() {
+    AudioPipelineReport report;
+    report.peak_decode_queue = peak_decode_queue_;
+    report.peak_playback_queue = peak_playback_queue_;
+    report.peak_encode_queue = peak_encode_queue_;
+    report.peak_send_queue = peak_send_queue_;
+    report.dropped = stats_dropped_;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    for (int i = 0; i < kAudioStageCount; i++) {
+        auto& recorder = latency_[i];
+        auto& stage = report.stages[i];
+        stage.count = recorder.count();
+        stage.p50_us = recorder.Percentile(50);
+        stage.p90_us = recorder.Percentile(90);
+        stage.p99_us = recorder.Percentile(99);
+        stage.max_us = recorder.max();
+    }
+    if (stats_start_us_ == 0) {
+        return report;
+    }
+    auto elapsed_us = NowUs() - stats_start_us_;
+    report.elapsed_ms = static_cast<uint32_t>(elapsed_us / 1000);
+    if (elapsed_us > 0) {
+        report.decode_fps = stats_decoded_ * 1e6f / elapsed_us;
+        report.encode_fps = stats_encoded_ * 1e6f / elapsed_us;
+        report.playback_fps = stats_played_ * 1e6f / elapsed_us;
+    }
+    return report;
+}
+
+void AudioPipeline::ResetReport() {
+    peak_decode_queue_ = decode_ring_.size();
+    peak_playback_queue_ = playback_ring_.size();
+    peak_encode_queue_ = encode_ring_.size();
+    peak_send_queue_ = send_ring_.size();
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    for (auto& recorder : latency_) {
+        recorder.Reset();
+    }
+    stats_start_us_ = NowUs();
+    stats_decoded_ = 0;
+    stats_encoded_ = 0;
+    stats_played_ = 0;
+    stats_dropped_ = 0;
+}
@@ -0,0 +1,199 @@
+#ifndef AUDIO_PIPELINE_H
+#define AUDIO_PIPELINE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "audio_frame_pool.h"
+#include "spsc_ring.h"
+
+/*
+ * Portable core of the AudioService: the encode / decode / playback / send queues and
+ * the Opus codec stage. Nothing here depends on FreeRTOS or on the audio hardware, the
+ * Opus codec and the speaker are reached through AudioPipelineCodec, and the loops are
+ * scheduled by an AudioTaskRunner. This lets the same code run on the device and in a
+ * host process that replays captured streams to measure latency and throughput.
+ */
+
+#define OPUS_FRAME_DURATION_MS 60
+#define MAX_ENCODE_TASKS_IN_QUEUE 2
+#define MAX_PLAYBACK_TASKS_IN_QUEUE 2
+#define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+#define AUDIO_TESTING_MAX_DURATION_MS 10000
+#define MAX_TIMESTAMPS_IN_QUEUE 3
+#define MAX_TESTING_PACKETS_IN_QUEUE (AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS)
+#define OPUS_PACKET_RESERVE_BYTES 512
+
+// Ring capacities, rounded up to a power of two from the queue limits above.
+// The decode ring must also hold a full audio testing recording when it is played back.
+#define ENCODE_RING_CAPACITY 2
+#define PLAYBACK_RING_CAPACITY 2
+#define DECODE_RING_CAPACITY 256
+#define SEND_RING_CAPACITY 64
+#define TESTING_RING_CAPACITY 256
+#define TIMESTAMP_RING_CAPACITY 8
+
+enum AudioTaskType {
+    kAudioTaskTypeEncodeToSendQueue,
+    kAudioTaskTypeEncodeToTestingQueue,
+    kAudioTaskTypeDecodeToPlaybackQueue,
+};
+
+struct AudioTask {
+    AudioTaskType type;
+    std::vector<int16_t> pcm;
+    uint32_t timestamp;
+};
+
+struct DebugStatistics {
+    uint32_t input_count = 0;
+    uint32_t decode_count = 0;
+    uint32_t encode_count = 0;
+    uint32_t playback_count = 0;
+};
+
+enum AudioPipelineStage {
+    kAudioStageDecodeQueue,     // Opus packet waiting in the decode queue
+    kAudioStageDecode,          // Opus decode + output resample
+    kAudioStagePlaybackQueue,   // PCM waiting in the playback queue
+    kAudioStageOutput,          // Codec write
+    kAudioStageEncodeQueue,     // PCM waiting in the encode queue
+    kAudioStageEncode,          // Opus encode
+    kAudioStageSendQueue,       // Opus packet waiting to be sent
+    kAudioStageCount,
+};
+
+// Keeps the most recent latency samples of one stage and answers percentile queries
+class AudioLatencyRecorder {
+public:
+    void Record(uint32_t us);
+    uint32_t Percentile(int percent) const;
+    uint32_t count() const { return count_; }
+    uint32_t max() const { return max_; }
+    void Reset();
+
+private:
+    static constexpr size_t kWindow = 256;
+    std::array<uint32_t, kWindow> samples_ = {};
+    size_t next_ = 0;
+    uint32_t count_ = 0;
+    uint32_t max_ = 0;
+};
+
+struct AudioStageReport {
+    uint32_t count = 0;
+    uint32_t p50_us = 0;
+    uint32_t p90_us = 0;
+    uint32_t p99_us = 0;
+    uint32_t max_us = 0;
+};
+
+struct AudioPipelineReport {
+    std::array<AudioStageReport, kAudioStageCount> stages;
+    uint32_t elapsed_ms = 0;
+    float decode_fps = 0;
+    float encode_fps = 0;
+    float playback_fps = 0;
+    size_t peak_decode_queue = 0;
+    size_t peak_playback_queue = 0;
+    size_t peak_encode_queue = 0;
+    size_t peak_send_queue = 0;
+    uint32_t dropped = 0;           // Frames lost to a full queue
+
+    std::string ToString() const;
+};
+
+struct AudioPipelineCodec {
+    // Decode one Opus packet into PCM at the output sample rate
+    std::function<bool(AudioStreamPacket& packet, std::vector<int16_t>& pcm)> decode;
+    // Encode one frame of 16kHz PCM into an Opus packet
+    std::function<bool(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus)> encode;
+    // Play one frame of PCM
+    std::function<void(std::vector<int16_t>& pcm)> output;
+};
+
+class AudioPipeline {
+public:
+    void SetCodec(const AudioPipelineCodec& codec) { codec_ = codec; }
+    void OnSendQueueAvailable(std::function<void()> callback) { on_send_queue_available_ = callback; }
+
+    void Start();
+    // Wakes every loop so it can return, and drops all pending audio
+    void Stop();
+    bool stopped() const { return stopped_; }
+
+    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    bool PushPacketToDecodeQueue(AudioStreamPacketPtr packet, bool wait = false);
+    AudioStreamPacketPtr PopPacketFromSendQueue();
+    size_t GetTestingQueueSize();
+    void MoveTestingQueueToDecodeQueue();
+    void ResetDecodeQueues();
+    bool IsIdle();
+
+    // Blocking loops, each must run on its own task until Stop() is called
+    void RunCodecLoop();
+    void RunOutputLoop();
+
+    DebugStatistics& debug_statistics() { return debug_statistics_; }
+    AudioPipelineReport GetReport();
+    void ResetReport();
+
+private:
+    template <typename T>
+    struct Queued {
+        std::unique_ptr<T, AudioFrameDeleter> item;
+        int64_t enqueued_us = 0;
+    };
+
+    AudioPipelineCodec codec_;
+    std::function<void()> on_send_queue_available_;
+    DebugStatistics debug_statistics_;
+    std::atomic<bool> stopped_{true};
+
+    /*
+     * Each ring has exactly one consumer. The encode and decode rings have several
+     * producers (AFE task / input task, network task / PlaySound), those serialize on a
+     * producer-only mutex that the consumer never touches.
+     */
+    SpscRing<Queued<AudioStreamPacket>, DECODE_RING_CAPACITY> decode_ring_;
+    SpscRing<Queued<AudioStreamPacket>, SEND_RING_CAPACITY> send_ring_;
+    SpscRing<Queued<AudioStreamPacket>, TESTING_RING_CAPACITY> testing_ring_;
+    SpscRing<Queued<AudioTask>, ENCODE_RING_CAPACITY> encode_ring_;
+    SpscRing<Queued<AudioTask>, PLAYBACK_RING_CAPACITY> playback_ring_;
+    // For server AEC
+    SpscRing<uint32_t, TIMESTAMP_RING_CAPACITY> timestamp_ring_;
+    std::mutex decode_producer_mutex_;
+    std::mutex encode_producer_mutex_;
+
+    RingWakeup codec_wakeup_;         // decode/encode pushed, playback/send popped
+    RingWakeup output_wakeup_;        // playback pushed
+    RingWakeup decode_space_wakeup_;  // decode popped
+    RingWakeup encode_space_wakeup_;  // encode popped
+
+    std::mutex stats_mutex_;
+    std::array<AudioLatencyRecorder, kAudioStageCount> latency_;
+    int64_t stats_start_us_ = 0;
+    std::atomic<uint32_t> stats_decoded_{0};
+    std::atomic<uint32_t> stats_encoded_{0};
+    std::atomic<uint32_t> stats_played_{0};
+    std::atomic<uint32_t> stats_dropped_{0};
+    std::atomic<size_t> peak_decode_queue_{0};
+    std::atomic<size_t> peak_playback_queue_{0};
+    std::atomic<size_t> peak_encode_queue_{0};
+    std::atomic<size_t> peak_send_queue_{0};
+
+    static int64_t NowUs();
+    static void UpdatePeak(std::atomic<size_t>& peak, size_t depth);
+    void CountDrop(const char* queue);
+    void RecordLatency(AudioPipelineStage stage, int64_t start_us, int64_t end_us);
+    bool CodecHasWork() const;
+};
+
+#endif // AUDIO_PIPELINE_H
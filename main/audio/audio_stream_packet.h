@@ -0,0 +1,14 @@
+#ifndef AUDIO_STREAM_PACKET_H
+#define AUDIO_STREAM_PACKET_H
+
+#include <cstdint>
+#include <vector>
+
+struct AudioStreamPacket {
+    int sample_rate = 0;
+    int frame_duration = 0;
+    uint32_t timestamp = 0;
+    std::vector<uint8_t> payload;
+};
+
+#endif // AUDIO_STREAM_PACKET_H
@@ -0,0 +1,30 @@
+#include "audio_task_runner.h"
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define TAG "AudioTaskRunner"
+
+bool FreeRtosTaskRunner::Start(const char* name, uint32_t stack_size, int priority, int core, std::function<void()> entry) {
+    auto arg = new std::function<void()>(std::move(entry));
+    auto trampoline = [](void* arg) {
+        auto entry = static_cast<std::function<void()>*>(arg);
+        (*entry)();
+        delete entry;
+        vTaskDelete(NULL);
+    };
+
+    BaseType_t ret;
+    if (core >= 0) {
+        ret = xTaskCreatePinnedToCore(trampoline, name, stack_size, arg, priority, nullptr, core);
+    } else {
+        ret = xTaskCreate(trampoline, name, stack_size, arg, priority, nullptr);
+    }
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create task %s", name);
+        delete arg;
+        return false;
+    }
+    return true;
+}
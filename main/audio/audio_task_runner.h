@@ -0,0 +1,56 @@
+#ifndef AUDIO_TASK_RUNNER_H
+#define AUDIO_TASK_RUNNER_H
+
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/*
+ * Thin threading shim for the audio pipeline.
+ *
+ * AudioPipeline only exposes blocking loops (RunCodecLoop / RunOutputLoop), the runner
+ * decides where they execute: FreeRTOS tasks on the device, std::thread on a host.
+ * Priority and core are hints, the std::thread runner ignores them.
+ */
+class AudioTaskRunner {
+public:
+    virtual ~AudioTaskRunner() = default;
+
+    // core < 0 means no affinity
+    virtual bool Start(const char* name, uint32_t stack_size, int priority, int core, std::function<void()> entry) = 0;
+    // Block until every started task has returned (host only, FreeRTOS tasks delete themselves)
+    virtual void Join() {}
+};
+
+#ifdef ESP_PLATFORM
+class FreeRtosTaskRunner : public AudioTaskRunner {
+public:
+    bool Start(const char* name, uint32_t stack_size, int priority, int core, std::function<void()> entry) override;
+};
+#endif
+
+class StdThreadTaskRunner : public AudioTaskRunner {
+public:
+    ~StdThreadTaskRunner() override { Join(); }
+
+    // Name, stack, priority and core only mean something to FreeRTOS
+    bool Start(const char*, uint32_t, int, int, std::function<void()> entry) override {
+        threads_.emplace_back(std::move(entry));
+        return true;
+    }
+
+    void Join() override {
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        threads_.clear();
+    }
+
+private:
+    std::vector<std::thread> threads_;
+};
+
+#endif // AUDIO_TASK_RUNNER_H
@@ -0,0 +1,147 @@
+#include "icy_metadata.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <esp_log.h>
+
+#define TAG "IcyMetadata"
+
+// true if text is valid UTF-8 (ASCII included)
+static bool IsUtf8(const std::string& text) {
+    size_t i = 0;
+    while (i < text.size()) {
+        uint8_t c = (uint8_t)text[i];
+        int extra = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : -1;
+        if (extra < 0 || i + extra >= text.size()) {
+            return false;
+        }
+        for (int k = 1; k <= extra; k++) {
+            if (((uint8_t)text[i + k] & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += extra + 1;
+    }
+    return true;
+}
+
+static std::string Latin1ToUtf8(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() * 2);
+    for (char ch : text) {
+        uint8_t c = (uint8_t)ch;
+        if (c < 0x80) {
+            out += (char)c;
+        } else {
+            out += (char)(0xC0 | (c >> 6));
+            out += (char)(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
+}
+
+void IcyMetadataFilter::Reset(size_t metaint) {
+    metaint_ = metaint;
+    state_ = State::Audio;
+    remaining_ = metaint;
+    metadata_.clear();
+    title_.clear();
+    title_changed_ = false;
+}
+
+size_t IcyMetadataFilter::Filter(uint8_t* data, size_t length) {
+    if (metaint_ == 0) {
+        return length;
+    }
+
+    size_t in = 0;
+    size_t out = 0;
+    while (in < length) {
+        switch (state_) {
+        case State::Audio: {
+            size_t n = std::min(remaining_, length - in);
+            if (out != in) {
+                memmove(data + out, data + in, n);
+            }
+            in += n;
+            out += n;
+            remaining_ -= n;
+            if (remaining_ == 0) {
+                state_ = State::Length;
+            }
+            break;
+        }
+        case State::Length:
+            remaining_ = (size_t)data[in++] * 16;
+            if (remaining_ == 0) {
+                // Không có metadata mới
+                state_ = State::Audio;
+                remaining_ = metaint_;
+            } else {
+                state_ = State::Metadata;
+                metadata_.clear();
+            }
+            break;
+        case State::Metadata: {
+            size_t n = std::min(remaining_, length - in);
+            metadata_.append((const char*)data + in, n);
+            in += n;
+            remaining_ -= n;
+            if (remaining_ == 0) {
+                ParseMetadata();
+                state_ = State::Audio;
+                remaining_ = metaint_;
+            }
+            break;
+        }
+        }
+    }
+    return out;
+}
+
+bool IcyMetadataFilter::TakeTitle(std::string& title) {
+    if (!title_changed_) {
+        return false;
+    }
+    title_changed_ = false;
+    title = title_;
+    return true;
+}
+
+void IcyMetadataFilter::ParseMetadata() {
+    // Phần đệm NUL ở cuối block
+    size_t end = metadata_.find('\0');
+    if (end != std::string::npos) {
+        metadata_.resize(end);
+    }
+
+    static const char kKey[] = "StreamTitle='";
+    size_t begin = metadata_.find(kKey);
+    if (begin == std::string::npos) {
+        return;
+    }
+    begin += sizeof(kKey) - 1;
+    // Tên bài có thể chứa dấu ', giá trị kết thúc bằng "';"
+    size_t stop = metadata_.find("';", begin);
+    if (stop == std::string::npos) {
+        stop = metadata_.rfind('\'');
+        if (stop == std::string::npos || stop < begin) {
+            stop = metadata_.size();
+        }
+    }
+
+    std::string title = metadata_.substr(begin, stop - begin);
+    while (!title.empty() && (title.back() == ' ' || title.back() == '-')) {
+        title.pop_back();
+    }
+    if (!IsUtf8(title)) {
+        title = Latin1ToUtf8(title);
+    }
+    if (title != title_) {
+        title_ = title;
+        title_changed_ = true;
+        ESP_LOGI(TAG, "StreamTitle: %s", title_.c_str());
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef ICY_METADATA_H
+#define ICY_METADATA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Strips ICY (SHOUTcast / Icecast) metadata blocks from a stream body.
+ *
+ * With "Icy-MetaData: 1" in the request the server answers with an icy-metaint header and
+ * inserts a metadata block after every metaint audio bytes: one length byte (x16) followed
+ * by that many bytes of "StreamTitle='...';StreamUrl='...';" padded with NULs.
+ *
+ * Filter() removes the blocks in place, so the downloader can run it over the bytes it
+ * just read into the jitter ring before committing them. Blocks may be split across any
+ * number of reads. StreamTitle is converted to UTF-8 when the server sends Latin-1.
+ */
+class IcyMetadataFilter {
+public:
+    static constexpr size_t kMaxMetadataBytes = 255 * 16;
+
+    // metaint 0: the stream carries no metadata and Filter() passes everything through
+    void Reset(size_t metaint);
+
+    // Removes metadata from data, returns the number of audio bytes left at its start
+    size_t Filter(uint8_t* data, size_t length);
+
+    // Returns true once for each new title
+    bool TakeTitle(std::string& title);
+
+    size_t metaint() const { return metaint_; }
+    const std::string& title() const { return title_; }
+
+private:
+    enum class State : uint8_t {
+        Audio,
+        Length,
+        Metadata,
+    };
+
+    size_t metaint_ = 0;
+    State state_ = State::Audio;
+    size_t remaining_ = 0;           // Audio bytes before the next length byte, or metadata bytes left
+    std::string metadata_;
+    std::string title_;
+    bool title_changed_ = false;
+
+    void ParseMetadata();
+};
+
+#endif // ICY_METADATA_H
@@ -0,0 +1,135 @@
+#include "pcm_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <esp_log.h>
+
+#define TAG "PcmResampler"
+
+// Pass band edge as a fraction of the lower Nyquist frequency, and the Kaiser window shape
+#define RESAMPLER_PASSBAND 0.90
+#define RESAMPLER_KAISER_BETA 7.0
+
+// Zeroth order modified Bessel function of the first kind, for the Kaiser window
+static double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+bool PcmResampler::Configure(int in_rate, int out_rate) {
+    if (in_rate <= 0 || out_rate <= 0) {
+        ESP_LOGE(TAG, "Invalid sample rates: %d -> %d", in_rate, out_rate);
+        in_rate_ = out_rate_ = 0;
+        return false;
+    }
+    if (in_rate == in_rate_ && out_rate == out_rate_) {
+        return true;
+    }
+
+    in_rate_ = in_rate;
+    out_rate_ = out_rate;
+    if (in_rate_ == out_rate_) {
+        taps_ = 0;
+        coefficients_.clear();
+    } else {
+        // Downsampling lowers the cutoff, keep the same transition band in output samples
+        int widen = (in_rate_ + out_rate_ - 1) / out_rate_;
+        taps_ = kBaseTaps * std::max(widen, 1);
+        BuildCoefficients();
+        ESP_LOGI(TAG, "Configured %d -> %d Hz, %d taps x %d phases", in_rate_, out_rate_, taps_, kPhases);
+    }
+    Reset();
+    return true;
+}
+
+void PcmResampler::BuildCoefficients() {
+    const double cutoff = 0.5 * RESAMPLER_PASSBAND * std::min(1.0, (double)out_rate_ / in_rate_);
+    const int half = taps_ / 2;
+    const double window_norm = BesselI0(RESAMPLER_KAISER_BETA);
+
+    coefficients_.resize((kPhases + 1) * taps_);
+    std::vector<double> row(taps_);
+    for (int phase = 0; phase <= kPhases; phase++) {
+        double offset = (double)phase / kPhases;
+        double sum = 0;
+        for (int k = 0; k < taps_; k++) {
+            // Distance from the output instant, which lies between taps half - 1 and half
+            double x = k - (half - 1) - offset;
+            double t = x / half;
+            double window = (t * t < 1.0) ? BesselI0(RESAMPLER_KAISER_BETA * std::sqrt(1.0 - t * t)) / window_norm : 0.0;
+            double arg = 2.0 * cutoff * x;
+            double sinc = (std::fabs(arg) < 1e-9) ? 1.0 : std::sin(M_PI * arg) / (M_PI * arg);
+            row[k] = 2.0 * cutoff * sinc * window;
+            sum += row[k];
+        }
+        // Unity DC gain on every phase, so a constant input stays constant
+        int16_t* dest = &coefficients_[phase * taps_];
+        for (int k = 0; k < taps_; k++) {
+            long value = std::lround(row[k] / sum * 32768.0);
+            dest[k] = (int16_t)std::clamp(value, -32768L, 32767L);
+        }
+    }
+}
+
+void PcmResampler::Reset() {
+    // Prime with silence so the first output lines up with the first input sample
+    history_.assign(taps_ > 0 ? taps_ / 2 - 1 : 0, 0);
+    position_ = 0;
+    fraction_ = 0;
+}
+
+size_t PcmResampler::GetOutputSamples(size_t in_samples) const {
+    if (in_rate_ <= 0 || in_rate_ == out_rate_) {
+        return in_samples;
+    }
+    return (uint64_t)(in_samples + taps_) * out_rate_ / in_rate_ + 1;
+}
+
+void PcmResampler::Process(std::span<const int16_t> in, std::vector<int16_t>& out) {
+    if (in_rate_ <= 0) {
+        return;
+    }
+    if (in_rate_ == out_rate_) {
+        out.insert(out.end(), in.begin(), in.end());
+        return;
+    }
+
+    out.reserve(out.size() + GetOutputSamples(in.size()));
+    history_.insert(history_.end(), in.begin(), in.end());
+
+    const size_t taps = taps_;
+    const int16_t* samples = history_.data();
+    while (position_ + taps <= history_.size()) {
+        uint32_t phase = (fraction_ * kPhases + out_rate_ / 2) / out_rate_;
+        const int16_t* coefficients = &coefficients_[phase * taps];
+        const int16_t* x = samples + position_;
+
+        // Every phase sums to 32768 and its absolute sum stays far below 65536, so int32 cannot overflow
+        int32_t acc = 1 << 14;
+        for (size_t k = 0; k < taps; k++) {
+            acc += (int32_t)x[k] * coefficients[k];
+        }
+        acc >>= 15;
+        out.push_back((int16_t)std::clamp<int32_t>(acc, INT16_MIN, INT16_MAX));
+
+        fraction_ += in_rate_;
+        while (fraction_ >= (uint32_t)out_rate_) {
+            fraction_ -= out_rate_;
+            position_++;
+        }
+    }
+
+    // Keep the unread tail as history for the next block
+    history_.erase(history_.begin(), history_.begin() + position_);
+    position_ = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef PCM_RESAMPLER_H
+#define PCM_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * Streaming fixed-point polyphase resampler for mono 16-bit PCM.
+ *
+ * Each output sample is a Q15 FIR over the surrounding input samples, the filter phase
+ * being picked from a table of kPhases sub-sample offsets. The read position advances
+ * by exactly in_rate / out_rate per output sample using an integer accumulator, so any
+ * rate pair (22050 -> 24000, 44100 -> 48000, 48000 -> 16000, ...) keeps its length
+ * without drift. The tail of every input block is kept for the next Process() call, so
+ * frame boundaries are seamless.
+ *
+ * The coefficient table only depends on the rate pair, it is built once in Configure()
+ * and reused until the rates change.
+ */
+class PcmResampler {
+public:
+    // Returns false for invalid rates, the resampler is left unconfigured
+    bool Configure(int in_rate, int out_rate);
+    // Drop the stream history, e.g. when a new track starts
+    void Reset();
+
+    // Appends the resampled block to out, out is not cleared
+    void Process(std::span<const int16_t> in, std::vector<int16_t>& out);
+    // Upper bound of the samples Process() appends for the given input length
+    size_t GetOutputSamples(size_t in_samples) const;
+
+    int in_rate() const { return in_rate_; }
+    int out_rate() const { return out_rate_; }
+    int taps() const { return taps_; }
+
+private:
+    static constexpr int kPhases = 128;
+    // Taps per phase when upsampling, downsampling widens the filter by the rate ratio
+    static constexpr int kBaseTaps = 16;
+
+    int in_rate_ = 0;
+    int out_rate_ = 0;
+    int taps_ = 0;
+    // (kPhases + 1) rows of taps_ coefficients, the last row is a full-sample offset
+    std::vector<int16_t> coefficients_;
+
+    // History + pending input, position of the next output's first tap and its sub-sample offset
+    std::vector<int16_t> history_;
+    size_t position_ = 0;
+    uint32_t fraction_ = 0;  // In units of 1 / out_rate_ input samples
+
+    void BuildCoefficients();
+};
+
+#endif // PCM_RESAMPLER_H
@@ -0,0 +1,160 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+/*
+ * Fixed-capacity single-producer / single-consumer ring.
+ *
+ * Slots are preallocated inline, Push/Pop never allocate and never lock. Indices grow
+ * monotonically and are masked on access, so Capacity must be a power of two.
+ *
+ * Flush() may be called from any thread: it only records the producer index at the time
+ * of the call. Everything below that mark is dead: Pop() skips it, size() and empty()
+ * no longer count it, and Push() reuses those slots even if the consumer has not run
+ * since. Packets pushed after the flush are kept.
+ *
+ * Flushed slots are never touched by the consumer, only by the producer, so the two
+ * can not both reclaim the same slot. The producer only reclaims while the consumer is
+ * outside Pop() (consuming_ is clear), which orders against the consumer reading the
+ * mark: any Pop() that starts later already sees it and skips past those slots.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Producer side, false when the ring is full
+    bool Push(T&& value) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        for (int attempt = 0; head - tail_.load(std::memory_order_acquire) >= Capacity; attempt++) {
+            if (!ReclaimFlushed(attempt)) {
+                return false;
+            }
+        }
+        slots_[head & (Capacity - 1)] = std::move(value);
+        head_.store(head + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Consumer side
+    bool Pop(T& value) {
+        consuming_.store(true, std::memory_order_seq_cst);
+        uint32_t tail = tail_.load(std::memory_order_seq_cst);
+        uint32_t mark = flush_mark_.load(std::memory_order_seq_cst);
+        if (static_cast<int32_t>(mark - tail) > 0) {
+            // Flushed slots are left to the producer, it overwrites or clears them
+            tail = mark;
+        }
+        bool popped = tail != head_.load(std::memory_order_acquire);
+        if (popped) {
+            value = std::move(slots_[tail & (Capacity - 1)]);
+            tail++;
+        }
+        tail_.store(tail, std::memory_order_seq_cst);
+        consuming_.store(false, std::memory_order_seq_cst);
+        return popped;
+    }
+
+    // Any thread
+    void Flush() {
+        flush_mark_.store(head_.load(std::memory_order_acquire), std::memory_order_seq_cst);
+    }
+
+    // Any thread, exact when called from the producer or the consumer
+    size_t size() const {
+        uint32_t head = head_.load(std::memory_order_acquire);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t mark = flush_mark_.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(mark - tail) > 0) {
+            tail = mark;
+        }
+        return head - tail;
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= Capacity; }
+
+private:
+    std::array<T, Capacity> slots_ = {};
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    std::atomic<uint32_t> flush_mark_{0};
+    std::atomic<bool> consuming_{false};
+
+    /*
+     * Producer side, called when the ring looks full. Frees the slots below the flush mark
+     * that the consumer has not skipped yet. Returns false if nothing was flushed (the ring
+     * really is full), true when the caller should check for space again.
+     */
+    bool ReclaimFlushed(int attempt) {
+        // Order matters: mark, then consuming_, then tail_ (see the class comment)
+        uint32_t mark = flush_mark_.load(std::memory_order_seq_cst);
+        if (static_cast<int32_t>(mark - tail_.load(std::memory_order_seq_cst)) <= 0) {
+            return false;
+        }
+        if (consuming_.load(std::memory_order_seq_cst)) {
+            // The consumer is inside Pop(), it frees at least one slot on its way out.
+            // Retry a few times, then sleep so a lower priority consumer gets to run.
+            if (attempt < 16) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return true;
+        }
+        uint32_t tail = tail_.load(std::memory_order_seq_cst);
+        if (static_cast<int32_t>(mark - tail) <= 0) {
+            return true;
+        }
+        for (uint32_t i = tail; static_cast<int32_t>(mark - i) > 0; i++) {
+            slots_[i & (Capacity - 1)] = T();
+        }
+        // Fails only if a Pop() that saw the mark already moved tail_ to (or past) it
+        tail_.compare_exchange_strong(tail, mark, std::memory_order_seq_cst);
+        return true;
+    }
+};
+
+/*
+ * Wakeup for one waiting side of a ring. Notify() only takes the mutex when somebody is
+ * actually sleeping, so the common non-blocking path stays lock free.
+ */
+class RingWakeup {
+public:
+    void Notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_all();
+        }
+    }
+
+    template <typename Predicate>
+    void Wait(Predicate ready) {
+        while (!ready()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            waiters_.fetch_add(1, std::memory_order_seq_cst);
+            if (!ready()) {
+                cv_.wait(lock);
+            }
+            waiters_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<int> waiters_{0};
+};
+
+#endif // SPSC_RING_H
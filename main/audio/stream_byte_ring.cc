@@ -0,0 +1,88 @@
+#include "stream_byte_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+
+#define TAG "StreamByteRing"
+
+StreamByteRing::~StreamByteRing() {
+    Release();
+}
+
+bool StreamByteRing::Allocate(size_t capacity, size_t guard) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || guard > capacity) {
+        ESP_LOGE(TAG, "Invalid ring size %u + %u", (unsigned)capacity, (unsigned)guard);
+        return false;
+    }
+    if (storage_ != nullptr && capacity_ == capacity && guard_ == guard) {
+        Reset();
+        return true;
+    }
+
+    Release();
+    storage_ = (uint8_t*)heap_caps_malloc(capacity + guard, MALLOC_CAP_SPIRAM);
+    if (storage_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes", (unsigned)(capacity + guard));
+        return false;
+    }
+    capacity_ = capacity;
+    guard_ = guard;
+    Reset();
+    return true;
+}
+
+void StreamByteRing::Release() {
+    if (storage_ != nullptr) {
+        heap_caps_free(storage_);
+        storage_ = nullptr;
+    }
+    capacity_ = 0;
+    guard_ = 0;
+    Reset();
+}
+
+void StreamByteRing::Reset() {
+    head_.store(0, std::memory_order_release);
+    tail_.store(0, std::memory_order_release);
+}
+
+uint8_t* StreamByteRing::WriteSpan(size_t& length) {
+    length = 0;
+    if (storage_ == nullptr) {
+        return nullptr;
+    }
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t offset = head & (capacity_ - 1);
+    length = std::min(free_space(), capacity_ - offset);
+    return storage_ + offset;
+}
+
+void StreamByteRing::CommitWrite(size_t length) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t offset = head & (capacity_ - 1);
+    if (offset < guard_) {
+        // Keep the guard area behind the end identical to the start of the ring
+        size_t mirrored = std::min(length, guard_ - offset);
+        memcpy(storage_ + capacity_ + offset, storage_ + offset, mirrored);
+    }
+    head_.store(head + length, std::memory_order_release);
+}
+
+uint8_t* StreamByteRing::ReadSpan(size_t& length) {
+    length = 0;
+    if (storage_ == nullptr) {
+        return nullptr;
+    }
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t offset = tail & (capacity_ - 1);
+    length = std::min(size(), capacity_ + guard_ - offset);
+    return storage_ + offset;
+}
+
+void StreamByteRing::Consume(size_t length) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    tail_.store(tail + std::min(length, size()), std::memory_order_release);
+}
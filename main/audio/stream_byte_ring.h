@@ -0,0 +1,62 @@
+#ifndef STREAM_BYTE_RING_H
+#define STREAM_BYTE_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Single-producer / single-consumer byte ring for compressed audio streams.
+ *
+ * The producer asks for the contiguous free span (WriteSpan), fills it directly, e.g. with
+ * Http::Read, and publishes it with CommitWrite. The consumer gets the contiguous readable
+ * span (ReadSpan), hands it to the decoder in place and releases what was decoded with
+ * Consume. Nothing is copied in between.
+ *
+ * The storage is one allocation of capacity + guard bytes. Bytes written at the start of
+ * the ring are mirrored into the guard area behind its end, so a read that starts close to
+ * the end still sees at least min(size(), guard) contiguous bytes and a compressed frame
+ * never has to be reassembled across the wrap.
+ *
+ * Positions are free-running counters masked on access, the capacity must be a power of
+ * two. Reset() must only be called while neither side is running.
+ */
+class StreamByteRing {
+public:
+    StreamByteRing() = default;
+    ~StreamByteRing();
+    StreamByteRing(const StreamByteRing&) = delete;
+    StreamByteRing& operator=(const StreamByteRing&) = delete;
+
+    // Allocates the storage once (PSRAM on the device); false on invalid sizes or no memory
+    bool Allocate(size_t capacity, size_t guard);
+    void Release();
+    void Reset();
+
+    bool allocated() const { return storage_ != nullptr; }
+    size_t capacity() const { return capacity_; }
+    size_t guard() const { return guard_; }
+    size_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+    size_t free_space() const { return capacity_ - size(); }
+
+    // Producer side
+    uint8_t* WriteSpan(size_t& length);
+    void CommitWrite(size_t length);
+
+    // Consumer side
+    uint8_t* ReadSpan(size_t& length);
+    void Consume(size_t length);
+
+    // Bytes produced / consumed since the last Reset()
+    size_t total_written() const { return head_.load(std::memory_order_acquire); }
+    size_t total_read() const { return tail_.load(std::memory_order_acquire); }
+
+private:
+    uint8_t* storage_ = nullptr;
+    size_t capacity_ = 0;
+    size_t guard_ = 0;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+};
+
+#endif // STREAM_BYTE_RING_H
@@ -0,0 +1,72 @@
+#include "stream_preroll.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Byte rate được đo lại sau mỗi ~2 s audio đã giải mã
+static constexpr uint32_t kRateWindowMs = 2000;
+
+StreamPreroll::StreamPreroll(size_t min_bytes, size_t max_bytes)
+    : min_bytes_(min_bytes), max_bytes_(std::max(min_bytes, max_bytes)) {
+}
+
+void StreamPreroll::Reset() {
+    byte_rate_ = kDefaultByteRate;
+    rate_measured_ = false;
+    peak_late_ms_ = 0.0f;
+    peak_time_us_ = 0;
+    decoded_bytes_ = 0;
+    decoded_frames_ = 0;
+    decoded_rate_ = 0;
+}
+
+void StreamPreroll::OnRead(size_t bytes, int64_t wait_us, int64_t now_us) {
+    if (peak_time_us_ > 0 && now_us > peak_time_us_) {
+        float elapsed_ms = (float)(now_us - peak_time_us_) / 1000.0f;
+        peak_late_ms_ *= std::exp2(-elapsed_ms / (float)kPeakHalfLifeMs);
+    }
+    peak_time_us_ = now_us;
+
+    // Trước khi đo được byte rate, thời gian chờ của một read không nói lên gì
+    if (bytes > 0 && !rate_measured_) {
+        return;
+    }
+    int64_t expected_us = (int64_t)bytes * 1000000 / byte_rate_;
+    float late_ms = (float)(wait_us - expected_us) / 1000.0f;
+    peak_late_ms_ = std::max(peak_late_ms_, late_ms);
+}
+
+void StreamPreroll::OnDecoded(size_t bytes, uint32_t frames, int sample_rate) {
+    if (sample_rate <= 0 || frames == 0) {
+        return;
+    }
+    if (sample_rate != decoded_rate_) {
+        decoded_rate_ = sample_rate;
+        decoded_bytes_ = 0;
+        decoded_frames_ = 0;
+    }
+    decoded_bytes_ += bytes;
+    decoded_frames_ += frames;
+    if (decoded_frames_ < (uint64_t)sample_rate * kRateWindowMs / 1000) {
+        return;
+    }
+
+    uint32_t rate = (uint32_t)(decoded_bytes_ * (uint64_t)sample_rate / decoded_frames_);
+    if (rate > 0) {
+        // Lần đo đầu lấy luôn, sau đó làm mượt cho VBR
+        byte_rate_ = rate_measured_ ? (byte_rate_ * 3 + rate) / 4 : rate;
+        rate_measured_ = true;
+    }
+    decoded_bytes_ = 0;
+    decoded_frames_ = 0;
+}
+
+size_t StreamPreroll::target_bytes() const {
+    float ms = (float)kBaseMs + kJitterFactor * peak_late_ms_;
+    size_t bytes = (size_t)((float)byte_rate_ * ms / 1000.0f);
+    return std::min(std::max(bytes, min_bytes_), max_bytes_);
+}
+
+uint32_t StreamPreroll::BytesToMs(size_t bytes) const {
+    return (uint32_t)((uint64_t)bytes * 1000 / byte_rate_);
+}
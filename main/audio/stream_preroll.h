@@ -0,0 +1,58 @@
+#ifndef STREAM_PREROLL_H
+#define STREAM_PREROLL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Pre-roll size of a live stream, from its measured bitrate and arrival jitter.
+ *
+ * OnRead() is fed every network read with the time it blocked. The part of that wait
+ * beyond what the bytes are worth at the stream's byte rate is lateness; its peak is kept
+ * and decays with a half-life of kPeakHalfLifeMs, so a stall or a reconnect raises the
+ * pre-roll for a while and it shrinks back while the connection stays smooth.
+ * OnDecoded() measures the byte rate from what the decoder consumed per second of PCM;
+ * until the first frame kDefaultByteRate (128 kbps) is assumed.
+ *
+ *   target_bytes() = byte_rate * (kBaseMs + kJitterFactor * peak_late_ms)
+ *
+ * clamped to [min_bytes, max_bytes]. Not thread safe, the caller serializes access.
+ */
+class StreamPreroll {
+public:
+    static constexpr uint32_t kDefaultByteRate = 16000;
+    static constexpr uint32_t kBaseMs = 1500;
+    static constexpr float kJitterFactor = 1.5f;
+    static constexpr uint32_t kPeakHalfLifeMs = 60000;
+
+    StreamPreroll(size_t min_bytes, size_t max_bytes);
+
+    void Reset();
+
+    // A network read returned bytes after blocking for wait_us, at now_us. An outage
+    // (reconnect) is reported as a read of 0 bytes that waited for its whole length
+    void OnRead(size_t bytes, int64_t wait_us, int64_t now_us);
+    // The decoder turned bytes of the stream into frames PCM frames at sample_rate
+    void OnDecoded(size_t bytes, uint32_t frames, int sample_rate);
+
+    size_t target_bytes() const;
+    uint32_t byte_rate() const { return byte_rate_; }
+    uint32_t jitter_ms() const { return (uint32_t)peak_late_ms_; }
+    // Playback time held by buffered bytes at the measured byte rate
+    uint32_t BytesToMs(size_t bytes) const;
+
+private:
+    size_t min_bytes_;
+    size_t max_bytes_;
+    uint32_t byte_rate_ = kDefaultByteRate;
+    bool rate_measured_ = false;
+    float peak_late_ms_ = 0.0f;
+    int64_t peak_time_us_ = 0;
+
+    // Cửa sổ đo byte rate phía decoder
+    uint64_t decoded_bytes_ = 0;
+    uint64_t decoded_frames_ = 0;
+    int decoded_rate_ = 0;
+};
+
+#endif // STREAM_PREROLL_H
@@ -0,0 +1,39 @@
+#include "stream_reconnect.h"
+
+#include <algorithm>
+
+StreamReconnect::StreamReconnect(int max_attempts, int base_ms, int max_ms)
+    : max_attempts_(max_attempts), base_ms_(base_ms), max_ms_(std::max(base_ms, max_ms)) {
+}
+
+void StreamReconnect::Reset() {
+    attempt_ = 0;
+    received_audio_ = false;
+    outage_start_us_ = -1;
+    outage_us_ = 0;
+    reconnects_ = 0;
+}
+
+int StreamReconnect::OnFailure(int64_t now_us) {
+    // Lỗi trước khi từng nhận được audio chỉ là kết nối ban đầu thất bại, không phải mất sóng
+    if (received_audio_ && outage_start_us_ < 0) {
+        outage_start_us_ = now_us;
+    }
+    if (++attempt_ > max_attempts_) {
+        return -1;
+    }
+    int64_t delay_ms = (int64_t)base_ms_ << std::min(attempt_ - 1, 16);
+    return (int)std::min<int64_t>(delay_ms, max_ms_);
+}
+
+bool StreamReconnect::OnAudio(int64_t now_us) {
+    attempt_ = 0;
+    received_audio_ = true;
+    if (outage_start_us_ < 0) {
+        return false;
+    }
+    outage_us_ = std::max<int64_t>(now_us - outage_start_us_, 0);
+    outage_start_us_ = -1;
+    reconnects_++;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef STREAM_RECONNECT_H
+#define STREAM_RECONNECT_H
+
+#include <cstdint>
+
+/*
+ * Reconnect policy of a live stream download.
+ *
+ * A failed attempt is either a connection that could not be opened or one that ended
+ * (server closed, network timeout). Both back off before the next attempt, with a delay
+ * doubling from base_ms up to max_ms, and the download gives up after max_attempts in a
+ * row. Only a connection that delivers audio resets the count: a server that accepts the
+ * connection and closes it at once (an Icecast mount with no source, a proxy) is backed
+ * off and given up on like one that refuses it.
+ *
+ * An outage starts at the first failure after audio was received and ends with the first
+ * audio of a later connection, which is what counts as a reconnect. Not thread safe.
+ */
+class StreamReconnect {
+public:
+    StreamReconnect(int max_attempts, int base_ms, int max_ms);
+
+    void Reset();
+
+    // An attempt failed at now_us. Returns the delay before the next one in ms, -1 to give up
+    int OnFailure(int64_t now_us);
+    // The current connection delivered audio. True if that ended an outage, whose length
+    // is then in outage_us()
+    bool OnAudio(int64_t now_us);
+
+    int attempt() const { return attempt_; }
+    int max_attempts() const { return max_attempts_; }
+    int64_t outage_us() const { return outage_us_; }
+    uint32_t reconnects() const { return reconnects_; }
+
+private:
+    int max_attempts_;
+    int base_ms_;
+    int max_ms_;
+    int attempt_ = 0;                // Failed attempts since the last audio
+    bool received_audio_ = false;
+    int64_t outage_start_us_ = -1;   // >= 0 during an outage
+    int64_t outage_us_ = 0;
+    uint32_t reconnects_ = 0;
+};
+
+#endif // STREAM_RECONNECT_H
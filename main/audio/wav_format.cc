@@ -0,0 +1,215 @@
+#include "wav_format.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_log.h>
+
+#define TAG "WavFormat"
+
+static constexpr uint16_t kFormatPcm = 0x0001;
+static constexpr uint16_t kFormatFloat = 0x0003;
+static constexpr uint16_t kFormatExtensible = 0xFFFE;
+static constexpr int kMaxChannels = 8;
+
+static inline uint16_t Le16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t Le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool WavFormat::Parse(FILE* fp, int64_t file_size)
+{
+    *this = WavFormat();
+    if (!fp || fseek(fp, 0, SEEK_SET) != 0) return false;
+
+    uint8_t riff[12];
+    if (fread(riff, 1, sizeof(riff), fp) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    bool have_fmt = false;
+    int64_t pos = sizeof(riff);
+    while (true) {
+        uint8_t chunk[8];
+        if (fseek(fp, (long)pos, SEEK_SET) != 0 || fread(chunk, 1, sizeof(chunk), fp) != sizeof(chunk)) {
+            return false;  // Hết file mà chưa thấy "data"
+        }
+        uint32_t size = Le32(chunk + 4);
+        pos += sizeof(chunk);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[40] = {};
+            size_t n = std::min<size_t>(size, sizeof(fmt));
+            if (size < 16 || fread(fmt, 1, n, fp) != n) {
+                return false;
+            }
+
+            uint16_t tag = Le16(fmt);
+            if (tag == kFormatExtensible && size >= 40) {
+                // SubFormat GUID: 2 byte đầu là mã định dạng thật
+                tag = Le16(fmt + 24);
+            }
+            channels        = Le16(fmt + 2);
+            sample_rate     = (int)Le32(fmt + 4);
+            block_align     = Le16(fmt + 12);
+            bits_per_sample = Le16(fmt + 14);
+
+            if (tag == kFormatPcm &&
+                (bits_per_sample == 8 || bits_per_sample == 16 || bits_per_sample == 24 || bits_per_sample == 32)) {
+                encoding = Encoding::Pcm;
+            } else if (tag == kFormatFloat && bits_per_sample == 32) {
+                encoding = Encoding::Float;
+            } else {
+                ESP_LOGW(TAG, "Unsupported format 0x%04x, %d bit", tag, bits_per_sample);
+                return false;
+            }
+            if (channels < 1 || channels > kMaxChannels || sample_rate <= 0 ||
+                block_align != channels * bits_per_sample / 8) {
+                ESP_LOGW(TAG, "Invalid fmt: %d ch, %d Hz, block %d", channels, sample_rate, block_align);
+                return false;
+            }
+            have_fmt = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!have_fmt) {
+                ESP_LOGW(TAG, "data chunk before fmt");
+                return false;
+            }
+            data_offset = pos;
+            data_size = size;
+            if (file_size > 0 && data_offset >= file_size) {
+                ESP_LOGW(TAG, "data chunk at %lld beyond file size %lld", (long long)data_offset, (long long)file_size);
+                return false;
+            }
+            // Bản ghi dở dang / streaming để size 0 hoặc 0xFFFFFFFF
+            if (file_size > 0 && (data_size == 0 || data_offset + data_size > file_size)) {
+                data_size = file_size - data_offset;
+            }
+            data_size -= data_size % block_align;
+            return fseek(fp, (long)data_offset, SEEK_SET) == 0;
+        }
+
+        // LIST, fact, bext, JUNK, ... được bỏ qua; chunk có độ dài lẻ được đệm 1 byte
+        pos += size + (size & 1);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Conversion kernels: sample → int16, channels summed in int32 and divided once per frame
+// ---------------------------------------------------------------------------
+
+struct U8Sample {
+    static constexpr int kBytes = 1;
+    static inline int32_t Load(const uint8_t* p) { return ((int32_t)p[0] - 128) << 8; }
+};
+
+struct S16Sample {
+    static constexpr int kBytes = 2;
+    static inline int32_t Load(const uint8_t* p) { return (int16_t)Le16(p); }
+};
+
+struct S24Sample {
+    static constexpr int kBytes = 3;
+    // 8 bit thấp bị bỏ: lấy 2 byte cao
+    static inline int32_t Load(const uint8_t* p) { return (int16_t)(p[1] | (p[2] << 8)); }
+};
+
+struct S32Sample {
+    static constexpr int kBytes = 4;
+    static inline int32_t Load(const uint8_t* p) { return (int16_t)(p[2] | (p[3] << 8)); }
+};
+
+struct F32Sample {
+    static constexpr int kBytes = 4;
+    static inline int32_t Load(const uint8_t* p)
+    {
+        uint32_t bits = Le32(p);
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        float scaled = f * 32768.0f;
+        // NaN cũng rơi vào nhánh 0
+        if (!(scaled > -32768.0f)) return scaled <= -32768.0f ? -32768 : 0;
+        if (scaled > 32767.0f) return 32767;
+        return (int32_t)scaled;
+    }
+};
+
+template <typename Sample>
+static void ConvertMono(const uint8_t* in, size_t frames, int16_t* out)
+{
+    for (size_t i = 0; i < frames; i++) {
+        out[i] = (int16_t)Sample::Load(in);
+        in += Sample::kBytes;
+    }
+}
+
+template <typename Sample>
+static void ConvertStereo(const uint8_t* in, size_t frames, int16_t* out)
+{
+    for (size_t i = 0; i < frames; i++) {
+        int32_t l = Sample::Load(in);
+        int32_t r = Sample::Load(in + Sample::kBytes);
+        out[i] = (int16_t)((l + r) >> 1);
+        in += 2 * Sample::kBytes;
+    }
+}
+
+template <typename Sample>
+static void ConvertMulti(const uint8_t* in, size_t frames, int channels, int16_t* out)
+{
+    for (size_t i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += Sample::Load(in);
+            in += Sample::kBytes;
+        }
+        out[i] = (int16_t)(sum / channels);
+    }
+}
+
+template <typename Sample>
+static void Convert(const uint8_t* in, size_t frames, int channels, int16_t* out)
+{
+    if (channels == 1) {
+        ConvertMono<Sample>(in, frames, out);
+    } else if (channels == 2) {
+        ConvertStereo<Sample>(in, frames, out);
+    } else {
+        ConvertMulti<Sample>(in, frames, channels, out);
+    }
+}
+
+void WavFormat::ToMono(const uint8_t* in, size_t frame_count, int16_t* out) const
+{
+    if (encoding == Encoding::Float) {
+        Convert<F32Sample>(in, frame_count, channels, out);
+        return;
+    }
+    switch (bits_per_sample) {
+        case 8:
+            Convert<U8Sample>(in, frame_count, channels, out);
+            break;
+        case 16:
+            if (channels == 1) {
+                if ((const void*)in != (const void*)out) {
+                    memcpy(out, in, frame_count * sizeof(int16_t));
+                }
+            } else {
+                Convert<S16Sample>(in, frame_count, channels, out);
+            }
+            break;
+        case 24:
+            Convert<S24Sample>(in, frame_count, channels, out);
+            break;
+        case 32:
+            Convert<S32Sample>(in, frame_count, channels, out);
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef WAV_FORMAT_H
+#define WAV_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/*
+ * Format of a RIFF/WAVE file and conversion of its samples to mono int16.
+ *
+ * Parse() walks the chunk list instead of assuming the canonical 44-byte header, so
+ * LIST/fact/bext/JUNK chunks before or after "fmt " are skipped. Supported encodings are
+ * PCM 8 (unsigned), 16, 24 and 32 bit and IEEE float 32 bit, also when wrapped in
+ * WAVE_FORMAT_EXTENSIBLE, with 1 to 8 interleaved channels.
+ *
+ * ToMono() converts a block of whole frames and mixes the channels down in the same pass.
+ * Each (encoding, channel count) pair has its own loop, the format is only dispatched once
+ * per block.
+ */
+struct WavFormat {
+    enum class Encoding : uint8_t {
+        Pcm,
+        Float,
+    };
+
+    Encoding encoding = Encoding::Pcm;
+    int sample_rate = 0;
+    int channels = 0;
+    int bits_per_sample = 0;
+    int block_align = 0;         // Bytes per frame (all channels)
+    int64_t data_offset = 0;
+    int64_t data_size = 0;
+
+    // Reads the chunk headers of fp from its start and leaves fp at the first data byte.
+    // file_size (if known) clamps a missing or oversized data chunk length
+    bool Parse(FILE* fp, int64_t file_size);
+
+    // 16-bit mono/stereo files are played straight from the read block
+    bool is_pcm16() const { return encoding == Encoding::Pcm && bits_per_sample == 16; }
+    int64_t frames() const { return block_align > 0 ? data_size / block_align : 0; }
+    int64_t duration_ms() const { return sample_rate > 0 ? frames() * 1000 / sample_rate : 0; }
+
+    // Converts frame_count frames from in to mono int16 in out. in and out may be the same
+    // buffer when block_align >= 2, the output never overtakes the input
+    void ToMono(const uint8_t* in, size_t frame_count, int16_t* out) const;
+};
+
+#endif // WAV_FORMAT_H
@@ -5,6 +5,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 
@@ -361,6 +363,10 @@ Esp32Camera::Esp32Camera(const esp_video_init_config_t& config) {
 }
 
 Esp32Camera::~Esp32Camera() {
+    if (encoder_thread_.joinable()) {
+        encoder_thread_.join();
+    }
+    ReleaseFrame();
     if (streaming_on_ && video_fd_ >= 0) {
         int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
         ioctl(video_fd_, VIDIOC_STREAMOFF, &type);
@@ -383,6 +389,60 @@ void Esp32Camera::SetExplainUrl(const std::string& url, const std::string& token
     explain_token_ = token;
 }
 
+void Esp32Camera::ReleaseFrame() {
+    if (held_buffer_ >= 0) {
+        struct v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = held_buffer_;
+        if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
+            ESP_LOGE(TAG, "VIDIOC_QBUF failed for held buffer %d", held_buffer_);
+        }
+        held_buffer_ = -1;
+    } else if (frame_.data) {
+        heap_caps_free(frame_.data);
+    }
+    frame_.data = nullptr;
+    frame_.len = 0;
+    frame_.format = 0;
+}
+
+/**
+ * Giữ lại buffer V4L2 thay vì copy sang PSRAM khi frame không cần xử lý gì thêm
+ * (không xoay, không đổi byte order). Explain() mã hoá thẳng từ vùng mmap này; buffer
+ * được trả cho driver ở lần Capture() sau, khi encoder đã xong.
+ */
+bool Esp32Camera::UseMmapFrame(int index, size_t bytesused) {
+#if defined(CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP) || defined(CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE)
+    return false;
+#else
+    v4l2_pix_fmt_t format;
+    switch (sensor_format_) {
+        case V4L2_PIX_FMT_RGB565:
+        case V4L2_PIX_FMT_RGB24:
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_YUV420:
+        case V4L2_PIX_FMT_GREY:
+#ifdef CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
+        case V4L2_PIX_FMT_JPEG:
+#endif  // CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
+            format = sensor_format_;
+            break;
+        case V4L2_PIX_FMT_YUV422P:
+            // 这个格式是 422 YUYV，不是 planer
+            format = V4L2_PIX_FMT_YUYV;
+            break;
+        default:
+            return false;
+    }
+    frame_.data = (uint8_t*)mmap_buffers_[index].start;
+    frame_.len = MIN(bytesused, mmap_buffers_[index].length);
+    frame_.format = format;
+    held_buffer_ = index;
+    return true;
+#endif
+}
+
 bool Esp32Camera::Capture() {
     if (encoder_thread_.joinable()) {
         encoder_thread_.join();
@@ -392,6 +452,10 @@ bool Esp32Camera::Capture() {
         return false;
     }
 
+    // Trả buffer đang giữ trước khi DQBUF, thiết bị DVP chỉ có 1 buffer
+    ReleaseFrame();
+    auto capture_start = esp_timer_get_time();
+
     for (int i = 0; i < 3; i++) {
         struct v4l2_buffer buf = {};
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -401,12 +465,11 @@ bool Esp32Camera::Capture() {
             return false;
         }
         if (i == 2) {
-            // 保存帧副本到PSRAM
-            if (frame_.data) {
-                heap_caps_free(frame_.data);
-                frame_.data = nullptr;
-                frame_.format = 0;
+            if (UseMmapFrame(buf.index, buf.bytesused)) {
+                // 不 QBUF：buffer 由 frame_ 持有
+                break;
             }
+            // 保存帧副本到PSRAM
             frame_.len = buf.bytesused;
             frame_.data = (uint8_t*)heap_caps_malloc(frame_.len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
             if (!frame_.data) {
@@ -727,6 +790,8 @@ bool Esp32Camera::Capture() {
         }
     }
 
+    capture_ms_ = (uint32_t)((esp_timer_get_time() - capture_start) / 1000);
+
     // 显示预览图片
     auto display = dynamic_cast<LvglDisplay*>(Board::GetInstance().GetDisplay());
     if (display != nullptr) {
@@ -872,6 +937,104 @@ bool Esp32Camera::SetVFlip(bool enabled) {
     return true;
 }
 
+#if CONFIG_XIAOZHI_CAMERA_EXPLAIN_MAX_WIDTH > 0
+/**
+ * 按整数倍 factor 缩小图像，每个输出像素取 factor x factor 个源像素的平均值 (box filter)。
+ * 输出 16 字节对齐，编码器可直接使用。不支持的格式返回 nullptr，调用者按原尺寸发送。
+ */
+static uint8_t* box_downscale(const uint8_t* src, uint16_t width, uint16_t height, v4l2_pix_fmt_t format, int factor,
+                              uint16_t* out_width, uint16_t* out_height, size_t* out_len) {
+    int ow = width / factor;
+    int oh = height / factor;
+    int bpp;
+    switch (format) {
+        case V4L2_PIX_FMT_GREY:
+            bpp = 1;
+            break;
+        case V4L2_PIX_FMT_RGB565:
+            bpp = 2;
+            break;
+        case V4L2_PIX_FMT_YUYV:
+            bpp = 2;
+            ow &= ~1;  // YUYV 两个像素共用一组 UV
+            break;
+        case V4L2_PIX_FMT_RGB24:
+            bpp = 3;
+            break;
+        default:
+            return nullptr;
+    }
+    if (factor < 2 || ow < 2 || oh < 1) {
+        return nullptr;
+    }
+    size_t len = (size_t)ow * oh * bpp;
+    auto dst = (uint8_t*)heap_caps_aligned_alloc(16, len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (dst == nullptr) {
+        return nullptr;
+    }
+
+    const uint32_t area = factor * factor;
+    const size_t src_stride = (size_t)width * bpp;
+    for (int y = 0; y < oh; y++) {
+        const uint8_t* block_row = src + (size_t)y * factor * src_stride;
+        uint8_t* out = dst + (size_t)y * ow * bpp;
+        if (format == V4L2_PIX_FMT_YUYV) {
+            // 每次输出一对像素: Y0 Y1 各自取平均, U V 取 2*factor 宽的平均
+            for (int x = 0; x < ow; x += 2) {
+                uint32_t y0 = 0, y1 = 0, u = 0, v = 0;
+                for (int r = 0; r < factor; r++) {
+                    const uint8_t* p = block_row + r * src_stride + (size_t)x * factor * 2;
+                    for (int c = 0; c < factor; c++) {
+                        y0 += p[c * 2];
+                        y1 += p[(factor + c) * 2];
+                    }
+                    for (int c = 0; c < factor * 2; c += 2) {
+                        u += p[c * 2 + 1];
+                        v += p[c * 2 + 3];
+                    }
+                }
+                out[0] = y0 / area;
+                out[1] = u / area;
+                out[2] = y1 / area;
+                out[3] = v / area;
+                out += 4;
+            }
+        } else if (format == V4L2_PIX_FMT_RGB565) {
+            for (int x = 0; x < ow; x++) {
+                uint32_t r5 = 0, g6 = 0, b5 = 0;
+                for (int r = 0; r < factor; r++) {
+                    auto p = (const uint16_t*)(block_row + r * src_stride) + x * factor;
+                    for (int c = 0; c < factor; c++) {
+                        r5 += p[c] >> 11;
+                        g6 += (p[c] >> 5) & 0x3F;
+                        b5 += p[c] & 0x1F;
+                    }
+                }
+                ((uint16_t*)out)[x] = (uint16_t)(((r5 / area) << 11) | ((g6 / area) << 5) | (b5 / area));
+            }
+        } else {
+            // GREY / RGB24: từng kênh độc lập
+            for (int x = 0; x < ow; x++) {
+                for (int k = 0; k < bpp; k++) {
+                    uint32_t sum = 0;
+                    for (int r = 0; r < factor; r++) {
+                        const uint8_t* p = block_row + r * src_stride + (size_t)x * factor * bpp + k;
+                        for (int c = 0; c < factor; c++) {
+                            sum += p[c * bpp];
+                        }
+                    }
+                    out[x * bpp + k] = sum / area;
+                }
+            }
+        }
+    }
+    *out_width = ow;
+    *out_height = oh;
+    *out_len = len;
+    return dst;
+}
+#endif  // CONFIG_XIAOZHI_CAMERA_EXPLAIN_MAX_WIDTH > 0
+
 /**
  * @brief 将摄像头捕获的图像发送到远程服务器进行AI分析和解释
  *
@@ -880,10 +1043,12 @@ bool Esp32Camera::SetVFlip(bool enabled) {
  * 问题对图像进行AI分析并返回结果。
  *
  * 实现特点：
- * - 使用独立线程编码JPEG，与主线程分离
- * - 采用分块传输编码(chunked transfer encoding)优化内存使用
- * - 通过队列机制实现编码线程和发送线程的数据同步
+ * - 使用独立线程编码JPEG，与建立HTTP连接同时进行
+ * - 直接从 V4L2 mmap 缓冲区编码，可选按 XIAOZHI_CAMERA_EXPLAIN_MAX_WIDTH 先缩小
+ * - 编码结果整块经队列交给发送方，不再复制，按 kUploadChunkSize 分块写入
+ * - 采用分块传输编码(chunked transfer encoding)
  * - 支持设备ID、客户端ID和认证令牌的HTTP头部配置
+ * - 每次请求记录 capture/encode/upload 耗时
  *
  * @param question 要向AI提出的关于图像的问题，将作为表单字段发送
  * @return std::string 服务器返回的JSON格式响应字符串
@@ -899,46 +1064,85 @@ std::string Esp32Camera::Explain(const std::string& question) {
     if (explain_url_.empty()) {
         throw std::runtime_error("Image explain URL or token is not set");
     }
+    if (frame_.data == nullptr) {
+        throw std::runtime_error("No image captured");
+    }
+    constexpr size_t kUploadChunkSize = 16 * 1024;
 
-    // 创建局部的 JPEG 队列, 40 entries is about to store 512 * 40 = 20480 bytes of JPEG data
-    QueueHandle_t jpeg_queue = xQueueCreate(40, sizeof(JpegChunk));
+    // 队列只传一块: 编码器输出的整个 JPEG (data 为 nullptr 表示失败)
+    QueueHandle_t jpeg_queue = xQueueCreate(1, sizeof(JpegChunk));
     if (jpeg_queue == nullptr) {
         ESP_LOGE(TAG, "Failed to create JPEG queue");
         throw std::runtime_error("Failed to create JPEG queue");
     }
 
-    // We spawn a thread to encode the image to JPEG using optimized encoder (cost about 500ms and 8KB SRAM)
-    encoder_thread_ = std::thread([this, jpeg_queue]() {
-        uint16_t w = frame_.width ? frame_.width : 320;
-        uint16_t h = frame_.height ? frame_.height : 240;
-        v4l2_pix_fmt_t enc_fmt = frame_.format;
-        bool ok = image_to_jpeg_cb(
-            frame_.data, frame_.len, w, h, enc_fmt, 80,
-            [](void* arg, size_t index, const void* data, size_t len) -> size_t {
-                auto jpeg_queue = static_cast<QueueHandle_t>(arg);
-                JpegChunk chunk = {.data = nullptr, .len = len};
-                if (index == 0 && data != nullptr && len > 0) {
-                    chunk.data = (uint8_t*)heap_caps_aligned_alloc(16, len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                    if (chunk.data == nullptr) {
-                        ESP_LOGE(TAG, "Failed to allocate %zu bytes for JPEG chunk", len);
-                        chunk.len = 0;
-                    } else {
-                        memcpy(chunk.data, data, len);
-                    }
+    // 摄像头直接输出 JPEG 时原样发送 mmap 中的数据
+    bool passthrough = false;
+#ifdef CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
+    passthrough = frame_.format == V4L2_PIX_FMT_JPEG;
+#endif  // CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
+    uint32_t encode_ms = 0;
+    uint16_t encoded_width = frame_.width ? frame_.width : 320;
+    uint16_t encoded_height = frame_.height ? frame_.height : 240;
+
+    if (passthrough) {
+        JpegChunk chunk = {.data = frame_.data, .len = frame_.len};
+        xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
+    } else {
+        // We spawn a thread to encode the image to JPEG while the HTTP connection is being opened
+        encoder_thread_ = std::thread([this, jpeg_queue, &encode_ms, &encoded_width, &encoded_height]() {
+            auto start_time = esp_timer_get_time();
+            uint8_t* src = frame_.data;
+            size_t src_len = frame_.len;
+            uint16_t w = encoded_width;
+            uint16_t h = encoded_height;
+            uint8_t* scaled = nullptr;
+#if CONFIG_XIAOZHI_CAMERA_EXPLAIN_MAX_WIDTH > 0
+            if (w > CONFIG_XIAOZHI_CAMERA_EXPLAIN_MAX_WIDTH) {
+                int factor = (w + CONFIG_XIAOZHI_CAMERA_EXPLAIN_MAX_WIDTH - 1) / CONFIG_XIAOZHI_CAMERA_EXPLAIN_MAX_WIDTH;
+                uint16_t scaled_w = 0, scaled_h = 0;
+                size_t scaled_len = 0;
+                scaled = box_downscale(src, w, h, frame_.format, factor, &scaled_w, &scaled_h, &scaled_len);
+                if (scaled != nullptr) {
+                    src = scaled;
+                    src_len = scaled_len;
+                    w = scaled_w;
+                    h = scaled_h;
                 } else {
-                    chunk.len = 0;  // Sentinel or error
+                    ESP_LOGW(TAG, "Cannot downscale format 0x%08lx, sending %dx%d", frame_.format, w, h);
                 }
-                xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
-                return len;
-            },
-            jpeg_queue);
+            }
+#endif  // CONFIG_XIAOZHI_CAMERA_EXPLAIN_MAX_WIDTH > 0
 
-        if (!ok) {
             JpegChunk chunk = {.data = nullptr, .len = 0};
+            if (!image_to_jpeg(src, src_len, w, h, frame_.format, 80, &chunk.data, &chunk.len)) {
+                chunk.data = nullptr;
+                chunk.len = 0;
+            }
+            if (scaled != nullptr) {
+                heap_caps_free(scaled);
+            }
+            encoded_width = w;
+            encoded_height = h;
+            encode_ms = (uint32_t)((esp_timer_get_time() - start_time) / 1000);
             xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
+        });
+    }
+
+    // Lấy JPEG từ encoder (chờ encoder xong) và giải phóng hàng đợi
+    auto take_jpeg = [this, jpeg_queue]() {
+        JpegChunk chunk = {.data = nullptr, .len = 0};
+        if (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to receive JPEG");
+        }
+        if (encoder_thread_.joinable()) {
+            encoder_thread_.join();
         }
-    });
+        vQueueDelete(jpeg_queue);
+        return chunk;
+    };
 
+    auto upload_start = esp_timer_get_time();
     auto network = Board::GetInstance().GetNetwork();
     auto http = network->CreateHttp(3);
     // 构造multipart/form-data请求体
@@ -954,17 +1158,10 @@ std::string Esp32Camera::Explain(const std::string& question) {
     http->SetHeader("Transfer-Encoding", "chunked");
     if (!http->Open("POST", explain_url_)) {
         ESP_LOGE(TAG, "Failed to connect to explain URL");
-        // Clear the queue
-        encoder_thread_.join();
-        JpegChunk chunk;
-        while (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) == pdPASS) {
-            if (chunk.data != nullptr) {
-                heap_caps_free(chunk.data);
-            } else {
-                break;
-            }
+        JpegChunk chunk = take_jpeg();
+        if (chunk.data != nullptr && !passthrough) {
+            free(chunk.data);
         }
-        vQueueDelete(jpeg_queue);
         throw std::runtime_error("Failed to connect to explain URL");
     }
 
@@ -987,32 +1184,21 @@ std::string Esp32Camera::Explain(const std::string& question) {
         http->Write(file_header.c_str(), file_header.size());
     }
 
-    // 第三块：JPEG数据
-    size_t total_sent = 0;
-    bool saw_terminator = false;
-    while (true) {
-        JpegChunk chunk;
-        if (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) != pdPASS) {
-            ESP_LOGE(TAG, "Failed to receive JPEG chunk");
-            break;
-        }
-        if (chunk.data == nullptr) {
-            saw_terminator = true;
-            break;  // The last chunk
-        }
-        http->Write((const char*)chunk.data, chunk.len);
-        total_sent += chunk.len;
-        heap_caps_free(chunk.data);
-    }
-    // Wait for the encoder thread to finish
-    encoder_thread_.join();
-    // 清理队列
-    vQueueDelete(jpeg_queue);
-
-    if (!saw_terminator || total_sent == 0) {
+    // 第三块：JPEG数据，直接从编码器输出分块写入
+    JpegChunk jpeg = take_jpeg();
+    if (jpeg.data == nullptr || jpeg.len == 0) {
         ESP_LOGE(TAG, "JPEG encoder failed or produced empty output");
+        http->Close();
         throw std::runtime_error("Failed to encode image to JPEG");
     }
+    auto send_start = esp_timer_get_time();
+    for (size_t offset = 0; offset < jpeg.len; offset += kUploadChunkSize) {
+        http->Write((const char*)jpeg.data + offset, std::min(kUploadChunkSize, jpeg.len - offset));
+    }
+    size_t total_sent = jpeg.len;
+    if (!passthrough) {
+        free(jpeg.data);
+    }
 
     {
         // 第四块：multipart尾部
@@ -1030,10 +1216,15 @@ std::string Esp32Camera::Explain(const std::string& question) {
 
     std::string result = http->ReadAll();
     http->Close();
+    auto end_time = esp_timer_get_time();
 
     // Get remain task stack size
     size_t remain_stack_size = uxTaskGetStackHighWaterMark(nullptr);
-    ESP_LOGI(TAG, "Explain image size=%d bytes, compressed size=%d, remain stack size=%d, question=%s\n%s",
-             (int)frame_.len, (int)total_sent, (int)remain_stack_size, question.c_str(), result.c_str());
+    ESP_LOGI(TAG, "Explain timings: capture %lu ms, encode %lu ms, upload %d ms (body %d ms)",
+             (unsigned long)capture_ms_, (unsigned long)encode_ms, int((end_time - upload_start) / 1000),
+             int((end_time - send_start) / 1000));
+    ESP_LOGI(TAG, "Explain image size=%d bytes (%dx%d), compressed size=%d, remain stack size=%d, question=%s\n%s",
+             (int)frame_.len, encoded_width, encoded_height, (int)total_sent, (int)remain_stack_size,
+             question.c_str(), result.c_str());
     return result;
 }
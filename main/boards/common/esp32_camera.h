@@ -28,6 +28,9 @@ private:
         uint16_t height = 0;
         v4l2_pix_fmt_t format = 0;
     } frame_;
+    // frame_.data trỏ thẳng vào V4L2 mmap buffer này (chưa QBUF lại), -1 nếu frame_ là bản sao PSRAM
+    int held_buffer_ = -1;
+    uint32_t capture_ms_ = 0;
     v4l2_pix_fmt_t sensor_format_ = 0;
 #ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
     uint16_t sensor_width_ = 0;
@@ -41,6 +44,9 @@ private:
     std::string explain_token_;
     std::thread encoder_thread_;
 
+    bool UseMmapFrame(int index, size_t bytesused);
+    void ReleaseFrame();
+
 public:
     Esp32Camera(const esp_video_init_config_t& config);
     ~Esp32Camera();
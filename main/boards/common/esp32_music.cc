@@ -291,13 +291,26 @@ static std::string normalize_filename (const std::string& text) {
     return result;
 }
 
+static std::string cache_file_path(const std::string& artist, const std::string& title) {
+    return "/sdcard/music/" + normalize_filename(artist) + "-" + normalize_filename(title) + ".mp3";
+}
+
+// Giữ file cache: dọn bớt bài cũ rồi đổi tên file tạm thành file .mp3
+static void commit_cache_file(StreamCacheWriter& cache) {
+    ensure_music_folder_capacity("/sdcard/music",
+                                 kMaxSongsInMusicFolder,
+                                 /*reserve_slots=*/1,
+                                 cache.path().c_str());
+    cache.Commit();
+}
+
 Esp32Music::Esp32Music() : last_downloaded_data_(), current_music_url_(), current_song_name_(),
                          song_name_displayed_(false), current_lyric_url_(), lyrics_(),
                          current_lyric_index_(-1), lyric_thread_(), is_lyric_running_(false),
                          display_mode_(DISPLAY_MODE_SPECTRUM), is_playing_(false),
                          auto_cache_to_sd_(true), auto_cache_file_name_(),
-                         play_thread_(), download_thread_(), audio_buffer_(), buffer_mutex_(),
-                         buffer_cv_(), buffer_size_(0), mp3_decoder_(nullptr), mp3_frame_info_(),
+                         play_thread_(), download_thread_(), stream_ring_(), buffer_mutex_(),
+                         buffer_cv_(), mp3_decoder_(nullptr), mp3_frame_info_(),
                          mp3_decoder_initialized_(false) {
     ESP_LOGI(TAG, "Music player initialized with default spectrum display mode");
     InitializeMp3Decoder();
@@ -409,6 +422,8 @@ Esp32Music::~Esp32Music() {
     }
 
     // [PATCH] join cache thread để tránh dùng this sau khi object đã bị hủy
+    // (download thread có thể vừa giao file cache cho nó trước khi kết thúc)
+    is_caching_ = false;
     if (cache_thread_.joinable()) {
         ESP_LOGI(TAG, "Waiting for cache thread to finish");
         cache_thread_.join();
@@ -628,7 +643,6 @@ bool Esp32Music::Download(const std::string& song_name, const std::string& artis
         }
 
         ESP_LOGI(TAG, "Final Audio URL: %s", current_music_url_.c_str());
-        auto_cache_file_name_.clear(); // Reset cache filename for new song
 
         // =================== EARLY DISPLAY INFO ===================
         if (display_mode_ == DISPLAY_MODE_SPECTRUM) {
@@ -715,9 +729,7 @@ bool Esp32Music::Download(const std::string& song_name, const std::string& artis
 bool Esp32Music::IsSongAlreadyCached() {
     if (title_name_.empty() || artist_name_.empty()) return false;
 
-    std::string file_name = "/sdcard/music/" +
-        normalize_filename(artist_name_) + "-" +
-        normalize_filename(title_name_) + ".mp3";
+    std::string file_name = cache_file_path(artist_name_, title_name_);
 
     struct stat st;
     if (stat(file_name.c_str(), &st) == 0) {
@@ -778,6 +790,21 @@ bool Esp32Music::StartStreaming(const std::string& music_url) {
 
     // Clear the buffer
     ClearAudioBuffer();
+    underrun_count_ = 0;
+    dropped_bytes_ = 0;
+
+    // Auto cache: the download thread tees the stream into this file from the first byte
+    cache_keep_ = false;
+    auto_cache_file_name_.clear();
+    if (auto_cache_to_sd_ && !title_name_.empty() && !artist_name_.empty() && !IsSongAlreadyCached()) {
+        auto_cache_file_name_ = cache_file_path(artist_name_, title_name_);
+    }
+
+    // The ring is allocated on the first stream and kept for the next ones
+    if (!stream_ring_.allocated() && !stream_ring_.Allocate(STREAM_RING_SIZE, STREAM_RING_GUARD)) {
+        ESP_LOGE(TAG, "Failed to allocate stream buffer");
+        return false;
+    }
 
     // Đảm bảo MP3 decoder sẵn sàng cho lần phát mới
     if (!mp3_decoder_initialized_) {
@@ -949,82 +976,91 @@ void Esp32Music::DownloadAudioStream(const std::string& music_url) {
 
     ESP_LOGI(TAG, "Started downloading audio stream, status: %d", status_code);
 
-    // Read audio data in chunks
-    const size_t chunk_size = 8192;  // 8KB per chunk
-    char* buffer = new char[chunk_size];
+    // Write-through SD cache, kept only if the song is listened to long enough
+    std::unique_ptr<StreamCacheWriter> cache;
+    if (!auto_cache_file_name_.empty()) {
+        mkdir("/sdcard/music", 0777);
+        cache = std::make_unique<StreamCacheWriter>();
+        if (!cache->Open(auto_cache_file_name_)) {
+            cache.reset();
+        }
+    }
+
+    // Read audio data straight into the stream ring
     size_t total_downloaded = 0;
     size_t total_print_bytes = 0;
+    bool completed = false;
+    bool read_failed = false;
 
     while (is_downloading_ && is_playing_) {
-        int bytes_read = http->Read(buffer, chunk_size);
+        // Wait for buffer space
+        {
+            std::unique_lock<std::mutex> lock(buffer_mutex_);
+            buffer_cv_.wait(lock, [this] {
+                return stream_ring_.free_space() >= WRITE_WATERMARK || !is_downloading_ || !is_playing_;
+            });
+        }
+        if (!is_downloading_ || !is_playing_) {
+            break;
+        }
+
+        size_t span = 0;
+        uint8_t* dest = stream_ring_.WriteSpan(span);
+        int bytes_read = http->Read((char*)dest, std::min(span, MAX_READ_SIZE));
         if (bytes_read < 0) {
             ESP_LOGE(TAG, "Failed to read audio data: error code %d", bytes_read);
+            read_failed = true;
             break;
         }
         if (bytes_read == 0) {
             ESP_LOGI(TAG, "Audio stream download completed, total: %d bytes", (int)total_downloaded);
+            completed = true;
             break;
         }
 
-        // Safely log the first 16 bytes of the chunk in hexadecimal
-        if (bytes_read < 16) {
-            ESP_LOGI(TAG, "Data chunk too small: %d bytes", bytes_read);
-        }
-
         // Attempt to detect file format (check file header)
         if (total_downloaded == 0 && bytes_read >= 4) {
-            if (memcmp(buffer, "ID3", 3) == 0) {
+            if (memcmp(dest, "ID3", 3) == 0) {
                 ESP_LOGI(TAG, "Detected MP3 file with ID3 tag");
-            } else if ((unsigned char)buffer[0] == 0xFF && (((unsigned char)buffer[1] & 0xE0) == 0xE0)) {
+            } else if (dest[0] == 0xFF && ((dest[1] & 0xE0) == 0xE0)) {
                 ESP_LOGI(TAG, "Detected MP3 file header");
-            } else if (memcmp(buffer, "RIFF", 4) == 0) {
+            } else if (memcmp(dest, "RIFF", 4) == 0) {
                 ESP_LOGI(TAG, "Detected WAV file");
-            } else if (memcmp(buffer, "fLaC", 4) == 0) {
+            } else if (memcmp(dest, "fLaC", 4) == 0) {
                 ESP_LOGI(TAG, "Detected FLAC file");
-            } else if (memcmp(buffer, "OggS", 4) == 0) {
+            } else if (memcmp(dest, "OggS", 4) == 0) {
                 ESP_LOGI(TAG, "Detected OGG file");
             } else {
                 ESP_LOGI(TAG, "Unknown audio format, first 4 bytes: %02X %02X %02X %02X",
-                        (unsigned char)buffer[0], (unsigned char)buffer[1],
-                        (unsigned char)buffer[2], (unsigned char)buffer[3]);
+                        dest[0], dest[1], dest[2], dest[3]);
             }
         }
 
-        // Create audio data chunk
-        uint8_t* chunk_data = (uint8_t*)heap_caps_malloc(bytes_read, MALLOC_CAP_SPIRAM);
-        if (!chunk_data) {
-            ESP_LOGE(TAG, "Failed to allocate memory for audio chunk");
+        // The cache gets every byte read, even when stopped during this Read: a partial
+        // file is finished by FinishCacheInBackground from the next read onwards.
+        // stream_ring_.Reset() only moves the indices, dest still holds what Read wrote.
+        if (cache) {
+            cache->Append(dest, bytes_read);
+        }
+        // Stopped while blocked in Read, the ring may already have been cleared
+        if (!is_downloading_) {
             break;
         }
-        memcpy(chunk_data, buffer, bytes_read);
+        stream_ring_.CommitWrite(bytes_read);
+        total_downloaded += bytes_read;
+        total_print_bytes += bytes_read;
 
-        // Wait for buffer space
+        // Notify playback thread of new data
         {
-            std::unique_lock<std::mutex> lock(buffer_mutex_);
-            buffer_cv_.wait(lock, [this] { return buffer_size_ < MAX_BUFFER_SIZE || !is_downloading_; });
-
-            if (is_downloading_) {
-                audio_buffer_.push(AudioChunk(chunk_data, bytes_read));
-                buffer_size_ += bytes_read;
-                total_downloaded += bytes_read;
-                total_print_bytes += bytes_read;
-
-                // Notify playback thread of new data
-                buffer_cv_.notify_one();
+            std::lock_guard<std::mutex> lock(buffer_mutex_);
+            buffer_cv_.notify_all();
+        }
 
-                if (total_print_bytes >= (128 * 1024)) {  // Log progress every 128KB
-                    total_print_bytes = 0;
-                    ESP_LOGI(TAG, "Downloaded %d bytes, buffer size: %d", (int)total_downloaded, (int)buffer_size_);
-                }
-            } else {
-                heap_caps_free(chunk_data);
-                break;
-            }
+        if (total_print_bytes >= (128 * 1024)) {  // Log progress every 128KB
+            total_print_bytes = 0;
+            ESP_LOGI(TAG, "Downloaded %d bytes, buffer size: %d", (int)total_downloaded, (int)stream_ring_.size());
         }
     }
-    delete[] buffer;
-
-    http->Close();
 
     if (is_downloading_) {
         ESP_LOGI(TAG, "Audio stream download finished successfully, total downloaded: %d bytes", (int)total_downloaded);
@@ -1040,16 +1076,44 @@ void Esp32Music::DownloadAudioStream(const std::string& music_url) {
         buffer_cv_.notify_all();
     }
 
+    // ==================== AUTO CACHE MP3 ====================
+    if (cache) {
+        if (completed) {
+            if (cache->Close() && cache_keep_) {
+                commit_cache_file(*cache);
+            } else {
+                cache->Discard();
+            }
+        } else if (!read_failed && cache_keep_ && !cache->failed() && !is_caching_) {
+            // Listened long enough but stopped early: finish the file on this same connection
+            if (cache_thread_.joinable()) {
+                cache_thread_.join();
+            }
+            is_caching_ = true;
+
+            esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+            cfg.stack_size = 6144;
+            cfg.prio = 2;
+            cfg.thread_name = "mp3_cache_dl";
+            esp_pthread_set_cfg(&cfg);
+            cache_thread_ = std::thread(&Esp32Music::FinishCacheInBackground, this,
+                                        std::move(http), std::move(cache));
+        } else {
+            cache->Close();
+            cache->Discard();
+        }
+    }
+
+    if (http) {
+        http->Close();
+    }
+
     ESP_LOGI(TAG, "Audio stream download thread finished");
 }
 
 // Stream audio data
 void Esp32Music::PlayAudioStream() {
     ESP_LOGI(TAG, "Starting audio stream playback");
-    if (!auto_cache_file_name_.empty()) {
-        ESP_LOGI(TAG, "[CACHE] Cleaning old cache flag");
-        auto_cache_file_name_.clear();
-    }
 
     // Initialize time tracking variables
     current_play_time_ms_ = 0;
@@ -1073,41 +1137,30 @@ void Esp32Music::PlayAudioStream() {
         is_playing_ = false;
         return;
     }
+    Application::GetInstance().BeginAudioStream();
 
     // Wait for the buffer to have enough data to start playback
     {
         std::unique_lock<std::mutex> lock(buffer_mutex_);
-        constexpr size_t kMinPrebuffer = 64 * 1024; // 64KB
-		buffer_cv_.wait(lock, [this] {
-			return buffer_size_ >= kMinPrebuffer || (!is_downloading_ && !audio_buffer_.empty());
-		});
+        buffer_cv_.wait(lock, [this] {
+            return stream_ring_.size() >= START_WATERMARK || !is_downloading_ || !is_playing_;
+        });
     }
 
-    ESP_LOGI(TAG, "Starting playback with buffer size: %d", (int)buffer_size_);
+    ESP_LOGI(TAG, "Starting playback with buffer size: %d", (int)stream_ring_.size());
 
     size_t total_played_bytes = 0;
     size_t total_print_bytes = 0;
-    uint8_t* mp3_input_buffer = nullptr;
-    int bytes_left = 0;
-    uint8_t* read_ptr = nullptr;
-
-    // Allocate MP3 input buffer
-    mp3_input_buffer = (uint8_t*)heap_caps_malloc(8192, MALLOC_CAP_SPIRAM);
-    if (!mp3_input_buffer) {
-        ESP_LOGE(TAG, "Failed to allocate MP3 input buffer");
-        is_playing_ = false;
-        return;
-    }
 
-    // Flag to indicate if ID3 tags have been processed
-    bool id3_processed = false;
+    // ID3 tags are skipped as they stream in, a tag with cover art can be larger than the ring
+    bool id3_checked = false;
+    size_t id3_pending = 0;
 
     auto& board = Board::GetInstance();
     auto display = board.GetDisplay();
     int16_t* pcm_buffer = new int16_t[2304];  // Max PCM samples per MP3 frame
     if (!pcm_buffer) {
         ESP_LOGE(TAG, "Failed to allocate PCM buffer");
-        heap_caps_free(mp3_input_buffer);
         is_playing_ = false;
         return;
     }
@@ -1163,99 +1216,73 @@ void Esp32Music::PlayAudioStream() {
             song_name_displayed_ = true;
         }
 
-        // If more MP3 data is needed, read from the buffer
-        if (bytes_left < 4096) {  // Maintain at least 4KB of data for decoding
-            AudioChunk chunk;
-
-            // Retrieve audio data from the buffer
-            {
-                std::unique_lock<std::mutex> lock(buffer_mutex_);
-                if (audio_buffer_.empty()) {
-                    if (!is_downloading_) {
-                        // Download complete and buffer empty, playback ends
-                        ESP_LOGI(TAG, "Playback finished, total played: %d bytes", (int)total_played_bytes);
-                        break;
-                    }
-                    // Wait for new data
-                    buffer_cv_.wait(lock, [this] { return !audio_buffer_.empty() || !is_downloading_; });
-                    if (audio_buffer_.empty()) {
-                        continue;
-                    }
-                }
-
-                chunk = audio_buffer_.front();
-                audio_buffer_.pop();
-                buffer_size_ -= chunk.size;
-                total_played_bytes += chunk.size;
-                total_print_bytes += chunk.size;
-
-                // Notify download thread that buffer has space
-                buffer_cv_.notify_one();
-            }
-
-            // Add new data to the MP3 input buffer
-            if (chunk.data && chunk.size > 0) {
-                // Move remaining data to the beginning of the buffer
-                if (bytes_left > 0 && read_ptr != mp3_input_buffer) {
-                    memmove(mp3_input_buffer, read_ptr, bytes_left);
-                }
-
-                // Check buffer space
-                size_t space_available = 8192 - bytes_left;
-                size_t copy_size = std::min(chunk.size, space_available);
-
-                // Copy new data
-                memcpy(mp3_input_buffer + bytes_left, chunk.data, copy_size);
-                bytes_left += copy_size;
-                read_ptr = mp3_input_buffer;
+        // Compressed data readable in place, at least one decode window unless the stream is ending
+        size_t available = 0;
+        uint8_t* read_ptr = stream_ring_.ReadSpan(available);
 
-                // ---- MULTI-CHUNK ID3 SKIP ----
-                while (!id3_processed && bytes_left >= 10) {
-                    size_t id3_skip = SkipId3Tag(read_ptr, bytes_left);
-                    if (id3_skip == 0) break;
-
-                    read_ptr += id3_skip;
-                    bytes_left -= id3_skip;
-
-                    ESP_LOGI(TAG, "Skipped ID3 chunk: %u bytes", (unsigned)id3_skip);
-
-                    // Khi buffer còn quá ít → chờ chunk tiếp theo
-                    if (bytes_left < 128) {
-                        bytes_left = 0;
-                        break;
-                    }
-                }
-
-                // Đánh dấu đã xử lý
-                if (bytes_left >= 256) id3_processed = true;
+        if (available < STREAM_RING_GUARD && is_downloading_) {
+            // Underrun: stop decoding and refill to the resume watermark instead of
+            // stuttering frame by frame on whatever trickles in
+            underrun_count_++;
+            ESP_LOGW(TAG, "Stream underrun #%lu, buffered %u bytes, refilling",
+                     (unsigned long)underrun_count_.load(), (unsigned)available);
+            std::unique_lock<std::mutex> lock(buffer_mutex_);
+            buffer_cv_.wait(lock, [this] {
+                return stream_ring_.size() >= RESUME_WATERMARK || !is_downloading_ || !is_playing_;
+            });
+            continue;
+        }
+        if (available == 0) {
+            // Download complete and buffer empty, playback ends
+            ESP_LOGI(TAG, "Playback finished, total played: %d bytes", (int)total_played_bytes);
+            break;
+        }
 
-                // Free chunk memory
-                heap_caps_free(chunk.data);
+        // ---- ID3 SKIP ----
+        if (!id3_checked && (available >= 10 || !is_downloading_)) {
+            id3_pending = SkipId3Tag(read_ptr, available);
+            id3_checked = true;
+        }
+        if (id3_pending > 0) {
+            size_t skip = std::min(id3_pending, available);
+            ConsumeStream(skip);
+            id3_pending -= skip;
+            if (id3_pending == 0) {
+                // Tags may be chained, check what follows
+                id3_checked = false;
             }
+            continue;
         }
 
         // Attempt to find MP3 frame sync
+        int bytes_left = (int)available;
         int sync_offset = MP3FindSyncWord(read_ptr, bytes_left);
-        if (sync_offset < 0) {
-            ESP_LOGW(TAG, "No MP3 sync word found, skipping %d bytes", bytes_left);
-            vTaskDelay(pdMS_TO_TICKS(2));
-            bytes_left = 0;
+        if (sync_offset != 0) {
+            // Keep the last bytes when nothing is found, a sync word may straddle the window end
+            size_t skip = sync_offset > 0 ? (size_t)sync_offset
+                                          : (available > 3 && is_downloading_ ? available - 3 : available);
+            if (sync_offset < 0) {
+                ESP_LOGW(TAG, "No MP3 sync word found, skipping %u bytes", (unsigned)skip);
+            }
+            dropped_bytes_ += skip;
+            ConsumeStream(skip);
             continue;
         }
 
-        if (bytes_left < 128) {
-            vTaskDelay(pdMS_TO_TICKS(2));
-            continue;
-        }
+        // Decode MP3 frame in place, the decoder advances read_ptr past what it used
+        uint8_t* frame_start = read_ptr;
+        int decode_result = MP3Decode(mp3_decoder_, &read_ptr, &bytes_left, pcm_buffer, 0);
+        size_t consumed = read_ptr - frame_start;
 
-        // Skip to sync position
-        if (sync_offset > 0) {
-            read_ptr += sync_offset;
-            bytes_left -= sync_offset;
+        if (decode_result == ERR_MP3_INDATA_UNDERFLOW && !is_downloading_) {
+            // Truncated last frame
+            dropped_bytes_ += available;
+            ConsumeStream(available);
+            continue;
         }
-
-        // Decode MP3 frame
-        int decode_result = MP3Decode(mp3_decoder_, &read_ptr, &bytes_left, pcm_buffer, 0);
+        ConsumeStream(consumed);
+        total_played_bytes += consumed;
+        total_print_bytes += consumed;
 
         if (decode_result == 0) {
             // Decode successful, get frame info
@@ -1308,39 +1335,11 @@ void Esp32Music::PlayAudioStream() {
             current_play_time_ms_ += frame_duration_ms;
 
             // ==================== AUTO CACHE MP3 ====================
-            if (auto_cache_to_sd_ &&
-                current_play_time_ms_ > kMinCachePlayTimeMs &&
-                auto_cache_file_name_.empty()) {
-
-                // === NEW: Check if file already cached ===
-                if (IsSongAlreadyCached()) {
-                    ESP_LOGI(TAG, "[CACHE] Skip: song already cached (by ID3 title + artist)");
-                    auto_cache_to_sd_ = false;   // turn off caching for this song
-                    continue;
-                }
-
-                // Build file name
-                char file_name[256];
-                snprintf(file_name, sizeof(file_name),
-                         "/sdcard/music/%s-%s.mp3",
-                         normalize_filename(artist_name_).c_str(),
-                         normalize_filename(title_name_).c_str());
-
-                auto_cache_file_name_ = file_name;
-
-                ESP_LOGI(TAG, "[CACHE] Begin caching MP3 → %s", file_name);
-
-                if (!is_caching_) {
-                    is_caching_ = true;
-
-                    if (cache_thread_.joinable())
-                        cache_thread_.join();
-
-                    cache_thread_ = std::thread([this] {
-                        DownloadAndSaveMp3(current_music_url_, auto_cache_file_name_);
-                        is_caching_ = false;
-                    });
-                }
+            // Stream đang được ghi song song vào file tạm, nghe đủ lâu thì giữ lại
+            if (!cache_keep_ && !auto_cache_file_name_.empty() &&
+                current_play_time_ms_ > kMinCachePlayTimeMs) {
+                cache_keep_ = true;
+                ESP_LOGI(TAG, "[CACHE] Keeping cached MP3 → %s", auto_cache_file_name_.c_str());
             }
 
             ESP_LOGD(TAG, "Frame %d: time=%lldms, duration=%dms, rate=%d, ch=%d",
@@ -1351,24 +1350,20 @@ void Esp32Music::PlayAudioStream() {
             if (mp3_frame_info_.outputSamps > 0) {
                 int16_t* final_pcm_data = pcm_buffer;
                 int final_sample_count = mp3_frame_info_.outputSamps;
-                std::vector<int16_t> mono_buffer;
 
                 // If stereo, convert to mono
                 if (mp3_frame_info_.nChans == 2) {
-                    // Convert stereo to mono: mix left and right channels
+                    // Convert stereo to mono in place: sample i only reads slots 2i and 2i+1
                     int stereo_samples = mp3_frame_info_.outputSamps;  // Total samples including both channels
                     int mono_samples = stereo_samples / 2;  // Actual mono sample count
 
-                    mono_buffer.resize(mono_samples);
-
                     for (int i = 0; i < mono_samples; ++i) {
                         // Mix left and right channels (L + R) / 2
                         int left = pcm_buffer[i * 2];      // Left channel
                         int right = pcm_buffer[i * 2 + 1]; // Right channel
-                        mono_buffer[i] = (int16_t)((left + right) / 2);
+                        pcm_buffer[i] = (int16_t)((left + right) / 2);
                     }
 
-                    final_pcm_data = mono_buffer.data();
                     final_sample_count = mono_samples;
 
                     ESP_LOGD(TAG, "Converted stereo to mono: %d -> %d samples",
@@ -1381,16 +1376,7 @@ void Esp32Music::PlayAudioStream() {
                             mp3_frame_info_.nChans);
                 }
 
-                // Create AudioStreamPacket
-                AudioStreamPacket packet;
-                packet.sample_rate = mp3_frame_info_.samprate;
-                packet.frame_duration = 60;  // Use Application's default frame duration
-                packet.timestamp = 0;
-
-                // Convert int16_t PCM data to uint8_t byte array
                 size_t pcm_size_bytes = final_sample_count * sizeof(int16_t);
-                packet.payload.resize(pcm_size_bytes);
-                memcpy(packet.payload.data(), final_pcm_data, pcm_size_bytes);
 
                 if (display && display_mode_ == DISPLAY_MODE_SPECTRUM) {
                     if (!final_pcm_data_fft || final_pcm_data_fft_size < pcm_size_bytes) {
@@ -1403,13 +1389,14 @@ void Esp32Music::PlayAudioStream() {
                 ESP_LOGD(TAG, "Sending %d PCM samples (%d bytes, rate=%d, channels=%d->1) to Application",
                         final_sample_count, (int)pcm_size_bytes, mp3_frame_info_.samprate, mp3_frame_info_.nChans);
 
-                // Send to Application's audio decoding queue
-                app.AddAudioData(std::move(packet));
+                // Hand the decoder buffer straight to the codec, it is only borrowed for the call
+                app.AddAudioData(std::span<const int16_t>(final_pcm_data, final_sample_count),
+                                 mp3_frame_info_.samprate);
 
                 // Log playback progress
                 if (total_print_bytes >= (128 * 1024)) {
                     total_print_bytes = 0;
-                    ESP_LOGI(TAG, "Played %d bytes, buffer size: %d", (int)total_played_bytes, (int)buffer_size_);
+                    ESP_LOGI(TAG, "Played %d bytes, buffer size: %d", (int)total_played_bytes, (int)stream_ring_.size());
                 }
             }
 
@@ -1417,12 +1404,10 @@ void Esp32Music::PlayAudioStream() {
             // Decode failed
             ESP_LOGW(TAG, "MP3 decode failed with error: %d", decode_result);
 
-            // Skip some bytes and continue
-            if (bytes_left > 1) {
-                read_ptr++;
-                bytes_left--;
-            } else {
-                bytes_left = 0;
+            // Skip a byte to resync unless the decoder already moved past the bad frame
+            if (consumed == 0) {
+                dropped_bytes_++;
+                ConsumeStream(1);
             }
             vTaskDelay(pdMS_TO_TICKS(2));
             continue;
@@ -1441,12 +1426,10 @@ void Esp32Music::PlayAudioStream() {
         ESP_LOGI(TAG, "Audio stream playback stopped by user, total played: %d bytes", (int)total_played_bytes);
     }
 
-    // Cleanup
-    if (mp3_input_buffer) {
-        heap_caps_free(mp3_input_buffer);
-    }
-
     ESP_LOGI(TAG, "Audio stream playback finished, total played: %d bytes", (int)total_played_bytes);
+    ESP_LOGI(TAG, "Stream buffer stats: underruns=%lu dropped=%lu bytes, written=%u read=%u",
+             (unsigned long)underrun_count_.load(), (unsigned long)dropped_bytes_.load(),
+             (unsigned)stream_ring_.total_written(), (unsigned)stream_ring_.total_read());
     ESP_LOGI(TAG, "Performing basic cleanup from play thread");
 
     // Stop playback flag
@@ -1469,7 +1452,6 @@ void Esp32Music::PlayAudioStream() {
     }
     final_pcm_data_fft = nullptr;
     ClearAudioBuffer();
-    buffer_size_ = 0;
     CleanupMp3Decoder();
     mp3_decoder_initialized_ = false;
 
@@ -1483,17 +1465,19 @@ void Esp32Music::PlayAudioStream() {
 // Clear audio buffer
 void Esp32Music::ClearAudioBuffer() {
     std::lock_guard<std::mutex> lock(buffer_mutex_);
+    stream_ring_.Reset();
+    // Wake a downloader waiting for space
+    buffer_cv_.notify_all();
+    ESP_LOGI(TAG, "Audio buffer cleared");
+}
 
-    while (!audio_buffer_.empty()) {
-        AudioChunk chunk = audio_buffer_.front();
-        audio_buffer_.pop();
-        if (chunk.data) {
-            heap_caps_free(chunk.data);
-        }
+// Release decoded bytes and wake the downloader if it waits for space
+void Esp32Music::ConsumeStream(size_t length) {
+    stream_ring_.Consume(length);
+    if (stream_ring_.free_space() >= WRITE_WATERMARK) {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        buffer_cv_.notify_all();
     }
-
-    buffer_size_ = 0;
-    ESP_LOGI(TAG, "Audio buffer cleared");
 }
 
 // Initialize MP3 decoder
@@ -1554,11 +1538,6 @@ size_t Esp32Music::SkipId3Tag(uint8_t* data, size_t size) {
     // ID3v2 header (10 bytes) + tag content
     size_t total_skip = 10 + tag_size;
 
-    // Ensure it does not exceed available data size
-    if (total_skip > size) {
-        total_skip = size;
-    }
-
     ESP_LOGI(TAG, "Found ID3v2 tag, skipping %u bytes", (unsigned int)total_skip);
     return total_skip;
 }
@@ -1938,55 +1917,33 @@ std::string Esp32Music::GetCheckMusicServerUrl() {
 }
 
 // ==================== SAVE MP3 TO SD ====================
-void Esp32Music::DownloadAndSaveMp3(const std::string& url, const std::string& file_path) {
-
-    ESP_LOGI(TAG, "[CACHE] Start saving MP3: %s → %s", url.c_str(), file_path.c_str());
-    mkdir("/sdcard/music", 0777);
-
-    // NEW: Nếu thư mục music đã đạt/ vượt 100 bài, xoá bài cũ nhất để chừa chỗ cho file mới.
-    ensure_music_folder_capacity("/sdcard/music",
-                                 kMaxSongsInMusicFolder,
-                                 /*reserve_slots=*/1,
-                                 file_path.c_str());
-
-    auto network = Board::GetInstance().GetNetwork();
-    auto http = network->CreateHttp(0);
-
-    http->SetHeader("User-Agent", "ESP32-MP3-Downloader");
-    add_auth_headers(http.get());
-
-    if (!http->Open("GET", url)) {
-        ESP_LOGE(TAG, "[CACHE] Cannot open URL");
-        return;
-    }
-
-    FILE* f = fopen(file_path.c_str(), "wb");
-    if (!f) {
-        ESP_LOGE(TAG, "[CACHE] Cannot create file: %s", file_path.c_str());
-        http->Close();
-        return;
-    }
+void Esp32Music::FinishCacheInBackground(std::unique_ptr<Http> http,
+                                         std::unique_ptr<StreamCacheWriter> cache) {
+    ESP_LOGI(TAG, "[CACHE] Playback stopped, finishing %s in background", cache->path().c_str());
 
     const size_t buf_size = 4096;
     uint8_t* buf = (uint8_t*)malloc(buf_size);
-    if (!buf) {
-        ESP_LOGE(TAG, "[CACHE] Out of memory");
-        fclose(f);
-        http->Close();
-        return;
-    }
+    bool completed = false;
 
-    while (true) {
+    while (buf && is_caching_ && !cache->failed()) {
         int len = http->Read(reinterpret_cast<char*>(buf), buf_size);
         if (len < 0) break;
-        if (len == 0) break;
-
-        fwrite(buf, 1, len, f);
+        if (len == 0) {
+            completed = true;
+            break;
+        }
+        // Không còn decoder phía sau, chờ thẻ SD thay vì bỏ cache
+        cache->Append(buf, len, true);
     }
 
     free(buf);
-    fclose(f);
     http->Close();
 
-    ESP_LOGI(TAG, "[CACHE] MP3 saved successfully: %s", file_path.c_str());
+    if (cache->Close() && completed) {
+        commit_cache_file(*cache);
+    } else {
+        ESP_LOGW(TAG, "[CACHE] Background download incomplete, discarding %s", cache->path().c_str());
+        cache->Discard();
+    }
+    is_caching_ = false;
 }
@@ -3,8 +3,8 @@
 
 #include <string>
 #include <thread>
+#include <memory>
 #include <atomic>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <vector>
@@ -13,21 +13,16 @@
 #include <utility>   // std::pair
 
 #include "music.h"
+#include "audio/stream_byte_ring.h"
+#include "stream_cache_writer.h"
+
+class Http;
 
 // MP3 decoder support
 extern "C" {
 #include "mp3dec.h"
 }
 
-// Audio data chunk structure
-struct AudioChunk {
-    uint8_t* data;
-    size_t size;
-
-    AudioChunk() : data(nullptr), size(0) {}
-    AudioChunk(uint8_t* d, size_t s) : data(d), size(s) {}
-};
-
 // LRC/Karaoke lyric line (ms + text)
 struct LyricLine {
     int start_ms;
@@ -73,25 +68,31 @@ private:
     std::atomic<bool>        is_downloading_{false};
 
     std::atomic<bool>        auto_cache_to_sd_{true};   // bật/tắt auto cache (mặc định bật)
-    std::atomic<bool>        is_caching_{false};        // trạng thái thread cache MP3
-    std::string              auto_cache_file_name_;     // tên file .mp3 trên SD (từ title)
+    std::atomic<bool>        is_caching_{false};        // thread hoàn tất file cache sau khi dừng phát
+    std::atomic<bool>        cache_keep_{false};        // đã nghe đủ lâu, giữ lại file cache
+    std::string              auto_cache_file_name_;     // tên file .mp3 trên SD (từ title), rỗng = không cache
 
     std::thread              play_thread_;
     std::thread              download_thread_;
-    std::thread              cache_thread_;             // thread tải/lưu MP3
+    std::thread              cache_thread_;             // thread ghi nốt file cache MP3
 
     int64_t                  current_play_time_ms_{0};  // Current playback time (ms)
     int64_t                  last_frame_time_ms_{0};    // Timestamp of the last frame
     int                      total_frames_decoded_{0};  // Total number of decoded frames
 
-    // Audio buffer
-    std::queue<AudioChunk>  audio_buffer_;
+    // Audio buffer: HTTP reads land in the ring, the MP3 decoder reads it in place
+    StreamByteRing          stream_ring_;
     std::mutex              buffer_mutex_;
     std::condition_variable buffer_cv_;
-    size_t                  buffer_size_{0};
+    std::atomic<uint32_t>   underrun_count_{0};     // Ring ran dry while still downloading
+    std::atomic<uint32_t>   dropped_bytes_{0};      // Bytes skipped without being decoded (resync, truncated tail)
 
-    static constexpr size_t MAX_BUFFER_SIZE = 256 * 1024;  // 256KB buffer
-    static constexpr size_t MIN_BUFFER_SIZE = 32 * 1024;   // 32KB minimum playback buffer
+    static constexpr size_t STREAM_RING_SIZE  = 256 * 1024;  // 256KB ring, power of two
+    static constexpr size_t STREAM_RING_GUARD = 4 * 1024;    // Contiguous decode window across the wrap
+    static constexpr size_t START_WATERMARK   = 64 * 1024;   // Prebuffer before playback starts
+    static constexpr size_t RESUME_WATERMARK  = 32 * 1024;   // Refill level after an underrun
+    static constexpr size_t WRITE_WATERMARK   = 8 * 1024;    // Downloader waits for this much free space
+    static constexpr size_t MAX_READ_SIZE     = 8 * 1024;    // Largest single HTTP read
 
     // MP3 decoder-related
     HMP3Decoder  mp3_decoder_{nullptr};
@@ -107,6 +108,7 @@ private:
     void DownloadAudioStream(const std::string& music_url);
     void PlayAudioStream();
     void ClearAudioBuffer();
+    void ConsumeStream(size_t length);
     bool InitializeMp3Decoder();
     void CleanupMp3Decoder();
     void ResetSampleRate();  // Reset sample rate to the original value
@@ -131,12 +133,12 @@ private:
     // Check if MP3 file already exists on SD card (avoid duplicate download)
     bool IsSongAlreadyCached();
 
-    // ID3 tag handling
+    // ID3 tag handling, returns the whole tag size even if only its header is buffered
     size_t SkipId3Tag(uint8_t* data, size_t size);
 
-    // Save MP3 to SD (auto cache)
-    void DownloadAndSaveMp3(const std::string& url,
-                            const std::string& file_path);
+    // Auto cache: finish a kept file on the stream's own connection after playback stopped
+    void FinishCacheInBackground(std::unique_ptr<Http> http,
+                                 std::unique_ptr<StreamCacheWriter> cache);
 
 public:
     Esp32Music();
@@ -150,7 +152,7 @@ public:
     // Streaming control
     virtual bool   StartStreaming(const std::string& music_url) override;
     virtual bool   StopStreaming() override;
-    virtual size_t GetBufferSize() const override { return buffer_size_; }
+    virtual size_t GetBufferSize() const override { return stream_ring_.size(); }
     virtual bool   IsDownloading() const override { return is_downloading_.load(); }
     virtual int16_t* GetAudioData() override { return final_pcm_data_fft; }
 
@@ -25,8 +25,9 @@
 Esp32Radio::Esp32Radio() : current_station_name_(), current_station_url_(),
                          station_name_displayed_(false), current_station_volume_(4.5f), radio_stations_(),
                          display_mode_(DISPLAY_MODE_SPECTRUM), is_playing_(false), is_downloading_(false), 
-                         play_thread_(), download_thread_(), audio_buffer_(), buffer_mutex_(), 
-                         buffer_cv_(), buffer_size_(0), aac_decoder_(nullptr), aac_info_(),
+                         play_thread_(), download_thread_(), stream_ring_(), buffer_mutex_(),
+                         buffer_cv_(), preroll_(MIN_PREROLL, MAX_PREROLL), icy_filter_(),
+                         frame_splitter_(MAX_FRAME_SIZE), stream_title_(), aac_decoder_(nullptr), aac_info_(),
                          aac_decoder_initialized_(false), aac_info_ready_(false), aac_out_buffer_() {
     ESP_LOGI(TAG, "VOV Radio player initialized with AAC decoder support");
     InitializeRadioStations();
@@ -216,8 +217,25 @@ bool Esp32Radio::PlayUrl(const std::string& radio_url, const std::string& statio
         current_station_volume_ = 4.5f;  // Default volume for custom URLs
     }
     
-    // Clear the buffer
+    // Allocate the stream ring once, it is reused by later stations
+    if (!stream_ring_.allocated() && !stream_ring_.Allocate(STREAM_RING_SIZE, STREAM_RING_GUARD)) {
+        ESP_LOGE(TAG, "Failed to allocate radio stream ring");
+        return false;
+    }
+
+    // Clear the buffer and the statistics of the previous stream
     ClearAudioBuffer();
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        preroll_.Reset();
+        stream_title_.clear();
+    }
+    underrun_count_ = 0;
+    reconnect_count_ = 0;
+    outage_ms_ = 0;
+    decode_errors_ = 0;
+    downloaded_bytes_ = 0;
+    reconnecting_ = false;
     
     // Configure thread stack size
     esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
@@ -314,131 +332,173 @@ void Esp32Radio::DownloadRadioStream(const std::string& radio_url) {
 
     auto network = Board::GetInstance().GetNetwork();
     auto http = network->CreateHttp(0);
-
-    http->SetHeader("User-Agent", "ESP32-Music-Player/1.0");
-    http->SetHeader("Accept", "*/*");
-    http->SetHeader("Range", "bytes=0-");
-
-    bool is_https = (radio_url.find("https://") == 0);
-    ESP_LOGI(TAG, "Connecting to %s stream: %s", is_https ? "HTTPS" : "HTTP", radio_url.c_str());
-
     auto display = Board::GetInstance().GetDisplay();
 
-    if (!http->Open("GET", radio_url)) {
-        ESP_LOGE(TAG, "Failed to connect to radio stream URL: %s", radio_url.c_str());
-        is_downloading_ = false;
-        if (display) display->SetMusicInfo("Radio connection error");
-        return;
-    }
-
-    int status_code = http->GetStatusCode();
-    if (status_code >= 300 && status_code < 400) {
-        ESP_LOGW(TAG, "HTTP %d redirect detected but cannot follow", status_code);
-        http->Close();
-        is_downloading_ = false;
-        return;
-    }
-    if (status_code != 200 && status_code != 206) {
-        ESP_LOGE(TAG, "HTTP GET failed with status code: %d", status_code);
-        http->Close();
-        is_downloading_ = false;
-        return;
-    }
+    bool is_https = (radio_url.find("https://") == 0);
 
-    ESP_LOGI(TAG, "Started downloading radio stream, status: %d", status_code);
+    // Mở (lại) kết nối, false nếu lỗi mạng hoặc HTTP status không dùng được
+    auto open_stream = [&]() -> bool {
+        http->SetHeader("User-Agent", "ESP32-Music-Player/1.0");
+        http->SetHeader("Accept", "*/*");
+        http->SetHeader("Range", "bytes=0-");
+        // Xin metadata ICY để lấy tên bài đang phát
+        http->SetHeader("Icy-MetaData", "1");
+
+        ESP_LOGI(TAG, "Connecting to %s stream: %s", is_https ? "HTTPS" : "HTTP", radio_url.c_str());
+        if (!http->Open("GET", radio_url)) {
+            ESP_LOGE(TAG, "Failed to connect to radio stream URL: %s", radio_url.c_str());
+            return false;
+        }
+        int status_code = http->GetStatusCode();
+        if (status_code >= 300 && status_code < 400) {
+            ESP_LOGW(TAG, "HTTP %d redirect detected but cannot follow", status_code);
+            http->Close();
+            return false;
+        }
+        if (status_code != 200 && status_code != 206) {
+            ESP_LOGE(TAG, "HTTP GET failed with status code: %d", status_code);
+            http->Close();
+            return false;
+        }
+        std::string metaint = http->GetResponseHeader("icy-metaint");
+        if (metaint.empty()) {
+            metaint = http->GetResponseHeader("Icy-MetaInt");
+        }
+        // Mỗi kết nối bắt đầu lại khoảng metaint từ byte đầu tiên
+        icy_filter_.Reset(metaint.empty() ? 0 : (size_t)std::max(0, atoi(metaint.c_str())));
+        ESP_LOGI(TAG, "Started downloading radio stream, status: %d, icy-metaint: %u",
+                 status_code, (unsigned)icy_filter_.metaint());
+        return true;
+    };
 
-    const size_t chunk_size = 4096;
-    char* buffer = new char[chunk_size];
     size_t total_downloaded = 0;
     size_t total_print_bytes = 0;
-    const int kMaxReconnectAttempts = 3;
-    int reconnect_attempts = 0;
+    // Backoff chỉ được reset khi kết nối mới thực sự đưa audio vào ring
+    StreamReconnect reconnect(RECONNECT_MAX_ATTEMPTS, RECONNECT_BASE_MS, RECONNECT_MAX_MS);
 
     while (is_downloading_ && is_playing_) {
-        int bytes_read = http->Read(buffer, chunk_size);
+        if (!open_stream()) {
+            reconnecting_ = true;
+            if (!WaitBackoff(reconnect, esp_timer_get_time())) {
+                break;
+            }
+            continue;
+        }
 
-        // ---- HANDLE READ ERRORS & RECONNECT ----
-        if (bytes_read < 0 || bytes_read == 0) {
-            reconnect_attempts++;
-            ESP_LOGW(TAG, "Stream lost (bytes_read=%d), trying reconnect (%d/%d)...", bytes_read, reconnect_attempts, kMaxReconnectAttempts);
+        bool connection_has_audio = false;
+        int64_t lost_at_us = esp_timer_get_time();
 
-            if (display) {
-                display->SetMusicInfo("🔌 Mất kết nối radio...\n⟳ Đang thử lại...");
+        while (is_downloading_ && is_playing_) {
+            // Wait for buffer space
+            {
+                std::unique_lock<std::mutex> lock(buffer_mutex_);
+                buffer_cv_.wait(lock, [this] {
+                    return stream_ring_.free_space() >= WRITE_WATERMARK || !is_downloading_ || !is_playing_;
+                });
+            }
+            if (!is_downloading_ || !is_playing_) {
+                break;
             }
 
-            if (reconnect_attempts > kMaxReconnectAttempts) {
-                ESP_LOGE(TAG, "Exceeded max reconnect attempts");
+            size_t span = 0;
+            uint8_t* dest = stream_ring_.WriteSpan(span);
+            int64_t read_start = esp_timer_get_time();
+            int bytes_read = http->Read((char*)dest, std::min(span, MAX_READ_SIZE));
+            int64_t read_end = esp_timer_get_time();
+
+            if (bytes_read <= 0) {
+                // Icecast đóng kết nối hoặc mạng treo quá timeout: nối lại
+                ESP_LOGW(TAG, "Stream lost (bytes_read=%d) after %u bytes, buffered %u bytes",
+                         bytes_read, (unsigned)total_downloaded, (unsigned)stream_ring_.size());
+                lost_at_us = read_start;
                 break;
             }
 
-            vTaskDelay(pdMS_TO_TICKS(1500));  // Wait 1.5s
-            http->Close();
+            // ICY metadata is cut out in place, only audio is committed to the ring
+            size_t audio_bytes = icy_filter_.Filter(dest, bytes_read);
+            std::string title;
+            if (icy_filter_.TakeTitle(title)) {
+                {
+                    std::lock_guard<std::mutex> lock(buffer_mutex_);
+                    stream_title_ = title;
+                }
+                ShowNowPlaying();
+            }
 
-            if (!http->Open("GET", radio_url)) {
-                ESP_LOGE(TAG, "Reconnect failed at attempt %d", reconnect_attempts);
-                continue;
-            } else {
-                ESP_LOGI(TAG, "Reconnect success at attempt %d", reconnect_attempts);
-                continue;
+            if (total_downloaded == 0 && audio_bytes >= 4) {
+                if (memcmp(dest, "ID3", 3) == 0) {
+                    ESP_LOGI(TAG, "Detected MP3 with ID3 tag");
+                } else if (dest[0] == 0xFF && (dest[1] & 0xF6) == 0xF0) {
+                    ESP_LOGI(TAG, "Detected AAC ADTS header");
+                } else if (dest[0] == 0xFF && (dest[1] & 0xE0) == 0xE0) {
+                    ESP_LOGI(TAG, "Detected MP3 file header");
+                } else if (dest[0] == 0x56 && (dest[1] & 0xE0) == 0xE0) {
+                    ESP_LOGI(TAG, "Detected AAC LOAS/LATM header");
+                } else if (memcmp(dest, "OggS", 4) == 0) {
+                    ESP_LOGI(TAG, "Detected OGG");
+                } else {
+                    ESP_LOGI(TAG, "Unknown format, first 4 bytes: %02X %02X %02X %02X",
+                             dest[0], dest[1], dest[2], dest[3]);
+                }
             }
-        }
 
-        reconnect_attempts = 0;
+            // Stopped while blocked in Read, the ring may already have been cleared
+            if (!is_downloading_) {
+                break;
+            }
+            if (audio_bytes == 0) {
+                continue;
+            }
+            stream_ring_.CommitWrite(audio_bytes);
+            total_downloaded += audio_bytes;
+            total_print_bytes += audio_bytes;
+            downloaded_bytes_ += audio_bytes;
+
+            if (!connection_has_audio) {
+                connection_has_audio = true;
+                int attempts = reconnect.attempt();
+                reconnecting_ = false;
+                if (reconnect.OnAudio(read_end)) {
+                    // Nối lại: decoder và dữ liệu còn trong ring được giữ nguyên, phát tiếp
+                    int64_t outage_us = reconnect.outage_us();
+                    reconnect_count_++;
+                    outage_ms_ += (uint32_t)(outage_us / 1000);
+                    {
+                        std::lock_guard<std::mutex> lock(buffer_mutex_);
+                        preroll_.OnRead(0, outage_us, read_end);
+                    }
+                    ESP_LOGI(TAG, "Reconnected after %lld ms (%d failed attempts, reconnect #%lu)",
+                             (long long)(outage_us / 1000), attempts, (unsigned long)reconnect_count_.load());
+                    ShowNowPlaying();
+                }
+            }
 
-        if (bytes_read < 16) {
-            ESP_LOGI(TAG, "Data chunk too small: %d bytes", bytes_read);
-        }
+            {
+                std::lock_guard<std::mutex> lock(buffer_mutex_);
+                preroll_.OnRead(audio_bytes, read_end - read_start, read_end);
+                buffer_cv_.notify_all();
+            }
 
-        if (total_downloaded == 0 && bytes_read >= 4) {
-            if (memcmp(buffer, "ID3", 3) == 0) {
-                ESP_LOGI(TAG, "Detected MP3 with ID3 tag");
-            } else if ((buffer[0] & 0xFF) == 0xFF && (buffer[1] & 0xE0) == 0xE0) {
-                ESP_LOGI(TAG, "Detected MP3 file header");
-            } else if (memcmp(buffer, "RIFF", 4) == 0) {
-                ESP_LOGI(TAG, "Detected WAV");
-            } else if (memcmp(buffer, "fLaC", 4) == 0) {
-                ESP_LOGI(TAG, "Detected FLAC");
-            } else if (memcmp(buffer, "OggS", 4) == 0) {
-                ESP_LOGI(TAG, "Detected OGG");
-            } else {
-                ESP_LOGI(TAG, "Unknown format, first 4 bytes: %02X %02X %02X %02X",
-                         (unsigned char)buffer[0], (unsigned char)buffer[1],
-                         (unsigned char)buffer[2], (unsigned char)buffer[3]);
+            if (total_print_bytes >= (128 * 1024)) {
+                total_print_bytes = 0;
+                ESP_LOGI(TAG, "Downloaded %u bytes, buffer size: %u", (unsigned)total_downloaded,
+                         (unsigned)stream_ring_.size());
             }
         }
+        http->Close();
 
-        uint8_t* chunk_data = (uint8_t*)heap_caps_malloc(bytes_read, MALLOC_CAP_SPIRAM);
-        if (!chunk_data) {
-            ESP_LOGE(TAG, "Failed to allocate memory for radio chunk");
+        if (!is_downloading_ || !is_playing_) {
             break;
         }
-        memcpy(chunk_data, buffer, bytes_read);
-
-        {
-            std::unique_lock<std::mutex> lock(buffer_mutex_);
-            buffer_cv_.wait(lock, [this] { return buffer_size_ < MAX_BUFFER_SIZE || !is_downloading_; });
-
-            if (is_downloading_) {
-                audio_buffer_.push(RadioAudioChunk(chunk_data, bytes_read));
-                buffer_size_ += bytes_read;
-                total_downloaded += bytes_read;
-                total_print_bytes += bytes_read;
-                buffer_cv_.notify_one();
-
-                if (total_print_bytes >= (128 * 1024)) {
-                    total_print_bytes = 0;
-                    ESP_LOGI(TAG, "Downloaded %d bytes, buffer size: %d", total_downloaded, buffer_size_);
-                }
-            } else {
-                heap_caps_free(chunk_data);
-                break;
-            }
+        if (display) {
+            display->SetMusicInfo("🔌 Mất kết nối radio...\n⟳ Đang thử lại...");
+        }
+        reconnecting_ = true;
+        if (!WaitBackoff(reconnect, lost_at_us)) {
+            break;
         }
     }
 
-    delete[] buffer;
-    http->Close();
-
     if (is_downloading_) {
         ESP_LOGI(TAG, "Radio stream download completed");
     } else {
@@ -446,6 +506,7 @@ void Esp32Radio::DownloadRadioStream(const std::string& radio_url) {
     }
 
     is_downloading_ = false;
+    reconnecting_ = false;
 
     {
         std::lock_guard<std::mutex> lock(buffer_mutex_);
@@ -459,6 +520,23 @@ void Esp32Radio::DownloadRadioStream(const std::string& radio_url) {
     ESP_LOGI(TAG, "Radio stream download thread finished");
 }
 
+// Ghi nhận một lần kết nối thất bại (lúc failed_at_us) và chờ trước lần thử kế tiếp,
+// false nếu đã hết số lần thử hoặc bị dừng trong lúc chờ
+bool Esp32Radio::WaitBackoff(StreamReconnect& reconnect, int64_t failed_at_us) {
+    int delay_ms = reconnect.OnFailure(failed_at_us);
+    if (delay_ms < 0) {
+        ESP_LOGE(TAG, "Exceeded max reconnect attempts");
+        return false;
+    }
+    ESP_LOGW(TAG, "Reconnect attempt %d/%d in %d ms", reconnect.attempt(), reconnect.max_attempts(), delay_ms);
+
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+    buffer_cv_.wait_for(lock, std::chrono::milliseconds(delay_ms), [this] {
+        return !is_downloading_ || !is_playing_;
+    });
+    return is_downloading_ && is_playing_;
+}
+
 void Esp32Radio::PlayRadioStream() {
     ESP_LOGI(TAG, "Starting VOV radio stream playback with AAC decoder");
     
@@ -481,29 +559,18 @@ void Esp32Radio::PlayRadioStream() {
         return;
     }
     
-    // Wait for the buffer to have enough data to start playback
-    {
-        std::unique_lock<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.wait(lock, [this] { 
-            return buffer_size_ >= MIN_BUFFER_SIZE || (!is_downloading_ && !audio_buffer_.empty()); 
-        });
-    }
+    Application::GetInstance().BeginAudioStream();
+
+    // Wait for the pre-roll before starting playback
+    WaitForPreroll(false);
     
-    ESP_LOGI(TAG, "Starting radio playback with buffer size: %d", buffer_size_);
+    ESP_LOGI(TAG, "Starting radio playback with buffer size: %u", (unsigned)stream_ring_.size());
     
     size_t total_played_bytes = 0;
     size_t total_print_bytes = 0;
-    uint8_t* input_buffer = nullptr;
-    int bytes_left = 0;
-    uint8_t* read_ptr = nullptr;
-    
-    // Allocate input buffer (for both MP3 and AAC)
-    input_buffer = (uint8_t*)heap_caps_malloc(4096, MALLOC_CAP_SPIRAM);
-    if (!input_buffer) {
-        ESP_LOGE(TAG, "Failed to allocate input buffer");
-        is_playing_ = false;
-        return;
-    }
+    int consecutive_errors = 0;
+    size_t resync_bytes = 0;        // Bytes dropped since the last whole frame
+    frame_splitter_.Reset();
 
     auto& board = Board::GetInstance();
     auto display = board.GetDisplay();
@@ -551,92 +618,89 @@ void Esp32Radio::PlayRadioStream() {
 				station_name_displayed_ = true;
 			}
 		}
-								
-        // If more audio data is needed, read from the buffer
-        if (bytes_left < 4096) {
-            RadioAudioChunk chunk;
-            
-            // Retrieve audio data from the buffer
-            {
-                std::unique_lock<std::mutex> lock(buffer_mutex_);
-                if (audio_buffer_.empty()) {
-                    if (!is_downloading_) {
-                        ESP_LOGI(TAG, "Radio stream ended, total played: %d bytes", total_played_bytes);
-                        break;
-                    }
-                    // Wait for new data
-                    buffer_cv_.wait(lock, [this] { return !audio_buffer_.empty() || !is_downloading_; });
-                    if (audio_buffer_.empty()) {
-                        continue;
-                    }
-                }
-                
-                chunk = audio_buffer_.front();
-                audio_buffer_.pop();
-                buffer_size_ -= chunk.size;
-                total_played_bytes += chunk.size;
-                total_print_bytes += chunk.size;
-                
-                // Notify download thread that buffer has space
-                buffer_cv_.notify_one();
+
+        // Compressed data readable in place, at least one decode window unless the stream is ending
+        size_t available = 0;
+        uint8_t* read_ptr = stream_ring_.ReadSpan(available);
+
+        if (available < STREAM_RING_GUARD && is_downloading_) {
+            // Underrun (or reconnecting): refill to the adaptive pre-roll, the decoder
+            // keeps its state and continues with the next frame
+            WaitForPreroll(true);
+            continue;
+        }
+        if (available == 0) {
+            ESP_LOGI(TAG, "Radio stream ended, total played: %u bytes", (unsigned)total_played_bytes);
+            break;
+        }
+
+        // Split off one whole frame, the decoder never sees a cut frame or arbitrary chunk boundaries
+        size_t frame_length = 0;
+        auto split = frame_splitter_.Next(read_ptr, available, !is_downloading_, frame_length);
+        if (split == AacFrameSplitter::Result::NeedMore) {
+            if (!is_downloading_) {
+                ESP_LOGI(TAG, "AAC radio stream ended");
+                break;
             }
-            
-            // Add new data to the input buffer
-            if (chunk.data && chunk.size > 0) {
-                // Move remaining data to the beginning of the buffer
-                if (bytes_left > 0 && read_ptr != input_buffer) {
-                    memmove(input_buffer, read_ptr, bytes_left);
-                }
-                
-                // Check buffer space
-                size_t space_available = 8192 - bytes_left;
-                size_t copy_size = std::min(chunk.size, space_available);
-                
-                // Copy new data
-                memcpy(input_buffer + bytes_left, chunk.data, copy_size);
-                bytes_left += copy_size;
-                read_ptr = input_buffer;
-                
-                // AAC streams don't need ID3 tag processing
-                
-                // Free chunk memory
-                heap_caps_free(chunk.data);
+            std::unique_lock<std::mutex> lock(buffer_mutex_);
+            buffer_cv_.wait(lock, [this, available] {
+                return stream_ring_.size() > available || !is_downloading_ || !is_playing_;
+            });
+            continue;
+        }
+        if (split == AacFrameSplitter::Result::Skip) {
+            // Dữ liệu không phải frame (đầu stream, sau khi nối lại hoặc hỏng): bỏ tới sync kế tiếp
+            resync_bytes += frame_length;
+            if (resync_bytes > MAX_RESYNC_BYTES) {
+                ESP_LOGE(TAG, "No AAC frame found in %u bytes, not an ADTS/LATM stream", (unsigned)resync_bytes);
+                break;
             }
+            ConsumeStream(frame_length);
+            continue;
         }
-        
-        // AAC DECODER for VOV streams
-        // === AAC DECODER PATH ===
-        if (bytes_left <= 0) {
-            continue; // Need more data
+        if (resync_bytes > 0) {
+            ESP_LOGW(TAG, "Skipped %u bytes to the next AAC frame", (unsigned)resync_bytes);
+            decode_errors_++;
+            resync_bytes = 0;
         }
-        
-        bool input_eos = (!is_downloading_ && audio_buffer_.empty());
-        
+        if (frame_splitter_.framing() == AacFrameSplitter::Framing::Loas) {
+            // esp_audio_simple_dec chỉ nhận AAC dạng ADTS
+            ESP_LOGE(TAG, "LOAS/LATM AAC stream is not supported by the decoder");
+            break;
+        }
+
+        // AAC DECODER for VOV streams, one whole frame per iteration straight from the ring
         esp_audio_simple_dec_raw_t raw = {};
         raw.buffer = read_ptr;
-        raw.len = bytes_left;
-        raw.eos = input_eos;
+        raw.len = frame_length;
+        raw.eos = false;
         
         esp_audio_simple_dec_out_t out_frame = {};
         out_frame.buffer = aac_out_buffer_.data();
         out_frame.len = aac_out_buffer_.size();
         
-        while (raw.len > 0 && is_playing_) {
-            esp_audio_err_t dec_ret = esp_audio_simple_dec_process(aac_decoder_, &raw, &out_frame);
-            if (dec_ret == ESP_AUDIO_ERR_BUFF_NOT_ENOUGH) {
-                // Output buffer not enough, expand and retry
-                aac_out_buffer_.resize(out_frame.needed_size);
-                out_frame.buffer = aac_out_buffer_.data();
-                out_frame.len = out_frame.needed_size;
-                continue;
-            }
-            if (dec_ret != ESP_AUDIO_ERR_OK) {
-                ESP_LOGE(TAG, "AAC decode error: %d", dec_ret);
-                is_playing_ = false;
+        esp_audio_err_t dec_ret = esp_audio_simple_dec_process(aac_decoder_, &raw, &out_frame);
+        if (dec_ret == ESP_AUDIO_ERR_BUFF_NOT_ENOUGH) {
+            // Output buffer not enough, expand and retry
+            aac_out_buffer_.resize(out_frame.needed_size);
+            continue;
+        }
+        if (dec_ret != ESP_AUDIO_ERR_OK) {
+            // Header hợp lệ nhưng payload hỏng: bỏ đúng frame này
+            decode_errors_++;
+            if (++consecutive_errors > MAX_DECODE_ERRORS) {
+                ESP_LOGE(TAG, "AAC decode error: %d, giving up after %d errors", dec_ret, consecutive_errors);
                 break;
             }
-            
-            if (out_frame.decoded_size > 0) {
+            ESP_LOGW(TAG, "AAC decode error: %d, frame of %u bytes dropped", dec_ret, (unsigned)frame_length);
+            ConsumeStream(frame_length);
+            continue;
+        }
+        // The frame is whole, whatever the decoder kept internally belongs to it
+        size_t consumed = frame_length;
+
+        if (out_frame.decoded_size > 0) {
+            consecutive_errors = 0;
 
 				// First decode -> get stream info
 				if (!aac_info_ready_) {
@@ -651,9 +715,6 @@ void Esp32Radio::PlayRadioStream() {
 					// ===============================
 					//   HIỂN THỊ THÔNG TIN AAC LÊN LCD
 					// ===============================
-					auto& board = Board::GetInstance();
-					auto display = board.GetDisplay();
-
 					if (display) {
 						std::ostringstream oss;
 
@@ -675,20 +736,24 @@ void Esp32Radio::PlayRadioStream() {
 				int total_samples = out_frame.decoded_size / bytes_per_sample;
 				int samples_per_channel = (channels > 0) ? (total_samples / channels) : total_samples;
 
+				{
+					// Byte rate thực của stream cho pre-roll thích ứng
+					std::lock_guard<std::mutex> lock(buffer_mutex_);
+					preroll_.OnDecoded(consumed, samples_per_channel, aac_info_.sample_rate);
+				}
+
 				int16_t* pcm_in = reinterpret_cast<int16_t*>(out_frame.buffer);
-				std::vector<int16_t> mono_buffer;
 				int16_t* final_pcm_data = nullptr;
 				int final_sample_count = 0;
 							
                 if (channels == 2) {
-                    // Downmix stereo -> mono
-                    mono_buffer.resize(samples_per_channel);
+                    // Downmix stereo -> mono in place, sample i only reads slots 2i and 2i+1
                     for (int i = 0; i < samples_per_channel; ++i) {
                         int left = pcm_in[i * 2];
                         int right = pcm_in[i * 2 + 1];
-                        mono_buffer[i] = (int16_t)((left + right) / 2);
+                        pcm_in[i] = (int16_t)((left + right) / 2);
                     }
-                    final_pcm_data = mono_buffer.data();
+                    final_pcm_data = pcm_in;
                     final_sample_count = samples_per_channel;
                 } else if (channels == 1) {
                     final_pcm_data = pcm_in;
@@ -699,8 +764,7 @@ void Esp32Radio::PlayRadioStream() {
                     final_sample_count = total_samples;
                 }
                 
-                // Amplify audio using station-specific volume setting
-                std::vector<int16_t> amplified_buffer(final_sample_count);
+                // Amplify audio in place using station-specific volume setting
                 const float amplification_factor = current_station_volume_; // Station-specific volume
                 
                 for (int i = 0; i < final_sample_count; ++i) {
@@ -711,18 +775,10 @@ void Esp32Radio::PlayRadioStream() {
                     } else if (amplified_sample < INT16_MIN) {
                         amplified_sample = INT16_MIN;
                     }
-                    amplified_buffer[i] = (int16_t)amplified_sample;
+                    final_pcm_data[i] = (int16_t)amplified_sample;
                 }
                 
-                // Create AudioStreamPacket with amplified audio
-                AudioStreamPacket packet;
-                packet.sample_rate = aac_info_.sample_rate;
-                packet.frame_duration = 60;
-                packet.timestamp = 0;
-                
                 size_t pcm_size_bytes = final_sample_count * sizeof(int16_t);
-                packet.payload.resize(pcm_size_bytes);
-                memcpy(packet.payload.data(), amplified_buffer.data(), pcm_size_bytes);
 
                 if (display) {
                     if (display_mode_ == DISPLAY_MODE_SPECTRUM) {
@@ -730,42 +786,30 @@ void Esp32Radio::PlayRadioStream() {
                         final_pcm_data_fft = display->MakeAudioBuffFFT(pcm_size_bytes);
 
                         // Copy amplified data to FFT buffer
-                        display->FeedAudioDataFFT(amplified_buffer.data(), pcm_size_bytes);
+                        display->FeedAudioDataFFT(final_pcm_data, pcm_size_bytes);
                     }
                 }
 
-                app.AddAudioData(std::move(packet));
-                
-                if (total_print_bytes >= (128 * 1024)) {
-                    total_print_bytes = 0;
-                    ESP_LOGI(TAG, "AAC: Played %d bytes, buffer size: %d", total_played_bytes, buffer_size_);
-                }
-            }
-            
-            // Update input pointer based on consumed bytes
-            raw.len -= raw.consumed;
-            raw.buffer += raw.consumed;
+                // Hand the decoder output straight to the codec, it is only borrowed for the call
+                app.AddAudioData(std::span<const int16_t>(final_pcm_data, final_sample_count),
+                                 aac_info_.sample_rate);
         }
-        
-        // Update read_ptr and bytes_left for main loop
-        bytes_left = raw.len;
-        read_ptr = const_cast<uint8_t*>(raw.buffer);
-        
-        // Check for end of stream
-        if (input_eos && bytes_left == 0) {
-            ESP_LOGI(TAG, "AAC radio stream ended");
-            break;
+
+        // Release what the decoder used, the downloader may be waiting for the space
+        ConsumeStream(consumed);
+        total_played_bytes += consumed;
+        total_print_bytes += consumed;
+
+        if (total_print_bytes >= (128 * 1024)) {
+            total_print_bytes = 0;
+            ESP_LOGI(TAG, "AAC: Played %u bytes, buffer size: %u", (unsigned)total_played_bytes,
+                     (unsigned)stream_ring_.size());
         }
     }
     
-    // Cleanup
-    if (input_buffer) {
-        heap_caps_free(input_buffer);
-    }
-    
     if (is_downloading_) {
+        // The ring is left to the downloader, it stops on is_playing_ and PlayUrl() clears it
         ESP_LOGI(TAG, "Radio stream playback finished successfully");
-        ClearAudioBuffer();  // Clear remaining buffer data
         // Reset the sample rate to the original value
         ResetSampleRate();
     } else {
@@ -777,6 +821,11 @@ void Esp32Radio::PlayRadioStream() {
 
     ESP_LOGI(TAG, "Radio stream playback finished, total played: %d bytes", total_played_bytes);
     is_playing_ = false;
+    {
+        // Wake the downloader if it is waiting for space
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        buffer_cv_.notify_all();
+    }
     
     // Stop FFT display
     if (display_mode_ == DISPLAY_MODE_SPECTRUM) {
@@ -790,20 +839,71 @@ void Esp32Radio::PlayRadioStream() {
 
 void Esp32Radio::ClearAudioBuffer() {
     std::lock_guard<std::mutex> lock(buffer_mutex_);
-    
-    while (!audio_buffer_.empty()) {
-        RadioAudioChunk chunk = audio_buffer_.front();
-        audio_buffer_.pop();
-        if (chunk.data) {
-            heap_caps_free(chunk.data);
-        }
-    }
-    
-    buffer_size_ = 0;
+    stream_ring_.Reset();
+    buffer_cv_.notify_all();
     ESP_LOGI(TAG, "Radio audio buffer cleared");
 }
 
+void Esp32Radio::ConsumeStream(size_t length) {
+    stream_ring_.Consume(length);
+    if (stream_ring_.free_space() >= WRITE_WATERMARK) {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        buffer_cv_.notify_all();
+    }
+}
+
+// Chờ đủ pre-roll; false nếu bị dừng hoặc stream đã hết trong lúc chờ
+bool Esp32Radio::WaitForPreroll(bool underrun) {
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+    size_t target = preroll_.target_bytes();
+    if (underrun) {
+        underrun_count_++;
+        ESP_LOGW(TAG, "Stream underrun #%lu, buffered %u bytes, refilling to %u bytes (jitter %lu ms)",
+                 (unsigned long)underrun_count_.load(), (unsigned)stream_ring_.size(), (unsigned)target,
+                 (unsigned long)preroll_.jitter_ms());
+    }
+    buffer_cv_.wait(lock, [this] {
+        return stream_ring_.size() >= preroll_.target_bytes() || !is_downloading_ || !is_playing_;
+    });
+    return is_downloading_ && is_playing_;
+}
 
+std::string Esp32Radio::GetStreamTitle() const {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    return stream_title_;
+}
+
+// Tên đài và bài đang phát (nếu đài gửi ICY metadata)
+void Esp32Radio::ShowNowPlaying() {
+    auto display = Board::GetInstance().GetDisplay();
+    if (!display || current_station_name_.empty()) {
+        return;
+    }
+    std::string title = GetStreamTitle();
+    std::string info = "Radio 《" + current_station_name_ + "》";
+    info += title.empty() ? "Đang phát..." : "\n♪ " + title;
+    display->SetMusicInfo(info.c_str());
+}
+
+Radio::StreamStats Esp32Radio::GetStreamStats() const {
+    StreamStats stats;
+    stats.capacity_bytes = stream_ring_.capacity();
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        stats.buffered_bytes = stream_ring_.size();
+        stats.buffered_ms = preroll_.BytesToMs(stats.buffered_bytes);
+        stats.preroll_bytes = preroll_.target_bytes();
+        stats.bitrate_kbps = preroll_.byte_rate() * 8 / 1000;
+        stats.jitter_ms = preroll_.jitter_ms();
+    }
+    stats.underruns = underrun_count_;
+    stats.reconnects = reconnect_count_;
+    stats.outage_ms = outage_ms_;
+    stats.decode_errors = decode_errors_;
+    stats.downloaded_bytes = downloaded_bytes_;
+    stats.reconnecting = reconnecting_;
+    return stats;
+}
 
 void Esp32Radio::ResetSampleRate() {
     auto codec = Board::GetInstance().GetAudioCodec();
@@ -4,7 +4,6 @@
 #include <string>
 #include <thread>
 #include <atomic>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <vector>
@@ -13,6 +12,11 @@
 #include <cstddef>
 
 #include "radio.h"
+#include "audio/stream_byte_ring.h"
+#include "audio/stream_preroll.h"
+#include "audio/stream_reconnect.h"
+#include "audio/icy_metadata.h"
+#include "audio/aac_frame_splitter.h"
 
 // AAC Simple Decoder for VOV radio streams
 // VOV URLs return audio/aacp format which requires AAC decoder
@@ -20,15 +24,6 @@ extern "C" {
 #include "esp_audio_simple_dec_default.h"
 }
 
-// Audio data chunk structure
-struct RadioAudioChunk {
-    uint8_t* data;
-    size_t size;
-    
-    RadioAudioChunk() : data(nullptr), size(0) {}
-    RadioAudioChunk(uint8_t* d, size_t s) : data(d), size(s) {}
-};
-
 // Radio station information structure
 struct RadioStation {
     std::string name;        // Radio station name
@@ -65,13 +60,37 @@ private:
     std::thread play_thread_;
     std::thread download_thread_;
     
-    // Audio buffer
-    std::queue<RadioAudioChunk> audio_buffer_;
-    std::mutex buffer_mutex_;
+    // Jitter buffer: HTTP reads land in the ring, the AAC decoder reads it in place.
+    // Pre-roll (start and refill level) follows the measured jitter, see StreamPreroll
+    StreamByteRing stream_ring_;
+    mutable std::mutex buffer_mutex_;
     std::condition_variable buffer_cv_;
-    size_t buffer_size_;
-    static constexpr size_t MAX_BUFFER_SIZE = 256 * 1024;  // 256KB buffer
-    static constexpr size_t MIN_BUFFER_SIZE = 32 * 1024;   // 32KB minimum playback buffer
+    StreamPreroll preroll_;                          // Guarded by buffer_mutex_
+    std::atomic<uint32_t> underrun_count_{0};
+    std::atomic<uint32_t> reconnect_count_{0};
+    std::atomic<uint32_t> outage_ms_{0};
+    std::atomic<uint32_t> decode_errors_{0};
+    std::atomic<uint64_t> downloaded_bytes_{0};
+    std::atomic<bool> reconnecting_{false};
+
+    IcyMetadataFilter icy_filter_;                   // Download thread only
+    AacFrameSplitter frame_splitter_;                // Play thread only
+    std::string stream_title_;                       // ICY StreamTitle, guarded by buffer_mutex_
+
+    static constexpr size_t STREAM_RING_SIZE  = 256 * 1024;  // 256KB ring, power of two
+    static constexpr size_t STREAM_RING_GUARD = 4 * 1024;    // Contiguous decode window across the wrap
+    static constexpr size_t MIN_PREROLL       = 16 * 1024;
+    static constexpr size_t MAX_PREROLL       = 192 * 1024;
+    static constexpr size_t WRITE_WATERMARK   = 8 * 1024;    // Downloader waits for this much free space
+    static constexpr size_t MAX_READ_SIZE     = 8 * 1024;    // Largest single HTTP read
+
+    // Reconnect: backoff doubles from RECONNECT_BASE_MS up to RECONNECT_MAX_MS, see StreamReconnect
+    static constexpr int RECONNECT_MAX_ATTEMPTS = 8;
+    static constexpr int RECONNECT_BASE_MS      = 500;
+    static constexpr int RECONNECT_MAX_MS       = 8000;
+    static constexpr int MAX_DECODE_ERRORS      = 64;    // Liên tiếp, stream không phải AAC
+    static constexpr size_t MAX_FRAME_SIZE      = STREAM_RING_GUARD - 16;  // Frame must fit the contiguous window
+    static constexpr size_t MAX_RESYNC_BYTES    = 64 * 1024;               // Không tìm thấy frame nào: bỏ cuộc
     
     // AAC Simple Decoder for VOV radio streams
     esp_audio_simple_dec_handle_t aac_decoder_;
@@ -85,9 +104,13 @@ private:
     void DownloadRadioStream(const std::string& radio_url);
     void PlayRadioStream();
     void ClearAudioBuffer();
+    void ConsumeStream(size_t length);
+    bool WaitForPreroll(bool underrun);
+    bool WaitBackoff(StreamReconnect& reconnect, int64_t failed_at_us);
     bool InitializeAacDecoder();
     void CleanupAacDecoder();
     void ResetSampleRate();
+    void ShowNowPlaying();
     
     // ID3 tag handling
     size_t SkipId3Tag(uint8_t* data, size_t size);
@@ -113,11 +136,13 @@ public:
     // Get current playback status
     virtual bool IsPlaying() const override { return is_playing_; }
     virtual std::string GetCurrentStation() const override { return current_station_name_; }
+    virtual std::string GetStreamTitle() const override;
     
     // Buffer status
-    virtual size_t GetBufferSize() const override { return buffer_size_; }
+    virtual size_t GetBufferSize() const override { return stream_ring_.size(); }
     virtual bool IsDownloading() const override { return is_downloading_; }
     virtual int16_t* GetAudioData() override { return final_pcm_data_fft; }
+    virtual StreamStats GetStreamStats() const override;
     
     // Display mode control methods
     void SetDisplayMode(DisplayMode mode);
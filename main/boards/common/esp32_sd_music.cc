@@ -12,6 +12,7 @@
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <memory>
 #include <cctype>
 #include <cstdio>
 #include <unordered_set>
@@ -19,8 +20,6 @@
 
 #include <esp_log.h>
 #include <esp_heap_caps.h>
-#include "esp_audio_dec.h"
-#include "esp_audio_simple_dec_default.h"
 #include <esp_pthread.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -45,13 +44,6 @@ static std::string ToLowerAscii(const std::string& s)
     return out;
 }
 
-static std::string ExtractDirectory(const std::string& full_path)
-{
-    size_t pos = full_path.find_last_of('/');
-    if (pos == std::string::npos) return std::string();
-    return full_path.substr(0, pos);
-}
-
 static std::string ExtractBaseNameNoExt(const std::string& name_or_path)
 {
     size_t slash = name_or_path.find_last_of('/');
@@ -83,42 +75,6 @@ static std::string MsToTimeString(int64_t ms)
     return std::string(buf);
 }
 
-// Chuẩn hóa chuỗi cho tìm kiếm:
-// - lower ASCII
-// - gom ' ', '_', '-', '.', '/', '\\' thành 1 khoảng trắng
-// - giữ nguyên byte UTF-8 đa byte
-static std::string NormalizeForSearch(const std::string& s)
-{
-    std::string lower = ToLowerAscii(s);
-    std::string out;
-    out.reserve(lower.size());
-
-    bool last_space = false;
-
-    for (char ch : lower) {
-        unsigned char c = static_cast<unsigned char>(ch);
-
-        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
-            out.push_back(ch);
-            last_space = false;
-        } else if (c < 128 && (ch == ' ' || ch == '_' || ch == '-' ||
-                               ch == '.' || ch == '/' || ch == '\\')) {
-            if (!last_space) {
-                out.push_back(' ');
-                last_space = true;
-            }
-        } else {
-            out.push_back(ch);
-            last_space = false;
-        }
-    }
-
-    while (!out.empty() && out.front() == ' ') out.erase(out.begin());
-    while (!out.empty() && out.back() == ' ')  out.pop_back();
-
-    return out;
-}
-
 // Kiểm tra đuôi file (ví dụ ".mp3", ".wav", ...)
 static bool HasExtension(const std::string& path, const char* ext)
 {
@@ -129,125 +85,23 @@ static bool HasExtension(const std::string& path, const char* ext)
     return memcmp(low.data() + low.size() - len_ext, ext, len_ext) == 0;
 }
 
-// Định dạng audio hỗ trợ trên SD
-enum class SdAudioFormat : uint8_t {
-    Unknown = 0,
-    Mp3,
-    Wav,
-    Aac,
-    Flac,
-    Ogg,
-    Opus
-};
-
 static SdAudioFormat DetectAudioFormat(const std::string& path)
 {
     if (HasExtension(path, ".mp3"))  return SdAudioFormat::Mp3;
     if (HasExtension(path, ".wav"))  return SdAudioFormat::Wav;
-    if (HasExtension(path, ".aac") ||
-        HasExtension(path, ".m4a")) return SdAudioFormat::Aac;
+    if (HasExtension(path, ".aac"))  return SdAudioFormat::Aac;
+    if (HasExtension(path, ".m4a"))  return SdAudioFormat::M4a;
     if (HasExtension(path, ".flac")) return SdAudioFormat::Flac;
     if (HasExtension(path, ".ogg"))  return SdAudioFormat::Ogg;
     if (HasExtension(path, ".opus")) return SdAudioFormat::Opus;
     return SdAudioFormat::Unknown;
 }
 
-// Parse header WAV PCM 16-bit đơn giản (RIFF/WAVE/fmt/data)
-static bool ParseWavHeader(FILE* fp,
-                           int& sample_rate,
-                           int& channels,
-                           size_t& data_offset,
-                           size_t& data_size)
-{
-    if (!fp) return false;
-
-    uint8_t header[44];
-    if (fread(header, 1, sizeof(header), fp) != sizeof(header)) {
-        return false;
-    }
-
-    if (memcmp(header, "RIFF", 4) != 0 ||
-        memcmp(header + 8, "WAVE", 4) != 0) {
-        return false;
-    }
-
-    if (memcmp(header + 12, "fmt ", 4) != 0) {
-        return false;
-    }
-
-    uint16_t audio_format = header[20] | (header[21] << 8);
-    uint16_t num_channels = header[22] | (header[23] << 8);
-    uint32_t sampleRate   = header[24] |
-                             (header[25] << 8) |
-                             (header[26] << 16) |
-                             (header[27] << 24);
-    uint16_t bitsPerSample = header[34] | (header[35] << 8);
-
-    if (audio_format != 1 || bitsPerSample != 16 ||
-        num_channels == 0 || sampleRate == 0) {
-        // Chỉ hỗ trợ PCM 16-bit
-        return false;
-    }
-
-    if (memcmp(header + 36, "data", 4) != 0) {
-        // Layout phức tạp hơn (chunk khác) không hỗ trợ ở đây
-        return false;
-    }
-
-    uint32_t dataSize = header[40] |
-                        (header[41] << 8) |
-                        (header[42] << 16) |
-                        (header[43] << 24);
-
-    sample_rate = (int)sampleRate;
-    channels    = (int)num_channels;
-    data_offset = sizeof(header);
-    data_size   = dataSize;
-
-    return true;
-}
-
-// Score cho chế độ gợi ý (tên tương tự + cùng thư mục + tần suất phát)
-static int ComputeTrackScoreForBase(const Esp32SdMusic::TrackInfo& base,
-                                    const Esp32SdMusic::TrackInfo& cand,
-                                    uint32_t cand_play_count)
-{
-    int score = 0;
-
-    std::string base_dir = ExtractDirectory(base.path);
-    std::string cand_dir = ExtractDirectory(cand.path);
-    if (!base_dir.empty() && base_dir == cand_dir) {
-        score += 3;
-    }
-
-    std::string base_name = ExtractBaseNameNoExt(base.name.empty() ? base.path : base.name);
-    std::string cand_name = ExtractBaseNameNoExt(cand.name.empty() ? cand.path : cand.name);
-
-    base_name = ToLowerAscii(base_name);
-    cand_name = ToLowerAscii(cand_name);
+// Khối đọc trước khi mở bài, bằng buffer input của decoder MP3 / simple-dec
+static constexpr size_t kTrackHeadBytes = 4096;
+// Bắt đầu nạp trước bài kế tiếp khi phần còn lại của file nhỏ hơn mức này
+static constexpr int64_t kLookAheadBytes = 256 * 1024;
 
-    if (!base_name.empty() && !cand_name.empty()) {
-        if (cand_name.find(base_name) != std::string::npos ||
-            base_name.find(cand_name) != std::string::npos)
-        {
-            score += 3;
-        } else {
-            auto b_space = base_name.find(' ');
-            auto c_space = cand_name.find(' ');
-            std::string b_first = base_name.substr(0, b_space);
-            std::string c_first = cand_name.substr(0, c_space);
-            if (!b_first.empty() && b_first == c_first) {
-                score += 1;
-            }
-        }
-    }
-
-    if (cand_play_count > 0) {
-        score += static_cast<int>(cand_play_count);
-    }
-
-    return score;
-}
 
 // ================================================================
 //  BẢNG TRA GENRE ID3v1
@@ -514,33 +368,6 @@ static void ReadId3v2_Safe(const std::string& path,
     fclose(f);
 }
 
-// Escape chuỗi sang JSON string
-static std::string JsonEscape(const std::string& in)
-{
-    std::string out;
-    out.reserve(in.size() + 8);
-    for (unsigned char c : in) {
-        switch (c) {
-        case '\"': out += "\\\""; break;
-        case '\\': out += "\\\\"; break;
-        case '\b': out += "\\b";  break;
-        case '\f': out += "\\f";  break;
-        case '\n': out += "\\n";  break;
-        case '\r': out += "\\r";  break;
-        case '\t': out += "\\t";  break;
-        default:
-            if (c < 0x20) {
-                char buf[7];
-                snprintf(buf, sizeof(buf), "\\u%04x", c);
-                out += buf;
-            } else {
-                out.push_back((char)c);
-            }
-        }
-    }
-    return out;
-}
-
 // ============================================================================
 //                         PART 1 / 3
 //      CTOR / DTOR / PLAYLIST / THƯ MỤC / ĐẾM BÀI / CHIA TRANG
@@ -548,7 +375,7 @@ static std::string JsonEscape(const std::string& in)
 
 Esp32SdMusic::Esp32SdMusic()
     : root_directory_(),
-      playlist_(),
+      library_(),
       playlist_mutex_(),
       current_index_(-1),
       play_count_(),
@@ -572,12 +399,12 @@ Esp32SdMusic::Esp32SdMusic()
       history_mutex_(),
       play_history_indices_()
 {
-    ESP_LOGI(TAG, "Initializing SD music player (playlist.json, no ID3v2)");
+    ESP_LOGI(TAG, "Initializing SD music player (library.idx)");
 
     auto& sd = SdMount::GetInstance();
     if (sd.IsMounted()) {
         root_directory_ = sd.GetMountPoint();
-        // Khi khởi động, cố gắng đọc / tạo playlist.json
+        // Khi khởi động, cố gắng đọc / tạo library.idx
         loadTrackList();
     } else {
         ESP_LOGW(TAG, "SD card not mounted yet — will retry later");
@@ -599,6 +426,9 @@ Esp32SdMusic::~Esp32SdMusic()
     }
 
     joinPlaybackThreadWithTimeout();
+    if (search_build_thread_.joinable()) {
+        search_build_thread_.join();
+    }
     cleanupMp3Decoder();
 
     auto display = Board::GetInstance().GetDisplay();
@@ -628,13 +458,11 @@ void Esp32SdMusic::joinPlaybackThreadWithTimeout()
     }
 }
 
-// Playlist loading — sử dụng playlist.json
-// Nếu chưa có / hỏng / rỗng → quét lại và lưu playlist.json
-// Nếu file đã có nội dung hợp lệ → chỉ đọc, không quét
+// Playlist loading — sử dụng library.idx
+// Nếu chưa có / hỏng / rỗng → chuyển từ playlist.json cũ nếu có, không thì quét SD
+// Nếu index hợp lệ → chỉ đọc header + bảng record, chuỗi đọc lười theo trang
 bool Esp32SdMusic::loadTrackList()
 {
-    std::vector<TrackInfo> list;
-
     if (root_directory_.empty()) {
         auto& sd = SdMount::GetInstance();
         if (!sd.IsMounted()) {
@@ -644,31 +472,49 @@ bool Esp32SdMusic::loadTrackList()
         root_directory_ = sd.GetMountPoint();
     }
 
-    // Playlist theo thư mục gốc hiện tại
-    // Ví dụ: /sdcard/playlist.json hoặc /sdcard/Music/playlist.json
-    std::string playlist_path = root_directory_ + "/playlist.json";
+    // Index theo thư mục gốc hiện tại
+    // Ví dụ: /sdcard/library.idx hoặc /sdcard/Music/library.idx
+    std::string index_path = root_directory_ + "/library.idx";
 
-    bool loaded = loadPlaylistFromFile(playlist_path, list);
-    if (!loaded || list.empty()) {
-        ESP_LOGW(TAG,
-                 "playlist.json missing/empty/invalid, scanning SD to rebuild: %s",
-                 root_directory_.c_str());
-
-        ESP_LOGI(TAG, "Scanning SD card: %s", root_directory_.c_str());
-        scanDirectoryRecursive(root_directory_, list);
-
-        // Lưu playlist.json (kể cả khi list rỗng, coi như playlist trống)
-        if (!savePlaylistToFile(playlist_path, list)) {
-            ESP_LOGE(TAG, "Failed to save playlist.json: %s", playlist_path.c_str());
-            return false;
+    bool loaded = false;
+    {
+        // library.idx chỉ đổi qua scanLibrary(), đã mở đúng file thì không đọc lại
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        loaded = (library_.index_path() == index_path && !library_.empty()) ||
+                 (library_.Open(index_path) && !library_.empty());
+    }
+
+    if (!loaded) {
+        std::vector<TrackInfo> legacy;
+        std::string playlist_path = root_directory_ + "/playlist.json";
+        if (loadPlaylistFromFile(playlist_path, legacy)) {
+            // mtime = 0: lần quét lại đầu tiên sẽ đọc lại tag của các bài này
+            ESP_LOGI(TAG, "Converting playlist.json to library.idx");
+            SdMusicLibrary::Builder builder;
+            for (const auto& t : legacy) {
+                builder.Add(t, 0);
+            }
+            std::lock_guard<std::mutex> lock(playlist_mutex_);
+            if (!builder.Save(index_path) || !library_.Open(index_path)) {
+                ESP_LOGE(TAG, "Failed to convert playlist.json: %s", index_path.c_str());
+                return false;
+            }
+        } else {
+            ESP_LOGW(TAG,
+                     "library.idx missing/empty/invalid, scanning SD to rebuild: %s",
+                     root_directory_.c_str());
+            if (!scanLibrary(index_path)) {
+                return false;
+            }
         }
     }
 
+    size_t total = 0;
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        playlist_.swap(list);
-        current_index_ = playlist_.empty() ? -1 : 0;
-        play_count_.assign(playlist_.size(), 0);
+        total = library_.size();
+        current_index_ = total == 0 ? -1 : 0;
+        play_count_.assign(total, 0);
     }
 
     {
@@ -676,28 +522,28 @@ bool Esp32SdMusic::loadTrackList()
         play_history_indices_.clear();
     }
 
-    ESP_LOGI(TAG, "Track list ready from playlist.json: %u tracks",
-             (unsigned)playlist_.size());
-    return !playlist_.empty();
+    ESP_LOGI(TAG, "Track list ready from library.idx: %u tracks", (unsigned)total);
+    startSearchIndexBuild();
+    return total > 0;
 }
 
 size_t Esp32SdMusic::getTotalTracks() const
 {
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    return playlist_.size();
+    return library_.size();
 }
 
 std::vector<Esp32SdMusic::TrackInfo> Esp32SdMusic::listTracks() const
 {
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    return playlist_;
+    return library_.GetRange(0, library_.size());
 }
 
 Esp32SdMusic::TrackInfo Esp32SdMusic::getTrackInfo(int index) const
 {
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    if (index < 0 || index >= (int)playlist_.size()) return {};
-    return playlist_[index];
+    if (index < 0 || index >= (int)library_.size()) return {};
+    return library_.Get(index);
 }
 
 // Gom code build path + resolve FAT short / case-insensitive
@@ -760,37 +606,25 @@ bool Esp32SdMusic::playDirectory(const std::string& relative_dir)
     }
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (playlist_.empty()) {
+        if (library_.empty()) {
             ESP_LOGE(TAG, "playDirectory: directory is empty: %s", relative_dir.c_str());
             return false;
         }
         current_index_ = 0;
         ESP_LOGI(TAG, "playDirectory: start track #0: %s",
-                 playlist_[0].name.c_str());
+                 library_.GetName(0).c_str());
     }
     return play();
 }
 
-// Tìm index theo keyword (tên hoặc path)
+// Tìm index theo keyword (tên, ca sĩ hoặc path), khớp tốt nhất trước
 int Esp32SdMusic::findTrackIndexByKeyword(const std::string& keyword) const
 {
     if (keyword.empty()) return -1;
 
-    std::string kw = NormalizeForSearch(keyword);
-    if (kw.empty()) return -1;
-
-    std::lock_guard<std::mutex> lock(playlist_mutex_);
-
-    for (int i = 0; i < (int)playlist_.size(); ++i) {
-        std::string name_norm = NormalizeForSearch(playlist_[i].name);
-        std::string path_norm = NormalizeForSearch(playlist_[i].path);
-
-        if ((!name_norm.empty() && name_norm.find(kw) != std::string::npos) ||
-            (!path_norm.empty() && path_norm.find(kw) != std::string::npos)) {
-            return i;
-        }
-    }
-    return -1;
+    ensureSearchIndex();
+    auto matches = search_index_.Search(keyword, 1);
+    return matches.empty() ? -1 : (int)matches[0];
 }
 
 bool Esp32SdMusic::playByName(const std::string& keyword)
@@ -803,7 +637,7 @@ bool Esp32SdMusic::playByName(const std::string& keyword)
     bool need_reload = false;
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (playlist_.empty()) {
+        if (library_.empty()) {
             ESP_LOGW(TAG, "playByName(): playlist empty — reloading");
             need_reload = true;
         }
@@ -824,12 +658,12 @@ bool Esp32SdMusic::playByName(const std::string& keyword)
 
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (found_index < 0 || found_index >= (int)playlist_.size()) {
+        if (found_index < 0 || found_index >= (int)library_.size()) {
             return false;
         }
         current_index_ = found_index;
         ESP_LOGI(TAG, "playByName(): matched track #%d → %s",
-                 found_index, playlist_[found_index].name.c_str());
+                 found_index, library_.GetName(found_index).c_str());
     }
 
     return play();
@@ -838,15 +672,15 @@ bool Esp32SdMusic::playByName(const std::string& keyword)
 std::string Esp32SdMusic::getCurrentTrack() const
 {
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    if (current_index_ < 0 || current_index_ >= (int)playlist_.size()) return "";
-    return playlist_[current_index_].name;
+    if (current_index_ < 0 || current_index_ >= (int)library_.size()) return "";
+    return library_.GetName(current_index_);
 }
 
 std::string Esp32SdMusic::getCurrentTrackPath() const
 {
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    if (current_index_ < 0 || current_index_ >= (int)playlist_.size()) return "";
-    return playlist_[current_index_].path;
+    if (current_index_ < 0 || current_index_ >= (int)library_.size()) return "";
+    return library_.GetPath(current_index_);
 }
 
 std::vector<std::string> Esp32SdMusic::listDirectories() const
@@ -863,7 +697,8 @@ std::vector<std::string> Esp32SdMusic::listDirectories() const
     while ((ent = readdir(d)) != nullptr) {
         std::string name = ent->d_name;
 
-        if (name == "." || name == "..")
+        // Thư mục ẩn (".seek" chứa seek index) không phải thư mục nhạc
+        if (name.empty() || name[0] == '.')
             continue;
 
         std::string full = root_directory_ + "/" + name;
@@ -887,32 +722,84 @@ Esp32SdMusic::searchTracks(const std::string& keyword) const
     std::vector<TrackInfo> results;
     if (keyword.empty()) return results;
 
-    std::string kw = NormalizeForSearch(keyword);
-    if (kw.empty()) return results;
+    ensureSearchIndex();
+    auto matches = search_index_.Search(keyword, 0);
 
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    for (const auto& t : playlist_) {
-        std::string name_norm = NormalizeForSearch(t.name);
-        std::string path_norm = NormalizeForSearch(t.path);
-
-        if ((!name_norm.empty() && name_norm.find(kw) != std::string::npos) ||
-            (!path_norm.empty() && path_norm.find(kw) != std::string::npos)) {
-            results.push_back(t);
+    results.reserve(matches.size());
+    for (uint32_t i : matches) {
+        if (i < library_.size()) {
+            results.push_back(library_.Get(i));
         }
     }
     return results;
 }
 
+// Index tìm kiếm được dựng trên thread nền ngay khi nạp / quét lại thư viện
+// (startSearchIndexBuild), truy vấn đến sớm hơn chỉ chờ lần dựng đó xong.
+// Chỉ giữ playlist_mutex_ khi đọc từng bài, phát nhạc không bị chặn trong lúc dựng.
+void Esp32SdMusic::ensureSearchIndex() const
+{
+    std::lock_guard<std::mutex> build_lock(search_build_mutex_);
+
+    uint32_t generation = 0;
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        generation = library_.generation();
+        count = library_.size();
+    }
+    if (search_index_.generation() == generation && search_index_.size() == count) {
+        return;
+    }
+
+    search_index_.Build(count, [&](size_t i) {
+        SdMusicSearchIndex::Entry e;
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        // Thư viện bị nạp lại giữa chừng → bỏ qua, truy vấn sau sẽ dựng lại
+        if (library_.generation() == generation) {
+            e.name   = library_.GetName(i);
+            e.artist = library_.GetArtist(i);
+            e.path   = library_.GetPath(i);
+        }
+        return e;
+    }, generation);
+}
+
+void Esp32SdMusic::startSearchIndexBuild()
+{
+    // Lần dựng trước (nếu còn chạy) đang dựng thư viện cũ, các bài đọc ra rỗng nên xong nhanh
+    if (search_build_thread_.joinable()) {
+        search_build_thread_.join();
+    }
+
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size  = 6144;
+    cfg.prio        = 2;
+    cfg.thread_name = (char*)"sd_search_idx";
+    esp_pthread_set_cfg(&cfg);
+
+    search_build_thread_ = std::thread([this]() {
+        ensureSearchIndex();
+    });
+}
+
+std::string Esp32SdMusic::getSearchIndexStats() const
+{
+    return search_index_.GetStats();
+}
+
 std::vector<std::string> Esp32SdMusic::listGenres() const
 {
     std::vector<std::string> genres;
     std::unordered_set<std::string> uniq;
 
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    for (const auto &t : playlist_) {
-        if (t.genre.empty()) continue;
-        if (uniq.insert(t.genre).second) {
-            genres.push_back(t.genre);
+    for (size_t i = 0; i < library_.size(); ++i) {
+        std::string genre = library_.GetGenre(i);
+        if (genre.empty()) continue;
+        if (uniq.insert(genre).second) {
+            genres.push_back(genre);
         }
     }
 
@@ -968,20 +855,22 @@ bool Esp32SdMusic::setTrack(int index)
 {
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (index < 0 || index >= (int)playlist_.size()) {
+        if (index < 0 || index >= (int)library_.size()) {
             ESP_LOGE(TAG, "setTrack: index %d out of range", index);
             return false;
         }
         current_index_ = index;
         ESP_LOGI(TAG, "Switching to track #%d: %s",
-                 index, playlist_[index].name.c_str());
+                 index, library_.GetName(index).c_str());
     }
     return play();
 }
 
 void Esp32SdMusic::scanDirectoryRecursive(
     const std::string& dir,
-    std::vector<TrackInfo>& out)
+    SdMusicLibrary::Builder& out,
+    const std::unordered_map<std::string, uint32_t>& known,
+    ScanStats& stats)
 {
     DIR* d = opendir(dir.c_str());
     if (!d) {
@@ -1004,7 +893,9 @@ void Esp32SdMusic::scanDirectoryRecursive(
         }
 
         if (S_ISDIR(st.st_mode)) {
-            scanDirectoryRecursive(full, out);
+            if (name_utf8[0] != '.') {
+                scanDirectoryRecursive(full, out, known, stats);
+            }
             continue;
         }
 
@@ -1012,6 +903,19 @@ void Esp32SdMusic::scanDirectoryRecursive(
         if (fmt == SdAudioFormat::Unknown)
             continue;
 
+        uint32_t mtime = (uint32_t)st.st_mtime;
+
+        // File không đổi size/mtime → dùng lại metadata trong index, không mở file
+        auto it = known.find(full);
+        if (it != known.end()) {
+            std::lock_guard<std::mutex> lock(playlist_mutex_);
+            if (library_.IsUnchanged(it->second, st.st_size, mtime)) {
+                out.Add(library_.Get(it->second), mtime);
+                ++stats.reused;
+                continue;
+            }
+        }
+
         TrackInfo t;
         t.path      = full;
         t.file_size = st.st_size;
@@ -1026,18 +930,55 @@ void Esp32SdMusic::scanDirectoryRecursive(
         else
             t.name = ExtractBaseNameNoExt(name_utf8);
 
-        out.push_back(std::move(t));
+        out.Add(t, mtime);
+        ++stats.parsed;
     }
 
     closedir(d);
 }
 
+bool Esp32SdMusic::scanLibrary(const std::string& index_path)
+{
+    std::unordered_map<std::string, uint32_t> known;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        if (library_.index_path() == index_path) {
+            known = library_.BuildPathMap();
+        }
+    }
+
+    ESP_LOGI(TAG, "Scanning SD card: %s (%u tracks indexed)",
+             root_directory_.c_str(), (unsigned)known.size());
+
+    auto start = std::chrono::steady_clock::now();
+    SdMusicLibrary::Builder builder;
+    ScanStats stats;
+    scanDirectoryRecursive(root_directory_, builder, known, stats);
+
+    {
+        // Ghi đè file đang được đọc lười → giữ lock tới khi mở lại xong
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        if (!builder.Save(index_path)) {
+            ESP_LOGE(TAG, "Failed to save library.idx: %s", index_path.c_str());
+            return false;
+        }
+        if (!library_.Open(index_path)) {
+            return false;
+        }
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    ESP_LOGI(TAG, "Scan done in %lld ms: %u tracks (%u unchanged, %u tags read)",
+             (long long)elapsed, (unsigned)builder.size(),
+             (unsigned)stats.reused, (unsigned)stats.parsed);
+    return true;
+}
+
 // Rebuild playlist theo yêu cầu người dùng (MCP gọi hàm này)
-// Bỏ qua nội dung playlist.json hiện tại, luôn quét lại và ghi đè
+// Luôn duyệt lại SD, nhưng chỉ đọc lại tag của file mới / đổi size hoặc mtime
 bool Esp32SdMusic::rebuildPlaylistFromSd()
 {
-    std::vector<TrackInfo> list;
-
     if (root_directory_.empty()) {
         auto& sd = SdMount::GetInstance();
         if (!sd.IsMounted()) {
@@ -1050,19 +991,24 @@ bool Esp32SdMusic::rebuildPlaylistFromSd()
     ESP_LOGI(TAG, "Rebuilding playlist by scanning directory: %s",
              root_directory_.c_str());
 
-    scanDirectoryRecursive(root_directory_, list);
-
-    std::string playlist_path = root_directory_ + "/playlist.json";
-    if (!savePlaylistToFile(playlist_path, list)) {
-        ESP_LOGE(TAG, "Failed to save playlist.json after rebuild");
+    std::string index_path = root_directory_ + "/library.idx";
+    {
+        // Giữ metadata đã biết kể cả khi library_ đang trỏ tới thư mục khác
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        if (library_.index_path() != index_path) {
+            library_.Open(index_path);
+        }
+    }
+    if (!scanLibrary(index_path)) {
         return false;
     }
 
+    size_t total = 0;
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        playlist_.swap(list);
-        current_index_ = playlist_.empty() ? -1 : 0;
-        play_count_.assign(playlist_.size(), 0);
+        total = library_.size();
+        current_index_ = total == 0 ? -1 : 0;
+        play_count_.assign(total, 0);
     }
 
     {
@@ -1070,75 +1016,15 @@ bool Esp32SdMusic::rebuildPlaylistFromSd()
         play_history_indices_.clear();
     }
 
-    ESP_LOGI(TAG, "Playlist rebuilt: %u tracks",
-             (unsigned)playlist_.size());
-    return !playlist_.empty();
+    ESP_LOGI(TAG, "Playlist rebuilt: %u tracks", (unsigned)total);
+    startSearchIndexBuild();
+    return total > 0;
 }
 
-// Playlist JSON: lưu đủ metadata cần thiết để search/tìm bài (không lưu ảnh bìa)
-bool Esp32SdMusic::savePlaylistToFile(const std::string& playlist_path,
-                                      const std::vector<TrackInfo>& list) const
+std::string Esp32SdMusic::getLibraryStats() const
 {
-    FILE* fp = fopen(playlist_path.c_str(), "wb");
-    if (!fp) {
-        ESP_LOGE(TAG, "Cannot create playlist file: %s", playlist_path.c_str());
-        return false;
-    }
-
-    // Header JSON
-    fprintf(fp, "{\n");
-    fprintf(fp, "  \"version\": 1,\n");
-    fprintf(fp, "  \"tracks\": [\n");
-
-    size_t written = 0;
-
-    for (size_t i = 0; i < list.size(); ++i) {
-        const auto& t = list[i];
-
-        // Chuẩn bị chuỗi đã escape
-        std::string name    = JsonEscape(t.name.empty()
-                                         ? ExtractBaseNameNoExt(t.path)
-                                         : t.name);
-        std::string path    = JsonEscape(t.path);
-        std::string title   = JsonEscape(t.title);
-        std::string artist  = JsonEscape(t.artist);
-        std::string album   = JsonEscape(t.album);
-        std::string genre   = JsonEscape(t.genre);
-        std::string comment = JsonEscape(t.comment);
-        std::string year    = JsonEscape(t.year);
-
-        int track_number = t.track_number;
-        int duration_ms  = t.duration_ms;
-        int bitrate      = t.bitrate_kbps;
-        unsigned long long file_size = (unsigned long long)t.file_size;
-
-        // Bắt đầu object
-        fprintf(fp, "    {\n");
-        fprintf(fp, "      \"name\": \"%s\",\n",    name.c_str());
-        fprintf(fp, "      \"path\": \"%s\",\n",    path.c_str());
-        fprintf(fp, "      \"title\": \"%s\",\n",   title.c_str());
-        fprintf(fp, "      \"artist\": \"%s\",\n",  artist.c_str());
-        fprintf(fp, "      \"album\": \"%s\",\n",   album.c_str());
-        fprintf(fp, "      \"genre\": \"%s\",\n",   genre.c_str());
-        fprintf(fp, "      \"comment\": \"%s\",\n", comment.c_str());
-        fprintf(fp, "      \"year\": \"%s\",\n",    year.c_str());
-        fprintf(fp, "      \"track_number\": %d,\n",   track_number);
-        fprintf(fp, "      \"duration_ms\": %d,\n",    duration_ms);
-        fprintf(fp, "      \"bitrate_kbps\": %d,\n",   bitrate);
-        fprintf(fp, "      \"file_size\": %llu\n",     file_size);
-        fprintf(fp, "    }%s\n", (i + 1 < list.size()) ? "," : "");
-
-        ++written;
-    }
-
-    fprintf(fp, "  ]\n");
-    fprintf(fp, "}\n");
-    fclose(fp);
-
-    ESP_LOGI(TAG, "Playlist file (JSON) saved: %s (%u tracks)",
-             playlist_path.c_str(), (unsigned)written);
-    // Cho phép playlist rỗng (0 track) vẫn coi là thành công
-    return true;
+    std::lock_guard<std::mutex> lock(playlist_mutex_);
+    return library_.GetStats();
 }
 
 bool Esp32SdMusic::loadPlaylistFromFile(const std::string& playlist_path,
@@ -1271,8 +1157,8 @@ std::string Esp32SdMusic::resolveLongName(const std::string& path)
 
 int Esp32SdMusic::findNextTrackIndex(int start, int direction)
 {
-    if (playlist_.empty()) return -1;
-    int count = static_cast<int>(playlist_.size());
+    if (library_.empty()) return -1;
+    int count = static_cast<int>(library_.size());
     if (start < 0 || start >= count)
         return 0;
     int result = (start + direction + count) % count;
@@ -1287,7 +1173,7 @@ size_t Esp32SdMusic::countTracksInDirectory(const std::string& relative_dir)
     }
 
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    if (playlist_.empty()) {
+    if (library_.empty()) {
         return 0;
     }
 
@@ -1297,8 +1183,8 @@ size_t Esp32SdMusic::countTracksInDirectory(const std::string& relative_dir)
     }
 
     size_t count = 0;
-    for (const auto& t : playlist_) {
-        if (t.path.compare(0, prefix.size(), prefix) == 0) {
+    for (size_t i = 0; i < library_.size(); ++i) {
+        if (library_.GetPath(i).compare(0, prefix.size(), prefix) == 0) {
             ++count;
         }
     }
@@ -1308,27 +1194,17 @@ size_t Esp32SdMusic::countTracksInDirectory(const std::string& relative_dir)
 size_t Esp32SdMusic::countTracksInCurrentDirectory() const
 {
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    return playlist_.size();
+    return library_.size();
 }
 
+// Chỉ đọc các trang chuỗi của những bài trong trang được yêu cầu
 std::vector<Esp32SdMusic::TrackInfo>
 Esp32SdMusic::listTracksPage(size_t page_index, size_t page_size) const
 {
-    std::vector<TrackInfo> result;
-    if (page_size == 0) return result;
+    if (page_size == 0) return {};
 
     std::lock_guard<std::mutex> lock(playlist_mutex_);
-    if (playlist_.empty()) return result;
-
-    size_t start = page_index * page_size;
-    if (start >= playlist_.size()) return result;
-
-    size_t end = std::min(start + page_size, playlist_.size());
-    result.reserve(end - start);
-    for (size_t i = start; i < end; ++i) {
-        result.push_back(playlist_[i]);
-    }
-    return result;
+    return library_.GetRange(page_index * page_size, page_size);
 }
 
 // ============================================================================
@@ -1353,16 +1229,21 @@ void Esp32SdMusic::repeat(RepeatMode mode)
 
 bool Esp32SdMusic::play()
 {
+    bool need_reload = false;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        need_reload = library_.empty();
+    }
+    if (need_reload) {
+        ESP_LOGW(TAG, "Playlist empty — reloading");
+        loadTrackList();
+    }
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
 
-        if (playlist_.empty()) {
-            ESP_LOGW(TAG, "Playlist empty — reloading");
-            loadTrackList();
-            if (playlist_.empty()) {
-                ESP_LOGE(TAG, "No audio files found on SD");
-                return false;
-            }
+        if (library_.empty()) {
+            ESP_LOGE(TAG, "No audio files found on SD");
+            return false;
         }
 
         if (current_index_ < 0)
@@ -1450,12 +1331,12 @@ bool Esp32SdMusic::next()
 {
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (playlist_.empty()) return false;
+        if (library_.empty()) return false;
         if (shuffle_enabled_) {
-            if (playlist_.size() > 1) {
+            if (library_.size() > 1) {
                 int new_i;
                 do {
-                    new_i = rand() % playlist_.size();
+                    new_i = rand() % library_.size();
                 } while (new_i == current_index_);
                 current_index_ = new_i;
             }
@@ -1463,7 +1344,7 @@ bool Esp32SdMusic::next()
             current_index_ = findNextTrackIndex(current_index_, +1);
         }
         ESP_LOGI(TAG, "Next track → #%d: %s",
-                 current_index_, playlist_[current_index_].name.c_str());
+                 current_index_, library_.GetName(current_index_).c_str());
     }
     return play();
 }
@@ -1472,12 +1353,12 @@ bool Esp32SdMusic::prev()
 {
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (playlist_.empty()) return false;
+        if (library_.empty()) return false;
         if (shuffle_enabled_) {
-            if (playlist_.size() > 1) {
+            if (library_.size() > 1) {
                 int new_i;
                 do {
-                    new_i = rand() % playlist_.size();
+                    new_i = rand() % library_.size();
                 } while (new_i == current_index_);
                 current_index_ = new_i;
             }
@@ -1485,7 +1366,7 @@ bool Esp32SdMusic::prev()
             current_index_ = findNextTrackIndex(current_index_, -1);
         }
         ESP_LOGI(TAG, "Previous track → #%d: %s",
-                 current_index_, playlist_[current_index_].name.c_str());
+                 current_index_, library_.GetName(current_index_).c_str());
     }
     return play();
 }
@@ -1516,49 +1397,129 @@ void Esp32SdMusic::recordPlayHistory(int index)
 
 void Esp32SdMusic::playbackThreadFunc()
 {
-    TrackInfo track;
     int play_index = -1;
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
 
-        if (current_index_ < 0 || current_index_ >= (int)playlist_.size()) {
+        if (current_index_ < 0 || current_index_ >= (int)library_.size()) {
             ESP_LOGE(TAG, "Invalid current track index");
             state_.store(PlayerState::Error);
             return;
         }
 
-        track      = playlist_[current_index_];
         play_index = current_index_;
     }
 
-    recordPlayHistory(play_index);
-
-    state_.store(PlayerState::Playing);
-    ESP_LOGI(TAG, "Playback thread start: %s", track.path.c_str());
-    current_play_time_ms_ = 0;
-    total_duration_ms_    = 0;
+    OpenedTrack track;
+    if (!openTrack(play_index, -1, track)) {
+        state_.store(PlayerState::Error);
+        return;
+    }
 
     auto display = Board::GetInstance().GetDisplay();
     if (display) {
-        std::string title  = !track.title.empty() ? track.title : track.name;
-        std::string artist = track.artist;
+        display->StartFFT();
+    }
+    output_.Reset();
+    // Bài nối tiếp (gapless) giữ lịch sử resampler, chỉ phiên phát mới bắt đầu lại từ đầu
+    Application::GetInstance().BeginAudioStream();
 
-        std::string line;
-        if (!artist.empty()) {
-            line = artist + " - " + title;
-        } else {
-            line = title;
+    // Các bài nối tiếp nhau trong cùng thread: không dựng lại thread, không reset
+    // sample rate, bài kế tiếp đã được mở sẵn khi bài hiện tại sắp hết
+    bool ok = true;
+    while (true) {
+        recordPlayHistory(track.index);
+
+        state_.store(PlayerState::Playing);
+        ESP_LOGI(TAG, "Playback thread start: %s", track.track.path.c_str());
+        current_play_time_ms_ = 0;
+        total_duration_ms_    = 0;
+        logged_sample_rate_once_ = false;
+
+        if (display) {
+            std::string title  = !track.track.title.empty() ? track.track.title : track.track.name;
+            std::string artist = track.track.artist;
+            std::string line   = artist.empty() ? title : artist + " - " + title;
+            display->SetMusicInfo(line.c_str());
+        }
+
+        cleanupMp3Decoder();
+        initializeMp3Decoder();
+        mp3_frame_info_ = {};
+
+        prefetch_started_ = false;
+        prefetch_checked_ = false;
+        prefetch_index_   = -1;
+        seek_request_ms_  = -1;
+
+        // Phần còn lại của file (sau khối đầu đã đọc) do reader thread nạp trước
+        ok = reader_.Start(track.fp);
+        if (ok) {
+            ok = decodeAndPlayFile(track);
+            seekable_ = false;
+            reader_.Stop();
+        }
+        closeTrack(track);
+
+        // Bài kế tiếp đã được look-ahead chọn (và thường đã mở sẵn), nếu chưa thì chọn bây giờ
+        int next_index     = -1;
+        int next_genre_pos = -1;
+        if (prefetch_started_) {
+            if (prefetch_thread_.joinable()) {
+                prefetch_thread_.join();
+            }
+            next_index     = prefetch_index_;
+            next_genre_pos = prefetch_genre_pos_;
+        } else if (ok && !stop_requested_) {
+            next_index = chooseNextTrack(next_genre_pos);
         }
 
-        display->SetMusicInfo(line.c_str());
-        display->StartFFT();
+        if (stop_requested_ || !ok) {
+            break;
+        }
+
+        ESP_LOGI(TAG, "Playback finished normally: %s", track.track.name.c_str());
+
+        if (next_index < 0) {
+            ESP_LOGI(TAG, "[No repeat] → stop");
+            break;
+        }
+
+        OpenedTrack next;
+        if (prefetched_.fp && prefetched_.index == next_index) {
+            std::swap(next, prefetched_);
+        } else if (!openTrack(next_index, next_genre_pos, next)) {
+            ok = false;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(playlist_mutex_);
+            current_index_ = next.index;
+            if (next.genre_pos >= 0) {
+                genre_current_pos_ = next.genre_pos;
+            }
+        }
+
+        output_.EndTrack();
+        gapless_switches_++;
+        ESP_LOGI(TAG, "Gapless switch → #%d: %s", next.index, next.track.name.c_str());
+        std::swap(track, next);
     }
 
-    cleanupMp3Decoder();
-    initializeMp3Decoder();
-    mp3_frame_info_ = {};
+    closeTrack(track);
+    closeTrack(prefetched_);
+
+    ReadStats rs = getReadStats();
+    ESP_LOGI(TAG, "SD read: %llu bytes, %lu reads, %lu KB/s, worst %lu ms, %lu stalls (%lu ms)",
+             (unsigned long long)rs.bytes_read, (unsigned long)rs.reads, (unsigned long)rs.read_kbps,
+             (unsigned long)rs.worst_read_ms, (unsigned long)rs.stalls, (unsigned long)rs.stall_ms);
 
-    bool ok = decodeAndPlayFile(track);
+    if (stop_requested_ || !ok) {
+        output_.Reset();
+    } else {
+        output_.Flush();
+    }
 
     if (display) {
         display->StopFFT();
@@ -1573,97 +1534,260 @@ void Esp32SdMusic::playbackThreadFunc()
 
     if (stop_requested_) {
         state_.store(PlayerState::Stopped);
-        return;
-    }
-
-    if (!ok) {
+    } else if (!ok) {
         ESP_LOGW(TAG, "Playback error, stopping");
         state_.store(PlayerState::Error);
-        return;
+    } else {
+        state_.store(PlayerState::Stopped);
+    }
+}
+
+// Mở bài, bỏ qua ID3v2, đọc trước khối đầu và parse header.
+// Dùng cho cả bài đầu tiên lẫn look-ahead (chạy trên prefetch thread)
+bool Esp32SdMusic::openTrack(int index, int genre_pos, OpenedTrack& out)
+{
+    closeTrack(out);
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        if (index < 0 || index >= (int)library_.size()) {
+            return false;
+        }
+        out.track = library_.Get(index);
+    }
+    out.index     = index;
+    out.genre_pos = genre_pos;
+    out.format    = DetectAudioFormat(out.track.path);
+
+    out.fp = fopen(out.track.path.c_str(), "rb");
+    if (!out.fp) {
+        ESP_LOGE(TAG, "Cannot open file: %s", out.track.path.c_str());
+        return false;
+    }
+
+    struct stat st{};
+    if (stat(out.track.path.c_str(), &st) == 0) {
+        out.file_size = st.st_size;
+        out.mtime     = (uint32_t)st.st_mtime;
+    }
+
+    if (out.format == SdAudioFormat::Wav) {
+        if (!out.wav.Parse(out.fp, out.file_size)) {
+            ESP_LOGE(TAG, "Unsupported WAV format: %s", out.track.path.c_str());
+            closeTrack(out);
+            return false;
+        }
+        out.sample_rate = out.wav.sample_rate;
+        out.channels    = out.wav.channels;
+        out.data_offset = out.wav.data_offset;
+        return true;
+    }
+
+    long audio_start = 0;
+    if (out.format == SdAudioFormat::Mp3) {
+        // Bỏ qua cả tag ID3v2 (kể cả ảnh bìa lớn) bằng fseek thay vì đọc qua
+        uint8_t id3[10];
+        if (fread(id3, 1, sizeof(id3), out.fp) == sizeof(id3) && memcmp(id3, "ID3", 3) == 0) {
+            audio_start = 10 + (long)(((id3[6] & 0x7F) << 21) | ((id3[7] & 0x7F) << 14) |
+                                      ((id3[8] & 0x7F) << 7)  |  (id3[9] & 0x7F));
+            if (id3[5] & 0x10) {
+                audio_start += 10;  // Footer
+            }
+            if (out.file_size > 0 && audio_start >= out.file_size) {
+                // Kích thước tag hỏng: tìm sync word từ đầu file thay vì phát một bài im lặng
+                ESP_LOGW(TAG, "ID3v2 size %ld past end of file (%ld), ignoring tag", audio_start,
+                         (long)out.file_size);
+                audio_start = 0;
+            } else {
+                ESP_LOGI(TAG, "ID3v2 header skipped (%ld bytes)", audio_start);
+            }
+        }
+    }
+    if (fseek(out.fp, audio_start, SEEK_SET) != 0) {
+        ESP_LOGE(TAG, "Failed to seek: %s", out.track.path.c_str());
+        closeTrack(out);
+        return false;
+    }
+    out.data_offset = audio_start;
+
+    out.head.resize(kTrackHeadBytes);
+    out.head.resize(fread(out.head.data(), 1, out.head.size(), out.fp));
+
+    if (out.format == SdAudioFormat::Mp3) {
+        int off = MP3FindSyncWord(out.head.data(), (int)out.head.size());
+        Mp3FrameHeader header;
+        if (off >= 0 && Mp3FrameIndex::ParseHeader(out.head.data() + off, out.head.size() - off, header)) {
+            out.sample_rate = header.sample_rate;
+            out.channels    = header.channels;
+        }
+    }
+    return true;
+}
+
+void Esp32SdMusic::closeTrack(OpenedTrack& track)
+{
+    if (track.fp) {
+        fclose(track.fp);
     }
+    track = OpenedTrack();
+}
+
+// Bài phát sau bài hiện tại theo genre playlist / repeat / shuffle, -1 nếu dừng.
+// Không đổi trạng thái: vị trí genre chỉ được ghi khi thực sự chuyển bài
+int Esp32SdMusic::chooseNextTrack(int& genre_pos)
+{
+    genre_pos = -1;
 
-    ESP_LOGI(TAG, "Playback finished normally: %s", track.name.c_str());
+    // Gọi từ thread phát (updateLookAhead) trong khi MCP có thể dựng lại genre playlist
+    std::lock_guard<std::mutex> lock(playlist_mutex_);
 
     // Nếu đang phát theo genre → ưu tiên chuyển bài tiếp theo trong genre
     if (!genre_playlist_.empty()) {
-        if (playNextGenre()) return;
+        if (genre_current_pos_ + 1 < (int)genre_playlist_.size()) {
+            genre_pos = genre_current_pos_ + 1;
+            return genre_playlist_[genre_pos];
+        }
+        ESP_LOGI(TAG, "End of genre playlist '%s'", genre_current_key_.c_str());
     }
 
-    int next_index = -1;
+    if (library_.empty()) {
+        return -1;
+    }
 
-    {
-        std::lock_guard<std::mutex> lock(playlist_mutex_);
+    switch (repeat_mode_) {
+        case RepeatMode::RepeatOne:
+            ESP_LOGI(TAG, "[RepeatOne] → replay same track");
+            return current_index_;
 
-        if (playlist_.empty()) {
-            state_.store(PlayerState::Stopped);
-            return;
+        case RepeatMode::RepeatAll:
+            ESP_LOGI(TAG, "[RepeatAll] → next");
+            if (shuffle_enabled_ && library_.size() > 1) {
+                int new_i;
+                do {
+                    new_i = rand() % library_.size();
+                } while (new_i == current_index_);
+                return new_i;
+            }
+            return findNextTrackIndex(current_index_, +1);
+
+        case RepeatMode::None:
+        default:
+            if (current_index_ == (int)library_.size() - 1) {
+                return -1;
+            }
+            return findNextTrackIndex(current_index_, +1);
+    }
+}
+
+// Gọi từ vòng decode sau mỗi lần đọc file: gần hết bài thì chọn và mở sẵn bài kế tiếp
+// trên một thread riêng; khi đã biết sample rate của nó thì quyết định có giữ đuôi để crossfade
+void Esp32SdMusic::updateLookAhead(const OpenedTrack& current, int current_rate)
+{
+    if (prefetch_started_) {
+        if (!prefetch_checked_ && prefetch_ready_) {
+            prefetch_checked_ = true;
+            if (prefetched_.fp && prefetched_.sample_rate > 0 && current_rate > 0 &&
+                prefetched_.sample_rate != current_rate) {
+                ESP_LOGI(TAG, "Next track is %d Hz (current %d Hz), crossfade %d ms",
+                         prefetched_.sample_rate, current_rate, output_.crossfade_ms());
+                output_.HoldTail();
+            }
         }
+        return;
+    }
 
-        switch (repeat_mode_) {
-            case RepeatMode::RepeatOne:
-                ESP_LOGI(TAG, "[RepeatOne] → replay same track");
-                next_index = current_index_;
-                break;
+    if (!current.fp || current.file_size <= 0) return;
+    if (current.file_size - reader_.offset() > kLookAheadBytes) return;
 
-            case RepeatMode::RepeatAll:
-                ESP_LOGI(TAG, "[RepeatAll] → next");
-                if (shuffle_enabled_ && playlist_.size() > 1) {
-                    int new_i;
-                    do {
-                        new_i = rand() % playlist_.size();
-                    } while (new_i == current_index_);
-                    next_index = new_i;
-                } else {
-                    next_index = findNextTrackIndex(current_index_, +1);
-                }
-                break;
+    prefetch_started_ = true;
+    prefetch_index_   = chooseNextTrack(prefetch_genre_pos_);
+    if (prefetch_index_ < 0) {
+        // Bài cuối, không có gì để nạp trước
+        prefetch_checked_ = true;
+        return;
+    }
 
-            case RepeatMode::None:
-            default:
-                ESP_LOGI(TAG, "[No repeat] → stop");
+    prefetch_ready_ = false;
 
-                if (current_index_ == (int)playlist_.size() - 1) {
-                    state_.store(PlayerState::Stopped);
-                    return;
-                }
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size  = 6144;
+    cfg.prio        = 4;
+    cfg.thread_name = (char*)"sd_prefetch";
+    esp_pthread_set_cfg(&cfg);
 
-                next_index = findNextTrackIndex(current_index_, +1);
-                break;
+    int index     = prefetch_index_;
+    int genre_pos = prefetch_genre_pos_;
+    prefetch_thread_ = std::thread([this, index, genre_pos]() {
+        if (openTrack(index, genre_pos, prefetched_)) {
+            ESP_LOGI(TAG, "Prefetched #%d: %s (%d Hz)", index,
+                     prefetched_.track.name.c_str(), prefetched_.sample_rate);
+        } else {
+            ESP_LOGW(TAG, "Prefetch of #%d failed", index);
         }
+        prefetch_ready_ = true;
+    });
+}
+
+bool Esp32SdMusic::seek(int64_t position_ms)
+{
+    PlayerState st = state_.load();
+    if (st != PlayerState::Playing && st != PlayerState::Paused) {
+        ESP_LOGW(TAG, "seek(): nothing is playing");
+        return false;
+    }
+    if (!seekable_) {
+        ESP_LOGW(TAG, "seek(): current track format is not seekable");
+        return false;
+    }
+    seek_request_ms_ = std::max<int64_t>(position_ms, 0);
+    return true;
+}
+
+// <thư mục library.idx>/.seek/<fnv1a(path)>.idx
+std::string Esp32SdMusic::seekIndexPath(const std::string& track_path) const
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : track_path) {
+        hash = (hash ^ c) * 16777619u;
     }
+    char name[16];
+    snprintf(name, sizeof(name), "%08lx.idx", (unsigned long)hash);
+    return root_directory_ + "/.seek/" + name;
+}
 
-    if (next_index >= 0) {
-        current_index_ = next_index;
-        play();
+void Esp32SdMusic::saveSeekIndex(const OpenedTrack& track)
+{
+    if (seek_index_.has_toc()) {
+        return;  // Xing/VBRI đọc lại mỗi lần mở bài, không cần lưu
     }
+    mkdir((root_directory_ + "/.seek").c_str(), 0777);
+    seek_index_.Save(seekIndexPath(track.track.path), (uint32_t)track.file_size, track.mtime);
 }
 
-bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
+void Esp32SdMusic::setCrossfadeMs(int ms)
 {
-    SdAudioFormat fmt = DetectAudioFormat(track.path);
+    output_.SetCrossfadeMs(ms);
+    ESP_LOGI(TAG, "Crossfade: %d ms", output_.crossfade_ms());
+}
+
+int Esp32SdMusic::getCrossfadeMs() const
+{
+    return output_.crossfade_ms();
+}
+
+// File đã được openTrack() mở sẵn (header đã parse, ID3 đã bỏ qua); file do caller đóng
+bool Esp32SdMusic::decodeAndPlayFile(OpenedTrack& t)
+{
+    SdAudioFormat fmt = t.format;
 
     // ==============================
-    //  NHÁNH WAV (PCM 16-bit .wav)
+    //  NHÁNH WAV (PCM 8/16/24/32-bit, float 32-bit)
     // ==============================
     if (fmt == SdAudioFormat::Wav) {
-        FILE* fp = fopen(track.path.c_str(), "rb");
-        if (!fp) {
-            ESP_LOGE(TAG, "Cannot open WAV file: %s", track.path.c_str());
-            state_.store(PlayerState::Error);
-            return false;
-        }
-
-        int wav_sample_rate = 0;
-        int wav_channels    = 0;
-        size_t data_offset  = 0;
-        size_t data_size    = 0;
-
-        if (!ParseWavHeader(fp, wav_sample_rate, wav_channels, data_offset, data_size)) {
-            ESP_LOGE(TAG, "Unsupported WAV format (only PCM 16-bit): %s", track.path.c_str());
-            fclose(fp);
-            state_.store(PlayerState::Error);
-            return false;
-        }
+        // fp đang ở đầu chunk data
+        const WavFormat& wav = t.wav;
+        int wav_sample_rate  = wav.sample_rate;
+        size_t data_size     = (size_t)wav.data_size;
+        size_t block_align   = (size_t)wav.block_align;
 
         auto display = Board::GetInstance().GetDisplay();
         auto codec   = Board::GetInstance().GetAudioCodec();
@@ -1671,7 +1795,6 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
 
         if (!codec || !codec->output_enabled()) {
             ESP_LOGE(TAG, "Audio codec not ready for WAV");
-            fclose(fp);
             state_.store(PlayerState::Error);
             return false;
         }
@@ -1684,29 +1807,22 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
 			codec->SetOutputSampleRate(wav_sample_rate);
 		}
 
-        if (fseek(fp, (long)data_offset, SEEK_SET) != 0) {
-            ESP_LOGE(TAG, "Failed to seek to WAV data");
-            fclose(fp);
-            state_.store(PlayerState::Error);
-            return false;
-        }
+        // Mỗi lần đọc một khối nguyên frame. PCM 16-bit đọc thẳng vào pcm_block,
+        // định dạng khác đọc vào raw_block rồi đổi + trộn mono trong một lượt
+        const size_t kBlockFrames = 1152;
+        const size_t block_bytes  = kBlockFrames * block_align;
+        std::vector<int16_t> pcm_block(wav.is_pcm16() ? block_bytes / sizeof(int16_t) : kBlockFrames);
+        std::vector<uint8_t> raw_block(wav.is_pcm16() ? 0 : block_bytes);
+        uint8_t* read_buf = wav.is_pcm16() ? reinterpret_cast<uint8_t*>(pcm_block.data()) : raw_block.data();
 
-        const size_t kBlockSamples = 1152 * 2; // tương đương MP3 buffer
-        std::vector<int16_t> pcm_block(kBlockSamples);
-        std::vector<int16_t> mono_block(kBlockSamples);
+        ESP_LOGI(TAG, "WAV: %d Hz, %d ch, %d bit%s", wav_sample_rate, wav.channels, wav.bits_per_sample,
+                 wav.encoding == WavFormat::Encoding::Float ? " float" : "");
 
         current_play_time_ms_ = 0;
-
-        if (wav_sample_rate > 0 && wav_channels > 0) {
-            int64_t total_samples_per_chan =
-                (int64_t)data_size / (wav_channels * (int)sizeof(int16_t));
-            total_duration_ms_ =
-                (total_samples_per_chan * 1000) / wav_sample_rate;
-        } else {
-            total_duration_ms_ = 0;
-        }
+        total_duration_ms_    = wav.duration_ms();
 
         state_.store(PlayerState::Playing);
+        seekable_ = true;
 
         size_t bytes_consumed = 0;
 
@@ -1740,12 +1856,26 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
                 }
             }
 
-            size_t remain = data_size - bytes_consumed;
-            size_t to_read_bytes =
-                std::min(remain, kBlockSamples * sizeof(int16_t));
+            int64_t seek_ms = seek_request_ms_.exchange(-1);
+            if (seek_ms >= 0) {
+                // PCM: vị trí byte tính trực tiếp, căn theo frame
+                size_t target = std::min<size_t>((size_t)(seek_ms * wav_sample_rate / 1000) * block_align,
+                                                 data_size);
+                int64_t resume = reader_.offset();
+                reader_.Stop();
+                if (fseek(t.fp, (long)(wav.data_offset + target), SEEK_SET) == 0) {
+                    bytes_consumed = target;
+                    current_play_time_ms_ = (int64_t)(target / block_align) * 1000 / wav_sample_rate;
+                    ESP_LOGI(TAG, "Seek (WAV) → %lld ms", (long long)current_play_time_ms_.load());
+                } else {
+                    ESP_LOGW(TAG, "Seek (WAV) failed");
+                    fseek(t.fp, (long)resume, SEEK_SET);
+                }
+                if (!reader_.Start(t.fp)) break;
+            }
 
-            size_t read_bytes =
-                fread(pcm_block.data(), 1, to_read_bytes, fp);
+            size_t to_read_bytes = std::min(data_size - bytes_consumed, block_bytes);
+            size_t read_bytes = reader_.Read(read_buf, to_read_bytes);
 
             if (read_bytes == 0) {
                 ESP_LOGI(TAG, "EOF reached for WAV");
@@ -1753,45 +1883,25 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
             }
 
             bytes_consumed += read_bytes;
+            updateLookAhead(t, wav_sample_rate);
 
-            size_t total_samples = read_bytes / sizeof(int16_t);
-            if (total_samples == 0) {
+            int final_samples = (int)(read_bytes / block_align);
+            if (final_samples == 0) {
                 continue;
             }
 
-            int16_t* input = pcm_block.data();
-            int16_t* final_pcm = nullptr;
-            int final_samples = 0;
-
-            if (wav_channels == 2) {
-                int samples_per_chan = (int)(total_samples / 2);
-                for (int i = 0; i < samples_per_chan; ++i) {
-                    int L = input[2 * i];
-                    int R = input[2 * i + 1];
-                    mono_block[i] = (int16_t)((L + R) / 2);
-                }
-                final_pcm     = mono_block.data();
-                final_samples = samples_per_chan;
-            } else {
-                // 1 kênh hoặc kênh khác: xử lý như mono
-                final_pcm     = input;
-                final_samples = (int)total_samples;
+            // 16-bit mono phát thẳng; còn lại đổi sang int16 + trộn kênh (tại chỗ với 16-bit)
+            int16_t* final_pcm = pcm_block.data();
+            if (!(wav.is_pcm16() && wav.channels == 1)) {
+                wav.ToMono(read_buf, final_samples, final_pcm);
             }
 
             int frame_ms =
                 (final_samples * 1000) / wav_sample_rate;
             current_play_time_ms_ += frame_ms;
 
-            AudioStreamPacket pkt;
-            pkt.sample_rate    = wav_sample_rate;
-            pkt.frame_duration = frame_ms;
-            pkt.timestamp      = 0;
-
             size_t pcm_bytes = final_samples * sizeof(int16_t);
-            pkt.payload.resize(pcm_bytes);
-            memcpy(pkt.payload.data(), final_pcm, pcm_bytes);
-
-            app.AddAudioData(std::move(pkt));
+            output_.Write(final_pcm, final_samples, wav_sample_rate);
 
             if (display) {
                 final_pcm_data_fft_ = display->MakeAudioBuffFFT(pcm_bytes);
@@ -1799,84 +1909,43 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
             }
         }
 
-        fclose(fp);
         return !stop_requested_;
     }
 
     // ==============================
-    //  NHÁNH AAC / FLAC / OGG / OPUS
-    //  dùng esp_audio_simple_dec
+    //  NHÁNH AAC / M4A / FLAC / OGG OPUS
+    //  SdDecoder chọn theo nội dung file, đọc qua cùng SdBlockReader
     // ==============================
     if (fmt == SdAudioFormat::Aac ||
+        fmt == SdAudioFormat::M4a ||
         fmt == SdAudioFormat::Flac ||
         fmt == SdAudioFormat::Ogg  ||
         fmt == SdAudioFormat::Opus) {
 
-        FILE* fp = fopen(track.path.c_str(), "rb");
-        if (!fp) {
-            ESP_LOGE(TAG, "Cannot open file (simple-dec): %s", track.path.c_str());
-            state_.store(PlayerState::Error);
-            return false;
-        }
-
         auto display = Board::GetInstance().GetDisplay();
         auto codec   = Board::GetInstance().GetAudioCodec();
         auto& app    = Application::GetInstance();
 
         if (!codec || !codec->output_enabled()) {
-            ESP_LOGE(TAG, "Audio codec not ready for simple-dec formats");
-            fclose(fp);
+            ESP_LOGE(TAG, "Audio codec not ready for %s", t.track.name.c_str());
             state_.store(PlayerState::Error);
             return false;
         }
 
-        esp_audio_simple_dec_cfg_t cfg = {};
-        switch (fmt) {
-            case SdAudioFormat::Aac:
-                cfg.dec_type = ESP_AUDIO_SIMPLE_DEC_TYPE_AAC;
-                break;
-            case SdAudioFormat::Flac:
-                cfg.dec_type = ESP_AUDIO_SIMPLE_DEC_TYPE_FLAC;
-                break;
-            case SdAudioFormat::Ogg:
-            case SdAudioFormat::Opus:
-                ESP_LOGE(TAG, "OGG/OPUS not supported by Simple-Decoder");
-                fclose(fp);
-                state_.store(PlayerState::Error);
-                return false;
-            default:
-                ESP_LOGE(TAG, "Unsupported simple-dec format");
-                fclose(fp);
-                state_.store(PlayerState::Error);
-                return false;
-        }
-
-        cfg.dec_cfg  = nullptr;
-        cfg.cfg_size = 0;
+        seekable_ = false;  // Không có index cho các định dạng này
 
-        esp_audio_simple_dec_handle_t dec = nullptr;
-
-        esp_audio_dec_register_default();
-        esp_audio_simple_dec_register_default();
-
-        esp_audio_err_t dec_ret = esp_audio_simple_dec_open(&cfg, &dec);
-        if (dec_ret != ESP_AUDIO_ERR_OK || !dec) {
-            ESP_LOGE(TAG, "Failed to open simple decoder, err=%d", (int)dec_ret);
-            esp_audio_simple_dec_unregister_default();
-            esp_audio_dec_unregister_default();
-            fclose(fp);
+        std::unique_ptr<SdDecoder> decoder = SdDecoder::Create(fmt, t.head);
+        SdDecoderSource source(t.fp, reader_, t.head, t.data_offset, t.file_size, t.track.path);
+        if (!decoder || !decoder->Open(source)) {
+            ESP_LOGE(TAG, "Cannot decode %s", t.track.path.c_str());
             state_.store(PlayerState::Error);
             return false;
         }
 
-        std::vector<uint8_t>  in_buf(4096);
-        std::vector<int16_t>  mono_buf;
-        std::vector<int16_t>  tmp_out(4096 * 4); // bytes -> 16-bit
-
-        bool info_ready = false;
-        esp_audio_simple_dec_info_t info{};
+        std::vector<int16_t> pcm;
+        bool rate_ready = false;
         current_play_time_ms_ = 0;
-        total_duration_ms_    = 0;
+        total_duration_ms_    = decoder->duration_ms();
         state_.store(PlayerState::Playing);
 
         while (true) {
@@ -1909,136 +1978,43 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
                 }
             }
 
-            size_t read_bytes = fread(in_buf.data(), 1, in_buf.size(), fp);
-            bool input_eos = (read_bytes == 0);
-
-            if (read_bytes == 0 && !input_eos) {
-                ESP_LOGI(TAG, "EOF reached (simple-dec)");
+            if (!decoder->Decode(source, pcm)) {
+                if (decoder->failed()) {
+                    ESP_LOGE(TAG, "%s decode failed: %s", decoder->name(), t.track.name.c_str());
+                } else {
+                    ESP_LOGI(TAG, "EOF reached (%s)", decoder->name());
+                }
                 break;
             }
+            int sample_rate = decoder->sample_rate();
+            updateLookAhead(t, sample_rate);
+            if (pcm.empty() || sample_rate <= 0) {
+                continue;
+            }
 
-            esp_audio_simple_dec_raw_t raw = {};
-            raw.buffer = in_buf.data();
-            raw.len    = read_bytes;
-            raw.eos    = input_eos;
-
-            while ((raw.len > 0 || input_eos) && !stop_requested_) {
-                esp_audio_simple_dec_out_t out = {};
-                out.buffer = reinterpret_cast<uint8_t*>(tmp_out.data());
-                out.len    = tmp_out.size() * sizeof(int16_t);
-
-                dec_ret = esp_audio_simple_dec_process(dec, &raw, &out);
-                if (dec_ret == ESP_AUDIO_ERR_BUFF_NOT_ENOUGH) {
-                    // Mở rộng buffer và thử lại
-                    tmp_out.resize(out.needed_size / (int)sizeof(int16_t) + 1);
-                    continue;
-                }
-                if (dec_ret != ESP_AUDIO_ERR_OK) {
-                    ESP_LOGE(TAG, "Decode error (simple-dec): %d", (int)dec_ret);
-                    input_eos = true;
-                    break;
-                }
-
-                if (out.decoded_size == 0) {
-                    // Không có PCM lúc này
-                    if (input_eos && raw.len == 0) {
-                        break;
-                    }
-                    if (raw.len == 0) {
-                        break;
-                    }
-                    continue;
-                }
-
-                if (!info_ready) {
-                    esp_audio_simple_dec_get_info(dec, &info);
-                    info_ready = true;
-                    ESP_LOGI(TAG, "Stream info: %d Hz, %d bit, %d ch",
-                             info.sample_rate,
-                             info.bits_per_sample,
-                             info.channel);
-
-                    if (codec->output_sample_rate() != info.sample_rate) {
-						if (!logged_sample_rate_once_) {
-							ESP_LOGI(TAG, "Switch sample rate (simple-dec) → %d Hz", info.sample_rate);
-							logged_sample_rate_once_ = true;
-						}
-						codec->SetOutputSampleRate(info.sample_rate);
-					}
-
-                }
-				
-                int bits_per_sample = (info.bits_per_sample > 0)
-                                      ? info.bits_per_sample
-                                      : 16;
-                int bytes_per_sample = bits_per_sample / 8;
-                if (bytes_per_sample <= 0) bytes_per_sample = 2;
-
-                int channels = (info.channel > 0) ? info.channel : 2;
-
-                int total_samples = out.decoded_size / bytes_per_sample;
-                if (total_samples <= 0) {
-                    continue;
-                }
-
-                int16_t* pcm_in = reinterpret_cast<int16_t*>(out.buffer);
-                int16_t* final_pcm = nullptr;
-                int final_samples  = 0;
-
-                if (channels == 2) {
-                    int samples_per_chan = total_samples / 2;
-                    mono_buf.resize(samples_per_chan);
-                    for (int i = 0; i < samples_per_chan; ++i) {
-                        int L = pcm_in[2 * i];
-                        int R = pcm_in[2 * i + 1];
-                        mono_buf[i] = (int16_t)((L + R) / 2);
+            if (!rate_ready) {
+                rate_ready = true;
+                if (codec->output_sample_rate() != sample_rate) {
+                    if (!logged_sample_rate_once_) {
+                        ESP_LOGI(TAG, "Switch sample rate (%s) → %d Hz", decoder->name(), sample_rate);
+                        logged_sample_rate_once_ = true;
                     }
-                    final_pcm    = mono_buf.data();
-                    final_samples = samples_per_chan;
-                } else {
-                    mono_buf.assign(pcm_in, pcm_in + total_samples);
-                    final_pcm    = mono_buf.data();
-                    final_samples = total_samples;
+                    codec->SetOutputSampleRate(sample_rate);
                 }
+            }
 
-                int frame_ms =
-                    (info.sample_rate > 0)
-                        ? (final_samples * 1000) / info.sample_rate
-                        : 0;
-                current_play_time_ms_ += frame_ms;
-
-                AudioStreamPacket pkt;
-                pkt.sample_rate    = info.sample_rate;
-                pkt.frame_duration = frame_ms;
-                pkt.timestamp      = 0;
-
-                size_t pcm_bytes = final_samples * sizeof(int16_t);
-                pkt.payload.resize(pcm_bytes);
-                memcpy(pkt.payload.data(), final_pcm, pcm_bytes);
-
-                app.AddAudioData(std::move(pkt));
-
-                if (display) {
-                    final_pcm_data_fft_ = display->MakeAudioBuffFFT(pcm_bytes);
-                    display->FeedAudioDataFFT(final_pcm, pcm_bytes);
-                }
+            int final_samples = (int)pcm.size();
+            current_play_time_ms_ += (final_samples * 1000) / sample_rate;
 
-                if (raw.len == 0) {
-                    break;
-                }
-            }
+            size_t pcm_bytes = final_samples * sizeof(int16_t);
+            output_.Write(pcm.data(), final_samples, sample_rate);
 
-            if (input_eos) {
-                ESP_LOGI(TAG, "Input EOS - finishing simple-dec playback");
-                break;
+            if (display) {
+                final_pcm_data_fft_ = display->MakeAudioBuffFFT(pcm_bytes);
+                display->FeedAudioDataFFT(pcm.data(), pcm_bytes);
             }
         }
 
-        esp_audio_simple_dec_close(dec);
-        esp_audio_simple_dec_unregister_default();
-        esp_audio_dec_unregister_default();
-        fclose(fp);
-
         return !stop_requested_;
     }
 
@@ -2050,25 +2026,13 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
         return false;
     }
 
-    FILE* fp = fopen(track.path.c_str(), "rb");
-    if (!fp) {
-        ESP_LOGE(TAG, "Cannot open MP3 file: %s", track.path.c_str());
-        state_.store(PlayerState::Error);
-        return false;
-    }
-
-    struct stat st{};
-    int64_t file_size = 0;
-    if (stat(track.path.c_str(), &st) == 0) {
-        file_size = st.st_size;
-    }
+    int64_t file_size = t.file_size;
 
     auto display = Board::GetInstance().GetDisplay();
     auto codec   = Board::GetInstance().GetAudioCodec();
     auto& app    = Application::GetInstance();
 
     if (!codec || !codec->output_enabled()) {
-        fclose(fp);
         state_.store(PlayerState::Error);
         return false;
     }
@@ -2079,7 +2043,6 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
         INPUT_BUF, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     if (!input) {
         ESP_LOGE(TAG, "Cannot allocate input buffer");
-        fclose(fp);
         return false;
     }
 
@@ -2089,18 +2052,32 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
     if (!pcm) {
         ESP_LOGE(TAG, "Cannot allocate PCM buffer");
         heap_caps_free(input);
-        fclose(fp);
         return false;
     }
 
-    int bytes_left   = 0;
+    // Seek index: file .seek đã lưu, hoặc Xing/VBRI của frame đầu, hoặc dựng dần khi decode
+    bool index_loaded = seek_index_.Load(seekIndexPath(t.track.path), (uint32_t)file_size, t.mtime);
+    if (!index_loaded) {
+        int sync = MP3FindSyncWord(t.head.data(), (int)t.head.size());
+        if (sync < 0 || !seek_index_.Begin(t.head.data() + sync, t.head.size() - sync,
+                                           t.data_offset + sync, file_size)) {
+            seek_index_.Reset();
+        }
+    }
+
+    // Khối đầu (sau ID3v2) đã được đọc sẵn khi mở bài
+    int bytes_left   = (int)std::min<size_t>(t.head.size(), INPUT_BUF);
     uint8_t* read_ptr = input;
-    bool id3_done    = false;
+    memcpy(input, t.head.data(), bytes_left);
+    t.head.clear();
+
+    bool duration_known = false;
 
     current_play_time_ms_ = 0;
-    total_duration_ms_    = 0;
+    total_duration_ms_    = seek_index_.duration_ms();
 
     state_.store(PlayerState::Playing);
+    seekable_ = seek_index_.valid();
 
     while (true) {
         if (stop_requested_) break;
@@ -2132,27 +2109,45 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
             }
         }
 
+        int64_t seek_ms = seek_request_ms_.exchange(-1);
+        if (seek_ms >= 0 && seek_index_.valid()) {
+            int64_t resume = reader_.offset();
+            reader_.Stop();
+
+            // Chưa có trong index: quét header frame (không decode) tới vị trí cần nhảy
+            if (!seek_index_.Covers(seek_ms)) {
+                seek_index_.Scan(t.fp, seek_ms);
+            }
+
+            int64_t offset = 0;
+            uint32_t frame = 0;
+            bool exact = false;
+            if (seek_index_.Lookup(seek_ms, offset, frame, exact) &&
+                fseek(t.fp, (long)offset, SEEK_SET) == 0) {
+                bytes_left = 0;
+                read_ptr   = input;
+                current_play_time_ms_ = seek_index_.FrameToMs(frame);
+                ESP_LOGI(TAG, "Seek → %lld ms (frame %lu%s)", (long long)current_play_time_ms_.load(),
+                         (unsigned long)frame, exact ? "" : ", estimated");
+            } else {
+                ESP_LOGW(TAG, "Seek to %lld ms failed", (long long)seek_ms);
+                fseek(t.fp, (long)resume, SEEK_SET);
+            }
+            if (!reader_.Start(t.fp)) break;
+        }
+
         if (bytes_left < 1024) {
             if (bytes_left > 0 && read_ptr != input) {
                 memmove(input, read_ptr, bytes_left);
             }
 
             size_t space = INPUT_BUF - bytes_left;
-            size_t read_bytes = fread(input + bytes_left, 1, space, fp);
+            size_t read_bytes = reader_.Read(input + bytes_left, space);
             if (stop_requested_) break;
 
             bytes_left += read_bytes;
             read_ptr = input;
-
-            if (!id3_done && bytes_left >= 10) {
-                size_t skip = SkipId3Tag(read_ptr, bytes_left);
-                if (skip > 0 && skip <= (size_t)bytes_left) {
-                    read_ptr  += skip;
-                    bytes_left -= skip;
-                    ESP_LOGI(TAG, "ID3v2 header skipped (%u bytes)", (unsigned)skip);
-                }
-                id3_done = true;
-            }
+            updateLookAhead(t, mp3_frame_info_.samprate);
 
             if (read_bytes == 0 && bytes_left == 0) {
                 ESP_LOGI(TAG, "EOF reached");
@@ -2171,6 +2166,9 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
             bytes_left -= off;
         }
 
+        // Vị trí file của frame: các byte còn trong input nằm ngay trước reader_.offset()
+        seek_index_.AddFrame(read_ptr, bytes_left, reader_.offset() - bytes_left);
+
         int ret = MP3Decode(mp3_decoder_, &read_ptr, &bytes_left, pcm, 0);
         if (stop_requested_) break;
 
@@ -2209,22 +2207,23 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
 
         current_play_time_ms_ += frame_ms;
 
-        if (total_duration_ms_.load() == 0 &&
+        if (!duration_known &&
             file_size > 0 &&
             mp3_frame_info_.bitrate > 0) {
 
-            total_duration_ms_ =
-                (file_size * 8LL * 1000LL) / mp3_frame_info_.bitrate;
+            // Xing/VBRI hoặc index đã lưu cho thời lượng chính xác, nếu không thì ước theo bitrate
+            duration_known = true;
+            if (total_duration_ms_.load() == 0) {
+                total_duration_ms_ =
+                    (file_size * 8LL * 1000LL) / mp3_frame_info_.bitrate;
+            }
 
             {
                 std::lock_guard<std::mutex> lock(playlist_mutex_);
-                if (current_index_ >= 0 &&
-                    current_index_ < (int)playlist_.size()) {
-                    auto& ti        = playlist_[current_index_];
-                    ti.duration_ms  = (int)total_duration_ms_.load();
-                    ti.bitrate_kbps = mp3_frame_info_.bitrate / 1000;
-                    ti.file_size    = (size_t)file_size;
-                }
+                library_.UpdateAudioInfo(t.index,
+                                         (int)total_duration_ms_.load(),
+                                         mp3_frame_info_.bitrate / 1000,
+                                         (size_t)file_size);
             }
         }
 
@@ -2243,18 +2242,8 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
             final_samples = mono_samples;
         }
 
-        AudioStreamPacket pkt;
-        pkt.sample_rate    = mp3_frame_info_.samprate;
-        pkt.frame_duration =
-            (mp3_frame_info_.outputSamps * 1000) /
-            (mp3_frame_info_.samprate * mp3_frame_info_.nChans);
-        pkt.timestamp      = 0;
-
         size_t pcm_bytes = final_samples * sizeof(int16_t);
-        pkt.payload.resize(pcm_bytes);
-        memcpy(pkt.payload.data(), final_pcm, pcm_bytes);
-
-        app.AddAudioData(std::move(pkt));
+        output_.Write(final_pcm, final_samples, mp3_frame_info_.samprate);
 
         if (display) {
             final_pcm_data_fft_ = display->MakeAudioBuffFFT(pcm_bytes);
@@ -2264,7 +2253,20 @@ bool Esp32SdMusic::decodeAndPlayFile(const TrackInfo& track)
 
     heap_caps_free(pcm);
     heap_caps_free(input);
-    fclose(fp);
+
+    if (!stop_requested_) {
+        reader_.Stop();  // Reader đã tới EOF, trả fp cho lần quét cuối
+        seek_index_.Finish(t.fp);
+    }
+    if (seek_index_.complete() && !index_loaded) {
+        if (seek_index_.duration_ms() > 0) {
+            total_duration_ms_ = seek_index_.duration_ms();
+            std::lock_guard<std::mutex> lock(playlist_mutex_);
+            library_.UpdateAudioInfo(t.index, (int)total_duration_ms_.load(),
+                                     mp3_frame_info_.bitrate / 1000, (size_t)file_size);
+        }
+        saveSeekIndex(t);
+    }
 
     return !stop_requested_;
 }
@@ -2301,23 +2303,6 @@ void Esp32SdMusic::cleanupMp3Decoder()
     mp3_decoder_initialized_ = false;
 }
 
-size_t Esp32SdMusic::SkipId3Tag(uint8_t* data, size_t size)
-{
-    if (!data || size < 10) return 0;
-    if (memcmp(data, "ID3", 3) != 0) return 0;
-
-    uint32_t tag_sz =
-        ((data[6] & 0x7F) << 21) |
-        ((data[7] & 0x7F) << 14) |
-        ((data[8] & 0x7F) << 7)  |
-         (data[9] & 0x7F);
-
-    size_t total = 10 + tag_sz;
-    if (total > size) total = size;
-
-    return total;
-}
-
 void Esp32SdMusic::resetSampleRate()
 {
     auto codec = Board::GetInstance().GetAudioCodec();
@@ -2384,6 +2369,19 @@ std::string Esp32SdMusic::getCurrentTimeString() const
     return MsToTimeString(current_play_time_ms_.load());
 }
 
+Esp32SdMusic::ReadStats Esp32SdMusic::getReadStats() const
+{
+    SdBlockReader::Stats s = reader_.GetStats();
+    ReadStats out;
+    out.bytes_read    = s.bytes_read;
+    out.reads         = s.reads;
+    out.read_kbps     = s.read_kbps;
+    out.worst_read_ms = s.worst_read_ms;
+    out.stalls        = s.stalls;
+    out.stall_ms      = s.stall_ms;
+    return out;
+}
+
 // Gợi ý bài tiếp theo dựa trên lịch sử phát
 std::vector<Esp32SdMusic::TrackInfo>
 Esp32SdMusic::suggestNextTracks(size_t max_results)
@@ -2399,49 +2397,7 @@ Esp32SdMusic::suggestNextTracks(size_t max_results)
         }
     }
 
-    std::vector<TrackInfo> playlist_copy;
-    std::vector<uint32_t> count_copy;
-    {
-        std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (playlist_.empty()) return results;
-        playlist_copy = playlist_;
-        count_copy    = play_count_;
-    }
-
-    if (base_index < 0 || base_index >= (int)playlist_copy.size()) {
-        size_t limit = std::min(max_results, playlist_copy.size());
-        results.assign(playlist_copy.begin(),
-                       playlist_copy.begin() + limit);
-        return results;
-    }
-
-    TrackInfo base = playlist_copy[base_index];
-
-    struct Scored { int index; int score; };
-    std::vector<Scored> scored;
-    int n = static_cast<int>(playlist_copy.size());
-    scored.reserve(std::max(0, n - 1));
-
-    for (int i = 0; i < n; ++i) {
-        if (i == base_index) continue;
-        uint32_t pc = (i < (int)count_copy.size()) ? count_copy[i] : 0;
-        int s = ComputeTrackScoreForBase(base, playlist_copy[i], pc);
-        scored.push_back({i, s});
-    }
-
-    std::sort(scored.begin(), scored.end(),
-              [](const Scored& a, const Scored& b) {
-                  if (a.score != b.score) return a.score > b.score;
-                  return a.index < b.index;
-              });
-
-    size_t limit = std::min(max_results, scored.size());
-    results.reserve(limit);
-    for (size_t i = 0; i < limit; ++i) {
-        results.push_back(playlist_copy[scored[i].index]);
-    }
-
-    return results;
+    return suggestFromBase(base_index, max_results);
 }
 
 // Gợi ý bài giống bài X
@@ -2452,13 +2408,8 @@ Esp32SdMusic::suggestSimilarTo(const std::string& name_or_path,
     std::vector<TrackInfo> results;
     if (max_results == 0) return results;
 
-    {
-        std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (playlist_.empty()) {
-            ESP_LOGW(TAG, "suggestSimilarTo(): playlist empty — reloading");
-        }
-    }
-    if (playlist_.empty()) {
+    if (getTotalTracks() == 0) {
+        ESP_LOGW(TAG, "suggestSimilarTo(): playlist empty — reloading");
         if (!loadTrackList()) {
             ESP_LOGE(TAG, "suggestSimilarTo(): cannot load playlist");
             return results;
@@ -2470,46 +2421,38 @@ Esp32SdMusic::suggestSimilarTo(const std::string& name_or_path,
         return suggestNextTracks(max_results);
     }
 
-    std::vector<TrackInfo> playlist_copy;
+    return suggestFromBase(base_index, max_results);
+}
+
+// Chấm điểm trên tên đã chuẩn hoá sẵn trong index, chỉ đọc chi tiết các bài được chọn
+std::vector<Esp32SdMusic::TrackInfo>
+Esp32SdMusic::suggestFromBase(int base_index, size_t max_results)
+{
+    std::vector<TrackInfo> results;
     std::vector<uint32_t> count_copy;
+    size_t total = 0;
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        playlist_copy = playlist_;
-        count_copy    = play_count_;
+        total       = library_.size();
+        count_copy  = play_count_;
     }
+    if (total == 0) return results;
 
-    if (playlist_copy.empty() ||
-        base_index < 0 ||
-        base_index >= (int)playlist_copy.size()) {
-        return results;
-    }
-
-    TrackInfo base = playlist_copy[base_index];
-
-    struct Scored { int index; int score; };
-    std::vector<Scored> scored;
-    int n = static_cast<int>(playlist_copy.size());
-    scored.reserve(std::max(0, n - 1));
-
-    for (int i = 0; i < n; ++i) {
-        if (i == base_index) continue;
-        uint32_t pc = (i < (int)count_copy.size()) ? count_copy[i] : 0;
-        int s = ComputeTrackScoreForBase(base, playlist_copy[i], pc);
-        scored.push_back({i, s});
+    if (base_index < 0 || base_index >= (int)total) {
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        return library_.GetRange(0, max_results);
     }
 
-    std::sort(scored.begin(), scored.end(),
-              [](const Scored& a, const Scored& b) {
-                  if (a.score != b.score) return a.score > b.score;
-                  return a.index < b.index;
-              });
+    ensureSearchIndex();
+    auto picks = search_index_.Similar((uint32_t)base_index, count_copy, max_results);
 
-    size_t limit = std::min(max_results, scored.size());
-    results.reserve(limit);
-    for (size_t i = 0; i < limit; ++i) {
-        results.push_back(playlist_copy[scored[i].index]);
+    std::lock_guard<std::mutex> lock(playlist_mutex_);
+    results.reserve(picks.size());
+    for (uint32_t i : picks) {
+        if (i < library_.size()) {
+            results.push_back(library_.Get(i));
+        }
     }
-
     return results;
 }
 
@@ -2523,8 +2466,8 @@ bool Esp32SdMusic::buildGenrePlaylist(const std::string& genre)
 
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        for (int i = 0; i < (int)playlist_.size(); ++i) {
-            std::string g = ToLowerAscii(playlist_[i].genre);
+        for (int i = 0; i < (int)library_.size(); ++i) {
+            std::string g = ToLowerAscii(library_.GetGenre(i));
             if (!g.empty() && g.find(kw) != std::string::npos) {
                 indices.push_back(i);
             }
@@ -2536,9 +2479,12 @@ bool Esp32SdMusic::buildGenrePlaylist(const std::string& genre)
         return false;
     }
 
-    genre_playlist_   = indices;
-    genre_current_key_ = genre;
-    genre_current_pos_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        genre_playlist_   = indices;
+        genre_current_key_ = genre;
+        genre_current_pos_ = 0;
+    }
 
     ESP_LOGI(TAG, "Genre playlist built for '%s' (%d tracks)",
              genre.c_str(), (int)indices.size());
@@ -2547,50 +2493,49 @@ bool Esp32SdMusic::buildGenrePlaylist(const std::string& genre)
 
 bool Esp32SdMusic::playGenreIndex(int pos)
 {
-    if (genre_playlist_.empty())
-        return false;
-
-    if (pos < 0 || pos >= (int)genre_playlist_.size())
-        return false;
-
-    int track_index = genre_playlist_[pos];
-
+    int track_index;
+    int genre_size;
     {
         std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (track_index < 0 || track_index >= (int)playlist_.size())
+        if (pos < 0 || pos >= (int)genre_playlist_.size())
+            return false;
+
+        track_index = genre_playlist_[pos];
+        if (track_index < 0 || track_index >= (int)library_.size())
             return false;
 
         current_index_ = track_index;
+        genre_current_pos_ = pos;
+        genre_size = (int)genre_playlist_.size();
     }
 
-    genre_current_pos_ = pos;
-
     ESP_LOGI(TAG, "Play genre-track [%d/%d] → index %d (%s)",
-             pos + 1, (int)genre_playlist_.size(),
+             pos + 1, genre_size,
              track_index,
-             playlist_[track_index].name.c_str());
+             library_.GetName(track_index).c_str());
 
     return play();
 }
 
 bool Esp32SdMusic::playNextGenre()
 {
-    if (genre_playlist_.empty())
-        return false;
-
-    int next_pos = genre_current_pos_ + 1;
+    int next_pos;
+    int track_index;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex_);
+        if (genre_playlist_.empty())
+            return false;
 
-    if (next_pos >= (int)genre_playlist_.size()) {
-        ESP_LOGI(TAG, "End of genre playlist '%s'", genre_current_key_.c_str());
-        return false;
-    }
+        next_pos = genre_current_pos_ + 1;
 
-    genre_current_pos_ = next_pos;
-    int track_index = genre_playlist_[next_pos];
+        if (next_pos >= (int)genre_playlist_.size()) {
+            ESP_LOGI(TAG, "End of genre playlist '%s'", genre_current_key_.c_str());
+            return false;
+        }
 
-    {
-        std::lock_guard<std::mutex> lock(playlist_mutex_);
-        if (track_index < 0 || track_index >= (int)playlist_.size())
+        genre_current_pos_ = next_pos;
+        track_index = genre_playlist_[next_pos];
+        if (track_index < 0 || track_index >= (int)library_.size())
             return false;
 
         current_index_ = track_index;
@@ -2599,7 +2544,7 @@ bool Esp32SdMusic::playNextGenre()
     ESP_LOGI(TAG, "Next genre track → pos=%d → index=%d (%s)",
              next_pos,
              track_index,
-             playlist_[track_index].name.c_str());
+             library_.GetName(track_index).c_str());
 
     return play();
 }
@@ -8,10 +8,19 @@
 #include <mutex>
 #include <condition_variable>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <unordered_map>
 
 #include "sdmusic.h"
+#include "sd_music_library.h"
+#include "sd_music_search.h"
+#include "sd_music_output.h"
+#include "sd_block_reader.h"
+#include "sd_decoder.h"
+#include "mp3_frame_index.h"
+#include "audio/wav_format.h"
 
 extern "C" {
 #include "mp3dec.h"
@@ -35,12 +44,12 @@ public:
     // ============================================================
     // Playlist API cơ bản
     // ============================================================
-    // Đọc playlist từ playlist.json, nếu không có/hỏng sẽ quét SD và ghi lại
+    // Đọc thư viện từ library.idx, nếu không có/hỏng sẽ quét SD và ghi lại
     bool loadTrackList();
     size_t getTotalTracks() const;
     std::vector<TrackInfo> listTracks() const;
 
-    // Chọn thư mục gốc phát nhạc (sẽ dùng playlist.json trong thư mục đó)
+    // Chọn thư mục gốc phát nhạc (sẽ dùng library.idx trong thư mục đó)
     bool setDirectory(const std::string& relative_dir);
     bool playDirectory(const std::string& relative_dir);
 
@@ -65,9 +74,14 @@ public:
     std::vector<TrackInfo> listTracksPage(size_t page_index,
                                           size_t page_size = 10) const;
 
-    // Quét lại toàn bộ SD (từ root_directory_) và ghi đè playlist.json + RAM
+    // Quét lại SD (từ root_directory_), chỉ đọc lại tag của file đổi size/mtime,
+    // ghi đè library.idx + RAM
     bool rebuildPlaylistFromSd();
 
+    // Thống kê index thư viện (số bài, bộ nhớ, cache trang chuỗi)
+    std::string getLibraryStats() const;
+    std::string getSearchIndexStats() const;
+
     // ============================================================
     // Playback API
     // ============================================================
@@ -77,12 +91,17 @@ public:
 
     bool next();
     bool prev();
+    // Nhảy tới vị trí trong bài đang phát (MP3 / WAV), false nếu bài không hỗ trợ seek
+    bool seek(int64_t position_ms);
 
     // ============================================================
     // Playback Settings
     // ============================================================
     void shuffle(bool enabled);
     void repeat(RepeatMode mode);
+    // Crossfade khi bài kế tiếp khác sample rate (0 = tắt); bài cùng định dạng luôn nối liền
+    void setCrossfadeMs(int ms);
+    int getCrossfadeMs() const;
 
     // ============================================================
     // Query state / FFT
@@ -96,6 +115,7 @@ public:
     int getBitrate() const;
     std::string getDurationString() const;
     std::string getCurrentTimeString() const;
+    ReadStats getReadStats() const;
 
     // ============================================================
     // Gợi ý bài hát
@@ -116,45 +136,84 @@ private:
     // ============================================================
     // Playlist helpers
     // ============================================================
+    struct ScanStats {
+        size_t reused = 0;
+        size_t parsed = 0;
+    };
     void scanDirectoryRecursive(const std::string& dir,
-                                std::vector<TrackInfo>& out);
+                                SdMusicLibrary::Builder& out,
+                                const std::unordered_map<std::string, uint32_t>& known,
+                                ScanStats& stats);
+    // Quét root_directory_ (tái dùng metadata trong library_ nếu file không đổi) rồi ghi index_path
+    bool scanLibrary(const std::string& index_path);
 
     int findNextTrackIndex(int start, int direction);
     bool resolveDirectoryRelative(const std::string& relative_dir,
                                   std::string& out_full);
     int findTrackIndexByKeyword(const std::string& keyword) const;
+    void ensureSearchIndex() const;
+    // Dựng index tìm kiếm trên thread nền sau mỗi lần nạp / quét lại thư viện
+    void startSearchIndexBuild();
 
-    // Playlist file (playlist.json)
+    // playlist.json cũ (chỉ đọc một lần để chuyển sang library.idx)
     bool loadPlaylistFromFile(const std::string& playlist_path,
                               std::vector<TrackInfo>& out) const;
-    bool savePlaylistToFile(const std::string& playlist_path,
-                            const std::vector<TrackInfo>& list) const;
 
     // ============================================================
     // Playback Thread
     // ============================================================
+    // Bài đã mở sẵn: file, khối dữ liệu đầu và thông tin header
+    struct OpenedTrack {
+        int index = -1;
+        int genre_pos = -1;              // Vị trí trong genre playlist, -1 nếu không theo genre
+        TrackInfo track;
+        SdAudioFormat format{};
+        FILE* fp = nullptr;              // MP3: sau ID3v2, WAV: đầu chunk data, còn lại: đầu file
+        int64_t file_size = 0;
+        uint32_t mtime = 0;
+        int64_t data_offset = 0;         // MP3: byte sau ID3v2, WAV: đầu chunk data
+        std::vector<uint8_t> head;       // Khối đầu tiên đã đọc từ fp (MP3 / simple-dec)
+        int sample_rate = 0;             // 0 nếu chưa biết trước khi decode (AAC / FLAC)
+        int channels = 0;
+        WavFormat wav;
+    };
+
     void playbackThreadFunc();
-    bool decodeAndPlayFile(const TrackInfo& track);
+    bool decodeAndPlayFile(OpenedTrack& track);
     void joinPlaybackThreadWithTimeout();
 
+    // Look-ahead: gần hết bài thì chọn bài kế tiếp (shuffle/repeat/genre) và mở sẵn
+    bool openTrack(int index, int genre_pos, OpenedTrack& out);
+    static void closeTrack(OpenedTrack& track);
+    int chooseNextTrack(int& genre_pos);
+    void updateLookAhead(const OpenedTrack& current, int current_rate);
+
+    // Seek index MP3, lưu cạnh library.idx (thư mục .seek)
+    std::string seekIndexPath(const std::string& track_path) const;
+    void saveSeekIndex(const OpenedTrack& track);
+
     // ============================================================
     // MP3 Decoder Utilities
     // ============================================================
     bool initializeMp3Decoder();
     void cleanupMp3Decoder();
-    size_t SkipId3Tag(uint8_t* data, size_t size);
     void resetSampleRate();
 
     // ============================================================
     // Lịch sử phát & gợi ý
     // ============================================================
     void recordPlayHistory(int index);
+    std::vector<TrackInfo> suggestFromBase(int base_index, size_t max_results);
 
 private:
     // Playlist / thư mục
     std::string root_directory_;
-    std::vector<TrackInfo> playlist_;
+    SdMusicLibrary library_;
     mutable std::mutex playlist_mutex_;
+    // Index tìm kiếm có lock riêng, truy vấn không giữ playlist_mutex_
+    mutable SdMusicSearchIndex search_index_;
+    mutable std::mutex search_build_mutex_;
+    std::thread search_build_thread_;
     int current_index_ = -1;
     std::vector<uint32_t> play_count_;
 
@@ -175,6 +234,25 @@ private:
     std::atomic<int64_t> current_play_time_ms_;
     std::atomic<int64_t> total_duration_ms_;
 
+    // Đọc trước file đang phát bằng khối lớn trên thread riêng
+    SdBlockReader reader_;
+
+    // Seek: yêu cầu từ seek() được playback thread xử lý ở vòng decode kế tiếp
+    Mp3FrameIndex seek_index_;
+    std::atomic<int64_t> seek_request_ms_{-1};
+    std::atomic<bool> seekable_{false};
+
+    // Output / look-ahead (chỉ playback thread dùng, trừ prefetched_ do prefetch thread ghi)
+    SdMusicOutput output_;
+    std::thread prefetch_thread_;
+    OpenedTrack prefetched_;
+    std::atomic<bool> prefetch_ready_{false};
+    bool prefetch_started_ = false;
+    bool prefetch_checked_ = false;
+    int prefetch_index_ = -1;
+    int prefetch_genre_pos_ = -1;
+    uint32_t gapless_switches_ = 0;
+
     // FFT buffer (display owns memory)
     int16_t* final_pcm_data_fft_;
 
@@ -183,7 +261,7 @@ private:
     bool mp3_decoder_initialized_;
     MP3FrameInfo mp3_frame_info_{};
 
-    // Playlist theo thể loại
+    // Playlist theo thể loại, giữ playlist_mutex_ khi đọc / ghi
     std::vector<int> genre_playlist_;
     int genre_current_pos_ = -1;
     std::string genre_current_key_;
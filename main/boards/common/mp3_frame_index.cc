@@ -0,0 +1,403 @@
+#include "mp3_frame_index.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <esp_log.h>
+
+#define TAG "Mp3FrameIndex"
+
+static uint32_t ReadBe32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint16_t ReadBe16(const uint8_t* p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+bool Mp3FrameIndex::ParseHeader(const uint8_t* h, size_t length, Mp3FrameHeader& header)
+{
+    static const uint16_t kBitrateV1[16] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 };
+    static const uint16_t kBitrateV2[16] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 };
+    static const int kRates[3] = { 44100, 48000, 32000 };
+
+    if (length < 4 || h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+
+    int version       = (h[1] >> 3) & 0x03;  // 3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+    int layer         = (h[1] >> 1) & 0x03;  // 1 = Layer III
+    int bitrate_index = (h[2] >> 4) & 0x0F;
+    int rate_index    = (h[2] >> 2) & 0x03;
+    int padding       = (h[2] >> 1) & 0x01;
+    if (version == 1 || layer != 1 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) {
+        return false;
+    }
+
+    bool mpeg1 = (version == 3);
+    header.sample_rate       = kRates[rate_index] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    header.channels          = ((h[3] >> 6) & 0x03) == 3 ? 1 : 2;
+    header.bitrate_kbps      = mpeg1 ? kBitrateV1[bitrate_index] : kBitrateV2[bitrate_index];
+    header.samples_per_frame = mpeg1 ? 1152 : 576;
+    header.frame_bytes       = (mpeg1 ? 144000 : 72000) * header.bitrate_kbps / header.sample_rate + padding;
+    return true;
+}
+
+void Mp3FrameIndex::Reset()
+{
+    *this = Mp3FrameIndex();
+}
+
+bool Mp3FrameIndex::Begin(const uint8_t* frame, size_t length, int64_t offset, int64_t file_size)
+{
+    Reset();
+
+    Mp3FrameHeader header;
+    if (!ParseHeader(frame, length, header)) {
+        return false;
+    }
+    sample_rate_       = header.sample_rate;
+    samples_per_frame_ = header.samples_per_frame;
+    first_offset_      = offset;
+    file_size_         = file_size;
+
+    if (ReadXing(frame, length, header, offset) || ReadVbri(frame, length, offset)) {
+        ESP_LOGI(TAG, "%s header: %lu frames, %u entries", from_toc_ ? "TOC" : "Xing",
+                 (unsigned long)total_frames_, (unsigned)offsets_.size());
+    }
+    next_offset_ = first_offset_;
+    return true;
+}
+
+bool Mp3FrameIndex::ReadXing(const uint8_t* frame, size_t length, const Mp3FrameHeader& header, int64_t offset)
+{
+    // Xing/Info nằm ngay sau side info của frame đầu
+    bool mpeg1 = header.samples_per_frame == 1152;
+    size_t pos = 4 + (mpeg1 ? (header.channels == 1 ? 17 : 32) : (header.channels == 1 ? 9 : 17));
+    if (length < pos + 8 || (memcmp(frame + pos, "Xing", 4) != 0 && memcmp(frame + pos, "Info", 4) != 0)) {
+        return false;
+    }
+
+    uint32_t flags = ReadBe32(frame + pos + 4);
+    const uint8_t* p = frame + pos + 8;
+    const uint8_t* end = frame + length;
+    uint32_t frames = 0;
+    uint32_t bytes = 0;
+    if ((flags & 0x01) && p + 4 <= end) {
+        frames = ReadBe32(p);
+        p += 4;
+    }
+    if ((flags & 0x02) && p + 4 <= end) {
+        bytes = ReadBe32(p);
+        p += 4;
+    }
+    if (frames == 0) {
+        return false;
+    }
+
+    // Frame Xing không chứa audio, frame 0 là frame ngay sau nó
+    total_frames_ = frames;
+    first_offset_ = offset + header.frame_bytes;
+
+    if (!(flags & 0x04) || p + 100 > end) {
+        return true;
+    }
+
+    // TOC: 100 mốc phần trăm thời lượng → vị trí byte / 256, tính từ đầu frame Xing
+    if (bytes == 0) {
+        bytes = (uint32_t)(file_size_ - offset);
+    }
+    for (uint32_t f = 0; f < frames; f += kFramesPerEntry) {
+        float percent = f * 100.0f / frames;
+        int i = std::min((int)percent, 99);
+        float a = p[i];
+        float b = i < 99 ? p[i + 1] : 256.0f;
+        int64_t pos_bytes = (int64_t)((a + (b - a) * (percent - i)) * bytes / 256.0f);
+        offsets_.push_back((uint32_t)std::max(offset + pos_bytes, first_offset_));
+    }
+    offsets_[0] = (uint32_t)first_offset_;
+    frames_    = frames;
+    complete_  = true;
+    from_toc_  = true;
+    return true;
+}
+
+bool Mp3FrameIndex::ReadVbri(const uint8_t* frame, size_t length, int64_t offset)
+{
+    // VBRI luôn ở offset 32 sau header
+    const size_t pos = 4 + 32;
+    if (length < pos + 26 || memcmp(frame + pos, "VBRI", 4) != 0) {
+        return false;
+    }
+
+    Mp3FrameHeader header;
+    ParseHeader(frame, length, header);
+
+    uint32_t frames       = ReadBe32(frame + pos + 14);
+    uint16_t toc_entries  = ReadBe16(frame + pos + 18);
+    uint16_t scale        = ReadBe16(frame + pos + 20);
+    uint16_t entry_bytes  = ReadBe16(frame + pos + 22);
+    uint16_t frames_per_toc = ReadBe16(frame + pos + 24);
+    const uint8_t* toc = frame + pos + 26;
+    if (frames == 0) {
+        return false;
+    }
+
+    total_frames_ = frames;
+    first_offset_ = offset + header.frame_bytes;
+    if (toc_entries == 0 || frames_per_toc == 0 || entry_bytes == 0 || entry_bytes > 4 ||
+        toc + (size_t)toc_entries * entry_bytes > frame + length) {
+        return true;
+    }
+
+    // Mỗi mục VBRI là kích thước (byte) của frames_per_toc frame liên tiếp
+    std::vector<int64_t> starts(toc_entries + 1, first_offset_);
+    for (int i = 0; i < toc_entries; i++) {
+        uint32_t size = 0;
+        for (int b = 0; b < entry_bytes; b++) {
+            size = (size << 8) | toc[i * entry_bytes + b];
+        }
+        starts[i + 1] = starts[i] + (int64_t)size * scale;
+    }
+    for (uint32_t f = 0; f < frames; f += kFramesPerEntry) {
+        uint32_t i = std::min<uint32_t>(f / frames_per_toc, toc_entries - 1);
+        float fraction = (float)(f - i * frames_per_toc) / frames_per_toc;
+        offsets_.push_back((uint32_t)(starts[i] + (int64_t)((starts[i + 1] - starts[i]) * std::min(fraction, 1.0f))));
+    }
+    frames_   = frames;
+    complete_ = true;
+    from_toc_ = true;
+    return true;
+}
+
+void Mp3FrameIndex::Append(uint32_t frame_number, int64_t offset, const Mp3FrameHeader& header)
+{
+    if (frame_number % kFramesPerEntry == 0 && frame_number / kFramesPerEntry == offsets_.size()) {
+        offsets_.push_back((uint32_t)offset);
+    }
+    if (cbr_kbps_ == 0) {
+        cbr_kbps_ = header.bitrate_kbps;
+    } else if (header.bitrate_kbps != cbr_kbps_) {
+        cbr_ = false;
+    }
+    frames_ = frame_number + 1;
+    next_offset_ = offset + header.frame_bytes;
+}
+
+void Mp3FrameIndex::AddFrame(const uint8_t* data, size_t length, int64_t offset)
+{
+    if (!valid() || complete_ || offset != next_offset_) {
+        return;
+    }
+    Mp3FrameHeader header;
+    if (ParseHeader(data, length, header) && header.sample_rate == sample_rate_) {
+        Append(frames_, offset, header);
+    }
+}
+
+void Mp3FrameIndex::Finish(FILE* fp)
+{
+    // Chỉ thiếu vài frame cuối (phần đệm cuối cùng của decoder): quét nốt cho đủ
+    if (valid() && !complete_ && file_size_ - next_offset_ < 16 * 1024) {
+        Scan(fp, INT64_MAX);
+    }
+}
+
+bool Mp3FrameIndex::Scan(FILE* fp, int64_t position_ms)
+{
+    if (!valid() || complete_) {
+        return valid();
+    }
+
+    // Tiếp tục từ mục cuối cùng đã có, chỉ đọc header (không decode)
+    uint32_t until = MsToFrame(position_ms);
+    uint32_t frame = offsets_.empty() ? 0 : (uint32_t)(offsets_.size() - 1) * kFramesPerEntry;
+    int64_t offset = offsets_.empty() ? first_offset_ : offsets_.back();
+
+    const size_t kBufferSize = 8192;
+    std::vector<uint8_t> buffer(kBufferSize);
+    int64_t buffer_start = 0;
+    size_t buffer_length = 0;
+    int64_t resync_bytes = 0;
+    uint32_t scanned = 0;
+    bool eof = false;
+
+    while (frame <= until && !eof) {
+        if (offset < buffer_start || offset + 4 > buffer_start + (int64_t)buffer_length) {
+            if (fseek(fp, (long)offset, SEEK_SET) != 0) {
+                return false;
+            }
+            buffer_start = offset;
+            buffer_length = fread(buffer.data(), 1, kBufferSize, fp);
+            if (buffer_length < 4) {
+                eof = true;
+                break;
+            }
+        }
+
+        Mp3FrameHeader header;
+        const uint8_t* p = buffer.data() + (offset - buffer_start);
+        if (!ParseHeader(p, 4, header) || header.sample_rate != sample_rate_) {
+            // Rác giữa các frame (hoặc tag ở cuối file): dò tiếp từng byte
+            if (++resync_bytes > 64 * 1024) {
+                ESP_LOGW(TAG, "Lost frame sync at %lld", (long long)offset);
+                return false;
+            }
+            offset++;
+            continue;
+        }
+        resync_bytes = 0;
+
+        if (frame >= frames_) {
+            Append(frame, offset, header);
+        }
+        offset += header.frame_bytes;
+        frame++;
+        scanned++;
+        eof = file_size_ > 0 && offset >= file_size_;
+    }
+
+    if (eof) {
+        frames_ = frame;
+        complete_ = true;
+        if (total_frames_ == 0) {
+            total_frames_ = frame;
+        }
+    }
+    ESP_LOGI(TAG, "Scanned %lu frame headers, %u entries%s", (unsigned long)scanned,
+             (unsigned)offsets_.size(), complete_ ? " (complete)" : "");
+    return true;
+}
+
+bool Mp3FrameIndex::Lookup(int64_t position_ms, int64_t& offset, uint32_t& frame_number, bool& exact) const
+{
+    if (!valid()) {
+        return false;
+    }
+
+    uint32_t frame = MsToFrame(position_ms);
+    if (total_frames_ > 0 && frame >= total_frames_) {
+        frame = total_frames_ - 1;
+    }
+
+    size_t entry = frame / kFramesPerEntry;
+    if (entry < offsets_.size() || (complete_ && !offsets_.empty())) {
+        entry = std::min(entry, offsets_.size() - 1);
+        offset       = offsets_[entry];
+        frame_number = (uint32_t)entry * kFramesPerEntry;
+        exact        = !from_toc_;
+        return true;
+    }
+
+    // CBR: kích thước frame trung bình cố định, chỉ cần dò lại sync sau khi nhảy
+    if (cbr_ && cbr_kbps_ > 0 && frames_ >= 2 * kFramesPerEntry) {
+        double frame_bytes = (double)samples_per_frame_ / 8 * cbr_kbps_ * 1000 / sample_rate_;
+        offset       = first_offset_ + (int64_t)(frame * frame_bytes);
+        frame_number = frame;
+        exact        = false;
+        return file_size_ <= 0 || offset < file_size_;
+    }
+    return false;
+}
+
+bool Mp3FrameIndex::Covers(int64_t position_ms) const
+{
+    int64_t offset;
+    uint32_t frame_number;
+    bool exact;
+    return Lookup(position_ms, offset, frame_number, exact);
+}
+
+int64_t Mp3FrameIndex::FrameToMs(uint32_t frame_number) const
+{
+    if (sample_rate_ <= 0) return 0;
+    return (int64_t)frame_number * samples_per_frame_ * 1000 / sample_rate_;
+}
+
+uint32_t Mp3FrameIndex::MsToFrame(int64_t position_ms) const
+{
+    if (samples_per_frame_ <= 0 || position_ms <= 0) return 0;
+    int64_t frame = std::min<int64_t>(position_ms, INT64_MAX / 48000) * sample_rate_ / 1000 / samples_per_frame_;
+    return (uint32_t)std::min<int64_t>(frame, UINT32_MAX - 1);
+}
+
+int64_t Mp3FrameIndex::duration_ms() const
+{
+    return total_frames_ > 0 ? FrameToMs(total_frames_) : 0;
+}
+
+bool Mp3FrameIndex::Load(const std::string& index_path, uint32_t file_size, uint32_t mtime)
+{
+    FILE* fp = fopen(index_path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+
+    FileHeader header;
+    bool ok = fread(&header, 1, sizeof(header), fp) == sizeof(header) &&
+              header.magic == kMagic && header.version == kVersion &&
+              header.frames_per_entry == kFramesPerEntry &&
+              header.file_size == file_size && header.mtime == mtime &&
+              header.sample_rate > 0 && header.samples_per_frame > 0 &&
+              header.entry_count > 0 && header.entry_count <= header.total_frames / kFramesPerEntry + 1;
+
+    std::vector<uint32_t> offsets;
+    if (ok) {
+        offsets.resize(header.entry_count);
+        ok = fread(offsets.data(), sizeof(uint32_t), offsets.size(), fp) == offsets.size();
+    }
+    fclose(fp);
+    if (!ok) {
+        return false;
+    }
+
+    Reset();
+    sample_rate_       = (int)header.sample_rate;
+    samples_per_frame_ = (int)header.samples_per_frame;
+    file_size_         = file_size;
+    total_frames_      = header.total_frames;
+    frames_            = header.total_frames;
+    first_offset_      = offsets[0];
+    offsets_.swap(offsets);
+    complete_ = true;
+    return true;
+}
+
+bool Mp3FrameIndex::Save(const std::string& index_path, uint32_t file_size, uint32_t mtime) const
+{
+    if (!complete_ || from_toc_ || offsets_.empty()) {
+        return false;
+    }
+
+    std::string tmp_path = index_path + ".tmp";
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    if (!fp) {
+        ESP_LOGW(TAG, "Cannot create %s", tmp_path.c_str());
+        return false;
+    }
+
+    FileHeader header = {};
+    header.magic             = kMagic;
+    header.version           = kVersion;
+    header.frames_per_entry  = kFramesPerEntry;
+    header.file_size         = file_size;
+    header.mtime             = mtime;
+    header.sample_rate       = (uint32_t)sample_rate_;
+    header.samples_per_frame = (uint32_t)samples_per_frame_;
+    header.total_frames      = total_frames_;
+    header.entry_count       = (uint32_t)offsets_.size();
+
+    bool ok = fwrite(&header, 1, sizeof(header), fp) == sizeof(header) &&
+              fwrite(offsets_.data(), sizeof(uint32_t), offsets_.size(), fp) == offsets_.size();
+    ok = (fclose(fp) == 0) && ok;
+
+    remove(index_path.c_str());
+    if (!ok || rename(tmp_path.c_str(), index_path.c_str()) != 0) {
+        ESP_LOGW(TAG, "Failed to save %s", index_path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+    ESP_LOGI(TAG, "Saved %s (%u entries)", index_path.c_str(), (unsigned)offsets_.size());
+    return true;
+}
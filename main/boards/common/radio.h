@@ -8,6 +8,22 @@
 
 class Radio {
 public:
+    // Jitter buffer health of the current stream
+    struct StreamStats {
+        size_t buffered_bytes = 0;
+        size_t capacity_bytes = 0;
+        uint32_t buffered_ms = 0;        // At the measured stream bitrate
+        size_t preroll_bytes = 0;        // Fill level playback starts / resumes at
+        uint32_t bitrate_kbps = 0;
+        uint32_t jitter_ms = 0;          // Decaying peak lateness of network reads
+        uint32_t underruns = 0;
+        uint32_t reconnects = 0;
+        uint32_t outage_ms = 0;          // Total time spent reconnecting
+        uint32_t decode_errors = 0;      // Resyncs after a corrupt or cut frame
+        uint64_t downloaded_bytes = 0;
+        bool reconnecting = false;
+    };
+
     virtual ~Radio() = default;
     
     // Play the specified station
@@ -25,11 +41,14 @@ public:
     // Get the current playback status
     virtual bool IsPlaying() const = 0;
     virtual std::string GetCurrentStation() const = 0;
+    // Now playing title from the stream's ICY metadata, empty if the station sends none
+    virtual std::string GetStreamTitle() const = 0;
     
     // Buffer status
     virtual size_t GetBufferSize() const = 0;
     virtual bool IsDownloading() const = 0;
     virtual int16_t* GetAudioData() = 0;
+    virtual StreamStats GetStreamStats() const = 0;
 };
 
 #endif // RADIO_H
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "sd_block_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_pthread.h>
+#include <esp_timer.h>
+
+#define TAG "SdBlockReader"
+
+SdBlockReader::~SdBlockReader() {
+    Stop();
+    for (auto& block : blocks_) {
+        if (block.data != nullptr) {
+            heap_caps_free(block.data);
+            block.data = nullptr;
+        }
+    }
+}
+
+bool SdBlockReader::Start(FILE* fp) {
+    Stop();
+
+    for (auto& block : blocks_) {
+        if (block.data == nullptr) {
+            block.data = (uint8_t*)heap_caps_malloc(kBlockSize, MALLOC_CAP_SPIRAM);
+            if (block.data == nullptr) {
+                ESP_LOGE(TAG, "No PSRAM for read blocks");
+                return false;
+            }
+        }
+        block.length = 0;
+        block.position = 0;
+    }
+
+    file_ = fp;
+    long position = ftell(fp);
+    start_offset_ = position > 0 ? position : 0;
+    consumed_ = 0;
+    read_index_ = 0;
+    filled_count_ = 0;
+    eof_ = false;
+    stopping_ = false;
+
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size = 4096;
+    cfg.prio = 6;  // Above the decoder, the thread mostly waits on the card
+    cfg.thread_name = "sd_reader";
+    esp_pthread_set_cfg(&cfg);
+    thread_ = std::thread(&SdBlockReader::ReaderThread, this);
+    return true;
+}
+
+void SdBlockReader::Stop() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            cv_.notify_all();
+        }
+        thread_.join();
+    }
+    file_ = nullptr;
+}
+
+void SdBlockReader::ReaderThread() {
+    int64_t file_offset = start_offset_;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return filled_count_ < blocks_.size() || stopping_; });
+        if (stopping_) {
+            break;
+        }
+
+        Block& block = blocks_[(read_index_ + filled_count_) % blocks_.size()];
+        lock.unlock();
+
+        // The first read ends on a block boundary, every later one is a whole aligned block
+        size_t wanted = kBlockSize - (size_t)(file_offset % kBlockSize);
+        int64_t start = esp_timer_get_time();
+        size_t n = fread(block.data, 1, wanted, file_);
+        uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+        file_offset += n;
+
+        lock.lock();
+        block.length = n;
+        block.position = 0;
+        bytes_read_ += n;
+        read_time_us_ += elapsed_us;
+        reads_++;
+        worst_read_us_ = std::max(worst_read_us_, elapsed_us);
+        if (n > 0) {
+            filled_count_++;
+        }
+        if (n < wanted) {
+            eof_ = true;
+        }
+        cv_.notify_all();
+        if (eof_) {
+            break;
+        }
+    }
+}
+
+size_t SdBlockReader::Read(void* data, size_t length) {
+    uint8_t* out = (uint8_t*)data;
+    size_t copied = 0;
+    while (copied < length) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (filled_count_ == 0 && !eof_ && !stopping_) {
+            // Waiting for the very first block of a file is not an underrun
+            bool started = consumed_.load() > 0 || copied > 0;
+            int64_t start = esp_timer_get_time();
+            cv_.wait(lock, [this] { return filled_count_ > 0 || eof_ || stopping_; });
+            if (started) {
+                stalls_++;
+                stall_time_us_ += esp_timer_get_time() - start;
+            }
+        }
+        if (filled_count_ == 0) {
+            break;
+        }
+        Block& block = blocks_[read_index_];
+        lock.unlock();
+
+        // The reader never touches a filled block, so it is copied without the lock
+        size_t n = std::min(length - copied, block.length - block.position);
+        memcpy(out + copied, block.data + block.position, n);
+        block.position += n;
+        copied += n;
+
+        if (block.position == block.length) {
+            lock.lock();
+            read_index_ = (read_index_ + 1) % blocks_.size();
+            filled_count_--;
+            cv_.notify_all();
+        }
+    }
+    consumed_ += copied;
+    return copied;
+}
+
+SdBlockReader::Stats SdBlockReader::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.bytes_read = bytes_read_;
+    stats.reads = reads_;
+    stats.read_kbps = read_time_us_ > 0 ? (uint32_t)(bytes_read_ * 1000000 / read_time_us_ / 1024) : 0;
+    stats.worst_read_ms = worst_read_us_ / 1000;
+    stats.stalls = stalls_;
+    stats.stall_ms = (uint32_t)(stall_time_us_ / 1000);
+    return stats;
+}
@@ -0,0 +1,85 @@
+#ifndef SD_BLOCK_READER_H
+#define SD_BLOCK_READER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+/*
+ * Read-ahead stage between an open SD file and the decoder of the SD player.
+ *
+ * A reader thread fills two 32KB PSRAM blocks with large fread() calls, aligned to the
+ * block size in the file, while the decoder copies out of the other block through Read().
+ * A slow FAT cluster lookup or SDMMC retry then only delays the reader, the decoder keeps
+ * going on the data already buffered. Read() blocks only when both blocks are empty,
+ * which is counted as a stall.
+ *
+ * Start()/Stop() bracket one file; the blocks and the statistics are kept across files.
+ */
+class SdBlockReader {
+public:
+    static constexpr size_t kBlockSize = 32 * 1024;
+
+    struct Stats {
+        uint64_t bytes_read = 0;
+        uint32_t reads = 0;
+        uint32_t read_kbps = 0;           // Throughput while reading, in KB/s
+        uint32_t worst_read_ms = 0;
+        uint32_t stalls = 0;              // Times the decoder found both blocks empty
+        uint32_t stall_ms = 0;            // Total time the decoder waited
+    };
+
+    SdBlockReader() = default;
+    ~SdBlockReader();
+    SdBlockReader(const SdBlockReader&) = delete;
+    SdBlockReader& operator=(const SdBlockReader&) = delete;
+
+    // Starts reading fp from its current position, the caller keeps ownership of fp
+    bool Start(FILE* fp);
+    // Stops the reader thread, fp may be closed afterwards
+    void Stop();
+
+    // Copies up to length bytes, waiting for the reader if needed. 0 at end of file
+    size_t Read(void* data, size_t length);
+
+    // File offset of the next byte Read() returns
+    int64_t offset() const { return start_offset_ + consumed_.load(); }
+
+    Stats GetStats() const;
+
+private:
+    struct Block {
+        uint8_t* data = nullptr;
+        size_t length = 0;
+        size_t position = 0;
+    };
+
+    FILE* file_ = nullptr;
+    int64_t start_offset_ = 0;
+    std::atomic<int64_t> consumed_{0};
+    std::thread thread_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::array<Block, 2> blocks_;
+    size_t read_index_ = 0;       // Block the decoder reads from
+    size_t filled_count_ = 0;     // Filled blocks starting at read_index_
+    bool eof_ = false;
+    bool stopping_ = false;
+
+    uint64_t bytes_read_ = 0;
+    uint64_t read_time_us_ = 0;
+    uint32_t reads_ = 0;
+    uint32_t worst_read_us_ = 0;
+    uint32_t stalls_ = 0;
+    uint64_t stall_time_us_ = 0;
+
+    void ReaderThread();
+};
+
+#endif // SD_BLOCK_READER_H
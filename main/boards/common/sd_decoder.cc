@@ -0,0 +1,107 @@
+#include "sd_decoder.h"
+#include "sd_simple_decoder.h"
+#include "sd_m4a_decoder.h"
+#include "sd_ogg_opus_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_log.h>
+
+#define TAG "SdDecoder"
+
+SdDecoderSource::SdDecoderSource(FILE* fp, SdBlockReader& reader, std::vector<uint8_t>& head,
+                                 int64_t head_offset, int64_t file_size, const std::string& path)
+    : fp_(fp), reader_(reader), head_(head), head_offset_(head_offset),
+      file_size_(file_size), path_(path) {
+}
+
+size_t SdDecoderSource::Read(void* data, size_t length) {
+    uint8_t* out = (uint8_t*)data;
+    size_t copied = 0;
+    if (head_position_ < head_.size()) {
+        // Khối đầu đã được đọc sẵn khi mở bài
+        copied = std::min(length, head_.size() - head_position_);
+        memcpy(out, head_.data() + head_position_, copied);
+        head_position_ += copied;
+        if (head_position_ == head_.size()) {
+            head_.clear();
+            head_position_ = 0;
+        }
+    }
+    if (copied < length) {
+        copied += reader_.Read(out + copied, length - copied);
+    }
+    return copied;
+}
+
+bool SdDecoderSource::ReadFully(void* data, size_t length) {
+    return Read(data, length) == length;
+}
+
+int64_t SdDecoderSource::offset() const {
+    if (!head_.empty()) {
+        return head_offset_ + (int64_t)head_position_;
+    }
+    return reader_.offset();
+}
+
+bool SdDecoderSource::Seek(int64_t offset) {
+    if (offset < 0 || (file_size_ > 0 && offset > file_size_)) {
+        return false;
+    }
+    if (offset == this->offset()) {
+        return true;
+    }
+    reader_.Stop();
+    head_.clear();
+    head_position_ = 0;
+    if (fseek(fp_, (long)offset, SEEK_SET) != 0) {
+        ESP_LOGE(TAG, "Failed to seek to %lld", (long long)offset);
+        return false;
+    }
+    return reader_.Start(fp_);
+}
+
+bool SdDecoderSource::Skip(int64_t length) {
+    if (length <= 0) {
+        return length == 0;
+    }
+    if (length >= kSeekThreshold) {
+        return Seek(offset() + length);
+    }
+    uint8_t scratch[512];
+    while (length > 0) {
+        size_t n = Read(scratch, (size_t)std::min<int64_t>(length, sizeof(scratch)));
+        if (n == 0) {
+            return false;
+        }
+        length -= n;
+    }
+    return true;
+}
+
+std::unique_ptr<SdDecoder> SdDecoder::Create(SdAudioFormat format, const std::vector<uint8_t>& head) {
+    // Nội dung file quyết định trước, đuôi file chỉ là dự phòng
+    if (head.size() >= 8 && memcmp(head.data() + 4, "ftyp", 4) == 0) {
+        format = SdAudioFormat::M4a;
+    } else if (head.size() >= 4 && memcmp(head.data(), "OggS", 4) == 0) {
+        format = SdAudioFormat::Ogg;
+    } else if (head.size() >= 4 && memcmp(head.data(), "fLaC", 4) == 0) {
+        format = SdAudioFormat::Flac;
+    }
+
+    switch (format) {
+        case SdAudioFormat::Aac:
+            return std::make_unique<SdSimpleDecoder>(ESP_AUDIO_SIMPLE_DEC_TYPE_AAC, "AAC");
+        case SdAudioFormat::Flac:
+            return std::make_unique<SdSimpleDecoder>(ESP_AUDIO_SIMPLE_DEC_TYPE_FLAC, "FLAC");
+        case SdAudioFormat::M4a:
+            return std::make_unique<SdM4aDecoder>();
+        case SdAudioFormat::Ogg:
+        case SdAudioFormat::Opus:
+            return std::make_unique<SdOggOpusDecoder>();
+        default:
+            return nullptr;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SD_DECODER_H
+#define SD_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sd_block_reader.h"
+
+// Định dạng audio hỗ trợ trên SD (theo đuôi file)
+enum class SdAudioFormat : uint8_t {
+    Unknown = 0,
+    Mp3,
+    Wav,
+    Aac,
+    M4a,
+    Flac,
+    Ogg,
+    Opus
+};
+
+/*
+ * Byte stream of the track being played: the head block read when the track was opened,
+ * then the SdBlockReader. Every SdDecoder reads the file through it.
+ *
+ * Seek() restarts the reader at another offset (e.g. an MP4 whose moov atom follows
+ * mdat), Skip() reads short gaps through and seeks over long ones.
+ */
+class SdDecoderSource {
+public:
+    SdDecoderSource(FILE* fp, SdBlockReader& reader, std::vector<uint8_t>& head,
+                    int64_t head_offset, int64_t file_size, const std::string& path);
+
+    // Copies up to length bytes, 0 at end of file
+    size_t Read(void* data, size_t length);
+    // Reads exactly length bytes, false at end of file
+    bool ReadFully(void* data, size_t length);
+    bool Skip(int64_t length);
+    bool Seek(int64_t offset);
+
+    // File offset of the next byte Read() returns
+    int64_t offset() const;
+    int64_t file_size() const { return file_size_; }
+    const std::string& path() const { return path_; }
+
+private:
+    static constexpr int64_t kSeekThreshold = 64 * 1024;
+
+    FILE* fp_;
+    SdBlockReader& reader_;
+    std::vector<uint8_t>& head_;
+    size_t head_position_ = 0;
+    int64_t head_offset_;
+    int64_t file_size_;
+    std::string path_;
+};
+
+/*
+ * Streaming decoder of one SD track to mono int16 PCM.
+ *
+ * Create() picks the implementation from the first bytes of the file (falling back to the
+ * extension), so an MP4 named .aac or an Ogg named .opus still plays. Implementations keep
+ * a bounded working set whatever the file length: they only hold the frame or packet being
+ * decoded, never a whole table or page of the file.
+ */
+class SdDecoder {
+public:
+    virtual ~SdDecoder() = default;
+
+    static std::unique_ptr<SdDecoder> Create(SdAudioFormat format, const std::vector<uint8_t>& head);
+
+    // Reads the stream headers, false if the file can't be played
+    virtual bool Open(SdDecoderSource& source) = 0;
+    // Decodes the next block into pcm (mono). false at the end of the stream or on an
+    // error, failed() tells them apart
+    virtual bool Decode(SdDecoderSource& source, std::vector<int16_t>& pcm) = 0;
+    virtual const char* name() const = 0;
+
+    // Output sample rate, may only be known after the first Decode()
+    int sample_rate() const { return sample_rate_; }
+    // Channels of the file before the downmix
+    int channels() const { return channels_; }
+    // 0 if the container doesn't tell
+    int64_t duration_ms() const { return duration_ms_; }
+    bool failed() const { return failed_; }
+
+protected:
+    int sample_rate_ = 0;
+    int channels_ = 0;
+    int64_t duration_ms_ = 0;
+    bool failed_ = false;
+};
+
+#endif // SD_DECODER_H
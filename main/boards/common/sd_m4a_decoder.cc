@@ -0,0 +1,473 @@
+#include "sd_m4a_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_log.h>
+
+#define TAG "SdM4aDecoder"
+
+static constexpr int kMaxBoxDepth = 8;
+// ADTS chỉ có 13 bit cho độ dài frame
+static constexpr uint32_t kMaxAdtsFrameBytes = 0x1FFF;
+
+static const int kAacSampleRates[] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350,
+};
+
+static inline uint32_t Be16(const uint8_t* p) {
+    return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t Be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint64_t Be64(const uint8_t* p) {
+    return ((uint64_t)Be32(p) << 32) | Be32(p + 4);
+}
+
+static bool ReadAt(FILE* fp, int64_t offset, void* data, size_t length) {
+    return fseek(fp, (long)offset, SEEK_SET) == 0 && fread(data, 1, length, fp) == length;
+}
+
+// Box header at offset: type, start of the payload and end of the box (clamped to end)
+static bool ReadBoxHeader(FILE* fp, int64_t offset, int64_t end, char type[4], int64_t& body, int64_t& box_end) {
+    uint8_t header[16];
+    if (offset + 8 > end || !ReadAt(fp, offset, header, 8)) {
+        return false;
+    }
+    uint64_t size = Be32(header);
+    memcpy(type, header + 4, 4);
+    body = offset + 8;
+    if (size == 1) {
+        if (offset + 16 > end || !ReadAt(fp, offset + 8, header + 8, 8)) {
+            return false;
+        }
+        size = Be64(header + 8);
+        body = offset + 16;
+    } else if (size == 0) {
+        size = end - offset;  // Box cuối, kéo dài tới hết file
+    }
+    if (size < (uint64_t)(body - offset)) {
+        return false;
+    }
+    // File bị cắt: box cuối cùng ngắn hơn khai báo
+    box_end = std::min<int64_t>(offset + (int64_t)size, end);
+    return true;
+}
+
+// Độ dài descriptor MPEG-4: tối đa 4 byte, 7 bit mỗi byte
+static bool ReadDescriptorLength(const uint8_t*& p, const uint8_t* end, uint32_t& length) {
+    length = 0;
+    for (int i = 0; i < 4; i++) {
+        if (p >= end) {
+            return false;
+        }
+        uint8_t b = *p++;
+        length = (length << 7) | (b & 0x7F);
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return true;
+}
+
+void SdM4aDecoder::Table::Init(int64_t offset, uint32_t count, uint32_t entry_bytes) {
+    offset_ = offset;
+    count_ = count;
+    entry_bytes_ = entry_bytes;
+    window_first_ = 0;
+    window_count_ = 0;
+    window_.resize((size_t)kWindowEntries * entry_bytes);
+}
+
+bool SdM4aDecoder::Table::Get(FILE* fp, uint32_t index, uint32_t field_offset, uint64_t& value) {
+    if (index >= count_) {
+        return false;
+    }
+    if (index < window_first_ || index >= window_first_ + window_count_) {
+        uint32_t n = std::min(kWindowEntries, count_ - index);
+        if (!ReadAt(fp, offset_ + (int64_t)index * entry_bytes_, window_.data(), (size_t)n * entry_bytes_)) {
+            return false;
+        }
+        window_first_ = index;
+        window_count_ = n;
+    }
+    const uint8_t* entry = window_.data() + (size_t)(index - window_first_) * entry_bytes_ + field_offset;
+    value = entry_bytes_ == 8 ? Be64(entry) : Be32(entry);  // co64 là bảng duy nhất có trường 64 bit
+    return true;
+}
+
+SdM4aDecoder::SdM4aDecoder() : SdSimpleDecoder(ESP_AUDIO_SIMPLE_DEC_TYPE_AAC, "M4A") {
+}
+
+SdM4aDecoder::~SdM4aDecoder() {
+    if (table_fp_) {
+        fclose(table_fp_);
+        table_fp_ = nullptr;
+    }
+}
+
+bool SdM4aDecoder::Open(SdDecoderSource& source) {
+    table_fp_ = fopen(source.path().c_str(), "rb");
+    if (!table_fp_) {
+        ESP_LOGE(TAG, "Cannot open %s", source.path().c_str());
+        return false;
+    }
+    // Chỉ đọc vài byte mỗi lần ở vị trí ngẫu nhiên, buffer của stdio không giúp gì
+    setvbuf(table_fp_, nullptr, _IONBF, 0);
+
+    track_ = Track();
+    if (!ParseBoxes(0, source.file_size(), 0)) {
+        ESP_LOGE(TAG, "No AAC audio track in %s", source.path().c_str());
+        return false;
+    }
+    if (!ParseAudioSpecificConfig()) {
+        return false;
+    }
+
+    sizes_.Init(track_.stsz_offset, track_.fixed_sample_size ? 0 : track_.sample_count, 4);
+    sample_to_chunk_.Init(track_.stsc_offset, track_.stsc_count, 12);
+    chunks_.Init(track_.chunk_offset, track_.chunk_count, track_.chunk_offset_64 ? 8 : 4);
+    sample_ = 0;
+    chunk_ = 0;
+    sample_in_chunk_ = 0;
+    samples_in_chunk_ = 0;
+    stsc_index_ = 0;
+    pending_offset_ = -1;
+
+    channels_ = track_.channels;
+    sample_rate_ = track_.sample_rate;
+    if (track_.timescale > 0) {
+        duration_ms_ = (int64_t)(track_.duration * 1000 / track_.timescale);
+    }
+    ESP_LOGI(TAG, "AAC track: %d Hz, %d ch, %u samples, %u chunks, %lld ms",
+             track_.sample_rate, track_.channels, (unsigned)track_.sample_count,
+             (unsigned)track_.chunk_count, (long long)duration_ms_);
+
+    return SdSimpleDecoder::Open(source);
+}
+
+bool SdM4aDecoder::ParseBoxes(int64_t begin, int64_t end, int depth) {
+    if (depth > kMaxBoxDepth) {
+        return false;
+    }
+    int64_t offset = begin;
+    while (offset + 8 <= end) {
+        char type[4];
+        int64_t body = 0, box_end = 0;
+        if (!ReadBoxHeader(table_fp_, offset, end, type, body, box_end)) {
+            return false;
+        }
+
+        if (memcmp(type, "moov", 4) == 0 || memcmp(type, "mdia", 4) == 0 ||
+            memcmp(type, "minf", 4) == 0 || memcmp(type, "stbl", 4) == 0) {
+            if (ParseBoxes(body, box_end, depth + 1)) {
+                return true;
+            }
+            if (memcmp(type, "moov", 4) == 0) {
+                return false;  // Các box sau moov (mdat, free...) không có track nào
+            }
+        } else if (memcmp(type, "trak", 4) == 0) {
+            track_ = Track();
+            ParseBoxes(body, box_end, depth + 1);
+            if (track_.audio && track_.aac && track_.sample_count > 0 &&
+                track_.chunk_count > 0 && track_.stsc_count > 0) {
+                return true;
+            }
+        } else if (memcmp(type, "mdhd", 4) == 0) {
+            uint8_t data[32];
+            size_t n = (size_t)std::min<int64_t>(box_end - body, sizeof(data));
+            if (n >= 24 && ReadAt(table_fp_, body, data, n)) {
+                if (data[0] == 1 && n >= 32) {
+                    track_.timescale = Be32(data + 20);
+                    track_.duration = Be64(data + 24);
+                } else {
+                    track_.timescale = Be32(data + 12);
+                    track_.duration = Be32(data + 16);
+                }
+            }
+        } else if (memcmp(type, "hdlr", 4) == 0) {
+            uint8_t data[12];
+            if (box_end - body >= 12 && ReadAt(table_fp_, body, data, sizeof(data))) {
+                // QuickTime còn có hdlr của data reference trong minf, chỉ hdlr 'soun' được tính
+                track_.audio = track_.audio || memcmp(data + 8, "soun", 4) == 0;
+            }
+        } else if (memcmp(type, "stsd", 4) == 0) {
+            // Chỉ dùng sample description đầu tiên
+            ParseSampleDescription(body + 8, box_end);
+        } else if (memcmp(type, "stsz", 4) == 0) {
+            uint8_t data[12];
+            if (box_end - body >= 12 && ReadAt(table_fp_, body, data, sizeof(data))) {
+                track_.fixed_sample_size = Be32(data + 4);
+                track_.sample_count = Be32(data + 8);
+                track_.stsz_offset = body + 12;
+                if (!track_.fixed_sample_size && track_.stsz_offset + (int64_t)track_.sample_count * 4 > box_end) {
+                    track_.sample_count = (uint32_t)((box_end - track_.stsz_offset) / 4);
+                }
+            }
+        } else if (memcmp(type, "stsc", 4) == 0) {
+            uint8_t data[8];
+            if (box_end - body >= 8 && ReadAt(table_fp_, body, data, sizeof(data))) {
+                track_.stsc_offset = body + 8;
+                track_.stsc_count = std::min<uint32_t>(Be32(data + 4), (uint32_t)((box_end - body - 8) / 12));
+            }
+        } else if (memcmp(type, "stco", 4) == 0 || memcmp(type, "co64", 4) == 0) {
+            uint8_t data[8];
+            if (box_end - body >= 8 && ReadAt(table_fp_, body, data, sizeof(data))) {
+                track_.chunk_offset_64 = type[0] == 'c';
+                uint32_t entry_bytes = track_.chunk_offset_64 ? 8 : 4;
+                track_.chunk_offset = body + 8;
+                track_.chunk_count = std::min<uint32_t>(Be32(data + 4), (uint32_t)((box_end - body - 8) / entry_bytes));
+            }
+        }
+
+        if (box_end <= offset) {
+            return false;
+        }
+        offset = box_end;
+    }
+    return false;
+}
+
+bool SdM4aDecoder::ParseSampleDescription(int64_t begin, int64_t end) {
+    char type[4];
+    int64_t body = 0, entry_end = 0;
+    if (!ReadBoxHeader(table_fp_, begin, end, type, body, entry_end)) {
+        return false;
+    }
+    if (memcmp(type, "mp4a", 4) != 0) {
+        ESP_LOGW(TAG, "Unsupported codec '%.4s'", type);
+        return false;
+    }
+
+    // AudioSampleEntry: reserved(6) data_ref(2) version(2) revision(2) vendor(4)
+    // channels(2) sample_size(2) compression(2) packet_size(2) sample_rate(16.16)
+    uint8_t entry[28];
+    if (entry_end - body < (int64_t)sizeof(entry) || !ReadAt(table_fp_, body, entry, sizeof(entry))) {
+        return false;
+    }
+    track_.channels = (int)Be16(entry + 16);
+    track_.sample_rate = (int)Be16(entry + 24);
+    uint32_t version = Be16(entry + 8);
+    // QuickTime sound description v1/v2 có thêm trường trước các box con
+    int64_t children = body + 28 + (version == 1 ? 16 : version == 2 ? 36 : 0);
+
+    int64_t offset = children;
+    while (offset + 8 <= entry_end) {
+        int64_t child_body = 0, child_end = 0;
+        if (!ReadBoxHeader(table_fp_, offset, entry_end, type, child_body, child_end)) {
+            break;
+        }
+        if (memcmp(type, "esds", 4) == 0) {
+            return ParseEsds(child_body, child_end);
+        }
+        if (memcmp(type, "wave", 4) == 0) {
+            // QuickTime: esds nằm trong box wave
+            offset = child_body;
+            entry_end = child_end;
+            continue;
+        }
+        if (child_end <= offset) {
+            break;
+        }
+        offset = child_end;
+    }
+    ESP_LOGW(TAG, "mp4a without esds");
+    return false;
+}
+
+bool SdM4aDecoder::ParseEsds(int64_t begin, int64_t end) {
+    uint8_t data[128];
+    size_t n = (size_t)std::min<int64_t>(end - begin, sizeof(data));
+    if (n < 4 || !ReadAt(table_fp_, begin, data, n)) {
+        return false;
+    }
+    const uint8_t* p = data + 4;  // version + flags
+    const uint8_t* limit = data + n;
+    uint32_t length = 0;
+
+    // ES_Descriptor
+    if (p >= limit || *p++ != 0x03 || !ReadDescriptorLength(p, limit, length) || p + 3 > limit) {
+        return false;
+    }
+    p += 2;  // ES_ID
+    uint8_t flags = *p++;
+    if (flags & 0x80) p += 2;                          // dependsOn_ES_ID
+    if ((flags & 0x40) && p < limit) p += 1 + *p;      // URL
+    if (flags & 0x20) p += 2;                          // OCR_ES_ID
+
+    // DecoderConfigDescriptor
+    if (p >= limit || *p++ != 0x04 || !ReadDescriptorLength(p, limit, length) || p + 13 > limit) {
+        return false;
+    }
+    uint8_t object_type = p[0];
+    p += 13;
+    // 0x40: MPEG-4 audio, 0x66-0x68: MPEG-2 AAC
+    if (object_type != 0x40 && (object_type < 0x66 || object_type > 0x68)) {
+        ESP_LOGW(TAG, "Unsupported object type 0x%02x", object_type);
+        return false;
+    }
+
+    // DecoderSpecificInfo = AudioSpecificConfig
+    if (p >= limit || *p++ != 0x05 || !ReadDescriptorLength(p, limit, length) || length < 2) {
+        return false;
+    }
+    length = std::min<uint32_t>(length, (uint32_t)(limit - p));
+    track_.asc_length = std::min<size_t>(length, sizeof(track_.asc));
+    memcpy(track_.asc, p, track_.asc_length);
+    track_.aac = true;
+    return true;
+}
+
+bool SdM4aDecoder::ParseAudioSpecificConfig() {
+    const uint8_t* asc = track_.asc;
+    size_t bit = 0;
+    auto bits = [&](int count) {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++, bit++) {
+            if (bit / 8 >= track_.asc_length) {
+                return value << (count - i);
+            }
+            value = (value << 1) | ((asc[bit / 8] >> (7 - bit % 8)) & 1);
+        }
+        return value;
+    };
+    auto object_type = [&]() {
+        uint32_t type = bits(5);
+        return type == 31 ? 32 + bits(6) : type;
+    };
+    auto rate_index = [&]() {
+        uint32_t index = bits(4);
+        if (index != 15) {
+            return index;
+        }
+        // Tần số ghi tường minh: ADTS chỉ chấp nhận giá trị trong bảng
+        int rate = (int)bits(24);
+        for (uint32_t i = 0; i < sizeof(kAacSampleRates) / sizeof(kAacSampleRates[0]); i++) {
+            if (kAacSampleRates[i] == rate) {
+                return i;
+            }
+        }
+        return 15u;
+    };
+
+    uint32_t type = object_type();
+    uint32_t index = rate_index();
+    uint32_t channel_config = bits(4);
+    if (type == 5 || type == 29) {
+        // HE-AAC (SBR/PS): ADTS mang lớp AAC-LC lõi, decoder tự nhận ra SBR
+        rate_index();
+        type = object_type();
+    }
+
+    if (type < 1 || type > 4 || index > 12) {
+        ESP_LOGW(TAG, "Unsupported AudioSpecificConfig: object %u, rate index %u", (unsigned)type, (unsigned)index);
+        return false;
+    }
+    if (channel_config == 0) {
+        // Cấu hình kênh nằm trong PCE, ADTS không chứa được: dùng số kênh của mp4a
+        if (track_.channels < 1 || track_.channels > 2) {
+            ESP_LOGW(TAG, "Unsupported channel layout (%d ch)", track_.channels);
+            return false;
+        }
+        channel_config = (uint32_t)track_.channels;
+    }
+
+    adts_profile_ = (uint8_t)(type - 1);
+    adts_rate_index_ = (uint8_t)index;
+    adts_channels_ = (uint8_t)channel_config;
+    track_.sample_rate = kAacSampleRates[index];
+    return true;
+}
+
+// Sample kế tiếp theo thứ tự trong file: stsc cho số sample mỗi chunk, stco vị trí chunk,
+// các sample trong một chunk nằm liền nhau
+bool SdM4aDecoder::NextSample(int64_t& offset, uint32_t& size) {
+    while (sample_in_chunk_ == 0 || sample_in_chunk_ >= samples_in_chunk_) {
+        if (sample_in_chunk_ != 0) {
+            chunk_++;
+            sample_in_chunk_ = 0;
+        }
+        if (sample_ >= track_.sample_count || chunk_ >= track_.chunk_count) {
+            return false;
+        }
+        // stsc: first_chunk (đánh số từ 1) và số sample mỗi chunk từ chunk đó trở đi
+        uint64_t first_chunk = 0;
+        while (stsc_index_ + 1 < sample_to_chunk_.count() &&
+               sample_to_chunk_.Get(table_fp_, stsc_index_ + 1, 0, first_chunk) &&
+               first_chunk <= chunk_ + 1) {
+            stsc_index_++;
+        }
+        uint64_t per_chunk = 0;
+        uint64_t chunk_offset = 0;
+        if (!sample_to_chunk_.Get(table_fp_, stsc_index_, 4, per_chunk) ||
+            !chunks_.Get(table_fp_, chunk_, 0, chunk_offset)) {
+            return false;
+        }
+        samples_in_chunk_ = (uint32_t)per_chunk;
+        next_offset_ = (int64_t)chunk_offset;
+        if (samples_in_chunk_ > 0) {
+            break;
+        }
+        chunk_++;  // Chunk rỗng
+    }
+
+    uint64_t sample_size = track_.fixed_sample_size;
+    if (!sample_size && !sizes_.Get(table_fp_, sample_, 0, sample_size)) {
+        return false;
+    }
+    offset = next_offset_;
+    size = (uint32_t)sample_size;
+    next_offset_ += sample_size;
+    sample_++;
+    sample_in_chunk_++;
+    return true;
+}
+
+bool SdM4aDecoder::Fill(SdDecoderSource& source, uint8_t* data, size_t length, size_t& written) {
+    written = 0;
+    while (true) {
+        if (pending_offset_ < 0) {
+            if (!NextSample(pending_offset_, pending_size_)) {
+                pending_offset_ = -1;
+                return written > 0;
+            }
+            if (pending_size_ == 0 || kAdtsHeaderBytes + pending_size_ > kMaxAdtsFrameBytes ||
+                kAdtsHeaderBytes + pending_size_ > kInputBytes / 2) {
+                ESP_LOGW(TAG, "Skipping sample %u of %u bytes", (unsigned)(sample_ - 1), (unsigned)pending_size_);
+                pending_offset_ = -1;
+                continue;
+            }
+        }
+
+        size_t frame_length = kAdtsHeaderBytes + pending_size_;
+        if (frame_length > length - written) {
+            return true;  // Sample giữ lại cho lần sau
+        }
+        if (source.offset() != pending_offset_) {
+            int64_t gap = pending_offset_ - source.offset();
+            if (!(gap > 0 ? source.Skip(gap) : source.Seek(pending_offset_))) {
+                return written > 0;
+            }
+        }
+
+        uint8_t* frame = data + written;
+        frame[0] = 0xFF;
+        frame[1] = 0xF1;  // MPEG-4, layer 0, không CRC
+        frame[2] = (uint8_t)((adts_profile_ << 6) | (adts_rate_index_ << 2) | (adts_channels_ >> 2));
+        frame[3] = (uint8_t)(((adts_channels_ & 3) << 6) | (frame_length >> 11));
+        frame[4] = (uint8_t)(frame_length >> 3);
+        frame[5] = (uint8_t)(((frame_length & 7) << 5) | 0x1F);
+        frame[6] = 0xFC;
+        if (!source.ReadFully(frame + kAdtsHeaderBytes, pending_size_)) {
+            ESP_LOGW(TAG, "File ends inside sample %u", (unsigned)(sample_ - 1));
+            pending_offset_ = -1;
+            sample_ = track_.sample_count;
+            return written > 0;
+        }
+        written += frame_length;
+        pending_offset_ = -1;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SD_M4A_DECODER_H
+#define SD_M4A_DECODER_H
+
+#include "sd_simple_decoder.h"
+
+/*
+ * AAC in an MP4/M4A container.
+ *
+ * Open() walks the atoms (moov/trak/mdia/minf/stbl) of the first AAC audio track with a
+ * second, unbuffered handle on the file. The sample tables (stsz, stsc, stco/co64) stay in
+ * the file: each is read through a window of kWindowEntries entries, so an audiobook of
+ * several hours needs the same few KB as a song. Samples are then read in file order from
+ * the SdDecoderSource, wrapped in an ADTS header built from the AudioSpecificConfig, and
+ * decoded as ADTS AAC. The table handle reads moov wherever it is, so files that were not
+ * made "fast start" (moov after mdat) play without seeking the block reader.
+ */
+class SdM4aDecoder : public SdSimpleDecoder {
+public:
+    SdM4aDecoder();
+    ~SdM4aDecoder() override;
+
+    bool Open(SdDecoderSource& source) override;
+
+protected:
+    bool Fill(SdDecoderSource& source, uint8_t* data, size_t length, size_t& written) override;
+
+private:
+    static constexpr uint32_t kWindowEntries = 128;
+    static constexpr size_t kAdtsHeaderBytes = 7;
+
+    // Array of fixed-size big-endian entries inside the file
+    class Table {
+    public:
+        void Init(int64_t offset, uint32_t count, uint32_t entry_bytes);
+        uint32_t count() const { return count_; }
+        // Field (4 or 8 bytes) at byte field_offset of entry index
+        bool Get(FILE* fp, uint32_t index, uint32_t field_offset, uint64_t& value);
+
+    private:
+        int64_t offset_ = 0;
+        uint32_t count_ = 0;
+        uint32_t entry_bytes_ = 0;
+        uint32_t window_first_ = 0;
+        uint32_t window_count_ = 0;
+        std::vector<uint8_t> window_;
+    };
+
+    struct Track {
+        bool audio = false;
+        bool aac = false;
+        uint32_t timescale = 0;
+        uint64_t duration = 0;
+        int channels = 0;
+        int sample_rate = 0;
+        uint8_t asc[16] = {};             // AudioSpecificConfig từ esds
+        size_t asc_length = 0;
+        uint32_t fixed_sample_size = 0;   // stsz: khác 0 nếu mọi sample cùng kích thước
+        uint32_t sample_count = 0;
+        int64_t stsz_offset = 0;
+        int64_t stsc_offset = 0;
+        uint32_t stsc_count = 0;
+        int64_t chunk_offset = 0;
+        uint32_t chunk_count = 0;
+        bool chunk_offset_64 = false;
+    };
+
+    FILE* table_fp_ = nullptr;
+    Track track_;
+    Table sizes_;
+    Table chunks_;
+    Table sample_to_chunk_;
+
+    // Header ADTS cố định của track, chỉ độ dài frame thay đổi
+    uint8_t adts_profile_ = 0;
+    uint8_t adts_rate_index_ = 0;
+    uint8_t adts_channels_ = 0;
+
+    // Vị trí duyệt sample theo thứ tự file
+    uint32_t sample_ = 0;
+    uint32_t chunk_ = 0;
+    uint32_t sample_in_chunk_ = 0;
+    uint32_t samples_in_chunk_ = 0;
+    uint32_t stsc_index_ = 0;
+    int64_t next_offset_ = 0;
+
+    // Sample đã lấy ra nhưng chưa vừa buffer input
+    int64_t pending_offset_ = -1;
+    uint32_t pending_size_ = 0;
+
+    bool ParseBoxes(int64_t begin, int64_t end, int depth);
+    bool ParseSampleDescription(int64_t begin, int64_t end);
+    bool ParseEsds(int64_t begin, int64_t end);
+    bool ParseAudioSpecificConfig();
+    bool NextSample(int64_t& offset, uint32_t& size);
+};
+
+#endif // SD_M4A_DECODER_H
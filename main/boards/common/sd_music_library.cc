@@ -0,0 +1,328 @@
+#include "sd_music_library.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <esp_log.h>
+
+static const char* TAG = "SdMusicLibrary";
+
+static_assert(sizeof(SdMusicLibrary::Header) == 24, "library.idx header layout");
+static_assert(sizeof(SdMusicLibrary::Record) == 48, "library.idx record layout");
+
+// ================================================================
+//  Builder
+// ================================================================
+
+SdMusicLibrary::Builder::Builder()
+{
+    // Offset 0 là chuỗi rỗng
+    pool_.push_back('\0');
+    offsets_.emplace(std::string(), 0);
+}
+
+uint32_t SdMusicLibrary::Builder::Intern(const std::string& s)
+{
+    if (s.empty()) return 0;
+    auto it = offsets_.find(s);
+    if (it != offsets_.end()) return it->second;
+
+    uint32_t offset = (uint32_t)pool_.size();
+    pool_.append(s);
+    pool_.push_back('\0');
+    offsets_.emplace(s, offset);
+    return offset;
+}
+
+void SdMusicLibrary::Builder::Add(const TrackInfo& t, uint32_t mtime)
+{
+    Record r{};
+    // Path gần như luôn duy nhất, không cần đưa vào bảng dedup
+    r.path = (uint32_t)pool_.size();
+    pool_.append(t.path);
+    pool_.push_back('\0');
+
+    r.name         = Intern(t.name);
+    r.title        = Intern(t.title);
+    r.artist       = Intern(t.artist);
+    r.album        = Intern(t.album);
+    r.genre        = Intern(t.genre);
+    r.comment      = Intern(t.comment);
+    r.year         = Intern(t.year);
+    r.file_size    = (uint32_t)t.file_size;
+    r.mtime        = mtime;
+    r.duration_ms  = t.duration_ms;
+    r.bitrate_kbps = (uint16_t)std::clamp(t.bitrate_kbps, 0, 0xFFFF);
+    r.track_number = (uint16_t)std::clamp(t.track_number, 0, 0xFFFF);
+    records_.push_back(r);
+}
+
+bool SdMusicLibrary::Builder::Save(const std::string& index_path) const
+{
+    // Ghi ra file tạm rồi đổi tên, index cũ vẫn dùng được nếu bị rút thẻ giữa chừng
+    std::string tmp_path = index_path + ".tmp";
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    if (!fp) {
+        ESP_LOGE(TAG, "Cannot create index file: %s", tmp_path.c_str());
+        return false;
+    }
+
+    Header header{};
+    header.magic        = kMagic;
+    header.version      = kVersion;
+    header.record_size  = sizeof(Record);
+    header.record_count = (uint32_t)records_.size();
+    header.pool_size    = (uint32_t)pool_.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    if (ok && !records_.empty()) {
+        ok = fwrite(records_.data(), sizeof(Record), records_.size(), fp) == records_.size();
+    }
+    if (ok) {
+        ok = fwrite(pool_.data(), 1, pool_.size(), fp) == pool_.size();
+    }
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to write index file: %s", tmp_path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+
+    // FAT không cho rename đè file đã tồn tại
+    remove(index_path.c_str());
+    if (rename(tmp_path.c_str(), index_path.c_str()) != 0) {
+        ESP_LOGE(TAG, "Failed to rename %s", tmp_path.c_str());
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Index saved: %s (%u tracks, %u bytes of strings)",
+             index_path.c_str(), (unsigned)records_.size(), (unsigned)pool_.size());
+    return true;
+}
+
+// ================================================================
+//  Reader
+// ================================================================
+
+bool SdMusicLibrary::Open(const std::string& index_path)
+{
+    Close();
+
+    FILE* fp = fopen(index_path.c_str(), "rb");
+    if (!fp) {
+        ESP_LOGW(TAG, "Index file not found: %s", index_path.c_str());
+        return false;
+    }
+
+    Header header{};
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        header.magic != kMagic ||
+        header.version != kVersion ||
+        header.record_size != sizeof(Record)) {
+        ESP_LOGW(TAG, "Invalid index header: %s", index_path.c_str());
+        fclose(fp);
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    uint64_t expected = sizeof(Header) + (uint64_t)header.record_count * sizeof(Record) + header.pool_size;
+    if (file_size < 0 || (uint64_t)file_size != expected || header.pool_size == 0) {
+        ESP_LOGW(TAG, "Index file truncated: %s (%ld/%llu bytes)",
+                 index_path.c_str(), file_size, (unsigned long long)expected);
+        fclose(fp);
+        return false;
+    }
+
+    std::vector<Record> records(header.record_count);
+    fseek(fp, sizeof(Header), SEEK_SET);
+    if (header.record_count > 0 &&
+        fread(records.data(), sizeof(Record), records.size(), fp) != records.size()) {
+        ESP_LOGE(TAG, "Failed to read index records: %s", index_path.c_str());
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+
+    records_.swap(records);
+    static uint32_t next_generation = 0;
+    generation_  = ++next_generation;
+    index_path_  = index_path;
+    pool_offset_ = sizeof(Header) + header.record_count * sizeof(Record);
+    pool_size_   = header.pool_size;
+
+    ESP_LOGI(TAG, "Index opened: %s (%u tracks, %u bytes of strings)",
+             index_path.c_str(), (unsigned)records_.size(), (unsigned)pool_size_);
+    return true;
+}
+
+void SdMusicLibrary::Close()
+{
+    records_.clear();
+    records_.shrink_to_fit();
+    index_path_.clear();
+    pool_offset_ = 0;
+    pool_size_   = 0;
+
+    std::lock_guard<std::mutex> lock(page_mutex_);
+    pages_.clear();
+}
+
+const SdMusicLibrary::Page* SdMusicLibrary::LoadPage(uint32_t number) const
+{
+    for (auto it = pages_.begin(); it != pages_.end(); ++it) {
+        if (it->number == number) {
+            pages_.splice(pages_.begin(), pages_, it);
+            page_hits_++;
+            return &pages_.front();
+        }
+    }
+    page_misses_++;
+
+    uint32_t start = number * kPageSize;
+    if (start >= pool_size_) return nullptr;
+    size_t length = std::min<size_t>(kPageSize, pool_size_ - start);
+
+    FILE* fp = fopen(index_path_.c_str(), "rb");
+    if (!fp) {
+        ESP_LOGE(TAG, "Cannot reopen index: %s", index_path_.c_str());
+        return nullptr;
+    }
+    Page page;
+    page.number = number;
+    page.data.resize(length);
+    bool ok = fseek(fp, pool_offset_ + start, SEEK_SET) == 0 &&
+              fread(page.data.data(), 1, length, fp) == length;
+    fclose(fp);
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to read string page %u", (unsigned)number);
+        return nullptr;
+    }
+
+    if (pages_.size() >= kMaxCachedPages) {
+        pages_.pop_back();
+    }
+    pages_.push_front(std::move(page));
+    return &pages_.front();
+}
+
+std::string SdMusicLibrary::ReadString(uint32_t offset) const
+{
+    std::string out;
+    if (offset == 0 || offset >= pool_size_) return out;
+
+    std::lock_guard<std::mutex> lock(page_mutex_);
+    while (offset < pool_size_) {
+        const Page* page = LoadPage(offset / kPageSize);
+        if (!page) break;
+
+        // Chuỗi có thể nằm vắt qua 2 trang
+        const char* begin = page->data.data() + (offset % kPageSize);
+        const char* end   = page->data.data() + page->data.size();
+        const char* nul   = (const char*)memchr(begin, '\0', end - begin);
+        if (nul) {
+            out.append(begin, nul);
+            break;
+        }
+        out.append(begin, end);
+        offset += end - begin;
+    }
+    return out;
+}
+
+SdMusicLibrary::TrackInfo SdMusicLibrary::Get(size_t index) const
+{
+    TrackInfo t;
+    if (index >= records_.size()) return t;
+
+    const Record& r = records_[index];
+    t.path         = ReadString(r.path);
+    t.name         = ReadString(r.name);
+    t.title        = ReadString(r.title);
+    t.artist       = ReadString(r.artist);
+    t.album        = ReadString(r.album);
+    t.genre        = ReadString(r.genre);
+    t.comment      = ReadString(r.comment);
+    t.year         = ReadString(r.year);
+    t.track_number = r.track_number;
+    t.duration_ms  = r.duration_ms;
+    t.bitrate_kbps = r.bitrate_kbps;
+    t.file_size    = r.file_size;
+    return t;
+}
+
+std::string SdMusicLibrary::GetName(size_t index) const
+{
+    return index < records_.size() ? ReadString(records_[index].name) : std::string();
+}
+
+std::string SdMusicLibrary::GetPath(size_t index) const
+{
+    return index < records_.size() ? ReadString(records_[index].path) : std::string();
+}
+
+std::string SdMusicLibrary::GetArtist(size_t index) const
+{
+    return index < records_.size() ? ReadString(records_[index].artist) : std::string();
+}
+
+std::string SdMusicLibrary::GetGenre(size_t index) const
+{
+    return index < records_.size() ? ReadString(records_[index].genre) : std::string();
+}
+
+std::vector<SdMusicLibrary::TrackInfo> SdMusicLibrary::GetRange(size_t start, size_t count) const
+{
+    std::vector<TrackInfo> out;
+    if (start >= records_.size()) return out;
+
+    size_t end = std::min(start + count, records_.size());
+    out.reserve(end - start);
+    for (size_t i = start; i < end; ++i) {
+        out.push_back(Get(i));
+    }
+    return out;
+}
+
+bool SdMusicLibrary::IsUnchanged(size_t index, size_t file_size, uint32_t mtime) const
+{
+    if (index >= records_.size()) return false;
+    const Record& r = records_[index];
+    return r.file_size == (uint32_t)file_size && r.mtime == mtime && mtime != 0;
+}
+
+std::unordered_map<std::string, uint32_t> SdMusicLibrary::BuildPathMap() const
+{
+    std::unordered_map<std::string, uint32_t> map;
+    map.reserve(records_.size());
+    for (size_t i = 0; i < records_.size(); ++i) {
+        map.emplace(ReadString(records_[i].path), (uint32_t)i);
+    }
+    return map;
+}
+
+void SdMusicLibrary::UpdateAudioInfo(size_t index, int duration_ms, int bitrate_kbps, size_t file_size)
+{
+    if (index >= records_.size()) return;
+    Record& r = records_[index];
+    r.duration_ms  = duration_ms;
+    r.bitrate_kbps = (uint16_t)std::clamp(bitrate_kbps, 0, 0xFFFF);
+    r.file_size    = (uint32_t)file_size;
+}
+
+std::string SdMusicLibrary::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(page_mutex_);
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "tracks=%u records=%uKB strings=%uKB pages=%u/%u hits=%lu misses=%lu",
+             (unsigned)records_.size(),
+             (unsigned)(records_.size() * sizeof(Record) / 1024),
+             (unsigned)(pool_size_ / 1024),
+             (unsigned)pages_.size(), (unsigned)kMaxCachedPages,
+             (unsigned long)page_hits_, (unsigned long)page_misses_);
+    return buf;
+}
@@ -0,0 +1,136 @@
+#ifndef SD_MUSIC_LIBRARY_H
+#define SD_MUSIC_LIBRARY_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <list>
+#include <cstdint>
+#include <cstddef>
+
+#include "sdmusic.h"
+
+/*
+ * Binary SD music library index (library.idx), replaces playlist.json.
+ *
+ * File layout (little endian):
+ *   Header | Record[record_count] | string pool[pool_size]
+ *
+ * A record is a fixed-size row with the numeric metadata and offsets of its strings in
+ * the pool. The pool holds NUL terminated UTF-8 strings, repeated values (artist, album,
+ * genre, year...) are stored once. Open() only loads the header and the record table,
+ * strings are read from the card in fixed pages on demand and kept in a small LRU, so a
+ * page of listTracksPage only touches the pages it needs.
+ *
+ * Records remember the file size and mtime they were scanned with, an incremental rescan
+ * reuses the metadata of every file whose size and mtime did not change.
+ */
+class SdMusicLibrary {
+public:
+    using TrackInfo = SdMusic::TrackInfo;
+
+    static constexpr uint32_t kMagic = 0x4C4D5A58;  // "XZML"
+    static constexpr uint16_t kVersion = 1;
+
+#pragma pack(push, 1)
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t record_size;
+        uint32_t record_count;
+        uint32_t pool_size;
+        uint32_t reserved[2];
+    };
+
+    struct Record {
+        // Offsets into the string pool, 0 is the empty string
+        uint32_t path;
+        uint32_t name;
+        uint32_t title;
+        uint32_t artist;
+        uint32_t album;
+        uint32_t genre;
+        uint32_t comment;
+        uint32_t year;
+        uint32_t file_size;
+        uint32_t mtime;
+        int32_t  duration_ms;
+        uint16_t bitrate_kbps;
+        uint16_t track_number;
+    };
+#pragma pack(pop)
+
+    // Collects tracks into records + a deduplicated pool, then writes library.idx
+    class Builder {
+    public:
+        Builder();
+        void Add(const TrackInfo& track, uint32_t mtime);
+        size_t size() const { return records_.size(); }
+        bool Save(const std::string& index_path) const;
+
+    private:
+        std::vector<Record> records_;
+        std::string pool_;
+        std::unordered_map<std::string, uint32_t> offsets_;
+
+        uint32_t Intern(const std::string& s);
+    };
+
+    SdMusicLibrary() = default;
+    SdMusicLibrary(const SdMusicLibrary&) = delete;
+    SdMusicLibrary& operator=(const SdMusicLibrary&) = delete;
+
+    // Loads the header and record table, returns false if the file is missing or invalid
+    bool Open(const std::string& index_path);
+    void Close();
+
+    size_t size() const { return records_.size(); }
+    bool empty() const { return records_.empty(); }
+    const std::string& index_path() const { return index_path_; }
+    // Changes on every Open(), lets derived indexes know they are stale
+    uint32_t generation() const { return generation_; }
+
+    // Materialise one track, strings are paged in from the card if needed
+    TrackInfo Get(size_t index) const;
+    std::string GetName(size_t index) const;
+    std::string GetPath(size_t index) const;
+    std::string GetArtist(size_t index) const;
+    std::string GetGenre(size_t index) const;
+    std::vector<TrackInfo> GetRange(size_t start, size_t count) const;
+
+    // True if the file at path was indexed with the same size and mtime
+    bool IsUnchanged(size_t index, size_t file_size, uint32_t mtime) const;
+    // Path -> record index, for incremental rescans
+    std::unordered_map<std::string, uint32_t> BuildPathMap() const;
+
+    // Audio info learned while decoding, kept in RAM until the next save
+    void UpdateAudioInfo(size_t index, int duration_ms, int bitrate_kbps, size_t file_size);
+
+    std::string GetStats() const;
+
+private:
+    static constexpr size_t kPageSize = 4096;
+    static constexpr size_t kMaxCachedPages = 16;
+
+    struct Page {
+        uint32_t number;
+        std::vector<char> data;
+    };
+
+    std::string index_path_;
+    std::vector<Record> records_;
+    uint32_t pool_offset_ = 0;
+    uint32_t pool_size_ = 0;
+    uint32_t generation_ = 0;
+
+    mutable std::mutex page_mutex_;
+    mutable std::list<Page> pages_;  // Front is the most recently used
+    mutable uint32_t page_hits_ = 0;
+    mutable uint32_t page_misses_ = 0;
+
+    std::string ReadString(uint32_t offset) const;
+    const Page* LoadPage(uint32_t number) const;
+};
+
+#endif // SD_MUSIC_LIBRARY_H
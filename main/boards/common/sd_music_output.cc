@@ -0,0 +1,121 @@
+#include "sd_music_output.h"
+
+#include <algorithm>
+#include <span>
+
+#include <esp_log.h>
+
+#include "application.h"
+
+static const char* TAG = "SdMusicOutput";
+
+void SdMusicOutput::SetCrossfadeMs(int ms)
+{
+    crossfade_ms_ = std::clamp(ms, 0, kMaxCrossfadeMs);
+}
+
+void SdMusicOutput::HoldTail()
+{
+    if (crossfade_ms_.load() > 0) {
+        holding_ = true;
+    }
+}
+
+void SdMusicOutput::EndTrack()
+{
+    holding_ = false;
+    if (held() == 0) {
+        Reset();
+        return;
+    }
+    mixing_ = true;
+    fade_length_ = held();
+    fade_position_ = 0;
+}
+
+void SdMusicOutput::Flush()
+{
+    if (held() > 0) {
+        Play(tail_.data() + tail_start_, held(), tail_rate_);
+    }
+    Reset();
+}
+
+void SdMusicOutput::Reset()
+{
+    holding_ = false;
+    mixing_ = false;
+    tail_.clear();
+    tail_start_ = 0;
+    fade_length_ = 0;
+    fade_position_ = 0;
+}
+
+void SdMusicOutput::Write(int16_t* pcm, size_t samples, int sample_rate)
+{
+    if (samples == 0 || sample_rate <= 0) {
+        return;
+    }
+
+    if (mixing_) {
+        if (sample_rate != tail_rate_) {
+            // Bring the rest of the old track to the new rate once, the fade runs at the new rate
+            resampler_.Configure(tail_rate_, sample_rate);
+            resampler_.Reset();
+            resampled_.clear();
+            resampled_.reserve(resampler_.GetOutputSamples(held()));
+            resampler_.Process(std::span<const int16_t>(tail_.data() + tail_start_, held()), resampled_);
+            tail_.swap(resampled_);
+            tail_start_ = 0;
+            tail_rate_ = sample_rate;
+            fade_length_ = std::max<size_t>(tail_.size(), 1);
+            fade_position_ = 0;
+            ESP_LOGI(TAG, "Crossfade %u samples at %d Hz", (unsigned)tail_.size(), sample_rate);
+        }
+
+        // Linear crossfade in Q15: the old track fades out while the new one fades in
+        size_t n = std::min(samples, held());
+        for (size_t i = 0; i < n; i++) {
+            int32_t gain = (int32_t)(((fade_position_ + i) << 15) / fade_length_);
+            int32_t mixed = (tail_[tail_start_ + i] * (32768 - gain) + pcm[i] * gain) >> 15;
+            pcm[i] = (int16_t)std::clamp<int32_t>(mixed, INT16_MIN, INT16_MAX);
+        }
+        tail_start_ += n;
+        fade_position_ += n;
+        if (held() == 0) {
+            crossfades_++;
+            Reset();
+        }
+        Play(pcm, samples, sample_rate);
+        return;
+    }
+
+    if (holding_) {
+        if (held() > 0 && sample_rate != tail_rate_) {
+            Flush();
+            holding_ = true;
+        }
+        tail_rate_ = sample_rate;
+        tail_.insert(tail_.end(), pcm, pcm + samples);
+
+        // Play what is older than the window, compact once the played part is a window long
+        size_t window = (size_t)sample_rate * crossfade_ms_.load() / 1000;
+        if (held() > window) {
+            size_t excess = held() - window;
+            Play(tail_.data() + tail_start_, excess, sample_rate);
+            tail_start_ += excess;
+        }
+        if (tail_start_ > 0 && tail_start_ >= window) {
+            tail_.erase(tail_.begin(), tail_.begin() + tail_start_);
+            tail_start_ = 0;
+        }
+        return;
+    }
+
+    Play(pcm, samples, sample_rate);
+}
+
+void SdMusicOutput::Play(const int16_t* pcm, size_t samples, int sample_rate)
+{
+    Application::GetInstance().AddAudioData(std::span<const int16_t>(pcm, samples), sample_rate);
+}
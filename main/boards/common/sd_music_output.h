@@ -0,0 +1,63 @@
+#ifndef SD_MUSIC_OUTPUT_H
+#define SD_MUSIC_OUTPUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "audio/pcm_resampler.h"
+
+/*
+ * Output stage of the SD player, between the decoders and Application::AddAudioData.
+ *
+ * Consecutive tracks are written back to back, so when they share a format the next one
+ * starts on the sample after the last one. When the next track needs another sample rate
+ * and a crossfade is configured, the player calls HoldTail() near the end: the last
+ * crossfade window is kept back instead of played, and after EndTrack() it is resampled
+ * to the new rate once and faded out over the start of the next track.
+ *
+ * All calls except SetCrossfadeMs() come from the playback thread.
+ */
+class SdMusicOutput {
+public:
+    static constexpr int kMaxCrossfadeMs = 2000;
+
+    // 0 turns the crossfade off, track changes between formats are then a plain cut
+    void SetCrossfadeMs(int ms);
+    int crossfade_ms() const { return crossfade_ms_.load(); }
+
+    // Keep the last crossfade window of the current track back
+    void HoldTail();
+    // The current track has ended, a held tail is mixed into the next Write() calls
+    void EndTrack();
+    // Plays what is still held, e.g. after the last track
+    void Flush();
+    // Drops what is still held, e.g. on stop
+    void Reset();
+
+    // Mono PCM, the buffer is mixed into in place
+    void Write(int16_t* pcm, size_t samples, int sample_rate);
+
+    uint32_t crossfades() const { return crossfades_; }
+
+private:
+    std::atomic<int> crossfade_ms_{0};
+
+    bool holding_ = false;
+    bool mixing_ = false;
+    int tail_rate_ = 0;
+    std::vector<int16_t> tail_;
+    size_t tail_start_ = 0;     // First sample of tail_ not played yet
+    size_t fade_length_ = 0;
+    size_t fade_position_ = 0;
+    uint32_t crossfades_ = 0;
+
+    PcmResampler resampler_;
+    std::vector<int16_t> resampled_;
+
+    void Play(const int16_t* pcm, size_t samples, int sample_rate);
+    size_t held() const { return tail_.size() - tail_start_; }
+};
+
+#endif // SD_MUSIC_OUTPUT_H
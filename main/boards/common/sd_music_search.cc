@@ -0,0 +1,449 @@
+#include "sd_music_search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+
+#include <esp_log.h>
+
+#define TAG "SdMusicSearch"
+
+// ================================================================
+//  Chuẩn hoá: lower ASCII + bỏ dấu tiếng Việt + gom ký tự phân cách
+// ================================================================
+
+namespace {
+
+struct FoldEntry {
+    uint32_t code_point;
+    char ascii;
+};
+
+uint32_t DecodeUtf8(const std::string& s, size_t& i)
+{
+    unsigned char c = s[i];
+    int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+    // ASCII, byte lẻ hoặc chuỗi bị cắt giữa ký tự → trả nguyên byte
+    if (extra == 0 || i + extra >= s.size()) {
+        i += 1;
+        return c;
+    }
+    uint32_t cp = c & (0x3F >> extra);
+    for (int k = 1; k <= extra; k++) {
+        unsigned char cc = s[i + k];
+        if ((cc & 0xC0) != 0x80) {
+            i += 1;
+            return c;
+        }
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    i += extra + 1;
+    return cp;
+}
+
+const std::vector<FoldEntry>& FoldTable()
+{
+    static const std::vector<FoldEntry> table = [] {
+        static const struct {
+            char ascii;
+            const char* letters;
+        } groups[] = {
+            { 'a', "àáảãạăằắẳẵặâầấẩẫậÀÁẢÃẠĂẰẮẲẴẶÂẦẤẨẪẬ" },
+            { 'e', "èéẻẽẹêềếểễệÈÉẺẼẸÊỀẾỂỄỆ" },
+            { 'i', "ìíỉĩịÌÍỈĨỊ" },
+            { 'o', "òóỏõọôồốổỗộơờớởỡợÒÓỎÕỌÔỒỐỔỖỘƠỜỚỞỠỢ" },
+            { 'u', "ùúủũụưừứửữựÙÚỦŨỤƯỪỨỬỮỰ" },
+            { 'y', "ỳýỷỹỵỲÝỶỸỴ" },
+            { 'd', "đĐ" },
+        };
+        std::vector<FoldEntry> out;
+        for (const auto& g : groups) {
+            std::string letters = g.letters;
+            size_t i = 0;
+            while (i < letters.size()) {
+                out.push_back({ DecodeUtf8(letters, i), g.ascii });
+            }
+        }
+        std::sort(out.begin(), out.end(),
+                  [](const FoldEntry& a, const FoldEntry& b) { return a.code_point < b.code_point; });
+        return out;
+    }();
+    return table;
+}
+
+char FoldCodePoint(uint32_t cp)
+{
+    const auto& table = FoldTable();
+    auto it = std::lower_bound(table.begin(), table.end(), cp,
+                               [](const FoldEntry& e, uint32_t v) { return e.code_point < v; });
+    return (it != table.end() && it->code_point == cp) ? it->ascii : 0;
+}
+
+std::string ToLowerAscii(const std::string& s)
+{
+    std::string out = s;
+    for (char& c : out) {
+        unsigned char uc = static_cast<unsigned char>(c);
+        if (uc >= 'A' && uc <= 'Z') {
+            c = static_cast<char>(uc - 'A' + 'a');
+        }
+    }
+    return out;
+}
+
+std::string ExtractDirectory(const std::string& path)
+{
+    size_t pos = path.find_last_of('/');
+    return pos == std::string::npos ? std::string() : path.substr(0, pos);
+}
+
+std::string ExtractFileName(const std::string& path)
+{
+    size_t pos = path.find_last_of('/');
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+std::string ExtractBaseNameNoExt(const std::string& name_or_path)
+{
+    size_t slash = name_or_path.find_last_of('/');
+    size_t start = (slash == std::string::npos) ? 0 : slash + 1;
+    size_t dot = name_or_path.find_last_of('.');
+    size_t end = (dot == std::string::npos || dot < start) ? name_or_path.size() : dot;
+    return name_or_path.substr(start, end - start);
+}
+
+inline uint32_t TrigramKey(const char* p)
+{
+    return ((uint32_t)(uint8_t)p[0] << 16) | ((uint32_t)(uint8_t)p[1] << 8) | (uint8_t)p[2];
+}
+
+// Unique trigrams of each field, never spanning two fields
+void CollectTrigrams(std::initializer_list<std::string_view> fields, std::vector<uint32_t>& keys)
+{
+    keys.clear();
+    for (auto field : fields) {
+        for (size_t i = 0; i + 3 <= field.size(); i++) {
+            keys.push_back(TrigramKey(field.data() + i));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+} // namespace
+
+std::string SdMusicSearchIndex::Normalize(const std::string& s)
+{
+    std::string out;
+    out.reserve(s.size());
+    bool last_space = false;
+
+    size_t i = 0;
+    while (i < s.size()) {
+        size_t start = i;
+        uint32_t cp = DecodeUtf8(s, i);
+
+        char ascii = 0;
+        if (cp < 128) {
+            ascii = (cp >= 'A' && cp <= 'Z') ? (char)(cp - 'A' + 'a') : (char)cp;
+        } else {
+            ascii = FoldCodePoint(cp);
+        }
+
+        if ((ascii >= 'a' && ascii <= 'z') || (ascii >= '0' && ascii <= '9')) {
+            out.push_back(ascii);
+            last_space = false;
+        } else if (ascii == ' ' || ascii == '_' || ascii == '-' ||
+                   ascii == '.' || ascii == '/' || ascii == '\\') {
+            if (!last_space && !out.empty()) {
+                out.push_back(' ');
+                last_space = true;
+            }
+        } else if (cp >= 128) {
+            // Giữ nguyên ký tự UTF-8 không phải tiếng Việt
+            out.append(s, start, i - start);
+            last_space = false;
+        } else {
+            // Các ký tự ASCII khác giữ nguyên như NormalizeForSearch cũ
+            out.push_back(ascii);
+            last_space = false;
+        }
+    }
+    while (!out.empty() && out.back() == ' ') out.pop_back();
+    return out;
+}
+
+// ================================================================
+//  Build
+// ================================================================
+
+void SdMusicSearchIndex::Build(size_t count, const std::function<Entry(size_t)>& get_entry, uint32_t generation)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto data = std::make_shared<Data>();
+    data->generation = generation;
+    data->tracks.reserve(count);
+
+    auto append = [&](const std::string& s) -> Span {
+        Span span{ (uint32_t)data->pool.size(), (uint16_t)std::min<size_t>(s.size(), 0xFFFF) };
+        data->pool.append(s, 0, span.length);
+        return span;
+    };
+
+    // Thư mục: chuẩn hoá một lần cho mỗi thư mục, không phải mỗi bài
+    std::unordered_map<std::string, uint32_t> dir_ids;
+    std::vector<uint32_t> dir_counts;
+
+    for (size_t i = 0; i < count; i++) {
+        Entry e = get_entry(i);
+
+        Track t{};
+        t.name   = append(Normalize(e.name));
+        t.artist = append(Normalize(e.artist));
+        t.file   = append(Normalize(ExtractBaseNameNoExt(ExtractFileName(e.path))));
+
+        std::string similar = ToLowerAscii(ExtractBaseNameNoExt(e.name.empty() ? e.path : e.name));
+        size_t space = similar.find(' ');
+        t.first_word = (uint16_t)std::min<size_t>(space == std::string::npos ? similar.size() : space, 0xFFFF);
+        t.similar = append(similar);
+
+        std::string dir = ExtractDirectory(e.path);
+        auto it = dir_ids.find(dir);
+        if (it == dir_ids.end()) {
+            it = dir_ids.emplace(dir, (uint32_t)data->dirs.size()).first;
+            data->dirs.push_back(append(Normalize(dir)));
+            dir_counts.push_back(0);
+        }
+        t.dir = it->second;
+        dir_counts[t.dir]++;
+        data->tracks.push_back(t);
+    }
+    data->pool.shrink_to_fit();
+
+    // CSR thư mục → bài
+    data->dir_starts.assign(data->dirs.size() + 1, 0);
+    for (size_t d = 0; d < dir_counts.size(); d++) {
+        data->dir_starts[d + 1] = data->dir_starts[d] + dir_counts[d];
+    }
+    data->dir_tracks.resize(count);
+    {
+        std::vector<uint32_t> cursor(data->dir_starts.begin(), data->dir_starts.end() - 1);
+        for (size_t i = 0; i < count; i++) {
+            data->dir_tracks[cursor[data->tracks[i].dir]++] = (uint32_t)i;
+        }
+    }
+
+    // Trigram: đếm trước rồi điền, không giữ mảng (key, track) tạm
+    if (count <= 0xFFFF) {
+        std::unordered_map<uint32_t, uint32_t> counts;
+        std::vector<uint32_t> keys;
+        for (const auto& t : data->tracks) {
+            CollectTrigrams({ data->View(t.name), data->View(t.artist), data->View(t.file) }, keys);
+            for (uint32_t k : keys) counts[k]++;
+        }
+
+        data->trigram_keys.reserve(counts.size());
+        for (const auto& kv : counts) data->trigram_keys.push_back(kv.first);
+        std::sort(data->trigram_keys.begin(), data->trigram_keys.end());
+
+        data->trigram_starts.assign(data->trigram_keys.size() + 1, 0);
+        for (size_t k = 0; k < data->trigram_keys.size(); k++) {
+            uint32_t n = counts[data->trigram_keys[k]];
+            data->trigram_starts[k + 1] = data->trigram_starts[k] + n;
+            counts[data->trigram_keys[k]] = data->trigram_starts[k];  // Dùng lại làm con trỏ ghi
+        }
+        data->trigram_tracks.resize(data->trigram_starts.back());
+        for (size_t i = 0; i < count; i++) {
+            const Track& t = data->tracks[i];
+            CollectTrigrams({ data->View(t.name), data->View(t.artist), data->View(t.file) }, keys);
+            for (uint32_t k : keys) data->trigram_tracks[counts[k]++] = (uint16_t)i;
+        }
+    } else {
+        ESP_LOGW(TAG, "%u tracks exceed the trigram table, searches will scan", (unsigned)count);
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    ESP_LOGI(TAG, "Index built in %lld ms: %u tracks, %u dirs, %u trigrams, %u postings",
+             (long long)elapsed, (unsigned)count, (unsigned)data->dirs.size(),
+             (unsigned)data->trigram_keys.size(), (unsigned)data->trigram_tracks.size());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_ = std::move(data);
+}
+
+void SdMusicSearchIndex::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_.reset();
+}
+
+std::shared_ptr<const SdMusicSearchIndex::Data> SdMusicSearchIndex::Snapshot() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return data_;
+}
+
+uint32_t SdMusicSearchIndex::generation() const
+{
+    auto data = Snapshot();
+    return data ? data->generation : 0;
+}
+
+size_t SdMusicSearchIndex::size() const
+{
+    auto data = Snapshot();
+    return data ? data->tracks.size() : 0;
+}
+
+// ================================================================
+//  Queries
+// ================================================================
+
+int SdMusicSearchIndex::MatchTier(const Data& data, const Track& track, std::string_view keyword)
+{
+    std::string_view name = data.View(track.name);
+    size_t pos = name.find(keyword);
+    if (pos == 0) return 0;
+    if (pos != std::string_view::npos) return 1;
+    if (data.View(track.artist).find(keyword) != std::string_view::npos) return 2;
+    if (data.View(track.file).find(keyword) != std::string_view::npos) return 3;
+    if (data.View(data.dirs[track.dir]).find(keyword) != std::string_view::npos) return 4;
+    return -1;
+}
+
+std::vector<uint32_t> SdMusicSearchIndex::Search(const std::string& keyword, size_t max_results) const
+{
+    std::vector<uint32_t> results;
+    auto data = Snapshot();
+    if (!data || data->tracks.empty()) return results;
+
+    std::string kw = Normalize(keyword);
+    if (kw.empty()) return results;
+
+    std::vector<uint32_t> candidates;
+    bool scan_all = kw.size() < 3 || data->trigram_tracks.empty();
+
+    if (!scan_all) {
+        // Bài chứa đủ mọi trigram của keyword, bắt đầu từ danh sách ngắn nhất
+        std::vector<uint32_t> keys;
+        CollectTrigrams({ std::string_view(kw) }, keys);
+
+        struct Range { const uint16_t* begin; const uint16_t* end; };
+        std::vector<Range> ranges;
+        for (uint32_t k : keys) {
+            auto it = std::lower_bound(data->trigram_keys.begin(), data->trigram_keys.end(), k);
+            if (it == data->trigram_keys.end() || *it != k) {
+                ranges.clear();
+                break;
+            }
+            size_t slot = it - data->trigram_keys.begin();
+            ranges.push_back({ data->trigram_tracks.data() + data->trigram_starts[slot],
+                               data->trigram_tracks.data() + data->trigram_starts[slot + 1] });
+        }
+        if (!ranges.empty()) {
+            std::sort(ranges.begin(), ranges.end(),
+                      [](const Range& a, const Range& b) { return (a.end - a.begin) < (b.end - b.begin); });
+            candidates.assign(ranges[0].begin, ranges[0].end);
+            for (size_t r = 1; r < ranges.size() && !candidates.empty(); r++) {
+                candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                                [&](uint32_t t) {
+                                                    return !std::binary_search(ranges[r].begin, ranges[r].end, (uint16_t)t);
+                                                }),
+                                 candidates.end());
+            }
+        }
+
+        // Thư mục không nằm trong bảng trigram, số thư mục ít nên duyệt thẳng
+        size_t trigram_count = candidates.size();
+        for (size_t d = 0; d < data->dirs.size(); d++) {
+            if (data->View(data->dirs[d]).find(kw) != std::string_view::npos) {
+                candidates.insert(candidates.end(),
+                                  data->dir_tracks.begin() + data->dir_starts[d],
+                                  data->dir_tracks.begin() + data->dir_starts[d + 1]);
+            }
+        }
+        if (candidates.size() != trigram_count) {
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        }
+    }
+
+    std::vector<std::pair<int, uint32_t>> matches;
+    auto consider = [&](uint32_t t) {
+        int tier = MatchTier(*data, data->tracks[t], kw);
+        if (tier >= 0) matches.push_back({ tier, t });
+    };
+    if (scan_all) {
+        for (uint32_t t = 0; t < data->tracks.size(); t++) consider(t);
+    } else {
+        for (uint32_t t : candidates) consider(t);
+    }
+
+    size_t limit = max_results == 0 ? matches.size() : std::min(max_results, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + limit, matches.end());
+    results.reserve(limit);
+    for (size_t i = 0; i < limit; i++) {
+        results.push_back(matches[i].second);
+    }
+    return results;
+}
+
+std::vector<uint32_t> SdMusicSearchIndex::Similar(uint32_t base, const std::vector<uint32_t>& play_counts,
+                                                  size_t max_results) const
+{
+    std::vector<uint32_t> results;
+    auto data = Snapshot();
+    if (!data || base >= data->tracks.size() || max_results == 0) return results;
+
+    const Track& b = data->tracks[base];
+    std::string_view base_name = data->View(b.similar);
+    std::string_view base_first = base_name.substr(0, b.first_word);
+    bool base_has_dir = b.dir < data->dirs.size() && data->dirs[b.dir].length > 0;
+
+    std::vector<std::pair<int, uint32_t>> scored;
+    scored.reserve(data->tracks.size());
+    for (uint32_t i = 0; i < data->tracks.size(); i++) {
+        if (i == base) continue;
+        const Track& c = data->tracks[i];
+        int score = 0;
+        if (base_has_dir && c.dir == b.dir) {
+            score += 3;
+        }
+        std::string_view cand_name = data->View(c.similar);
+        if (!base_name.empty() && !cand_name.empty()) {
+            if (cand_name.find(base_name) != std::string_view::npos ||
+                base_name.find(cand_name) != std::string_view::npos) {
+                score += 3;
+            } else if (!base_first.empty() && base_first == cand_name.substr(0, c.first_word)) {
+                score += 1;
+            }
+        }
+        if (i < play_counts.size()) {
+            score += (int)play_counts[i];
+        }
+        // Điểm cao trước, cùng điểm giữ thứ tự playlist
+        scored.push_back({ -score, i });
+    }
+
+    size_t limit = std::min(max_results, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + limit, scored.end());
+    results.reserve(limit);
+    for (size_t i = 0; i < limit; i++) {
+        results.push_back(scored[i].second);
+    }
+    return results;
+}
+
+std::string SdMusicSearchIndex::GetStats() const
+{
+    auto data = Snapshot();
+    if (!data) return "empty";
+    char buf[160];
+    snprintf(buf, sizeof(buf), "tracks=%u dirs=%u text=%uKB trigrams=%u postings=%uKB",
+             (unsigned)data->tracks.size(), (unsigned)data->dirs.size(),
+             (unsigned)(data->pool.size() / 1024), (unsigned)data->trigram_keys.size(),
+             (unsigned)(data->trigram_tracks.size() * sizeof(uint16_t) / 1024));
+    return buf;
+}
@@ -0,0 +1,90 @@
+#ifndef SD_MUSIC_SEARCH_H
+#define SD_MUSIC_SEARCH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Search index over the SD music library, built once per library load.
+ *
+ * Every title, artist, file name and directory is normalised once (ASCII lower case,
+ * Vietnamese diacritics folded, separators collapsed) into one string pool. A trigram
+ * table maps each 3-byte sequence to the tracks containing it, so a keyword only verifies
+ * the tracks holding all of its trigrams instead of renormalising the whole playlist.
+ *
+ * Build() fills a new snapshot and swaps it in, queries work on the snapshot they picked
+ * up, so neither side holds the playlist lock while the other runs.
+ */
+class SdMusicSearchIndex {
+public:
+    struct Entry {
+        std::string name;
+        std::string artist;
+        std::string path;
+    };
+
+    // Lower case + Vietnamese diacritic folding, ' ', '_', '-', '.', '/', '\\' collapse into one space
+    static std::string Normalize(const std::string& s);
+
+    void Build(size_t count, const std::function<Entry(size_t)>& get_entry, uint32_t generation);
+    void Clear();
+
+    uint32_t generation() const;
+    size_t size() const;
+
+    // Best matches first: title prefix, title, artist, file name, then directory; ties keep
+    // playlist order. max_results == 0 returns every match
+    std::vector<uint32_t> Search(const std::string& keyword, size_t max_results) const;
+
+    // Same ranking as the old per-track suggestion score (same directory, similar name,
+    // play count), computed over the pre-normalised names
+    std::vector<uint32_t> Similar(uint32_t base, const std::vector<uint32_t>& play_counts,
+                                  size_t max_results) const;
+
+    std::string GetStats() const;
+
+private:
+    struct Span {
+        uint32_t offset;
+        uint16_t length;
+    };
+
+    struct Track {
+        Span name;        // Normalize(name)
+        Span artist;      // Normalize(artist)
+        Span file;        // Normalize(file name without directory)
+        Span similar;     // Lower case base name used by Similar()
+        uint16_t first_word;
+        uint32_t dir;
+    };
+
+    struct Data {
+        uint32_t generation = 0;
+        std::string pool;
+        std::vector<Track> tracks;
+
+        std::vector<Span> dirs;                // Normalize(directory)
+        std::vector<uint32_t> dir_starts;      // CSR: tracks of dir d are dir_tracks[dir_starts[d] .. dir_starts[d + 1])
+        std::vector<uint32_t> dir_tracks;
+
+        std::vector<uint32_t> trigram_keys;    // Sorted
+        std::vector<uint32_t> trigram_starts;  // CSR into trigram_tracks, one more than keys
+        std::vector<uint16_t> trigram_tracks;  // Empty when the library exceeds 65535 tracks
+
+        std::string_view View(const Span& s) const { return std::string_view(pool).substr(s.offset, s.length); }
+    };
+
+    mutable std::mutex mutex_;
+    std::shared_ptr<const Data> data_;
+
+    std::shared_ptr<const Data> Snapshot() const;
+    static int MatchTier(const Data& data, const Track& track, std::string_view keyword);
+};
+
+#endif // SD_MUSIC_SEARCH_H
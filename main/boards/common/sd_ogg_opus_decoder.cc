@@ -0,0 +1,313 @@
+#include "sd_ogg_opus_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_log.h>
+#include <opus.h>
+
+#define TAG "SdOggOpusDecoder"
+
+static constexpr uint8_t kPageContinued = 0x01;
+static constexpr uint8_t kPageBeginOfStream = 0x02;
+static constexpr uint8_t kPageEndOfStream = 0x04;
+// Tìm lại "OggS" sau dữ liệu hỏng tối đa chừng này byte
+static constexpr int kMaxResyncBytes = 64 * 1024;
+
+static inline uint16_t Le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t Le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int64_t Le64(const uint8_t* p) {
+    return (int64_t)((uint64_t)Le32(p) | ((uint64_t)Le32(p + 4) << 32));
+}
+
+SdOggOpusDecoder::~SdOggOpusDecoder() {
+    if (decoder_) {
+        opus_decoder_destroy(decoder_);
+        decoder_ = nullptr;
+    }
+}
+
+bool SdOggOpusDecoder::ReadPage(SdDecoderSource& source) {
+    uint8_t header[kPageHeaderBytes];
+    if (!source.ReadFully(header, sizeof(header))) {
+        return false;
+    }
+    int skipped = 0;
+    while (memcmp(header, "OggS", 4) != 0 || header[4] != 0) {
+        if (++skipped > kMaxResyncBytes) {
+            ESP_LOGE(TAG, "Lost Ogg page sync");
+            return false;
+        }
+        memmove(header, header + 1, sizeof(header) - 1);
+        if (!source.ReadFully(header + sizeof(header) - 1, 1)) {
+            return false;
+        }
+    }
+    if (skipped > 0) {
+        ESP_LOGW(TAG, "Skipped %d bytes to the next Ogg page", skipped);
+        // Phần đầu của packet nối tiếp đã mất
+        in_packet_ = false;
+    }
+
+    page_flags_ = header[5];
+    page_granule_ = Le64(header + 6);
+    page_serial_ = Le32(header + 14);
+    segment_count_ = header[26];
+    segment_index_ = 0;
+    if (!source.ReadFully(lacing_, segment_count_)) {
+        return false;
+    }
+    last_packet_end_ = -1;
+    for (int i = segment_count_ - 1; i >= 0; i--) {
+        if (lacing_[i] < 255) {
+            last_packet_end_ = i;
+            break;
+        }
+    }
+    return true;
+}
+
+bool SdOggOpusDecoder::NextPacket(SdDecoderSource& source, bool& end_of_stream) {
+    end_of_stream = false;
+    while (true) {
+        if (segment_index_ >= segment_count_) {
+            if (!ReadPage(source)) {
+                return false;
+            }
+            bool ours = serial_locked_ ? page_serial_ == serial_ : (page_flags_ & kPageBeginOfStream) != 0;
+            if (!ours) {
+                // Page của stream logic khác (hoặc của stream trước khi khóa): bỏ cả body
+                int64_t body = 0;
+                for (int i = 0; i < segment_count_; i++) {
+                    body += lacing_[i];
+                }
+                segment_count_ = 0;
+                if (!source.Skip(body)) {
+                    return false;
+                }
+                continue;
+            }
+            if (page_flags_ & kPageContinued) {
+                if (!in_packet_) {
+                    // Page nối tiếp nhưng không có phần đầu packet
+                    in_packet_ = true;
+                    drop_packet_ = true;
+                    packet_.clear();
+                }
+            } else if (in_packet_) {
+                ESP_LOGW(TAG, "Incomplete packet dropped");
+                in_packet_ = false;
+            }
+            if (segment_count_ == 0) {
+                // Page không có segment (vd. page EOS rỗng): không có lacing nào để đọc
+                if (page_flags_ & kPageEndOfStream) {
+                    in_packet_ = false;
+                    drop_packet_ = false;
+                    packet_.clear();
+                    end_of_stream = true;
+                    return true;
+                }
+                continue;
+            }
+        }
+
+        if (!in_packet_) {
+            packet_.clear();
+            drop_packet_ = false;
+            in_packet_ = true;
+        }
+
+        int segment = segment_index_++;
+        uint8_t lace = lacing_[segment];
+        if (!drop_packet_ && packet_.size() + lace <= kMaxPacketBytes) {
+            size_t old_size = packet_.size();
+            packet_.resize(old_size + lace);
+            if (!source.ReadFully(packet_.data() + old_size, lace)) {
+                return false;
+            }
+        } else {
+            drop_packet_ = true;
+            packet_.clear();
+            if (!source.Skip(lace)) {
+                return false;
+            }
+        }
+
+        if (lace < 255) {
+            in_packet_ = false;
+            end_of_stream = segment == last_packet_end_ && (page_flags_ & kPageEndOfStream);
+            if (drop_packet_) {
+                packet_.clear();
+                drop_packet_ = false;
+            }
+            return true;
+        }
+    }
+}
+
+bool SdOggOpusDecoder::ParseHead(const std::vector<uint8_t>& packet) {
+    // "OpusHead" version(1) channels(1) pre_skip(2) input_rate(4) gain(2) mapping_family(1)
+    if (packet.size() < 19 || memcmp(packet.data(), "OpusHead", 8) != 0) {
+        return false;
+    }
+    const uint8_t* p = packet.data();
+    if ((p[8] >> 4) != 0 || p[9] == 0) {
+        ESP_LOGW(TAG, "Unsupported OpusHead version %d, %d ch", p[8], p[9]);
+        return false;
+    }
+    if (p[18] != 0) {
+        ESP_LOGW(TAG, "Multistream Opus (mapping family %d, %d ch) not supported", p[18], p[9]);
+        return false;
+    }
+
+    if (!decoder_) {
+        int error = OPUS_OK;
+        // Decoder mono: libopus tự downmix stream stereo
+        decoder_ = opus_decoder_create(kSampleRate, 1, &error);
+        if (!decoder_ || error != OPUS_OK) {
+            ESP_LOGE(TAG, "Failed to create Opus decoder: %d", error);
+            decoder_ = nullptr;
+            return false;
+        }
+    } else {
+        opus_decoder_ctl(decoder_, OPUS_RESET_STATE);
+    }
+    opus_decoder_ctl(decoder_, OPUS_SET_GAIN((int16_t)Le16(p + 16)));
+
+    channels_ = p[9];
+    sample_rate_ = kSampleRate;
+    pre_skip_ = Le16(p + 10);
+    samples_to_skip_ = pre_skip_;
+    granule_ = 0;
+    serial_ = page_serial_;
+    serial_locked_ = true;
+    stage_ = Stage::Tags;
+    ESP_LOGI(TAG, "Opus stream: %d ch, input %u Hz, pre-skip %d",
+             channels_, (unsigned)Le32(p + 12), pre_skip_);
+    return true;
+}
+
+bool SdOggOpusDecoder::Open(SdDecoderSource& source) {
+    stage_ = Stage::Head;
+    serial_locked_ = false;
+    segment_count_ = 0;
+    segment_index_ = 0;
+    in_packet_ = false;
+
+    // Các stream khác (Vorbis, video...) đi trước được bỏ qua qua vài page đầu
+    for (int i = 0; i < kMaxHeaderPages; i++) {
+        bool end_of_stream = false;
+        if (!NextPacket(source, end_of_stream)) {
+            break;
+        }
+        if (ParseHead(packet_)) {
+            ProbeDuration(source);
+            return true;
+        }
+    }
+    ESP_LOGE(TAG, "No Opus stream in %s (Ogg Vorbis / FLAC are not supported)", source.path().c_str());
+    return false;
+}
+
+bool SdOggOpusDecoder::Decode(SdDecoderSource& source, std::vector<int16_t>& pcm) {
+    if (!decoder_) {
+        failed_ = true;
+        return false;
+    }
+
+    while (true) {
+        bool end_of_stream = false;
+        if (!NextPacket(source, end_of_stream)) {
+            return false;
+        }
+
+        if (stage_ == Stage::Head) {
+            // File nối chuỗi: stream tiếp theo bắt đầu bằng OpusHead mới
+            ParseHead(packet_);
+            continue;
+        }
+        if (stage_ == Stage::Tags) {
+            stage_ = Stage::Audio;  // OpusTags: không dùng
+            continue;
+        }
+
+        int samples = 0;
+        if (!packet_.empty()) {
+            pcm.resize(kMaxFrameSamples);
+            samples = opus_decode(decoder_, packet_.data(), (opus_int32)packet_.size(), pcm.data(), kMaxFrameSamples, 0);
+            if (samples < 0) {
+                ESP_LOGW(TAG, "Opus decode error %d, packet of %u bytes skipped", samples, (unsigned)packet_.size());
+                samples = 0;
+            }
+        }
+        granule_ += samples;
+
+        if (end_of_stream) {
+            // Granule của page cuối cắt phần đệm của packet cuối cùng
+            if (page_granule_ >= 0 && granule_ > page_granule_) {
+                samples -= (int)std::min<int64_t>(samples, granule_ - page_granule_);
+            }
+            serial_locked_ = false;
+            stage_ = Stage::Head;
+        }
+
+        int skip = (int)std::min<int64_t>(samples, samples_to_skip_);
+        samples_to_skip_ -= skip;
+        if (samples - skip <= 0) {
+            continue;
+        }
+        if (skip > 0) {
+            memmove(pcm.data(), pcm.data() + skip, (samples - skip) * sizeof(int16_t));
+        }
+        pcm.resize(samples - skip);
+        return true;
+    }
+}
+
+void SdOggOpusDecoder::ProbeDuration(const SdDecoderSource& source) {
+    // Granule của page cuối cùng thuộc stream = tổng số sample, đọc ngược tối đa 64 KB cuối file
+    int64_t file_size = source.file_size();
+    if (file_size <= 0) {
+        return;
+    }
+    FILE* fp = fopen(source.path().c_str(), "rb");
+    if (!fp) {
+        return;
+    }
+
+    static constexpr size_t kWindow = 8 * 1024;
+    std::vector<uint8_t> window(kWindow);
+    int64_t end = file_size;
+    int64_t limit = std::max<int64_t>(0, file_size - kDurationProbeBytes);
+    int64_t granule = -1;
+    while (end > limit && granule < 0) {
+        int64_t begin = std::max(limit, end - (int64_t)kWindow);
+        size_t length = (size_t)(end - begin);
+        if (fseek(fp, (long)begin, SEEK_SET) != 0 || fread(window.data(), 1, length, fp) != length) {
+            break;
+        }
+        for (int64_t i = (int64_t)length - (int64_t)kPageHeaderBytes; i >= 0; i--) {
+            const uint8_t* page = window.data() + i;
+            if (memcmp(page, "OggS", 4) == 0 && page[4] == 0 && Le32(page + 14) == serial_ && Le64(page + 6) >= 0) {
+                granule = Le64(page + 6);
+                break;
+            }
+        }
+        if (begin == limit) {
+            break;
+        }
+        // Các cửa sổ chồng nhau một header để không bỏ sót page nằm vắt qua ranh giới
+        end = begin + kPageHeaderBytes - 1;
+    }
+    fclose(fp);
+
+    if (granule > pre_skip_) {
+        duration_ms_ = (granule - pre_skip_) * 1000 / kSampleRate;
+    }
+}
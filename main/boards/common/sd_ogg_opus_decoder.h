@@ -0,0 +1,73 @@
+#ifndef SD_OGG_OPUS_DECODER_H
+#define SD_OGG_OPUS_DECODER_H
+
+#include "sd_decoder.h"
+
+struct OpusDecoder;
+
+/*
+ * Opus in an Ogg container (.opus, and .ogg files that carry Opus rather than Vorbis).
+ *
+ * Pages are not buffered: the segment table of the current page is kept and packets are
+ * read segment by segment straight into a packet buffer of at most kMaxPacketBytes.
+ * Bigger packets (OpusTags with embedded cover art) are skipped without being stored.
+ * Only the logical stream of the first OpusHead is played; chained files switch to the
+ * next OpusHead after an end-of-stream page.
+ *
+ * libopus decodes at 48 kHz straight to mono, the pre-skip is dropped and the last page's
+ * granule position trims the end, so gapless albums stay gapless.
+ */
+class SdOggOpusDecoder : public SdDecoder {
+public:
+    SdOggOpusDecoder() = default;
+    ~SdOggOpusDecoder() override;
+
+    bool Open(SdDecoderSource& source) override;
+    bool Decode(SdDecoderSource& source, std::vector<int16_t>& pcm) override;
+    const char* name() const override { return "Opus"; }
+
+private:
+    static constexpr int kSampleRate = 48000;
+    static constexpr int kMaxFrameSamples = kSampleRate * 120 / 1000;  // Packet dài nhất 120 ms
+    static constexpr size_t kMaxPacketBytes = 16 * 1024;
+    static constexpr int kMaxHeaderPages = 16;
+    static constexpr size_t kPageHeaderBytes = 27;
+    static constexpr int64_t kDurationProbeBytes = 64 * 1024;
+
+    enum class Stage : uint8_t {
+        Head,
+        Tags,
+        Audio,
+    };
+
+    OpusDecoder* decoder_ = nullptr;
+    Stage stage_ = Stage::Head;
+    int pre_skip_ = 0;
+    int64_t samples_to_skip_ = 0;
+    int64_t granule_ = 0;               // Số sample 48 kHz đã giải mã, tính cả pre-skip
+
+    // Page hiện tại
+    uint32_t page_serial_ = 0;
+    uint8_t page_flags_ = 0;
+    int64_t page_granule_ = -1;
+    uint8_t lacing_[255] = {};
+    int segment_count_ = 0;
+    int segment_index_ = 0;
+    int last_packet_end_ = -1;          // Segment kết thúc packet cuối cùng của page
+    // Stream logic đang phát
+    uint32_t serial_ = 0;
+    bool serial_locked_ = false;
+
+    std::vector<uint8_t> packet_;
+    bool drop_packet_ = false;          // Packet quá lớn hoặc mất phần đầu (sau resync)
+    bool in_packet_ = false;            // Packet đang dở, nối tiếp ở page sau
+
+    bool ReadPage(SdDecoderSource& source);
+    // Next packet of the locked stream (or of any BOS page while unlocked) in packet_,
+    // empty if it was dropped. end_of_stream is set for the last packet of an EOS page
+    bool NextPacket(SdDecoderSource& source, bool& end_of_stream);
+    bool ParseHead(const std::vector<uint8_t>& packet);
+    void ProbeDuration(const SdDecoderSource& source);
+};
+
+#endif // SD_OGG_OPUS_DECODER_H
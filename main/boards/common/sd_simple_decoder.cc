@@ -0,0 +1,151 @@
+#include "sd_simple_decoder.h"
+#include "audio/wav_format.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_log.h>
+#include "esp_audio_dec.h"
+
+#define TAG "SdSimpleDecoder"
+
+SdSimpleDecoder::SdSimpleDecoder(esp_audio_simple_dec_type_t type, const char* name)
+    : type_(type), name_(name) {
+}
+
+SdSimpleDecoder::~SdSimpleDecoder() {
+    if (decoder_) {
+        esp_audio_simple_dec_close(decoder_);
+        decoder_ = nullptr;
+    }
+    if (registered_) {
+        esp_audio_simple_dec_unregister_default();
+        esp_audio_dec_unregister_default();
+    }
+}
+
+bool SdSimpleDecoder::Open(SdDecoderSource& source) {
+    esp_audio_dec_register_default();
+    esp_audio_simple_dec_register_default();
+    registered_ = true;
+
+    esp_audio_simple_dec_cfg_t cfg = {};
+    cfg.dec_type = type_;
+    cfg.dec_cfg  = nullptr;
+    cfg.cfg_size = 0;
+    esp_audio_err_t ret = esp_audio_simple_dec_open(&cfg, &decoder_);
+    if (ret != ESP_AUDIO_ERR_OK || !decoder_) {
+        ESP_LOGE(TAG, "Failed to open %s decoder, err=%d", name_, (int)ret);
+        decoder_ = nullptr;
+        return false;
+    }
+
+    input_.resize(kInputBytes);
+    output_.resize(4096 * sizeof(int16_t) * 2);
+    input_position_ = 0;
+    input_length_ = 0;
+    input_eos_ = false;
+    flushed_ = false;
+    info_ready_ = false;
+    return true;
+}
+
+bool SdSimpleDecoder::Fill(SdDecoderSource& source, uint8_t* data, size_t length, size_t& written) {
+    written = source.Read(data, length);
+    return written > 0;
+}
+
+bool SdSimpleDecoder::Refill(SdDecoderSource& source) {
+    if (input_position_ > 0) {
+        memmove(input_.data(), input_.data() + input_position_, input_length_ - input_position_);
+        input_length_ -= input_position_;
+        input_position_ = 0;
+    }
+    if (input_length_ == input_.size()) {
+        return false;
+    }
+    size_t n = 0;
+    if (!Fill(source, input_.data() + input_length_, input_.size() - input_length_, n)) {
+        input_eos_ = true;
+    }
+    input_length_ += n;
+    return n > 0;
+}
+
+bool SdSimpleDecoder::Decode(SdDecoderSource& source, std::vector<int16_t>& pcm) {
+    if (!decoder_) {
+        failed_ = true;
+        return false;
+    }
+
+    while (true) {
+        if (!input_eos_ && input_length_ - input_position_ < input_.size() / 2) {
+            Refill(source);
+        }
+        size_t available = input_length_ - input_position_;
+        if (available == 0 && input_eos_) {
+            if (flushed_) {
+                return false;
+            }
+            flushed_ = true;  // Một lần gọi cuối với eos để lấy phần còn trong decoder
+        }
+
+        esp_audio_simple_dec_raw_t raw = {};
+        raw.buffer = input_.data() + input_position_;
+        raw.len    = available;
+        raw.eos    = input_eos_;
+
+        esp_audio_simple_dec_out_t out = {};
+        out.buffer = output_.data();
+        out.len    = output_.size();
+
+        esp_audio_err_t ret = esp_audio_simple_dec_process(decoder_, &raw, &out);
+        if (ret == ESP_AUDIO_ERR_BUFF_NOT_ENOUGH) {
+            output_.resize(out.needed_size);
+            flushed_ = false;
+            continue;
+        }
+        if (ret != ESP_AUDIO_ERR_OK) {
+            ESP_LOGE(TAG, "%s decode error: %d", name_, (int)ret);
+            failed_ = true;
+            return false;
+        }
+        input_position_ += std::min<size_t>(raw.consumed, available);
+
+        if (out.decoded_size > 0) {
+            esp_audio_simple_dec_info_t info = {};
+            esp_audio_simple_dec_get_info(decoder_, &info);
+            if (!info_ready_) {
+                info_ready_ = true;
+                ESP_LOGI(TAG, "%s stream: %d Hz, %d bit, %d ch",
+                         name_, (int)info.sample_rate, (int)info.bits_per_sample, (int)info.channel);
+            }
+            sample_rate_ = info.sample_rate;
+            channels_ = info.channel > 0 ? info.channel : 2;
+
+            WavFormat format;
+            format.channels = channels_;
+            format.bits_per_sample = info.bits_per_sample > 0 ? info.bits_per_sample : 16;
+            format.block_align = format.channels * format.bits_per_sample / 8;
+            size_t frames = out.decoded_size / format.block_align;
+            pcm.resize(frames);
+            format.ToMono(output_.data(), frames, pcm.data());
+            if (frames > 0) {
+                return true;
+            }
+            continue;
+        }
+
+        if (raw.consumed == 0 && input_eos_) {
+            return false;
+        }
+        if (raw.consumed == 0) {
+            // Chưa đủ một frame: đọc thêm, buffer đầy mà vẫn không giải mã được là file hỏng
+            if (!Refill(source) && !input_eos_) {
+                ESP_LOGE(TAG, "%s: no frame in %u bytes", name_, (unsigned)input_.size());
+                failed_ = true;
+                return false;
+            }
+        }
+    }
+}
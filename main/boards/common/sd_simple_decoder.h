@@ -0,0 +1,48 @@
+#ifndef SD_SIMPLE_DECODER_H
+#define SD_SIMPLE_DECODER_H
+
+#include "sd_decoder.h"
+
+#include "esp_audio_simple_dec_default.h"
+
+/*
+ * Elementary stream decoded by esp_audio_simple_dec: ADTS AAC and native FLAC.
+ *
+ * The input buffer holds at most kInputBytes of the file. Unconsumed bytes are moved to
+ * its start before the next Fill(), a frame split between two reads is never lost.
+ * Subclasses that demux a container override Fill() to feed the elementary stream.
+ */
+class SdSimpleDecoder : public SdDecoder {
+public:
+    SdSimpleDecoder(esp_audio_simple_dec_type_t type, const char* name);
+    ~SdSimpleDecoder() override;
+
+    bool Open(SdDecoderSource& source) override;
+    bool Decode(SdDecoderSource& source, std::vector<int16_t>& pcm) override;
+    const char* name() const override { return name_; }
+
+protected:
+    static constexpr size_t kInputBytes = 16 * 1024;
+
+    // Appends up to length bytes of the elementary stream to data. written may be 0 when
+    // the next frame doesn't fit yet; false once the stream has ended
+    virtual bool Fill(SdDecoderSource& source, uint8_t* data, size_t length, size_t& written);
+
+private:
+    esp_audio_simple_dec_type_t type_;
+    const char* name_;
+    esp_audio_simple_dec_handle_t decoder_ = nullptr;
+    bool registered_ = false;
+    bool info_ready_ = false;
+
+    std::vector<uint8_t> input_;
+    size_t input_position_ = 0;
+    size_t input_length_ = 0;
+    bool input_eos_ = false;
+    bool flushed_ = false;          // Đã gọi decoder với eos và không còn input
+    std::vector<uint8_t> output_;
+
+    bool Refill(SdDecoderSource& source);
+};
+
+#endif // SD_SIMPLE_DECODER_H
@@ -66,6 +66,16 @@ public:
         int64_t duration_ms = 0;
     };
 
+    // Thống kê đọc thẻ SD của luồng phát (cộng dồn từ lúc khởi động)
+    struct ReadStats {
+        uint64_t bytes_read    = 0;
+        uint32_t reads         = 0;
+        uint32_t read_kbps     = 0;   // Tốc độ đọc thực của thẻ, KB/s
+        uint32_t worst_read_ms = 0;
+        uint32_t stalls        = 0;   // Số lần decoder phải chờ dữ liệu
+        uint32_t stall_ms      = 0;
+    };
+
     // ============================================================
     // Playlist / browsing
     // ============================================================
@@ -106,12 +116,15 @@ public:
 
     virtual bool next() = 0;
     virtual bool prev() = 0;
+    virtual bool seek(int64_t position_ms) = 0;
 
     // ============================================================
     // Playback settings
     // ============================================================
     virtual void shuffle(bool enabled) = 0;
     virtual void repeat(RepeatMode mode) = 0;
+    virtual void setCrossfadeMs(int ms) = 0;
+    virtual int getCrossfadeMs() const = 0;
 
     // ============================================================
     // State / FFT query
@@ -125,6 +138,7 @@ public:
     virtual int getBitrate() const = 0;
     virtual std::string getDurationString() const = 0;
     virtual std::string getCurrentTimeString() const = 0;
+    virtual ReadStats getReadStats() const = 0;
 
     // ============================================================
     // Suggestions
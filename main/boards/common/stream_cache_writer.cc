@@ -0,0 +1,182 @@
+#include "stream_cache_writer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_pthread.h>
+#include <esp_timer.h>
+
+#define TAG "StreamCacheWriter"
+
+StreamCacheWriter::~StreamCacheWriter() {
+    if (thread_.joinable() || file_ != nullptr) {
+        failed_ = true;
+        Close();
+        Discard();
+    }
+    FreeBatches();
+}
+
+bool StreamCacheWriter::Open(const std::string& final_path) {
+    path_ = final_path;
+    temp_path_ = final_path + ".part";
+
+    for (auto& batch : batches_) {
+        batch.data = (uint8_t*)heap_caps_malloc(kBatchSize, MALLOC_CAP_SPIRAM);
+        batch.length = 0;
+        if (batch.data == nullptr) {
+            ESP_LOGE(TAG, "No PSRAM for cache batches");
+            FreeBatches();
+            return false;
+        }
+    }
+
+    // Leftover of a stream interrupted by a reset
+    remove(temp_path_.c_str());
+    file_ = fopen(temp_path_.c_str(), "wb");
+    if (file_ == nullptr) {
+        ESP_LOGE(TAG, "Cannot create temp file: %s", temp_path_.c_str());
+        FreeBatches();
+        return false;
+    }
+    // Batches are already large, skip the stdio copy
+    setvbuf(file_, nullptr, _IONBF, 0);
+
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size = 4096;
+    cfg.prio = 2;  // Below the audio stream threads
+    cfg.thread_name = "mp3_cache";
+    esp_pthread_set_cfg(&cfg);
+    thread_ = std::thread(&StreamCacheWriter::WriterThread, this);
+
+    ESP_LOGI(TAG, "Caching stream to %s", temp_path_.c_str());
+    return true;
+}
+
+void StreamCacheWriter::Append(const uint8_t* data, size_t length, bool wait) {
+    while (length > 0 && !failed_) {
+        Batch& batch = batches_[fill_index_];
+        size_t n = std::min(length, kBatchSize - batch.length);
+        memcpy(batch.data + batch.length, data, n);
+        batch.length += n;
+        bytes_appended_ += n;
+        data += n;
+        length -= n;
+
+        if (batch.length < kBatchSize) {
+            break;
+        }
+
+        // Batch full, queue it and move on to the next free one
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wait) {
+            cv_.wait(lock, [this] { return full_count_ < kBatchCount - 1 || failed_; });
+        }
+        if (full_count_ >= kBatchCount - 1) {
+            ESP_LOGW(TAG, "SD card too slow, giving up cache of %s", path_.c_str());
+            failed_ = true;
+            cv_.notify_all();
+            break;
+        }
+        full_count_++;
+        fill_index_ = (fill_index_ + 1) % kBatchCount;
+        batches_[fill_index_].length = 0;
+        cv_.notify_all();
+    }
+}
+
+void StreamCacheWriter::WriterThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return full_count_ > 0 || closing_ || failed_; });
+        if (failed_ || full_count_ == 0) {
+            break;
+        }
+
+        Batch& batch = batches_[(fill_index_ + kBatchCount - full_count_) % kBatchCount];
+        lock.unlock();
+
+        int64_t start = esp_timer_get_time();
+        bool ok = fwrite(batch.data, 1, batch.length, file_) == batch.length;
+        uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+        lock.lock();
+        if (!ok) {
+            ESP_LOGE(TAG, "Write failed: %s", temp_path_.c_str());
+            failed_ = true;
+            cv_.notify_all();
+            break;
+        }
+        bytes_written_ += batch.length;
+        batches_written_++;
+        slowest_write_ms_ = std::max(slowest_write_ms_, elapsed_ms);
+        full_count_--;
+        cv_.notify_all();
+    }
+}
+
+bool StreamCacheWriter::Close() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // The partial batch being filled goes out last
+            if (!failed_ && batches_[fill_index_].length > 0) {
+                full_count_++;
+                fill_index_ = (fill_index_ + 1) % kBatchCount;
+                batches_[fill_index_].length = 0;
+            }
+            closing_ = true;
+            cv_.notify_all();
+        }
+        thread_.join();
+    }
+    if (file_ != nullptr) {
+        if (fclose(file_) != 0) {
+            failed_ = true;
+        }
+        file_ = nullptr;
+    }
+    ESP_LOGI(TAG, "Cache closed: %s", GetStats().c_str());
+    return !failed_;
+}
+
+bool StreamCacheWriter::Commit() {
+    if (failed_ || file_ != nullptr) {
+        return false;
+    }
+    // FAT không cho rename đè file đã tồn tại
+    remove(path_.c_str());
+    if (rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        ESP_LOGE(TAG, "Failed to rename %s", temp_path_.c_str());
+        Discard();
+        return false;
+    }
+    ESP_LOGI(TAG, "MP3 cached: %s (%u bytes)", path_.c_str(), (unsigned)bytes_written_);
+    return true;
+}
+
+void StreamCacheWriter::Discard() {
+    if (!temp_path_.empty()) {
+        remove(temp_path_.c_str());
+    }
+}
+
+std::string StreamCacheWriter::GetStats() const {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "appended=%u written=%u batches=%lu slowest_write=%lums%s",
+             (unsigned)bytes_appended_, (unsigned)bytes_written_, (unsigned long)batches_written_,
+             (unsigned long)slowest_write_ms_, failed_ ? " (failed)" : "");
+    return buf;
+}
+
+void StreamCacheWriter::FreeBatches() {
+    for (auto& batch : batches_) {
+        if (batch.data != nullptr) {
+            heap_caps_free(batch.data);
+            batch.data = nullptr;
+        }
+        batch.length = 0;
+    }
+}
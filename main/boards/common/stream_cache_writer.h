@@ -0,0 +1,82 @@
+#ifndef STREAM_CACHE_WRITER_H
+#define STREAM_CACHE_WRITER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * Write-through SD cache stage for a stream that is already being downloaded.
+ *
+ * The download thread hands every block it reads to Append(), which only copies it into a
+ * 32KB PSRAM batch. Full batches are written to "<path>.part" by a low priority writer
+ * thread, so SD latency never reaches the HTTP reader or the decoder. If the card falls
+ * so far behind that every batch is full, the cache gives up instead of blocking and the
+ * temp file is discarded.
+ *
+ * Once the stream is complete, Close() flushes the last batch and Commit() renames the
+ * temp file to its final name, so a half written file is never seen as a song.
+ */
+class StreamCacheWriter {
+public:
+    StreamCacheWriter() = default;
+    ~StreamCacheWriter();
+    StreamCacheWriter(const StreamCacheWriter&) = delete;
+    StreamCacheWriter& operator=(const StreamCacheWriter&) = delete;
+
+    // Creates the temp file next to final_path and starts the writer thread
+    bool Open(const std::string& final_path);
+
+    // Copies data into the current batch. With wait == false it never blocks and gives up on
+    // overflow; wait == true waits for the writer instead (no decoder behind the caller)
+    void Append(const uint8_t* data, size_t length, bool wait = false);
+
+    // Writes the pending batches and closes the temp file, false if anything was lost
+    bool Close();
+    // Renames the closed temp file to the final path
+    bool Commit();
+    // Removes the temp file
+    void Discard();
+
+    bool failed() const { return failed_.load(); }
+    const std::string& path() const { return path_; }
+    std::string GetStats() const;
+
+private:
+    static constexpr size_t kBatchSize = 32 * 1024;
+    static constexpr size_t kBatchCount = 4;
+
+    struct Batch {
+        uint8_t* data = nullptr;
+        size_t length = 0;
+    };
+
+    std::string path_;
+    std::string temp_path_;
+    FILE* file_ = nullptr;
+    std::thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::array<Batch, kBatchCount> batches_;
+    size_t fill_index_ = 0;      // Batch the producer is filling
+    size_t full_count_ = 0;      // Full batches queued before fill_index_
+    bool closing_ = false;
+    std::atomic<bool> failed_{false};
+
+    size_t bytes_appended_ = 0;
+    size_t bytes_written_ = 0;
+    uint32_t batches_written_ = 0;
+    uint32_t slowest_write_ms_ = 0;
+
+    void WriterThread();
+    void FreeBatches();
+};
+
+#endif // STREAM_CACHE_WRITER_H
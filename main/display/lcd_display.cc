@@ -59,9 +59,48 @@ static std::string ms_to_time_string(int64_t ms) {
 
 //Declare theme color
 #define BAR_COL_NUM  40
-#define LCD_FFT_SIZE 512
+#define BAR_BLOCK_SPACE 2
+#define BAR_BLOCK_HEIGHT 4
+// Log the spectrum frame time every this many frames
+#define SPECTRUM_STATS_FRAMES 400
 static int current_heights[BAR_COL_NUM] = {0};
-static float avg_power_spectrum[LCD_FFT_SIZE/2]={-25.0f};
+
+// What is currently drawn for one bar: stacked blocks from the bottom and the falling peak cap
+struct SpectrumBarState {
+    int blocks = 0;
+    int cap_top = -1;
+};
+static SpectrumBarState drawn_bars[BAR_COL_NUM];
+
+// Whether a canvas row belongs to a bar, the baseline block sits on the bottom row and
+// block j >= 1 has its top row at canvas_height - j * (BAR_BLOCK_HEIGHT + BAR_BLOCK_SPACE)
+static bool bar_row_lit(const SpectrumBarState& bar, int row, int canvas_height) {
+    if (bar.cap_top >= 0 && row <= bar.cap_top && row > bar.cap_top - BAR_BLOCK_HEIGHT) {
+        return true;
+    }
+    if (bar.blocks <= 0) {
+        return false;
+    }
+    if (row >= canvas_height - BAR_BLOCK_HEIGHT) {
+        return true;
+    }
+    int depth = canvas_height - row;
+    int block = depth / (BAR_BLOCK_HEIGHT + BAR_BLOCK_SPACE);
+    return block >= 1 && block < bar.blocks && depth % (BAR_BLOCK_HEIGHT + BAR_BLOCK_SPACE) < BAR_BLOCK_HEIGHT;
+}
+
+static int bar_top_row(const SpectrumBarState& bar, int canvas_height) {
+    int top = canvas_height;
+    if (bar.blocks == 1) {
+        top = canvas_height - BAR_BLOCK_HEIGHT;
+    } else if (bar.blocks > 1) {
+        top = canvas_height - (bar.blocks - 1) * (BAR_BLOCK_HEIGHT + BAR_BLOCK_SPACE) - (BAR_BLOCK_HEIGHT - 1);
+    }
+    if (bar.cap_top >= 0) {
+        top = std::min(top, bar.cap_top - (BAR_BLOCK_HEIGHT - 1));
+    }
+    return std::max(top, 0);
+}
 
 #define COLOR_BLACK   0x0000
 #define COLOR_RED     0xF800
@@ -276,25 +315,7 @@ SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
     if (offset_x != 0 || offset_y != 0) {
         lv_display_set_offset(display_, offset_x, offset_y);
     }
-	
-    fft_real = (float*)heap_caps_malloc(LCD_FFT_SIZE * sizeof(float), MALLOC_CAP_SPIRAM);
-    fft_imag = (float*)heap_caps_malloc(LCD_FFT_SIZE * sizeof(float), MALLOC_CAP_SPIRAM);
-    hanning_window_float = (float*)heap_caps_malloc(LCD_FFT_SIZE * sizeof(float), MALLOC_CAP_SPIRAM);
 
-    for (int i = 0; i < LCD_FFT_SIZE; i++) {
-        hanning_window_float[i] = 0.5 * (1.0 - cos(2.0 * M_PI * i / (LCD_FFT_SIZE - 1)));
-    }
-    
-    if(audio_data_==nullptr){
-        audio_data_=(int16_t*)heap_caps_malloc(sizeof(int16_t)*1152, MALLOC_CAP_SPIRAM);
-        memset(audio_data_,0,sizeof(int16_t)*1152);
-    }
-    if(frame_audio_data==nullptr){
-        frame_audio_data=(int16_t*)heap_caps_malloc(sizeof(int16_t)*1152, MALLOC_CAP_SPIRAM);
-        memset(frame_audio_data,0,sizeof(int16_t)*1152);
-    }
-    
-    ESP_LOGI(TAG,"Initialize fft_input, audio_data_, frame_audio_data, spectrum_data");
     SetupUI();
 }
 
@@ -1449,13 +1470,11 @@ void LcdDisplay::StopFFT() {
     DisplayLockGuard lock(this);
     
     fft_data_ready = false;
-    audio_display_last_update = 0;
     
     memset(current_heights, 0, sizeof(current_heights));
+    spectrum_full_redraw_ = true;
     
-    for (int i = 0; i < LCD_FFT_SIZE/2; i++) {
-        avg_power_spectrum[i] = -25.0f;
-    }
+    spectrum_analyzer_.Reset();
     
     if (canvas_ != nullptr) {
         lv_obj_del(canvas_);
@@ -1873,12 +1892,7 @@ void LcdDisplay::periodicUpdateTask() {
             if (fft_data_ready) {
                 DisplayLockGuard lock(this);
                 drawSpectrumIfReady();
-                lv_area_t refresh_area;
-                refresh_area.x1 = 0;
-                refresh_area.y1 = height_ - 150;
-                refresh_area.x2 = canvas_width_ - 1;
-                refresh_area.y2 = height_ - 1;
-                lv_obj_invalidate_area(canvas_, &refresh_area);
+                invalidateSpectrum();
                 fft_data_ready   = false;
                 lastDisplayTime  = currentTime;
             }
@@ -2062,43 +2076,73 @@ void LcdDisplay::create_canvas(int32_t status_bar_height) {
     lv_obj_set_size(canvas_, canvas_width_, canvas_height_);
     lv_canvas_fill_bg(canvas_, lv_color_make(0, 0, 0), LV_OPA_TRANSP);
     lv_obj_move_foreground(canvas_);
+    spectrum_full_redraw_ = true;
     ESP_LOGI(TAG, "canvas created successfully");  
 }
 
 void LcdDisplay::drawSpectrumIfReady() {
     if (fft_data_ready) {
-        draw_spectrum(avg_power_spectrum, LCD_FFT_SIZE/2);
+        int64_t start_us = esp_timer_get_time();
+        float magnitude[BAR_COL_NUM];
+        spectrum_analyzer_.GetBars(magnitude, BAR_COL_NUM);
+        draw_spectrum(magnitude, BAR_COL_NUM);
         fft_data_ready = false;
+
+        int64_t frame_us = esp_timer_get_time() - start_us;
+        spectrum_frame_us_ += frame_us;
+        spectrum_frame_max_us_ = std::max(spectrum_frame_max_us_, frame_us);
+        if (spectrum_dirty_.x2 >= spectrum_dirty_.x1) {
+            spectrum_dirty_pixels_ += (uint64_t)lv_area_get_width(&spectrum_dirty_) * lv_area_get_height(&spectrum_dirty_);
+        }
+        if (++spectrum_frames_ >= SPECTRUM_STATS_FRAMES) {
+            ESP_LOGI(TAG, "Spectrum frame: avg %d us, max %d us, invalidated %d px/frame",
+                     (int)(spectrum_frame_us_ / spectrum_frames_), (int)spectrum_frame_max_us_,
+                     (int)(spectrum_dirty_pixels_ / spectrum_frames_));
+            spectrum_frames_ = 0;
+            spectrum_frame_us_ = 0;
+            spectrum_frame_max_us_ = 0;
+            spectrum_dirty_pixels_ = 0;
+        }
     }
 }
 
-void LcdDisplay::draw_spectrum(float *power_spectrum,int fft_size){
-    const int bartotal=BAR_COL_NUM;
+void LcdDisplay::invalidateSpectrum() {
+    if (canvas_ == nullptr || spectrum_dirty_.x2 < spectrum_dirty_.x1) {
+        return;
+    }
+    // lv_obj_invalidate_area takes screen coordinates
+    lv_area_t coords;
+    lv_obj_get_coords(canvas_, &coords);
+    lv_area_t area = spectrum_dirty_;
+    lv_area_move(&area, coords.x1, coords.y1);
+    lv_obj_invalidate_area(canvas_, &area);
+    spectrum_dirty_ = {0, 0, -1, -1};
+}
+
+void LcdDisplay::mark_spectrum_dirty(int x1, int y1, int x2, int y2) {
+    if (spectrum_dirty_.x2 < spectrum_dirty_.x1) {
+        spectrum_dirty_ = {x1, y1, x2, y2};
+        return;
+    }
+    spectrum_dirty_.x1 = std::min<int32_t>(spectrum_dirty_.x1, x1);
+    spectrum_dirty_.y1 = std::min<int32_t>(spectrum_dirty_.y1, y1);
+    spectrum_dirty_.x2 = std::max<int32_t>(spectrum_dirty_.x2, x2);
+    spectrum_dirty_.y2 = std::max<int32_t>(spectrum_dirty_.y2, y2);
+}
+
+void LcdDisplay::draw_spectrum(float *magnitude,int bar_count){
+    const int bartotal=bar_count;
     int bar_height;
     const int bar_max_height=canvas_height_ - 50;
     const int bar_width=canvas_width_/bartotal;
     int x_pos=0;
-    int y_pos = (canvas_height_) - 1;
 
-    float magnitude[bartotal]={0};
     float max_magnitude=0;
 
     const float MIN_DB = -25.0f;
     const float MAX_DB = 0.0f;
     
     for (int bin = 0; bin < bartotal; bin++) {
-        int start = bin * (fft_size / bartotal);
-        int end = (bin+1) * (fft_size / bartotal);
-        magnitude[bin] = 0;
-        int count=0;
-        for (int k = start; k < end; k++) {
-            magnitude[bin] += sqrt(power_spectrum[k]);
-            count++;
-        }
-        if(count>0){
-            magnitude[bin] /= count;
-        }
-
         if (magnitude[bin] > max_magnitude) max_magnitude = magnitude[bin];
     }
 
@@ -2117,7 +2161,16 @@ void LcdDisplay::draw_spectrum(float *power_spectrum,int fft_size){
         if (magnitude[bin] > max_magnitude) max_magnitude = magnitude[bin];
     }
 
-    std::fill_n(canvas_buffer_, canvas_width_ * canvas_height_, COLOR_BLACK);
+    // The whole canvas is only cleared when it was (re)created, afterwards each bar
+    // rewrites just the rows that differ from what it drew last time
+    if (spectrum_full_redraw_) {
+        std::fill_n(canvas_buffer_, canvas_width_ * canvas_height_, COLOR_BLACK);
+        for (auto& bar : drawn_bars) {
+            bar = SpectrumBarState();
+        }
+        mark_spectrum_dirty(0, 0, canvas_width_ - 1, canvas_height_ - 1);
+        spectrum_full_redraw_ = false;
+    }
     
     for (int k = 1; k < bartotal; k++) {
         x_pos = canvas_width_/bartotal*(k-1);
@@ -2126,17 +2179,23 @@ void LcdDisplay::draw_spectrum(float *power_spectrum,int fft_size){
         bar_height=int(mag*(bar_max_height));
         
         int color=get_bar_color(k);
-        draw_bar(x_pos,y_pos,bar_width,bar_height, color,k-1);
+        draw_bar(x_pos,bar_width,bar_height, color,k-1);
     }
 }
 
 int16_t* LcdDisplay::MakeAudioBuffFFT(size_t sample_count) {
     // sample_count được hiểu là số BYTES cần thiết
+    // The buffer only marks that audio is flowing, the samples go to the spectrum analyzer,
+    // so keep it as long as it is large enough instead of reallocating it for every frame
+    if (final_pcm_data_fft != nullptr && final_pcm_data_fft_bytes_ >= sample_count) {
+        return final_pcm_data_fft;
+    }
     if (final_pcm_data_fft != nullptr) {
         heap_caps_free(final_pcm_data_fft);
         final_pcm_data_fft = nullptr;
     }
     final_pcm_data_fft = (int16_t *)heap_caps_malloc(sample_count, MALLOC_CAP_SPIRAM);
+    final_pcm_data_fft_bytes_ = final_pcm_data_fft ? sample_count : 0;
     if (!final_pcm_data_fft) {
         ESP_LOGE(TAG, "MakeAudioBuffFFT: malloc %u bytes failed", (unsigned)sample_count);
     }
@@ -2145,7 +2204,8 @@ int16_t* LcdDisplay::MakeAudioBuffFFT(size_t sample_count) {
 
 void LcdDisplay::FeedAudioDataFFT(int16_t* data, size_t sample_count) {
     if (!final_pcm_data_fft || !data) return;
-    memcpy(final_pcm_data_fft, data, sample_count);
+    // sample_count is in bytes, frames of any length are accepted
+    spectrum_analyzer_.Feed(data, sample_count / sizeof(int16_t));
 }
 
 void LcdDisplay::ReleaseAudioBuffFFT(int16_t* buffer) {
@@ -2153,46 +2213,14 @@ void LcdDisplay::ReleaseAudioBuffFFT(int16_t* buffer) {
     if (final_pcm_data_fft != nullptr) {
         heap_caps_free(final_pcm_data_fft);
         final_pcm_data_fft = nullptr;
+        final_pcm_data_fft_bytes_ = 0;
     }
 }
 
 void LcdDisplay::processAudioData() {
     if(final_pcm_data_fft != nullptr) {
-        if(audio_display_last_update <= 2) {
-            memcpy(audio_data_, final_pcm_data_fft, sizeof(int16_t) * 1152);
-            for(int i = 0; i < 1152; i++) {
-                frame_audio_data[i] += audio_data_[i];
-            }
-            audio_display_last_update++;
-        } else {
-            const int HOP_SIZE = LCD_FFT_SIZE;
-            const int NUM_SEGMENTS = 1 + (1152 - LCD_FFT_SIZE) / HOP_SIZE;
-
-            for (int seg = 0; seg < NUM_SEGMENTS; seg++) {
-                int start = seg * HOP_SIZE;
-                if (start + LCD_FFT_SIZE > 1152) break;
-
-                for (int i = 0; i < LCD_FFT_SIZE; i++) {
-                    int idx = start + i;
-                    float sample = frame_audio_data[idx] / 32768.0f;
-                    fft_real[i] = sample * hanning_window_float[i];
-                    fft_imag[i] = 0.0f;
-                }
-
-                compute(fft_real, fft_imag, LCD_FFT_SIZE, true);
-
-                for (int i = 0; i < LCD_FFT_SIZE / 2; i++) {
-                    avg_power_spectrum[i] += fft_real[i] * fft_real[i] + fft_imag[i] * fft_imag[i];
-                }
-            }
-
-            for (int i = 0; i < LCD_FFT_SIZE / 2; i++) {
-                avg_power_spectrum[i] /= NUM_SEGMENTS;
-            }
-
-            audio_display_last_update = 0;
+        if (spectrum_analyzer_.Analyze()) {
             fft_data_ready = true;
-            memset(frame_audio_data, 0, sizeof(int16_t) * 1152);
         }
     } else {
         ESP_LOGI(TAG, "audio_data_ is nullptr");
@@ -2200,14 +2228,14 @@ void LcdDisplay::processAudioData() {
     }
 }
 
-void LcdDisplay::draw_bar(int x,int y,int bar_width,int bar_height,uint16_t color,int bar_index){
+void LcdDisplay::draw_bar(int x,int bar_width,int bar_height,uint16_t color,int bar_index){
 
-    const int block_space=2;
-    const int block_x_size=bar_width-block_space;
-    const int block_y_size=4;
-    
-    int blocks_per_col=(bar_height/(block_y_size+block_space));
-    int start_x=(block_x_size+block_space)/2+x;
+    const int block_x_size=bar_width-BAR_BLOCK_SPACE;
+    int start_x=(block_x_size+BAR_BLOCK_SPACE)/2+x;
+
+    SpectrumBarState next;
+    // The baseline block is always drawn
+    next.blocks=std::max(1, bar_height/(BAR_BLOCK_HEIGHT+BAR_BLOCK_SPACE));
     
     if(current_heights[bar_index]<bar_height) 
     {
@@ -2216,75 +2244,25 @@ void LcdDisplay::draw_bar(int x,int y,int bar_width,int bar_height,uint16_t colo
     else{
         int fall_speed=2;
         current_heights[bar_index]=current_heights[bar_index]-fall_speed;
-        if(current_heights[bar_index]>(block_y_size+block_space)) 
-            draw_block(start_x,canvas_height_-current_heights[bar_index],block_x_size,block_y_size,color,bar_index);
+        if(current_heights[bar_index]>(BAR_BLOCK_HEIGHT+BAR_BLOCK_SPACE)) 
+            next.cap_top=canvas_height_-current_heights[bar_index];
     }
-   
-    draw_block(start_x,canvas_height_-1,block_x_size,block_y_size,color,bar_index);
 
-    for(int j=1;j<blocks_per_col;j++){
-        int start_y=j*(block_y_size+block_space);
-        draw_block(start_x,canvas_height_-start_y,block_x_size,block_y_size,color,bar_index); 
-    }
-}
-
-void LcdDisplay::draw_block(int x,int y,int block_x_size,int block_y_size,uint16_t color,int bar_index){
-    LV_UNUSED(bar_index);
-    for (int row = y; row > y-block_y_size;row--) {
-        uint16_t* line_start = &canvas_buffer_[row * canvas_width_ + x];
-        std::fill_n(line_start, block_x_size, color);
-    }
-}
-
-void LcdDisplay::compute(float* real, float* imag, int n, bool forward) {
-    int j = 0;
-    for (int i = 0; i < n; i++) {
-        if (j > i) {
-            std::swap(real[i], real[j]);
-            std::swap(imag[i], imag[j]);
-        }
-        
-        int m = n >> 1;
-        while (m >= 1 && j >= m) {
-            j -= m;
-            m >>= 1;
-        }
-        j += m;
+    SpectrumBarState& prev=drawn_bars[bar_index];
+    if(prev.blocks==next.blocks && prev.cap_top==next.cap_top){
+        return;
     }
 
-    for (int s = 1; s <= (int)log2(n); s++) {
-        int m = 1 << s;
-        int m2 = m >> 1;
-        float w_real = 1.0f;
-        float w_imag = 0.0f;
-        float angle = (forward ? -2.0f : 2.0f) * M_PI / m;
-        float wm_real = cosf(angle);
-        float wm_imag = sinf(angle);
-        
-        for (int j = 0; j < m2; j++) {
-            for (int k = j; k < n; k += m) {
-                int k2 = k + m2;
-                float t_real = w_real * real[k2] - w_imag * imag[k2];
-                float t_imag = w_real * imag[k2] + w_imag * real[k2];
-                
-                real[k2] = real[k] - t_real;
-                imag[k2] = imag[k] - t_imag;
-                real[k] += t_real;
-                imag[k] += t_imag;
-            }
-            
-            float w_temp = w_real;
-            w_real = w_real * wm_real - w_imag * wm_imag;
-            w_imag = w_temp * wm_imag + w_imag * wm_real;
-        }
-    }
-    
-    if (forward) {
-        for (int i = 0; i < n; i++) {
-            real[i] /= n;
-            imag[i] /= n;
+    int top=std::min(bar_top_row(prev,canvas_height_),bar_top_row(next,canvas_height_));
+    for(int row=top;row<canvas_height_;row++){
+        bool lit=bar_row_lit(next,row,canvas_height_);
+        if(lit==bar_row_lit(prev,row,canvas_height_)){
+            continue;
         }
+        std::fill_n(&canvas_buffer_[row*canvas_width_+start_x],block_x_size,lit?color:COLOR_BLACK);
+        mark_spectrum_dirty(start_x,row,start_x+block_x_size-1,row);
     }
+    prev=next;
 }
 
 uint16_t LcdDisplay::get_bar_color(int x_pos) {
@@ -3,6 +3,7 @@
 
 #include "lvgl_display.h"
 #include "gif/lvgl_gif.h"
+#include "spectrum_analyzer.h"
 
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
@@ -14,6 +15,7 @@
 #include <cstdint>
 
 #define PREVIEW_IMAGE_DURATION_MS 5000
+#define LCD_FFT_SIZE 512
 
 // Theme color structure
 struct ThemeColors {
@@ -66,24 +68,27 @@ protected:
     static void periodicUpdateTaskWrapper(void* arg);
 
     int16_t* final_pcm_data_fft = nullptr;
-    int16_t* audio_data_ = nullptr;
-    int16_t* frame_audio_data = nullptr;
-    uint32_t last_fft_update = 0;
+    size_t final_pcm_data_fft_bytes_ = 0;
     bool fft_data_ready = false;
-    float* spectrum_data = nullptr;
-    int audio_display_last_update = 0;
     std::atomic<bool> fft_task_should_stop = false;
     TaskHandle_t fft_task_handle = nullptr;
-    float* fft_real = nullptr;
-    float* fft_imag = nullptr;
-    float* hanning_window_float = nullptr;
+    SpectrumAnalyzer spectrum_analyzer_{LCD_FFT_SIZE};
+
+    // Incremental spectrum rendering: only rows that changed since the last frame are written,
+    // and their bounding box (canvas coordinates) is what gets invalidated
+    bool spectrum_full_redraw_ = true;
+    lv_area_t spectrum_dirty_ = {0, 0, -1, -1};
+    uint32_t spectrum_frames_ = 0;
+    int64_t spectrum_frame_us_ = 0;
+    int64_t spectrum_frame_max_us_ = 0;
+    uint64_t spectrum_dirty_pixels_ = 0;
 
-    void compute(float* real, float* imag, int n, bool forward);
     void drawSpectrumIfReady();
+    void invalidateSpectrum();
     uint16_t get_bar_color(int x_pos);
-    void draw_spectrum(float* power_spectrum, int fft_size);
-    void draw_bar(int x, int y, int bar_width, int bar_height, uint16_t color, int bar_index);
-    void draw_block(int x, int y, int block_x_size, int block_y_size, uint16_t color, int bar_index);
+    void draw_spectrum(float* magnitude, int bar_count);
+    void draw_bar(int x, int bar_width, int bar_height, uint16_t color, int bar_index);
+    void mark_spectrum_dirty(int x1, int y1, int x2, int y2);
 
     // LVGL variables for FFT canvas or QR code
     int canvas_width_ = 0;
@@ -0,0 +1,311 @@
+#include "gif_frame_cache.h"
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#define TAG "GifFrameCache"
+
+static inline uint16_t to_rgb565(uint32_t argb) {
+    // gifdec canvas: byte 0 = B, 1 = G, 2 = R, 3 = A
+    return (uint16_t)(((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F));
+}
+
+GifFrameCache::Key GifFrameCache::MakeKey(const lv_img_dsc_t* img_dsc) {
+    Key key;
+    key.data = img_dsc->data;
+    key.size = img_dsc->data_size;
+    // "GIF89a" + logical screen width / height, little endian
+    if (img_dsc->data != nullptr && img_dsc->data_size >= 10) {
+        const uint8_t* p = img_dsc->data;
+        key.width = (uint16_t)(p[6] | (p[7] << 8));
+        key.height = (uint16_t)(p[8] | (p[9] << 8));
+    }
+    return key;
+}
+
+GifFrameCache::Entry::~Entry() {
+    for (auto& frame : frames) {
+        heap_caps_free(frame.pixels);
+    }
+    heap_caps_free(wrap.pixels);
+}
+
+void GifFrameCache::Entry::Apply(const Frame& frame, uint8_t* canvas) const {
+    if (frame.pixels == nullptr) {
+        return;
+    }
+    const uint8_t* src = frame.pixels;
+    uint8_t* dst = canvas + ((size_t)frame.y * width + frame.x) * 2;
+    for (int row = 0; row < frame.h; row++) {
+        memcpy(dst, src, (size_t)frame.w * 2);
+        src += (size_t)frame.w * 2;
+        dst += (size_t)width * 2;
+    }
+    if (!has_alpha) {
+        return;
+    }
+    // RGB565A8: alpha plane sau color plane, stride = width
+    dst = canvas + (size_t)width * height * 2 + (size_t)frame.y * width + frame.x;
+    for (int row = 0; row < frame.h; row++) {
+        memcpy(dst, src, frame.w);
+        src += frame.w;
+        dst += width;
+    }
+}
+
+void GifFrameCache::Entry::Load(const uint8_t* argb8888, uint8_t* canvas) const {
+    size_t count = (size_t)width * height;
+    auto src = (const uint32_t*)argb8888;
+    auto color = (uint16_t*)canvas;
+    for (size_t i = 0; i < count; i++) {
+        color[i] = to_rgb565(src[i]);
+    }
+    if (has_alpha) {
+        uint8_t* alpha = canvas + count * 2;
+        for (size_t i = 0; i < count; i++) {
+            alpha[i] = src[i] >> 24;
+        }
+    }
+}
+
+GifFrameCache::Recorder::Recorder(const Key& key, uint16_t width, uint16_t height, int32_t loop_count,
+                                  size_t max_bytes) : max_bytes_(max_bytes) {
+    entry_ = std::make_shared<Entry>();
+    entry_->key = key;
+    entry_->width = width;
+    entry_->height = height;
+    entry_->loop_count = loop_count;
+    previous_ = (uint32_t*)heap_caps_malloc((size_t)width * height * 4, MALLOC_CAP_SPIRAM);
+    failed_ = previous_ == nullptr;
+}
+
+GifFrameCache::Recorder::~Recorder() {
+    heap_caps_free(previous_);
+}
+
+bool GifFrameCache::Recorder::Capture(const uint8_t* canvas, uint32_t delay_ms, bool full, Frame& frame) {
+    const int width = entry_->width;
+    const int height = entry_->height;
+    auto current = (const uint32_t*)canvas;
+    frame.delay_ms = delay_ms;
+
+    // Bounding box của các pixel khác frame trước
+    int x0 = 0, y0 = 0, x1 = width - 1, y1 = height - 1;
+    if (!full) {
+        x0 = width;
+        y0 = height;
+        x1 = -1;
+        y1 = -1;
+        for (int y = 0; y < height; y++) {
+            const uint32_t* a = current + (size_t)y * width;
+            const uint32_t* b = previous_ + (size_t)y * width;
+            int left = 0;
+            while (left < width && a[left] == b[left]) {
+                left++;
+            }
+            if (left == width) {
+                continue;
+            }
+            int right = width - 1;
+            while (a[right] == b[right]) {
+                right--;
+            }
+            x0 = std::min(x0, left);
+            x1 = std::max(x1, right);
+            y0 = std::min(y0, y);
+            y1 = y;
+        }
+        if (x1 < 0) {
+            // Frame giống hệt frame trước, chỉ giữ delay
+            return true;
+        }
+    }
+
+    int w = x1 - x0 + 1;
+    int h = y1 - y0 + 1;
+    size_t count = (size_t)w * h;
+    // Luôn giữ alpha khi đang ghi, Finish() bỏ đi nếu cả vòng không có pixel trong suốt
+    auto pixels = (uint8_t*)heap_caps_malloc(count * 3, MALLOC_CAP_SPIRAM);
+    if (pixels == nullptr) {
+        return false;
+    }
+    entry_->bytes += count * 3;
+    if (entry_->bytes > max_bytes_) {
+        heap_caps_free(pixels);
+        return false;
+    }
+
+    auto color = (uint16_t*)pixels;
+    uint8_t* alpha = pixels + count * 2;
+    for (int y = 0; y < h; y++) {
+        const uint32_t* src = current + (size_t)(y0 + y) * width + x0;
+        for (int x = 0; x < w; x++) {
+            uint32_t argb = src[x];
+            color[x] = to_rgb565(argb);
+            alpha[x] = argb >> 24;
+            has_alpha_ |= alpha[x] != 0xFF;
+        }
+        color += w;
+        alpha += w;
+    }
+
+    frame.x = x0;
+    frame.y = y0;
+    frame.w = w;
+    frame.h = h;
+    frame.pixels = pixels;
+    memcpy(previous_, canvas, (size_t)width * height * 4);
+    return true;
+}
+
+void GifFrameCache::Recorder::AddFrame(const uint8_t* canvas, uint32_t delay_ms) {
+    if (failed_) {
+        return;
+    }
+    Frame frame;
+    if (!Capture(canvas, delay_ms, entry_->frames.empty(), frame)) {
+        ESP_LOGW(TAG, "GIF %p too large to cache (%u frames)", entry_->key.data, (unsigned)entry_->frames.size());
+        failed_ = true;
+        return;
+    }
+    entry_->frames.push_back(frame);
+}
+
+std::shared_ptr<GifFrameCache::Entry> GifFrameCache::Recorder::Finish(const uint8_t* canvas, uint32_t delay_ms) {
+    if (failed_ || entry_->frames.empty()) {
+        return nullptr;
+    }
+    if (!Capture(canvas, delay_ms, false, entry_->wrap)) {
+        failed_ = true;
+        return nullptr;
+    }
+    return Finish();
+}
+
+std::shared_ptr<GifFrameCache::Entry> GifFrameCache::Recorder::Finish() {
+    if (failed_ || entry_->frames.empty()) {
+        return nullptr;
+    }
+    heap_caps_free(previous_);
+    previous_ = nullptr;
+
+    entry_->has_alpha = has_alpha_;
+    if (!has_alpha_) {
+        // Color plane nằm trước alpha plane, chỉ cần cắt bớt
+        entry_->bytes = 0;
+        auto shrink = [this](Frame& frame) {
+            if (frame.pixels == nullptr) {
+                return;
+            }
+            size_t bytes = (size_t)frame.w * frame.h * 2;
+            auto pixels = (uint8_t*)heap_caps_realloc(frame.pixels, bytes, MALLOC_CAP_SPIRAM);
+            if (pixels != nullptr) {
+                frame.pixels = pixels;
+            }
+            entry_->bytes += bytes;
+        };
+        for (auto& frame : entry_->frames) {
+            shrink(frame);
+        }
+        shrink(entry_->wrap);
+    }
+
+    auto entry = entry_;
+    entry_.reset();
+    failed_ = true;     // Recorder đã dùng xong
+    return entry;
+}
+
+GifFrameCache::GifFrameCache() {
+    budget_ = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0 ? GIF_FRAME_CACHE_BUDGET : 0;
+}
+
+void GifFrameCache::SetBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+    EvictLocked(0);
+    ESP_LOGI(TAG, "Budget %u KB", (unsigned)(budget_ / 1024));
+}
+
+void GifFrameCache::EvictLocked(size_t needed) {
+    while (!entries_.empty() && used_ + needed > budget_) {
+        used_ -= entries_.back()->bytes;
+        entries_.pop_back();
+        evictions_++;
+    }
+}
+
+std::shared_ptr<const GifFrameCache::Entry> GifFrameCache::Find(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if ((*it)->key == key) {
+            entries_.splice(entries_.begin(), entries_, it);
+            hits_++;
+            return entries_.front();
+        }
+    }
+    misses_++;
+    return nullptr;
+}
+
+std::unique_ptr<GifFrameCache::Recorder> GifFrameCache::StartRecording(const Key& key, uint16_t width,
+                                                                        uint16_t height, int32_t loop_count) {
+    size_t max_bytes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Một GIF chiếm tối đa nửa budget để vẫn giữ được vài emoji cùng lúc
+        max_bytes = budget_ / 2;
+    }
+    if (width == 0 || height == 0 || (size_t)width * height * 3 > max_bytes) {
+        return nullptr;
+    }
+    auto recorder = std::make_unique<Recorder>(key, width, height, loop_count, max_bytes);
+    if (recorder->Failed()) {
+        return nullptr;
+    }
+    return recorder;
+}
+
+void GifFrameCache::Insert(std::shared_ptr<Entry> entry) {
+    if (entry == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entry->bytes > budget_) {
+        return;
+    }
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if ((*it)->key == entry->key) {
+            used_ -= (*it)->bytes;
+            entries_.erase(it);
+            break;
+        }
+    }
+    EvictLocked(entry->bytes);
+    entries_.push_front(entry);
+    used_ += entry->bytes;
+    ESP_LOGI(TAG, "Cached GIF %p %ux%u, %u frames, %s, %u KB", entry->key.data, entry->width, entry->height,
+             (unsigned)entry->frames.size(), entry->has_alpha ? "RGB565A8" : "RGB565", (unsigned)(entry->bytes / 1024));
+}
+
+void GifFrameCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.empty()) {
+        return;
+    }
+    evictions_ += entries_.size();
+    entries_.clear();
+    used_ = 0;
+    ESP_LOGI(TAG, "Cleared");
+}
+
+std::string GifFrameCache::ToString() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    char buf[128];
+    snprintf(buf, sizeof(buf), "gifs=%u used=%uKB/%uKB hits=%lu misses=%lu evictions=%lu",
+             (unsigned)entries_.size(), (unsigned)(used_ / 1024), (unsigned)(budget_ / 1024),
+             (unsigned long)hits_, (unsigned long)misses_, (unsigned long)evictions_);
+    return buf;
+}
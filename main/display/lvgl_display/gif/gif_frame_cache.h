@@ -0,0 +1,128 @@
+#pragma once
+
+#include <lvgl.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef GIF_FRAME_CACHE_BUDGET
+// Default PSRAM budget for decoded GIF frames, SetBudget() overrides it
+#define GIF_FRAME_CACHE_BUDGET (1024 * 1024)
+#endif
+
+/**
+ * Decoded frames of short animated GIFs (emoji), so that every loop after the first one
+ * replays with a memcpy of the changed region instead of LZW decoding and palette lookup.
+ *
+ * A GIF is recorded while it plays its first loop: after each rendered frame the ARGB8888
+ * canvas is compared with the previous one and only the dirty rectangle is kept, converted
+ * to RGB565 plus an A8 alpha plane. If no pixel of the loop is transparent the alpha planes
+ * are dropped and the entry is plain RGB565. Entries are keyed by the GIF data pointer
+ * (assets are memory mapped, the pointer is stable) together with the data size and the
+ * logical screen size from the GIF header, and evicted least recently used once the memory
+ * budget is exceeded. A new assets partition can map a different GIF at the same address,
+ * Assets::Apply() calls Clear() so no entry outlives the data it was recorded from.
+ *
+ * Only used from the LVGL task, the mutex just keeps the class safe to query elsewhere.
+ */
+class GifFrameCache {
+public:
+    struct Key {
+        const void* data = nullptr;
+        size_t size = 0;
+        uint16_t width = 0;                    // Logical screen size in the GIF header
+        uint16_t height = 0;
+
+        bool operator==(const Key& other) const {
+            return data == other.data && size == other.size && width == other.width && height == other.height;
+        }
+    };
+    static Key MakeKey(const lv_img_dsc_t* img_dsc);
+
+    struct Frame {
+        uint16_t x = 0, y = 0, w = 0, h = 0;   // Dirty rectangle, empty if nothing changed
+        uint32_t delay_ms = 0;
+        uint8_t* pixels = nullptr;             // w*h RGB565, followed by w*h A8 if has_alpha
+    };
+
+    struct Entry {
+        Key key;
+        uint16_t width = 0;
+        uint16_t height = 0;
+        bool has_alpha = false;
+        int32_t loop_count = -1;               // As in gd_GIF: -1 play once, 0 forever
+        std::vector<Frame> frames;             // frames[0] is the full canvas after the first frame
+        Frame wrap;                            // Last frame -> first frame of the next loop
+        size_t bytes = 0;
+
+        ~Entry();
+        lv_color_format_t color_format() const { return has_alpha ? LV_COLOR_FORMAT_RGB565A8 : LV_COLOR_FORMAT_RGB565; }
+        size_t canvas_size() const { return (size_t)width * height * (has_alpha ? 3 : 2); }
+        // Copies a frame's rectangle into a canvas of color_format()
+        void Apply(const Frame& frame, uint8_t* canvas) const;
+        // Converts a whole ARGB8888 gifdec canvas into a canvas of color_format()
+        void Load(const uint8_t* argb8888, uint8_t* canvas) const;
+    };
+
+    /**
+     * Builds an entry from the canvases of the first loop. Aborts (Failed()) if the frames
+     * would not fit in max_bytes.
+     */
+    class Recorder {
+    public:
+        Recorder(const Key& key, uint16_t width, uint16_t height, int32_t loop_count, size_t max_bytes);
+        ~Recorder();
+
+        // canvas: ARGB8888 after gd_render_frame, delay_ms: how long it stays on screen
+        void AddFrame(const uint8_t* canvas, uint32_t delay_ms);
+        // The first frame of the next loop, ends recording
+        std::shared_ptr<Entry> Finish(const uint8_t* canvas, uint32_t delay_ms);
+        // The GIF does not loop, the last frame is final
+        std::shared_ptr<Entry> Finish();
+        bool Failed() const { return failed_; }
+
+    private:
+        std::shared_ptr<Entry> entry_;
+        uint32_t* previous_ = nullptr;         // Previous ARGB8888 canvas
+        size_t max_bytes_;
+        bool has_alpha_ = false;
+        bool failed_ = false;
+
+        bool Capture(const uint8_t* canvas, uint32_t delay_ms, bool full, Frame& frame);
+    };
+
+    static GifFrameCache& GetInstance() {
+        static GifFrameCache instance;
+        return instance;
+    }
+
+    // 0 disables caching. Shrinking evicts immediately
+    void SetBudget(size_t bytes);
+    size_t budget() const { return budget_; }
+
+    std::shared_ptr<const Entry> Find(const Key& key);
+    // Starts a recorder if a GIF of this size can be cached at all, nullptr otherwise
+    std::unique_ptr<Recorder> StartRecording(const Key& key, uint16_t width, uint16_t height, int32_t loop_count);
+    void Insert(std::shared_ptr<Entry> entry);
+    // Drops every entry, GIFs still playing keep theirs until they are destroyed
+    void Clear();
+
+    std::string ToString();
+
+private:
+    GifFrameCache();
+
+    std::mutex mutex_;
+    std::list<std::shared_ptr<Entry>> entries_;   // Front = most recently used
+    size_t budget_ = 0;
+    size_t used_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    uint32_t evictions_ = 0;
+
+    void EvictLocked(size_t needed);
+};
@@ -1,5 +1,6 @@
 #include "lvgl_gif.h"
 #include <esp_log.h>
+#include <esp_heap_caps.h>
 #include <cstring>
 
 #define TAG "LvglGif"
@@ -11,6 +12,16 @@ LvglGif::LvglGif(const lv_img_dsc_t* img_dsc)
         return;
     }
 
+    memset(&img_dsc_, 0, sizeof(img_dsc_));
+    auto& cache = GifFrameCache::GetInstance();
+    auto key = GifFrameCache::MakeKey(img_dsc);
+    auto entry = cache.Find(key);
+    if (entry && UseCachedFrames(entry, nullptr)) {
+        loaded_ = true;
+        ESP_LOGD(TAG, "GIF loaded from frame cache: %dx%d", entry->width, entry->height);
+        return;
+    }
+
     gif_ = gd_open_gif_data(img_dsc->data);
     if (!gif_) {
         ESP_LOGE(TAG, "Failed to open GIF from image descriptor");
@@ -18,7 +29,6 @@ LvglGif::LvglGif(const lv_img_dsc_t* img_dsc)
     }
 
     // Setup LVGL image descriptor
-    memset(&img_dsc_, 0, sizeof(img_dsc_));
     img_dsc_.header.magic = LV_IMAGE_HEADER_MAGIC;
     img_dsc_.header.flags = LV_IMAGE_FLAGS_MODIFIABLE;
     img_dsc_.header.cf = LV_COLOR_FORMAT_ARGB8888;
@@ -33,6 +43,8 @@ LvglGif::LvglGif(const lv_img_dsc_t* img_dsc)
         gd_render_frame(gif_, gif_->canvas);
     }
 
+    recorder_ = cache.StartRecording(key, gif_->width, gif_->height, gif_->loop_count);
+
     loaded_ = true;
     ESP_LOGD(TAG, "GIF loaded from image descriptor: %dx%d", gif_->width, gif_->height);
 }
@@ -52,7 +64,7 @@ const lv_img_dsc_t* LvglGif::image_dsc() const {
 
 // Animation control methods
 void LvglGif::Start() {
-    if (!loaded_ || !gif_) {
+    if (!loaded_) {
         ESP_LOGW(TAG, "GIF not loaded, cannot start");
         return;
     }
@@ -86,7 +98,7 @@ void LvglGif::Pause() {
 }
 
 void LvglGif::Resume() {
-    if (!loaded_ || !gif_) {
+    if (!loaded_) {
         ESP_LOGW(TAG, "GIF not loaded, cannot resume");
         return;
     }
@@ -104,7 +116,19 @@ void LvglGif::Stop() {
         lv_timer_pause(timer_);
     }
 
-    if (gif_) {
+    if (cached_) {
+        // Như gd_rewind: về frame đầu và chỉ phát một lần
+        cached_->Apply(cached_->frames[0], canvas_);
+        frame_index_ = 0;
+        frame_delay_ms_ = cached_->frames[0].delay_ms;
+        loop_count_ = -1;
+        if (frame_callback_) {
+            frame_callback_();
+        }
+        ESP_LOGD(TAG, "GIF animation stopped and rewound");
+    } else if (gif_) {
+        // Vòng đang ghi dở không còn liền mạch
+        recorder_.reset();
         gd_rewind(gif_);
         NextFrame();
         ESP_LOGD(TAG, "GIF animation stopped and rewound");
@@ -120,32 +144,36 @@ bool LvglGif::IsLoaded() const {
 }
 
 int32_t LvglGif::GetLoopCount() const {
-    if (!loaded_ || !gif_) {
+    if (!loaded_) {
         return -1;
     }
-    return gif_->loop_count;
+    return gif_ ? gif_->loop_count : loop_count_;
 }
 
 void LvglGif::SetLoopCount(int32_t count) {
-    if (!loaded_ || !gif_) {
+    if (!loaded_) {
         ESP_LOGW(TAG, "GIF not loaded, cannot set loop count");
         return;
     }
-    gif_->loop_count = count;
+    if (gif_) {
+        gif_->loop_count = count;
+    } else {
+        loop_count_ = count;
+    }
 }
 
 uint16_t LvglGif::width() const {
-    if (!loaded_ || !gif_) {
+    if (!loaded_) {
         return 0;
     }
-    return gif_->width;
+    return img_dsc_.header.w;
 }
 
 uint16_t LvglGif::height() const {
-    if (!loaded_ || !gif_) {
+    if (!loaded_) {
         return 0;
     }
-    return gif_->height;
+    return img_dsc_.header.h;
 }
 
 void LvglGif::SetFrameCallback(std::function<void()> callback) {
@@ -153,7 +181,14 @@ void LvglGif::SetFrameCallback(std::function<void()> callback) {
 }
 
 void LvglGif::NextFrame() {
-    if (!loaded_ || !gif_ || !playing_) {
+    if (!loaded_ || !playing_) {
+        return;
+    }
+    if (cached_) {
+        NextCachedFrame();
+        return;
+    }
+    if (!gif_) {
         return;
     }
 
@@ -165,8 +200,10 @@ void LvglGif::NextFrame() {
 
     last_call_ = lv_tick_get();
 
-    // Get next frame
+    // Get next frame, đọc lùi về anim_start nghĩa là GIF vừa quay vòng
+    uint32_t position = gif_->f_rw_p;
     int has_next = gd_get_frame(gif_);
+    bool wrapped = has_next > 0 && gif_->f_rw_p < position;
     if (has_next == 0) {
         // Animation finished, pause timer
         playing_ = false;
@@ -179,6 +216,26 @@ void LvglGif::NextFrame() {
     // Render current frame
     if (gif_->canvas) {
         gd_render_frame(gif_, gif_->canvas);
+
+        if (recorder_) {
+            if (has_next < 0) {
+                recorder_.reset();
+            } else if (has_next == 0) {
+                GifFrameCache::GetInstance().Insert(recorder_->Finish());
+                recorder_.reset();
+            } else if (wrapped) {
+                auto entry = recorder_->Finish(gif_->canvas, gif_->gce.delay * 10);
+                recorder_.reset();
+                if (entry) {
+                    GifFrameCache::GetInstance().Insert(entry);
+                    // Từ vòng thứ hai phát từ cache, giữ số vòng còn lại của gifdec
+                    loop_count_ = gif_->loop_count;
+                    UseCachedFrames(entry, gif_->canvas);
+                }
+            } else {
+                recorder_->AddFrame(gif_->canvas, gif_->gce.delay * 10);
+            }
+        }
         
         // Call frame callback if set
         if (frame_callback_) {
@@ -187,6 +244,78 @@ void LvglGif::NextFrame() {
     }
 }
 
+bool LvglGif::UseCachedFrames(std::shared_ptr<const GifFrameCache::Entry> entry, const uint8_t* argb8888) {
+    auto canvas = (uint8_t*)heap_caps_malloc(entry->canvas_size(), MALLOC_CAP_SPIRAM);
+    if (canvas == nullptr) {
+        ESP_LOGW(TAG, "No memory for cached GIF canvas");
+        return false;
+    }
+    if (argb8888) {
+        // Đang phát: giữ nguyên hình hiện tại, frame kế tiếp là frames[1]
+        entry->Load(argb8888, canvas);
+        frame_delay_ms_ = entry->wrap.delay_ms;
+    } else {
+        entry->Apply(entry->frames[0], canvas);
+        frame_delay_ms_ = entry->frames[0].delay_ms;
+        loop_count_ = entry->loop_count;
+    }
+    frame_index_ = 0;
+
+    heap_caps_free(canvas_);
+    canvas_ = canvas;
+    cached_ = entry;
+    if (gif_) {
+        gd_close_gif(gif_);
+        gif_ = nullptr;
+    }
+
+    img_dsc_.header.magic = LV_IMAGE_HEADER_MAGIC;
+    img_dsc_.header.flags = LV_IMAGE_FLAGS_MODIFIABLE;
+    img_dsc_.header.cf = entry->color_format();
+    img_dsc_.header.w = entry->width;
+    img_dsc_.header.h = entry->height;
+    img_dsc_.header.stride = entry->width * 2;
+    img_dsc_.data = canvas_;
+    img_dsc_.data_size = entry->canvas_size();
+    return true;
+}
+
+void LvglGif::NextCachedFrame() {
+    uint32_t elapsed = lv_tick_elaps(last_call_);
+    if (elapsed < frame_delay_ms_) {
+        return;
+    }
+    last_call_ = lv_tick_get();
+
+    const GifFrameCache::Frame* frame;
+    size_t next = frame_index_ + 1;
+    if (next < cached_->frames.size()) {
+        frame = &cached_->frames[next];
+    } else {
+        // Hết một vòng, cùng quy ước loop_count với gd_get_frame
+        if (loop_count_ == 1 || loop_count_ < 0) {
+            playing_ = false;
+            if (timer_) {
+                lv_timer_pause(timer_);
+            }
+            ESP_LOGD(TAG, "GIF animation completed");
+            return;
+        }
+        if (loop_count_ > 1) {
+            loop_count_--;
+        }
+        next = 0;
+        frame = &cached_->wrap;
+    }
+
+    cached_->Apply(*frame, canvas_);
+    frame_index_ = next;
+    frame_delay_ms_ = frame->delay_ms;
+    if (frame_callback_) {
+        frame_callback_();
+    }
+}
+
 void LvglGif::Cleanup() {
     // Stop and delete timer
     if (timer_) {
@@ -200,6 +329,11 @@ void LvglGif::Cleanup() {
         gif_ = nullptr;
     }
 
+    recorder_.reset();
+    cached_.reset();
+    heap_caps_free(canvas_);
+    canvas_ = nullptr;
+
     playing_ = false;
     loaded_ = false;
     
@@ -2,6 +2,7 @@
 
 #include "../lvgl_image.h"
 #include "gifdec.h"
+#include "gif_frame_cache.h"
 #include <lvgl.h>
 #include <memory>
 #include <functional>
@@ -9,6 +10,10 @@
 /**
  * C++ implementation of LVGL GIF widget
  * Provides GIF animation functionality using gifdec library
+ *
+ * The first loop is decoded by gifdec and recorded into GifFrameCache; once the GIF wraps
+ * (or when another instance already recorded it) playback switches to the cached frames
+ * and the image becomes RGB565 / RGB565A8 instead of ARGB8888.
  */
 class LvglGif {
 public:
@@ -88,6 +93,24 @@ private:
     
     // Frame update callback
     std::function<void()> frame_callback_;
+
+    // Decoded frame cache: recorder_ while decoding the first loop, cached_ once replaying
+    std::unique_ptr<GifFrameCache::Recorder> recorder_;
+    std::shared_ptr<const GifFrameCache::Entry> cached_;
+    uint8_t* canvas_ = nullptr;        // Canvas of cached_->color_format()
+    size_t frame_index_ = 0;
+    uint32_t frame_delay_ms_ = 0;
+    int32_t loop_count_ = -1;          // Replaces gif_->loop_count once gif_ is closed
+    
+    /**
+     * Switch to replaying cached frames, closes the decoder
+     */
+    bool UseCachedFrames(std::shared_ptr<const GifFrameCache::Entry> entry, const uint8_t* argb8888);
+
+    /**
+     * Update to next cached frame
+     */
+    void NextCachedFrame();
     
     /**
      * Update to next frame
@@ -0,0 +1,103 @@
+#include "glyph_cache.h"
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <cstdio>
+#include <cstring>
+
+#define TAG "GlyphCache"
+
+GlyphCache::GlyphCache() : budget_(GLYPH_CACHE_BUDGET) {
+}
+
+void GlyphCache::SetBudget(size_t bytes) {
+    budget_ = bytes;
+    Evict(0);
+    ESP_LOGI(TAG, "Budget %u KB", (unsigned)(budget_ / 1024));
+}
+
+bool GlyphCache::Lookup(const lv_font_t* font, uint32_t glyph_id, lv_draw_buf_t* draw_buf) {
+    auto it = index_.find(Key{font, glyph_id});
+    if (it == index_.end()) {
+        misses_++;
+        return false;
+    }
+    auto& entry = *it->second;
+    if (entry.width != draw_buf->header.w || entry.height != draw_buf->header.h) {
+        Erase(it->second);
+        misses_++;
+        return false;
+    }
+
+    const uint8_t* src = entry.bitmap;
+    uint8_t* dst = draw_buf->data;
+    for (int y = 0; y < entry.height; y++) {
+        memcpy(dst, src, entry.width);
+        src += entry.width;
+        dst += draw_buf->header.stride;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    hits_++;
+    return true;
+}
+
+void GlyphCache::Insert(const lv_font_t* font, uint32_t glyph_id, const lv_draw_buf_t* draw_buf) {
+    uint16_t width = draw_buf->header.w;
+    uint16_t height = draw_buf->header.h;
+    size_t bytes = (size_t)width * height;
+    // Glyph lớn (font emoji, font số cỡ to) sẽ đẩy hết glyph chữ ra khỏi cache
+    if (bytes == 0 || bytes > budget_ / 8 || draw_buf->header.cf != LV_COLOR_FORMAT_A8) {
+        return;
+    }
+    Key key{font, glyph_id};
+    if (index_.count(key) > 0) {
+        return;
+    }
+
+    Evict(bytes);
+    auto bitmap = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (bitmap == nullptr) {
+        return;
+    }
+    const uint8_t* src = draw_buf->data;
+    uint8_t* dst = bitmap;
+    for (int y = 0; y < height; y++) {
+        memcpy(dst, src, width);
+        src += draw_buf->header.stride;
+        dst += width;
+    }
+    entries_.push_front(Entry{key, width, height, bitmap});
+    index_[key] = entries_.begin();
+    used_ += bytes;
+}
+
+void GlyphCache::Remove(const lv_font_t* font) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        auto next = std::next(it);
+        if (it->key.font == font) {
+            Erase(it);
+        }
+        it = next;
+    }
+}
+
+void GlyphCache::Evict(size_t needed) {
+    while (!entries_.empty() && used_ + needed > budget_) {
+        Erase(std::prev(entries_.end()));
+        evictions_++;
+    }
+}
+
+void GlyphCache::Erase(std::list<Entry>::iterator it) {
+    used_ -= (size_t)it->width * it->height;
+    heap_caps_free(it->bitmap);
+    index_.erase(it->key);
+    entries_.erase(it);
+}
+
+std::string GlyphCache::ToString() const {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "glyphs=%u used=%uKB/%uKB hits=%lu misses=%lu evictions=%lu",
+             (unsigned)entries_.size(), (unsigned)(used_ / 1024), (unsigned)(budget_ / 1024),
+             (unsigned long)hits_, (unsigned long)misses_, (unsigned long)evictions_);
+    return buf;
+}
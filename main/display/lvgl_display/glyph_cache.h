@@ -0,0 +1,79 @@
+#pragma once
+
+#include <lvgl.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#ifndef GLYPH_CACHE_BUDGET
+// Internal RAM for rendered glyph bitmaps, SetBudget() overrides it
+#define GLYPH_CACHE_BUDGET (16 * 1024)
+#endif
+
+/**
+ * LRU of glyph bitmaps rendered by fonts that live in flash (cbin fonts in the assets
+ * partition), kept in internal RAM as A8 with no row padding.
+ *
+ * A miss costs a read of the glyph through the flash cache plus the bpp expansion or
+ * decompression done by the font; a hit is a memcpy into LVGL's glyph draw buffer.
+ * Entries are keyed by font and glyph id: a glyph id maps to one codepoint in a font, and
+ * the font pointer stands for its size.
+ *
+ * Only used from the LVGL task (under the display lock), so there is no locking.
+ */
+class GlyphCache {
+public:
+    static GlyphCache& GetInstance() {
+        static GlyphCache instance;
+        return instance;
+    }
+
+    // 0 disables caching. Shrinking evicts immediately
+    void SetBudget(size_t bytes);
+    size_t budget() const { return budget_; }
+    size_t used() const { return used_; }
+
+    // Copies a cached glyph into draw_buf (already shaped for the glyph), false on a miss
+    bool Lookup(const lv_font_t* font, uint32_t glyph_id, lv_draw_buf_t* draw_buf);
+    // Stores the A8 bitmap the font just rendered into draw_buf
+    void Insert(const lv_font_t* font, uint32_t glyph_id, const lv_draw_buf_t* draw_buf);
+    // Drops all glyphs of a font that is being deleted
+    void Remove(const lv_font_t* font);
+
+    uint32_t hits() const { return hits_; }
+    uint32_t misses() const { return misses_; }
+    std::string ToString() const;
+
+private:
+    GlyphCache();
+
+    struct Key {
+        const lv_font_t* font;
+        uint32_t glyph_id;
+        bool operator==(const Key& other) const { return font == other.font && glyph_id == other.glyph_id; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<const void*>()(key.font) ^ (key.glyph_id * 2654435761u);
+        }
+    };
+    struct Entry {
+        Key key;
+        uint16_t width;
+        uint16_t height;
+        uint8_t* bitmap;
+    };
+
+    std::list<Entry> entries_;      // Front = most recently used
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    size_t budget_ = 0;
+    size_t used_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    uint32_t evictions_ = 0;
+
+    void Evict(size_t needed);
+    void Erase(std::list<Entry>::iterator it);
+};
@@ -35,11 +35,23 @@ static __always_inline uint8_t expand_6_to_8(uint8_t v) {
     return (uint8_t)((v << 2) | (v >> 4));
 }
 
+static inline bool is_encoder_aligned(const uint8_t* p) {
+    return ((uintptr_t)p & 15) == 0;
+}
+
+// 返回值可能就是 src（GRAY/YUYV 且已 16 字节对齐，如 V4L2 mmap 缓冲区），此时调用者不能释放
 static uint8_t* convert_input_to_encoder_buf(const uint8_t* src, uint16_t width, uint16_t height, v4l2_pix_fmt_t format,
                                              jpeg_pixel_format_t* out_fmt, int* out_size) {
     // GRAY 直接作为 JPEG_PIXEL_FORMAT_GRAY 输入
     if (format == V4L2_PIX_FMT_GREY) {
         int sz = (int)width * (int)height;
+        if (is_encoder_aligned(src)) {
+            if (out_fmt)
+                *out_fmt = JPEG_PIXEL_FORMAT_GRAY;
+            if (out_size)
+                *out_size = sz;
+            return const_cast<uint8_t*>(src);
+        }
         uint8_t* buf = (uint8_t*)jpeg_calloc_align(sz, 16);
         if (!buf)
             return NULL;
@@ -54,6 +66,13 @@ static uint8_t* convert_input_to_encoder_buf(const uint8_t* src, uint16_t width,
     // V4L2 YUYV (Y Cb Y Cr) 可直接作为 JPEG_PIXEL_FORMAT_YCbYCr 输入
     if (format == V4L2_PIX_FMT_YUYV) {
         int sz = (int)width * (int)height * 2;
+        if (is_encoder_aligned(src)) {
+            if (out_fmt)
+                *out_fmt = JPEG_PIXEL_FORMAT_YCbYCr;
+            if (out_size)
+                *out_size = sz;
+            return const_cast<uint8_t*>(src);
+        }
         uint8_t* buf = (uint8_t*)jpeg_calloc_align(sz, 16);
         if (!buf)
             return NULL;
@@ -375,7 +394,8 @@ static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_
     jpeg_enc_handle_t h = NULL;
     jpeg_error_t ret = jpeg_enc_open(&cfg, &h);
     if (ret != JPEG_ERR_OK) {
-        jpeg_free_align(enc_in);
+        if (enc_in != src)
+            jpeg_free_align(enc_in);
         ESP_LOGE(TAG, "jpeg_enc_open failed: %d", (int)ret);
         return false;
     }
@@ -387,7 +407,8 @@ static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_
     uint8_t* outbuf = (uint8_t*)malloc_psram(out_cap);
     if (!outbuf) {
         jpeg_enc_close(h);
-        jpeg_free_align(enc_in);
+        if (enc_in != src)
+            jpeg_free_align(enc_in);
         ESP_LOGE(TAG, "alloc out buffer failed");
         return false;
     }
@@ -395,7 +416,8 @@ static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_
     int out_len = 0;
     ret = jpeg_enc_process(h, enc_in, enc_in_size, outbuf, (int)out_cap, &out_len);
     jpeg_enc_close(h);
-    jpeg_free_align(enc_in);
+    if (enc_in != src)
+        jpeg_free_align(enc_in);
 
     if (ret != JPEG_ERR_OK) {
         free(outbuf);
@@ -1,13 +1,72 @@
 #include "lvgl_font.h"
+#include "glyph_cache.h"
+#include <esp_log.h>
 #include <cbin_font.h>
 
+#define TAG "LvglFont"
+
 
 LvglCBinFont::LvglCBinFont(void* data) {
     font_ = cbin_font_create(static_cast<uint8_t*>(data));
+    if (font_ != nullptr) {
+        // LVGL trả lại resolved_font = &cached_font_.font, nên callback tìm được hàm gốc
+        cached_font_.font = *font_;
+        cached_font_.font.get_glyph_bitmap = GetGlyphBitmap;
+        cached_font_.get_glyph_bitmap = font_->get_glyph_bitmap;
+    }
 }
 
 LvglCBinFont::~LvglCBinFont() {
     if (font_ != nullptr) {
+        GlyphCache::GetInstance().Remove(&cached_font_.font);
         cbin_font_delete(font_);
     }
-}
\ No newline at end of file
+}
+
+const void* LvglCBinFont::GetGlyphBitmap(lv_font_glyph_dsc_t* g_dsc, lv_draw_buf_t* draw_buf) {
+    auto font = g_dsc->resolved_font;
+    auto cached_font = reinterpret_cast<const CachedFont*>(font);
+    bool cacheable = draw_buf != nullptr && !g_dsc->req_raw_bitmap &&
+                     g_dsc->format >= LV_FONT_GLYPH_FORMAT_A1 && g_dsc->format <= LV_FONT_GLYPH_FORMAT_A8;
+    if (!cacheable) {
+        return cached_font->get_glyph_bitmap(g_dsc, draw_buf);
+    }
+
+    auto& cache = GlyphCache::GetInstance();
+    if (cache.Lookup(font, g_dsc->gid.index, draw_buf)) {
+        return draw_buf;
+    }
+    auto bitmap = cached_font->get_glyph_bitmap(g_dsc, draw_buf);
+    if (bitmap == draw_buf) {
+        cache.Insert(font, g_dsc->gid.index, draw_buf);
+    }
+    return bitmap;
+}
+
+void LvglCBinFont::Warmup(const uint32_t* codepoints, size_t count) {
+    if (font_ == nullptr) {
+        return;
+    }
+    auto& cache = GlyphCache::GetInstance();
+    size_t warmed = 0;
+    for (size_t i = 0; i < count; i++) {
+        lv_font_glyph_dsc_t g_dsc = {};
+        if (!lv_font_get_glyph_dsc(&cached_font_.font, &g_dsc, codepoints[i], 0) ||
+            g_dsc.resolved_font != &cached_font_.font || g_dsc.box_w == 0 || g_dsc.box_h == 0) {
+            continue;
+        }
+        // Dừng khi đầy, nếu không glyph quan trọng nhất sẽ bị đẩy ra trước
+        if (cache.used() + (size_t)g_dsc.box_w * g_dsc.box_h > cache.budget()) {
+            break;
+        }
+        lv_draw_buf_t* draw_buf = lv_draw_buf_create(g_dsc.box_w, g_dsc.box_h, LV_COLOR_FORMAT_A8, LV_STRIDE_AUTO);
+        if (draw_buf == nullptr) {
+            break;
+        }
+        if (lv_font_get_glyph_bitmap(&g_dsc, draw_buf) != nullptr) {
+            warmed++;
+        }
+        lv_draw_buf_destroy(draw_buf);
+    }
+    ESP_LOGI(TAG, "Glyph cache warmed with %u glyphs: %s", (unsigned)warmed, cache.ToString().c_str());
+}
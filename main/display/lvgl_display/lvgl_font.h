@@ -20,12 +20,26 @@ private:
 };
 
 
+// Font in the mmapped assets partition. Glyph bitmaps go through GlyphCache
 class LvglCBinFont : public LvglFont {
 public:
     LvglCBinFont(void* data);
     virtual ~LvglCBinFont();
-    virtual const lv_font_t* font() const override { return font_; }
+    virtual const lv_font_t* font() const override { return font_ != nullptr ? &cached_font_.font : nullptr; }
+
+    // Renders the given codepoints into the glyph cache, most important first, until the
+    // cache is full. Call with the display locked
+    void Warmup(const uint32_t* codepoints, size_t count);
 
 private:
+    // Copy of font_ with a caching get_glyph_bitmap; LVGL hands it back as resolved_font
+    struct CachedFont {
+        lv_font_t font;
+        const void* (*get_glyph_bitmap)(lv_font_glyph_dsc_t*, lv_draw_buf_t*);
+    };
+
     lv_font_t* font_;
+    CachedFont cached_font_;
+
+    static const void* GetGlyphBitmap(lv_font_glyph_dsc_t* g_dsc, lv_draw_buf_t* draw_buf);
 };
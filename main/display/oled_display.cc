@@ -82,11 +82,6 @@ OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handl
     height_ = height;
     
     final_pcm_data_fft = nullptr;
-    audio_data_ = nullptr;
-    frame_audio_data = nullptr;
-    fft_real = nullptr;
-    fft_imag = nullptr;
-    hanning_window_float = nullptr;
     spectrum_container_ = nullptr;
     qr_canvas_ = nullptr;
     qr_canvas_buffer_ = nullptr;
@@ -145,30 +140,6 @@ OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handl
         return;
     }
 
-    fft_real = (float*)heap_caps_malloc(OLED_FFT_SIZE * sizeof(float), MALLOC_CAP_SPIRAM);
-    fft_imag = (float*)heap_caps_malloc(OLED_FFT_SIZE * sizeof(float), MALLOC_CAP_SPIRAM);
-    hanning_window_float = (float*)heap_caps_malloc(OLED_FFT_SIZE * sizeof(float), MALLOC_CAP_SPIRAM);
-
-    for (int i = 0; i < OLED_FFT_SIZE; i++) {
-        hanning_window_float[i] = 0.5 * (1.0 - cos(2.0 * M_PI * i / (OLED_FFT_SIZE - 1)));
-    }
-    
-    audio_data_=(int16_t*)heap_caps_malloc(sizeof(int16_t)*1152, MALLOC_CAP_SPIRAM);
-    if(audio_data_!=nullptr){
-        ESP_LOGI(TAG, "audio_data_ allocated");
-        memset(audio_data_,0,sizeof(int16_t)*1152);
-    } else {
-        ESP_LOGE(TAG, "Failed to allocate audio_data_");
-    }
-    frame_audio_data=(int16_t*)heap_caps_malloc(sizeof(int16_t)*1152, MALLOC_CAP_SPIRAM);
-    if(frame_audio_data!=nullptr){
-        ESP_LOGI(TAG, "frame_audio_data allocated");
-        memset(frame_audio_data,0,sizeof(int16_t)*1152);
-    } else {
-        ESP_LOGE(TAG, "Failed to allocate frame_audio_data");
-    }
-    ESP_LOGI(TAG,"Initialize fft_input, audio_data_, frame_audio_data, spectrum_data");
-    
 
     if (height_ == 64) {
         SetupUI_128x64();
@@ -436,8 +407,8 @@ void OledDisplay::draw_bar(int x, int y, int bar_width, int bar_height, int bar_
     }
 }
 
-void OledDisplay::draw_spectrum(float* power_spectrum, int fft_size) {
-    const int bartotal = BAR_COL_NUM;
+void OledDisplay::draw_spectrum(float* magnitude, int bar_count) {
+    const int bartotal = bar_count;
     int bar_height;
     const int bar_max_height = BAR_MAX_HEIGHT;
     const int canvas_w = LV_HOR_RES;
@@ -446,25 +417,12 @@ void OledDisplay::draw_spectrum(float* power_spectrum, int fft_size) {
     int x_pos = 0;
     int y_pos = canvas_h - 1;
     
-    float magnitude[bartotal] = {0};
     float max_magnitude = 0;
     
     const float MIN_DB = -25.0f;
     const float MAX_DB = 0.0f;
     
-    // Compute magnitude per bar (same as LCD)
     for (int bin = 0; bin < bartotal; bin++) {
-        int start = bin * (fft_size / bartotal);
-        int end = (bin + 1) * (fft_size / bartotal);
-        magnitude[bin] = 0;
-        int count = 0;
-        for (int k = start; k < end; k++) {
-            magnitude[bin] += sqrtf(power_spectrum[k]);
-            count++;
-        }
-        if (count > 0) {
-            magnitude[bin] /= count;
-        }
         if (magnitude[bin] > max_magnitude) max_magnitude = magnitude[bin];
     }
     
@@ -511,7 +469,9 @@ void OledDisplay::DrawOledSpectrum() {
     }
 
     // Use LCD-style block-based spectrum rendering with fall effect
-    draw_spectrum(avg_power_spectrum, OLED_FFT_SIZE / 2);
+    float magnitude[BAR_COL_NUM];
+    spectrum_analyzer_.GetBars(magnitude, BAR_COL_NUM);
+    draw_spectrum(magnitude, BAR_COL_NUM);
 }
 
 int16_t* OledDisplay::MakeAudioBuffFFT(size_t sample_count) {
@@ -522,8 +482,9 @@ int16_t* OledDisplay::MakeAudioBuffFFT(size_t sample_count) {
 }
 
 void OledDisplay::FeedAudioDataFFT(int16_t* data, size_t sample_count) {
-    if (final_pcm_data_fft != nullptr) {
-        memcpy(final_pcm_data_fft, data, sample_count);
+    // sample_count is in bytes, frames of any length are accepted
+    if (final_pcm_data_fft != nullptr && data != nullptr) {
+        spectrum_analyzer_.Feed(data, sample_count / sizeof(int16_t));
     }
 }
 
@@ -565,7 +526,7 @@ void OledDisplay::StopFFT() {
     }
     // Reset FFT state variables
     fft_data_ready = false;
-    audio_display_last_update = 0;
+    spectrum_analyzer_.Reset();
     
     // Ẩn spectrum đi khi dừng
     DisplayLockGuard lock(this);
@@ -590,80 +551,8 @@ void OledDisplay::processAudioData() {
         return;
     }
 
-    if (audio_display_last_update <= 2) {
-        if (audio_data_ == nullptr) {
-            ESP_LOGI(TAG, "audio_data_ buffer is nullptr");
-            vTaskDelay(pdMS_TO_TICKS(500));
-            return;
-        }
-        memcpy(audio_data_, final_pcm_data_fft, sizeof(int16_t) * 1152);
-        for (int i = 0; i < 1152; i++) frame_audio_data[i] += audio_data_[i];
-        audio_display_last_update++;
-    } else {
-        // Thực hiện FFT
-        const int HOP_SIZE = OLED_FFT_SIZE; // Tinh chỉnh theo OLED_FFT_SIZE
-        int num_segments = (1152 - OLED_FFT_SIZE) / HOP_SIZE;
-        if (num_segments < 1) num_segments = 1;
-
-        // Reset mảng spectrum
-        memset(avg_power_spectrum, 0, sizeof(avg_power_spectrum));
-
-        for (int seg = 0; seg < num_segments; seg++) {
-            int start = seg * HOP_SIZE;
-            for (int i = 0; i < OLED_FFT_SIZE; i++) {
-                float sample = frame_audio_data[start + i] / 32768.0f;
-                fft_real[i] = sample * hanning_window_float[i];
-                fft_imag[i] = 0.0f;
-            }
-            compute(fft_real, fft_imag, OLED_FFT_SIZE, true);
-            
-            for (int i = 0; i < OLED_FFT_SIZE / 2; i++) {
-                avg_power_spectrum[i] += (fft_real[i] * fft_real[i] + fft_imag[i] * fft_imag[i]);
-            }
-        }
-        
-        audio_display_last_update = 0;
+    if (spectrum_analyzer_.Analyze()) {
         fft_data_ready = true;
-        memset(frame_audio_data, 0, sizeof(int16_t) * 1152);
-    }
-}
-
-void OledDisplay::compute(float* real, float* imag, int n, bool forward) {
-    // Hàm FFT tiêu chuẩn (Cooley-Tukey) - Copy y nguyên
-    int j = 0;
-    for (int i = 0; i < n; i++) {
-        if (j > i) {
-            std::swap(real[i], real[j]);
-            std::swap(imag[i], imag[j]);
-        }
-        int m = n >> 1;
-        while (m >= 1 && j >= m) { j -= m; m >>= 1; }
-        j += m;
-    }
-    for (int s = 1; s <= (int)log2(n); s++) {
-        int m = 1 << s;
-        int m2 = m >> 1;
-        float w_real = 1.0f, w_imag = 0.0f;
-        float angle = (forward ? -2.0f : 2.0f) * M_PI / m;
-        float wm_real = cosf(angle);
-        float wm_imag = sinf(angle);
-        for (int j2 = 0; j2 < m2; j2++) {
-            for (int k = j2; k < n; k += m) {
-                int k2 = k + m2;
-                float t_real = w_real * real[k2] - w_imag * imag[k2];
-                float t_imag = w_real * imag[k2] + w_imag * real[k2];
-                real[k2] = real[k] - t_real;
-                imag[k2] = imag[k] - t_imag;
-                real[k] += t_real;
-                imag[k] += t_imag;
-            }
-            float w_temp = w_real;
-            w_real = w_real * wm_real - w_imag * wm_imag;
-            w_imag = w_temp * wm_imag + w_imag * wm_real;
-        }
-    }
-    if (forward) {
-        for (int i = 0; i < n; i++) { real[i] /= n; imag[i] /= n; }
     }
 }
 
@@ -2,6 +2,7 @@
 #define OLED_DISPLAY_H
 
 #include "lvgl_display.h"
+#include "spectrum_analyzer.h"
 
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
@@ -30,7 +31,7 @@ private:
     // FFT handling methods
     void SetupSpectrumUI();
     void DrawOledSpectrum(); // Hàm cập nhật giao diện
-    void draw_spectrum(float* power_spectrum, int fft_size);
+    void draw_spectrum(float* magnitude, int bar_count);
     void draw_bar(int x, int y, int bar_width, int bar_height, int bar_index);
     void draw_block(int x, int y, int block_x_size, int block_y_size);
 
@@ -46,20 +47,11 @@ private:
     static void periodicUpdateTaskWrapper(void* arg);
     void periodicUpdateTask();
     void processAudioData();
-    void compute(float* real, float* imag, int n, bool forward); // Hàm tính toán FFT
 
     // Buffer dữ liệu
     int16_t* final_pcm_data_fft = nullptr;
-    int16_t* audio_data_ = nullptr;
-    int16_t* frame_audio_data = nullptr;
-    int audio_display_last_update = 0;
     bool fft_data_ready = false;
-    
-    // Mảng FFT
-    float* fft_real = nullptr;
-    float* fft_imag = nullptr;
-    float* hanning_window_float = nullptr;
-    float avg_power_spectrum[OLED_FFT_SIZE / 2] = {0};
+    SpectrumAnalyzer spectrum_analyzer_{OLED_FFT_SIZE};
 
     // QR code handling
     lv_obj_t* qr_canvas_ = nullptr;
@@ -0,0 +1,157 @@
+#include "spectrum_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+SpectrumAnalyzer::SpectrumAnalyzer(int fft_size)
+    : fft_size_(fft_size), half_size_(fft_size / 2), hop_(fft_size / 2) {
+    history_.assign(fft_size_, 0);
+    frame_.resize(fft_size_);
+    work_.resize(half_size_);
+    power_.assign(half_size_, 0.0f);
+
+    window_.resize(fft_size_);
+    for (int i = 0; i < fft_size_; i++) {
+        window_[i] = 0.5f * (1.0f - cosf(2.0f * M_PI * i / (fft_size_ - 1)));
+    }
+
+    int bits = 0;
+    while ((1 << bits) < half_size_) {
+        bits++;
+    }
+    bit_reverse_.resize(half_size_);
+    for (int i = 0; i < half_size_; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        bit_reverse_[i] = reversed;
+    }
+
+    twiddles_.resize(half_size_ / 2);
+    for (int k = 0; k < half_size_ / 2; k++) {
+        twiddles_[k] = std::polar(1.0f, (float)(-2.0 * M_PI * k / half_size_));
+    }
+    split_twiddles_.resize(half_size_);
+    for (int k = 0; k < half_size_; k++) {
+        split_twiddles_[k] = std::polar(1.0f, (float)(-2.0 * M_PI * k / fft_size_));
+    }
+}
+
+void SpectrumAnalyzer::Feed(const int16_t* samples, size_t count) {
+    if (samples == nullptr || count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Only the tail of a long frame can still be in the window
+    if (count > (size_t)fft_size_) {
+        samples += count - fft_size_;
+        pending_ += count - fft_size_;
+        count = fft_size_;
+    }
+    size_t first = std::min(count, (size_t)fft_size_ - write_pos_);
+    std::copy(samples, samples + first, history_.begin() + write_pos_);
+    std::copy(samples + first, samples + count, history_.begin());
+    write_pos_ = (write_pos_ + count) % fft_size_;
+    pending_ += count;
+}
+
+void SpectrumAnalyzer::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::fill(history_.begin(), history_.end(), 0);
+    write_pos_ = 0;
+    pending_ = 0;
+    std::fill(power_.begin(), power_.end(), 0.0f);
+}
+
+bool SpectrumAnalyzer::Analyze() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_ < (size_t)hop_) {
+            return false;
+        }
+        pending_ = 0;
+        // Unroll the ring, oldest sample first
+        std::copy(history_.begin() + write_pos_, history_.end(), frame_.begin());
+        std::copy(history_.begin(), history_.begin() + write_pos_, frame_.begin() + (fft_size_ - write_pos_));
+    }
+
+    // Pack even samples into the real part and odd samples into the imaginary part
+    const float scale = 1.0f / 32768.0f;
+    for (int n = 0; n < half_size_; n++) {
+        float even = frame_[2 * n] * scale * window_[2 * n];
+        float odd = frame_[2 * n + 1] * scale * window_[2 * n + 1];
+        work_[bit_reverse_[n]] = std::complex<float>(even, odd);
+    }
+    TransformHalf();
+
+    // Split the packed spectrum into the spectrum of the real input, normalised by 1/N like the old FFT
+    const float norm = 1.0f / fft_size_;
+    for (int k = 0; k < half_size_; k++) {
+        std::complex<float> z = work_[k];
+        std::complex<float> zc = std::conj(work_[k == 0 ? 0 : half_size_ - k]);
+        std::complex<float> even = 0.5f * (z + zc);
+        std::complex<float> odd = std::complex<float>(0.0f, -0.5f) * (z - zc);
+        std::complex<float> x = (even + split_twiddles_[k] * odd) * norm;
+        power_[k] = std::norm(x);
+    }
+    return true;
+}
+
+void SpectrumAnalyzer::TransformHalf() {
+    // Iterative radix-2, the input is already in bit-reversed order
+    for (int size = 2; size <= half_size_; size <<= 1) {
+        int half = size >> 1;
+        int stride = half_size_ / size;
+        for (int start = 0; start < half_size_; start += size) {
+            for (int j = 0; j < half; j++) {
+                std::complex<float> t = twiddles_[j * stride] * work_[start + j + half];
+                work_[start + j + half] = work_[start + j] - t;
+                work_[start + j] += t;
+            }
+        }
+    }
+}
+
+void SpectrumAnalyzer::BuildBarEdges(int bar_count) {
+    bar_count_ = bar_count;
+    bar_edges_.assign(bar_count + 1, 0);
+    bar_edges_[0] = 0;
+    if (bar_count == 1) {
+        bar_edges_[1] = half_size_;
+        return;
+    }
+    bar_edges_[1] = 1;
+    int log_bars = bar_count - 1;
+    for (int b = 1; b <= log_bars; b++) {
+        int edge = (int)lroundf(powf((float)half_size_, (float)b / log_bars));
+        // At least one bin per bar, and leave one for each remaining bar
+        edge = std::max(edge, bar_edges_[b] + 1);
+        edge = std::min(edge, half_size_ - (log_bars - b));
+        bar_edges_[b + 1] = edge;
+    }
+}
+
+void SpectrumAnalyzer::GetBars(float* magnitudes, int bar_count) {
+    if (bar_count <= 0) {
+        return;
+    }
+    if (bar_count > half_size_) {
+        std::fill(magnitudes + half_size_, magnitudes + bar_count, 0.0f);
+        bar_count = half_size_;
+    }
+    if (bar_count != bar_count_) {
+        BuildBarEdges(bar_count);
+    }
+    for (int b = 0; b < bar_count; b++) {
+        float sum = 0.0f;
+        for (int k = bar_edges_[b]; k < bar_edges_[b + 1]; k++) {
+            sum += sqrtf(power_[k]);
+        }
+        magnitudes[b] = sum / (bar_edges_[b + 1] - bar_edges_[b]);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef SPECTRUM_ANALYZER_H
+#define SPECTRUM_ANALYZER_H
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/*
+ * Spectrum engine shared by the LCD and OLED music visualizers.
+ *
+ * Feed() accepts PCM frames of any size from any task and keeps the most recent
+ * fft_size samples. Analyze() windows them and runs a real FFT, computed as an
+ * fft_size / 2 complex FFT plus a split step, with every twiddle, the window and the
+ * bit reversal precomputed in the constructor. GetBars() folds the power spectrum into
+ * log-spaced bars, the band edges are cached for the last bar count.
+ */
+class SpectrumAnalyzer {
+public:
+    // fft_size must be a power of two, at least 8
+    explicit SpectrumAnalyzer(int fft_size);
+
+    // Any task
+    void Feed(const int16_t* samples, size_t count);
+    void Reset();
+
+    // Analysis task: transforms the latest window once at least a hop of new samples has
+    // arrived, returns false if there was nothing new
+    bool Analyze();
+    // Mean magnitude of each bar, bar 0 holds the DC bin and the others span bin 1 .. N/2 log-spaced
+    void GetBars(float* magnitudes, int bar_count);
+
+    const float* power_spectrum() const { return power_.data(); }
+    int bins() const { return half_size_; }
+    int fft_size() const { return fft_size_; }
+
+private:
+    int fft_size_;
+    int half_size_;
+    int hop_;
+
+    std::mutex mutex_;
+    std::vector<int16_t> history_;   // Ring of the latest fft_size samples
+    size_t write_pos_ = 0;
+    size_t pending_ = 0;             // Samples fed since the last analysis
+
+    std::vector<float> window_;
+    std::vector<uint16_t> bit_reverse_;
+    std::vector<std::complex<float>> twiddles_;        // exp(-2*pi*i*k / half_size)
+    std::vector<std::complex<float>> split_twiddles_;  // exp(-2*pi*i*k / fft_size)
+    std::vector<std::complex<float>> work_;
+    std::vector<int16_t> frame_;
+    std::vector<float> power_;
+
+    int bar_count_ = 0;
+    std::vector<int> bar_edges_;
+
+    void TransformHalf();
+    void BuildBarEdges(int bar_count);
+};
+
+#endif // SPECTRUM_ANALYZER_H
@@ -370,14 +370,17 @@ void McpServer::AddCommonTools() {
 			// Gộp: self.sdmusic.shuffle, repeat
 			AddTool(
 				"self.sdmusic.mode",
-				"Control playback mode: shuffle and repeat.\n"
-				"action = shuffle | repeat\n"
+				"Control playback mode: shuffle, repeat and crossfade.\n"
+				"action = shuffle | repeat | crossfade\n"
 				"For shuffle: `enabled` (bool)\n"
-				"For repeat: `mode` = none | one | all",
+				"For repeat: `mode` = none | one | all\n"
+				"For crossfade: `crossfade_ms` (0-2000, 0 = off), used only when the next track "
+				"has a different sample rate; tracks of the same format always play gaplessly",
 				PropertyList({
 					Property("action",  kPropertyTypeString),
 					Property("enabled", kPropertyTypeBoolean),
-					Property("mode",    kPropertyTypeString)
+					Property("mode",    kPropertyTypeString),
+					Property("crossfade_ms", kPropertyTypeInteger, 0, 0, 2000)
 				}),
 				[](const PropertyList& props) -> ReturnValue {
 					auto sd = Board::GetInstance().GetSdMusic();
@@ -410,6 +413,11 @@ void McpServer::AddCommonTools() {
 						return true;
 					}
 
+					if (action == "crossfade") {
+						sd->setCrossfadeMs(props["crossfade_ms"].value<int>());
+						return true;
+					}
+
 					return "Unknown mode action";
 				}
 			);
@@ -654,7 +662,7 @@ void McpServer::AddCommonTools() {
 			AddTool(
 				"self.sdmusic.library",
 				"Thông tin THƯ VIỆN BÀI HÁT (tracks), KHÔNG phải thư mục.\n"
-				"Tất cả thao tác dùng dữ liệu đã index trong playlist.json, không tự quét lại thẻ SD.\n"
+				"Tất cả thao tác dùng dữ liệu đã index trong library.idx, không tự quét lại thẻ SD.\n"
 				"Nếu người dùng muốn quét lại toàn bộ, hãy dùng tool `self.sdmusic.reload`.\n"
 				"\n"
 				"action = count_dir | count_current | page\n"
@@ -758,11 +766,11 @@ void McpServer::AddCommonTools() {
 			// ================== 7) NẠP LẠI DANH SÁCH NHẠC (QUÉT LẠI SD THEO YÊU CẦU) ==================
 			AddTool(
 				"self.sdmusic.reload",
-				"Quét lại toàn bộ thư viện nhạc trong thẻ SD và cập nhật playlist.json.\n"
+				"Quét lại toàn bộ thư viện nhạc trong thẻ SD và cập nhật library.idx.\n"
 				"Chỉ dùng khi người dùng yêu cầu rõ ràng: 'nạp lại danh sách nhạc', 'quét lại nhạc', 'reload playlist', ...\n"
 				"Hành vi:\n"
 				"- Quét lại thư mục gốc hiện tại của SD music.\n"
-				"- Ghi đè file playlist.json tương ứng.\n"
+				"- Chỉ đọc lại tag của file mới / đã thay đổi, ghi đè file library.idx tương ứng.\n"
 				"- Nạp lại danh sách bài hát vào bộ nhớ.\n"
 				"Return:\n"
 				"  JSON báo thành công / thất bại.",
@@ -772,7 +780,7 @@ void McpServer::AddCommonTools() {
 					if (!sd) {
 						return "{\"success\": false, \"message\": \"SD music module not available\"}";
 					}
-					if (!sd->rebuildPlaylistFromSd()) { // hàm mới trong SdMusic: luôn quét lại SD + ghi playlist.json
+					if (!sd->rebuildPlaylistFromSd()) { // duyệt lại SD, chỉ đọc tag file đổi size/mtime + ghi library.idx
 						return "{\"success\": false, \"message\": \"Failed to rescan SD card or no supported audio files found\"}";
 					}
 					return "{\"success\": true, \"message\": \"SD playlist reloaded from SD card\"}";
@@ -854,7 +862,9 @@ void McpServer::AddCommonTools() {
 			// Nâng cấp: thêm track_path
 			AddTool(
 				"self.sdmusic.progress",
-				"Get current playback progress and duration.",
+				"Get current playback progress and duration.\n"
+				"`sd_read` reports SD card read statistics since boot: throughput (KB/s), "
+				"worst single read latency and decoder stalls waiting for data.",
 				PropertyList(),
 				[](const PropertyList&) -> ReturnValue {
 					auto sd = Board::GetInstance().GetSdMusic();
@@ -892,10 +902,60 @@ void McpServer::AddCommonTools() {
 					cJSON_AddStringToObject(o, "duration_str", sd->getDurationString().c_str());
 					cJSON_AddStringToObject(o, "track_name", sd->getCurrentTrack().c_str());
 					cJSON_AddStringToObject(o, "track_path", sd->getCurrentTrackPath().c_str());
+
+					auto rs = sd->getReadStats();
+					cJSON* r = cJSON_CreateObject();
+					cJSON_AddNumberToObject(r, "bytes", (double)rs.bytes_read);
+					cJSON_AddNumberToObject(r, "reads", rs.reads);
+					cJSON_AddNumberToObject(r, "throughput_kbps", rs.read_kbps);
+					cJSON_AddNumberToObject(r, "worst_read_ms", rs.worst_read_ms);
+					cJSON_AddNumberToObject(r, "stalls", rs.stalls);
+					cJSON_AddNumberToObject(r, "stall_ms", rs.stall_ms);
+					cJSON_AddItemToObject(o, "sd_read", r);
 					return o;
 				}
 			);
 
+			// ================== 9b) TUA (SEEK) ==================
+			AddTool(
+				"self.sdmusic.seek",
+				"Seek inside the SD card track that is playing, without restarting it.\n"
+				"Use for: 'tua tới 30 giây', 'skip 30 seconds', 'lùi lại 10 giây', 'go to 1:20'.\n"
+				"mode = to | forward | backward\n"
+				"  to:       jump to `seconds` from the start of the track\n"
+				"  forward:  skip ahead `seconds`\n"
+				"  backward: go back `seconds`\n"
+				"Works for MP3 and WAV.",
+				PropertyList({
+					Property("mode",    kPropertyTypeString, "forward"),
+					Property("seconds", kPropertyTypeInteger, 30, 0, 36000)
+				}),
+				[](const PropertyList& props) -> ReturnValue {
+					auto sd = Board::GetInstance().GetSdMusic();
+					if (!sd) return "{\"success\": false, \"message\": \"SD music module not available\"}";
+
+					std::string mode = props["mode"].value<std::string>();
+					int64_t delta = (int64_t)props["seconds"].value<int>() * 1000;
+					int64_t position = sd->getCurrentPositionMs();
+
+					int64_t target;
+					if (mode == "to")            target = delta;
+					else if (mode == "forward")  target = position + delta;
+					else if (mode == "backward") target = std::max<int64_t>(position - delta, 0);
+					else return "{\"success\": false, \"message\": \"Invalid seek mode\"}";
+
+					int64_t duration = sd->getDurationMs();
+					if (duration > 0 && target >= duration) {
+						return "{\"success\": false, \"message\": \"Position is past the end of the track\"}";
+					}
+
+					if (!sd->seek(target)) {
+						return "{\"success\": false, \"message\": \"Nothing playing or track is not seekable\"}";
+					}
+					return true;
+				}
+			);
+
 			// ================== 10) THỂ LOẠI (GENRE PLAYLIST) ==================
 			AddTool(
 				"self.sdmusic.genre",
@@ -1097,6 +1157,33 @@ void McpServer::AddCommonTools() {
 						return result;
 					});
 
+			AddTool("self.radio.get_status",
+					"Get the state of the radio stream and its network buffer.\n"
+					"Return:\n"
+					"  JSON object with the station, the now playing title (ICY metadata), buffered data (bytes / ms), the adaptive pre-roll, "
+					"measured bitrate and jitter, and counts of underruns, reconnects and decode resyncs.",
+					PropertyList(),
+					[radio](const PropertyList &properties) -> ReturnValue {
+						auto stats = radio->GetStreamStats();
+						cJSON* o = cJSON_CreateObject();
+						cJSON_AddBoolToObject(o, "playing", radio->IsPlaying());
+						cJSON_AddStringToObject(o, "station", radio->GetCurrentStation().c_str());
+						cJSON_AddStringToObject(o, "title", radio->GetStreamTitle().c_str());
+						cJSON_AddBoolToObject(o, "reconnecting", stats.reconnecting);
+						cJSON_AddNumberToObject(o, "buffered_bytes", (double)stats.buffered_bytes);
+						cJSON_AddNumberToObject(o, "buffered_ms", stats.buffered_ms);
+						cJSON_AddNumberToObject(o, "capacity_bytes", (double)stats.capacity_bytes);
+						cJSON_AddNumberToObject(o, "preroll_bytes", (double)stats.preroll_bytes);
+						cJSON_AddNumberToObject(o, "bitrate_kbps", stats.bitrate_kbps);
+						cJSON_AddNumberToObject(o, "jitter_ms", stats.jitter_ms);
+						cJSON_AddNumberToObject(o, "underruns", stats.underruns);
+						cJSON_AddNumberToObject(o, "reconnects", stats.reconnects);
+						cJSON_AddNumberToObject(o, "outage_ms", stats.outage_ms);
+						cJSON_AddNumberToObject(o, "decode_errors", stats.decode_errors);
+						cJSON_AddNumberToObject(o, "downloaded_bytes", (double)stats.downloaded_bytes);
+						return o;
+					});
+
 			AddTool("self.radio.set_display_mode",
 					"Set the display mode for radio playback. You can choose to display spectrum or station info.\n"
 					"Args:\n"
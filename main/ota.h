@@ -6,6 +6,7 @@
 
 #include <esp_err.h>
 #include "board.h"
+#include "ota_downloader.h"
 
 class Ota {
 public:
@@ -20,8 +21,8 @@ public:
     bool HasWebsocketConfig() { return has_websocket_config_; }
     bool HasActivationCode() { return has_activation_code_; }
     bool HasServerTime() { return has_server_time_; }
-    bool StartUpgrade(std::function<void(int progress, size_t speed)> callback);
-    static bool Upgrade(const std::string& firmware_url, std::function<void(int progress, size_t speed)> callback);
+    bool StartUpgrade(OtaDownloader::ProgressCallback callback);
+    static bool Upgrade(const std::string& firmware_url, OtaDownloader::ProgressCallback callback);
     void MarkCurrentVersionValid();
 
     const std::string& GetFirmwareVersion() const { return firmware_version_; }
@@ -48,7 +49,7 @@ private:
     std::string serial_number_;
     int activation_timeout_ms_ = 30000;
 
-    std::function<void(int progress, size_t speed)> upgrade_callback_;
+    OtaDownloader::ProgressCallback upgrade_callback_;
     std::vector<int> ParseVersion(const std::string& version);
     bool IsNewVersionAvailable(const std::string& currentVersion, const std::string& newVersion);
     std::string GetActivationPayload();
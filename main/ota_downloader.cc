@@ -0,0 +1,269 @@
+#include "ota_downloader.h"
+#include "board.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_pthread.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#define TAG "OtaDownloader"
+
+OtaDownloader::OtaDownloader(const std::string& url, size_t max_size) : url_(url), max_size_(max_size) {
+}
+
+OtaDownloader::~OtaDownloader() {
+    FreeBlocks();
+}
+
+bool OtaDownloader::AllocateBlocks() {
+    for (int i = 0; i < kBlockCount; i++) {
+        // PSRAM nếu có, nếu không thì RAM trong; cần tối thiểu 2 block để chạy song song
+        auto data = (uint8_t*)heap_caps_malloc(kBlockSize, MALLOC_CAP_SPIRAM);
+        if (data == nullptr) {
+            data = (uint8_t*)heap_caps_malloc(kBlockSize, MALLOC_CAP_8BIT);
+        }
+        if (data == nullptr) {
+            break;
+        }
+        blocks_.push_back({data, 0});
+        free_blocks_.push_back(i);
+    }
+    if (blocks_.size() < 2) {
+        ESP_LOGE(TAG, "Failed to allocate download buffers");
+        FreeBlocks();
+        return false;
+    }
+    ESP_LOGI(TAG, "Using %u blocks of %u bytes", (unsigned)blocks_.size(), (unsigned)kBlockSize);
+    return true;
+}
+
+void OtaDownloader::FreeBlocks() {
+    for (auto& block : blocks_) {
+        heap_caps_free(block.data);
+    }
+    blocks_.clear();
+    free_blocks_.clear();
+    filled_blocks_.clear();
+}
+
+int OtaDownloader::AcquireFreeBlock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !free_blocks_.empty() || failed_; });
+    if (failed_) {
+        return -1;
+    }
+    int index = free_blocks_.front();
+    free_blocks_.pop_front();
+    return index;
+}
+
+void OtaDownloader::QueueBlock(int index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    filled_blocks_.push_back(index);
+    cv_.notify_all();
+}
+
+void OtaDownloader::FinishReading() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reader_done_ = true;
+    cv_.notify_all();
+}
+
+void OtaDownloader::WriterLoop() {
+    while (true) {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !filled_blocks_.empty() || reader_done_ || failed_; });
+            if (failed_ || filled_blocks_.empty()) {
+                break;
+            }
+            index = filled_blocks_.front();
+            filled_blocks_.pop_front();
+        }
+
+        auto& block = blocks_[index];
+        auto start_time = esp_timer_get_time();
+        bool ok = write_callback_(written_.load(), block.data, block.length);
+        flash_write_us_ += (uint32_t)(esp_timer_get_time() - start_time);
+        if (!ok) {
+            ESP_LOGE(TAG, "Failed to write %u bytes at offset %u", (unsigned)block.length, (unsigned)written_.load());
+            std::lock_guard<std::mutex> lock(mutex_);
+            failed_ = true;
+            cv_.notify_all();
+            break;
+        }
+        written_ += block.length;
+        block.length = 0;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_blocks_.push_back(index);
+        cv_.notify_all();
+    }
+}
+
+bool OtaDownloader::Run() {
+    if (!write_callback_ || !AllocateBlocks()) {
+        return false;
+    }
+
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size = 4096;
+    cfg.prio = 5;
+    cfg.thread_name = "ota_writer";
+    esp_pthread_set_cfg(&cfg);
+    std::thread writer_thread(&OtaDownloader::WriterLoop, this);
+
+    auto network = Board::GetInstance().GetNetwork();
+    size_t received = 0;         // Bytes queued (or being filled) for the writer
+    size_t recent_received = 0;
+    int resumes = 0;
+    int failures = 0;            // Consecutive attempts that made no progress
+    int current = -1;            // Block being filled
+    auto last_calc_time = esp_timer_get_time();
+
+    auto report = [&](bool force) {
+        auto now = esp_timer_get_time();
+        if (!force && now - last_calc_time < 1000000) {
+            return;
+        }
+        DownloadProgress progress;
+        progress.written = written_.load();
+        progress.total = content_length_;
+        progress.progress = content_length_ > 0 ? (int)((uint64_t)progress.written * 100 / content_length_) : 0;
+        progress.speed = (size_t)((uint64_t)recent_received * 1000000 / std::max<int64_t>(now - last_calc_time, 1));
+        progress.flash_write_ms = flash_write_us_.exchange(0) / 1000;
+        progress.resumes = resumes;
+        ESP_LOGI(TAG, "Progress: %d%% (%u/%u), Speed: %uB/s, Flash write: %lums", progress.progress,
+                 (unsigned)progress.written, (unsigned)progress.total, (unsigned)progress.speed,
+                 (unsigned long)progress.flash_write_ms);
+        if (progress_callback_) {
+            progress_callback_(progress);
+        }
+        last_calc_time = now;
+        recent_received = 0;
+    };
+
+    auto fail = [this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = true;
+        cv_.notify_all();
+    };
+
+    while (!failed_) {
+        auto http = network->CreateHttp(0);
+        if (received > 0) {
+            http->SetHeader("Range", "bytes=" + std::to_string(received) + "-");
+        }
+
+        size_t skip = 0;         // Bytes to discard when the server ignored the Range header
+        size_t attempt_start = received;
+        bool opened = http->Open("GET", url_);
+        if (opened) {
+            int status_code = http->GetStatusCode();
+            size_t body_length = http->GetBodyLength();
+            if (status_code == 200) {
+                if (content_length_ == 0) {
+                    content_length_ = body_length;
+                    if (content_length_ == 0) {
+                        ESP_LOGE(TAG, "Failed to get content length");
+                        fail();
+                        break;
+                    }
+                    if (content_length_ > max_size_) {
+                        ESP_LOGE(TAG, "File size (%u) is larger than the target (%u)",
+                                 (unsigned)content_length_, (unsigned)max_size_);
+                        fail();
+                        break;
+                    }
+                } else if (body_length != content_length_) {
+                    ESP_LOGE(TAG, "File size changed from %u to %u", (unsigned)content_length_, (unsigned)body_length);
+                    fail();
+                    break;
+                }
+                if (received > 0) {
+                    ESP_LOGW(TAG, "Server ignored Range, skipping %u bytes", (unsigned)received);
+                }
+                skip = received;
+            } else if (status_code == 206 && received > 0) {
+                if (received + body_length != content_length_) {
+                    ESP_LOGE(TAG, "Unexpected range length %u at offset %u", (unsigned)body_length, (unsigned)received);
+                    fail();
+                    break;
+                }
+            } else {
+                ESP_LOGE(TAG, "Failed to download, status code: %d", status_code);
+                fail();
+                break;
+            }
+
+            while (received < content_length_ && !failed_) {
+                if (current < 0) {
+                    current = AcquireFreeBlock();
+                    if (current < 0) {
+                        break;
+                    }
+                }
+                auto& block = blocks_[current];
+                size_t space = std::min(kBlockSize - block.length, content_length_ - received + skip);
+                int ret = http->Read((char*)block.data + block.length, space);
+                if (ret <= 0) {
+                    ESP_LOGW(TAG, "Connection lost at %u/%u bytes: %d", (unsigned)received, (unsigned)content_length_, ret);
+                    break;
+                }
+
+                size_t length = ret;
+                if (skip > 0) {
+                    size_t dropped = std::min(skip, length);
+                    memmove(block.data + block.length, block.data + block.length + dropped, length - dropped);
+                    skip -= dropped;
+                    length -= dropped;
+                }
+                block.length += length;
+                received += length;
+                recent_received += ret;
+
+                if (block.length == kBlockSize || received == content_length_) {
+                    QueueBlock(current);
+                    current = -1;
+                }
+                report(false);
+            }
+        } else {
+            ESP_LOGW(TAG, "Failed to open HTTP connection");
+        }
+        http->Close();
+
+        if (failed_ || (content_length_ > 0 && received == content_length_)) {
+            break;
+        }
+        failures = received > attempt_start ? 1 : failures + 1;
+        if (failures > kMaxFailures) {
+            ESP_LOGE(TAG, "Giving up after %d failed attempts", kMaxFailures);
+            fail();
+            break;
+        }
+        resumes++;
+        int delay_ms = std::min(1000 << (failures - 1), 8000);
+        ESP_LOGW(TAG, "Resuming from offset %u in %d ms (attempt %d/%d)", (unsigned)received, delay_ms,
+                 failures, kMaxFailures);
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    }
+
+    FinishReading();
+    writer_thread.join();
+
+    bool success = !failed_ && content_length_ > 0 && written_.load() == content_length_;
+    if (success) {
+        report(true);
+        ESP_LOGI(TAG, "Download completed, %u bytes, %d resumes", (unsigned)content_length_, resumes);
+    }
+    FreeBlocks();
+    return success;
+}
@@ -0,0 +1,90 @@
+#ifndef _OTA_DOWNLOADER_H
+#define _OTA_DOWNLOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Progress of a download into flash, reported about once per second
+struct DownloadProgress {
+    int progress = 0;                // Percent written to flash
+    size_t written = 0;
+    size_t total = 0;
+    size_t speed = 0;                // Network bytes/s over the last period
+    uint32_t flash_write_ms = 0;     // Time spent in erase/write during the last period
+    int resumes = 0;                 // Reconnects resumed with a Range request
+};
+
+/*
+ * Downloads a large file (firmware, assets) straight into flash.
+ *
+ * The calling thread reads the HTTP body into kBlockSize blocks while a writer thread
+ * drains filled blocks into the flash sink, so the network keeps receiving while a sector
+ * is being erased or written. With kBlockCount blocks in flight the reader only waits when
+ * flash is the bottleneck.
+ *
+ * When the connection drops, the download resumes with "Range: bytes=<received>-" after a
+ * backoff that grows while reconnects keep failing and is reset by any progress. Every
+ * byte received before the drop is already queued for the writer, so flash stays strictly
+ * sequential. A server that ignores Range (200) is read from the start and the part
+ * already received is discarded.
+ *
+ * The sink is called on the writer thread with consecutive offsets; returning false aborts.
+ */
+class OtaDownloader {
+public:
+    using WriteCallback = std::function<bool(size_t offset, const uint8_t* data, size_t length)>;
+    using ProgressCallback = std::function<void(const DownloadProgress& progress)>;
+
+    static constexpr size_t kBlockSize = 16 * 1024;
+    static constexpr int kBlockCount = 4;
+    static constexpr int kMaxFailures = 6;     // Reconnects in a row without receiving anything
+
+    OtaDownloader(const std::string& url, size_t max_size);
+    ~OtaDownloader();
+
+    void OnWrite(WriteCallback callback) { write_callback_ = callback; }
+    void OnProgress(ProgressCallback callback) { progress_callback_ = callback; }
+
+    // Blocks until the whole body is in flash (true) or the download failed
+    bool Run();
+
+    size_t content_length() const { return content_length_; }
+
+private:
+    struct Block {
+        uint8_t* data = nullptr;
+        size_t length = 0;
+    };
+
+    std::string url_;
+    size_t max_size_;
+    size_t content_length_ = 0;
+    WriteCallback write_callback_;
+    ProgressCallback progress_callback_;
+
+    std::vector<Block> blocks_;
+    std::deque<int> free_blocks_;
+    std::deque<int> filled_blocks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool reader_done_ = false;                   // No more blocks will be queued
+    std::atomic<bool> failed_{false};
+    std::atomic<size_t> written_{0};
+    std::atomic<uint32_t> flash_write_us_{0};    // Since the last progress report
+
+    bool AllocateBlocks();
+    void FreeBlocks();
+    void WriterLoop();
+    int AcquireFreeBlock();
+    void QueueBlock(int index);
+    void FinishReading();
+};
+
+#endif // _OTA_DOWNLOADER_H
@@ -0,0 +1,160 @@
+// main/ui/wallpaper_cache.cc
+#include "ui/wallpaper_cache.h"
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <lvgl.h>
+#include "libs/lodepng/lodepng.h"
+
+static const char* TAG = "WallpaperCache";
+
+static const uint8_t kPngMagic[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static inline uint16_t to_rgb565(uint32_t r, uint32_t g, uint32_t b) {
+    return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+void WallpaperCache::Configure(int width, int height, size_t budget_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (width != width_ || height != height_) {
+        // Entries are scaled for the old panel size
+        entries_.clear();
+        used_bytes_ = 0;
+    }
+    width_ = width;
+    height_ = height;
+    budget_bytes_ = budget_bytes;
+    while (used_bytes_ > budget_bytes_ && !entries_.empty()) {
+        used_bytes_ -= entries_.back().bytes;
+        entries_.pop_back();
+        evictions_++;
+    }
+    ESP_LOGI(TAG, "Panel %dx%d, budget %u KB", width_, height_, (unsigned)(budget_bytes_ / 1024));
+}
+
+std::shared_ptr<LvglImage> WallpaperCache::Find(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->name == name) {
+            entries_.splice(entries_.begin(), entries_, it);
+            hits_++;
+            return entries_.front().image;
+        }
+    }
+    misses_++;
+    return nullptr;
+}
+
+std::shared_ptr<LvglImage> WallpaperCache::Insert(const std::string& name, const uint8_t* data, size_t size) {
+    int width, height;
+    size_t budget;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        width = width_;
+        height = height_;
+        budget = budget_bytes_;
+    }
+    size_t bytes = (size_t)width * height * sizeof(uint16_t);
+    if (bytes == 0 || bytes > budget) {
+        return nullptr;
+    }
+    if (data == nullptr || size < sizeof(kPngMagic) || memcmp(data, kPngMagic, sizeof(kPngMagic)) != 0) {
+        return nullptr;
+    }
+
+    auto pixels = (uint16_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (pixels == nullptr) {
+        ESP_LOGW(TAG, "No PSRAM for %s (%u bytes)", name.c_str(), (unsigned)bytes);
+        return nullptr;
+    }
+
+    int64_t start = esp_timer_get_time();
+    if (!DecodeToRgb565(data, size, width, height, pixels)) {
+        heap_caps_free(pixels);
+        ESP_LOGW(TAG, "Failed to decode %s", name.c_str());
+        return nullptr;
+    }
+    auto image = std::make_shared<LvglAllocatedImage>(pixels, bytes, width, height,
+                                                      width * (int)sizeof(uint16_t), LV_COLOR_FORMAT_RGB565);
+    ESP_LOGI(TAG, "Decoded %s to %dx%d RGB565 in %lld ms", name.c_str(), width, height,
+             (long long)((esp_timer_get_time() - start) / 1000));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (width != width_ || height != height_) {
+        // Reconfigured while decoding, hand the image out without keeping it
+        return image;
+    }
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->name == name) {
+            // Another task decoded it first
+            used_bytes_ -= it->bytes;
+            entries_.erase(it);
+            break;
+        }
+    }
+    entries_.push_front({ name, image, bytes });
+    used_bytes_ += bytes;
+    while (used_bytes_ > budget_bytes_ && entries_.size() > 1) {
+        // The evicted image stays alive while a theme still references it
+        used_bytes_ -= entries_.back().bytes;
+        entries_.pop_back();
+        evictions_++;
+    }
+    return image;
+}
+
+bool WallpaperCache::DecodeToRgb565(const uint8_t* data, size_t size, int width, int height, uint16_t* pixels) {
+    // lodepng is called directly instead of through lv_image_decoder: it only touches the
+    // buffers passed in and lv_malloc (the C library heap here), so the decode and the scale
+    // run without the LVGL lock and a theme redraw never waits for a wallpaper
+    unsigned char* rgba = nullptr;
+    unsigned src_w = 0, src_h = 0;
+    unsigned error = lodepng_decode32(&rgba, &src_w, &src_h, data, size);
+    if (error != 0 || rgba == nullptr || src_w == 0 || src_h == 0) {
+        ESP_LOGW(TAG, "PNG decode failed: %s", lodepng_error_text(error));
+        lv_free(rgba);
+        return false;
+    }
+    const size_t src_stride = (size_t)src_w * 4;
+
+    // Cover the panel keeping the aspect ratio, crop the overflow evenly
+    int crop_w = src_w, crop_h = src_h;
+    if ((int64_t)src_w * height > (int64_t)src_h * width) {
+        crop_w = (int)((int64_t)src_h * width / height);
+    } else {
+        crop_h = (int)((int64_t)src_w * height / width);
+    }
+    const int x0 = ((int)src_w - crop_w) / 2;
+    const int y0 = ((int)src_h - crop_h) / 2;
+
+    std::vector<int> columns(width);
+    for (int x = 0; x < width; x++) {
+        columns[x] = x0 + (int)((int64_t)x * crop_w / width);
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = rgba + (size_t)(y0 + (int64_t)y * crop_h / height) * src_stride;
+        uint16_t* out = pixels + (size_t)y * width;
+        // RGBA; blend transparent areas onto black, like the screen behind the wallpaper
+        for (int x = 0; x < width; x++) {
+            const uint8_t* p = row + columns[x] * 4;
+            uint32_t a = p[3];
+            out[x] = to_rgb565(p[0] * a / 255, p[1] * a / 255, p[2] * a / 255);
+        }
+    }
+    lv_free(rgba);
+    return true;
+}
+
+std::string WallpaperCache::ToString() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    char buf[128];
+    snprintf(buf, sizeof(buf), "wallpapers=%u used=%uKB/%uKB hits=%lu misses=%lu evictions=%lu",
+             (unsigned)entries_.size(), (unsigned)(used_bytes_ / 1024), (unsigned)(budget_bytes_ / 1024),
+             (unsigned long)hits_, (unsigned long)misses_, (unsigned long)evictions_);
+    return buf;
+}
@@ -0,0 +1,47 @@
+// main/ui/wallpaper_cache.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "lvgl_image.h"
+
+// LRU cache of wallpapers decoded once to panel-sized RGB565 in PSRAM.
+// A cached wallpaper is a plain RGB565 bitmap, so applying it costs LVGL a blit
+// instead of a PNG decode during the theme redraw.
+class WallpaperCache {
+public:
+    // budget_bytes == 0 disables the cache, Insert() then always returns nullptr
+    void Configure(int width, int height, size_t budget_bytes);
+
+    // Cached image, or nullptr. Marks the entry as most recently used.
+    std::shared_ptr<LvglImage> Find(const std::string& name);
+
+    // Decode a PNG, scale it to cover the panel and keep it, evicting the least recently
+    // used entries over budget. Returns nullptr for other formats or on failure so the
+    // caller can fall back to handing the source to LVGL.
+    std::shared_ptr<LvglImage> Insert(const std::string& name, const uint8_t* data, size_t size);
+
+    std::string ToString();
+
+private:
+    struct Entry {
+        std::string name;
+        std::shared_ptr<LvglImage> image;
+        size_t bytes;
+    };
+
+    std::mutex mutex_;
+    std::list<Entry> entries_;  // Front is the most recently used
+    int width_ = 0;
+    int height_ = 0;
+    size_t budget_bytes_ = 0;
+    size_t used_bytes_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    uint32_t evictions_ = 0;
+
+    bool DecodeToRgb565(const uint8_t* data, size_t size, int width, int height, uint16_t* pixels);
+};
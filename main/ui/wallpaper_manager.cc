@@ -4,8 +4,12 @@
 #include "assets.h"
 #include "lvgl_theme.h"
 #include "board.h"
+#include "application.h"
 #include <cstdlib>
 #include <ctime>
+#include <algorithm>
+#include <strings.h>
+#include <esp_heap_caps.h>
 
 // Khoá LVGL + FreeRTOS
 #include "esp_lvgl_port.h"
@@ -14,20 +18,44 @@
 
 static const char* TAG = "WallpaperManager";
 
+// Số hình nền decode sẵn giữ trong PSRAM (hiện tại + kế tiếp + 1 dự phòng)
+#define WALLPAPER_CACHE_FRAMES 3
+// Decode trước hình kế tiếp bao nhiêu giây trước khi auto-rotate
+#define WALLPAPER_PREFETCH_LEAD_SEC 10
+// Thời gian fade đen (ms)
+#define WALLPAPER_FADE_OUT_MS 220
+#define WALLPAPER_FADE_IN_MS 240
+
 void WallpaperManager::SetWallpapers(const std::vector<std::string>& names) {
     names_ = names;
     if (names_.empty()) return;
+
+    if (auto display = Board::GetInstance().GetDisplay()) {
+        // Không có PSRAM thì tắt cache, LVGL decode PNG như cũ
+        size_t frame_bytes = (size_t)display->width() * display->height() * sizeof(uint16_t);
+        size_t budget = std::min(frame_bytes * WALLPAPER_CACHE_FRAMES,
+                                 heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / 4);
+        cache_.Configure(display->width(), display->height(), budget);
+    }
 	current_index_ = current_index_ % names_.size();
     Apply(current_index_);
 }
 
 std::shared_ptr<LvglImage> WallpaperManager::LoadImage(const std::string& name) {
+    // 0) Cache đã decode sẵn
+    if (auto cached = cache_.Find(name)) {
+        return cached;
+    }
+
     // 1) Assets
     void* ptr = nullptr; size_t size = 0;
     auto& assets = Assets::GetInstance();
     if (assets.partition_valid() && assets.checksum_valid() && assets.GetAssetData(name, ptr, size)) {
         auto dot = name.find_last_of('.');
         bool is_cbin = (dot != std::string::npos) && (name.substr(dot) == ".cbin");
+        if (auto decoded = cache_.Insert(name, (const uint8_t*)ptr, size)) {
+            return decoded;
+        }
         if (is_cbin) {
             ESP_LOGI(TAG, "Load %s from assets as CBIN (%u bytes)", name.c_str(), (unsigned)size);
             return std::make_shared<LvglCBinImage>(ptr);
@@ -52,6 +80,10 @@ std::shared_ptr<LvglImage> WallpaperManager::LoadImage(const std::string& name)
     fread(buf, 1, sz, f);
     fclose(f);
 
+    if (auto decoded = cache_.Insert(name, (const uint8_t*)buf, (size_t)sz)) {
+        heap_caps_free(buf);
+        return decoded;
+    }
     ESP_LOGI(TAG, "Load %s from SPIFFS (%ld bytes)", path.c_str(), sz);
     return std::make_shared<LvglAllocatedImage>(buf, (size_t)sz);
 }
@@ -90,35 +122,23 @@ bool WallpaperManager::ApplyWithEffect(size_t index, TransitionEffect fx) {
 
     // Map mọi thứ về FadeBlack để an toàn tuyệt đối
     (void)fx;
-    fx = TransitionEffect::FadeBlack;
-
-    auto display = Board::GetInstance().GetDisplay();
-    if (!display) return false;
-    auto theme = display->GetTheme();
-    if (!theme) return false;
-
-    auto new_img = LoadImage(names_[index]);
-    if (!new_img) {
-        ESP_LOGE(TAG, "Failed to load image: %s", names_[index].c_str());
-        return false;
-    }
 
 #ifdef HAVE_LVGL
-    if (!do_fade_black_then_apply(new_img)) {
-        // fallback đổi thẳng
-        return Apply(index);	
+    // Decode ảnh và fade chạy ngoài luồng gọi (main loop / MCP)
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        pending_transition_ = (int)index;
+    }
+    if (NotifyWorker()) {
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        pending_transition_ = -1;
     }
-#else
-    if (!Apply(index)) return false;
 #endif
-
-    current_index_ = index;
-    ESP_LOGI(TAG, "Applied wallpaper #%u with FadeBlack", (unsigned)index);
-	// Hiển thị tên hình nền lên khung chat (khi dùng hiệu ứng)
-    char buf[64];
-    snprintf(buf, sizeof(buf), "Hình nền: %s", names_[index].c_str());
-    display->SetChatMessage("system", buf);
-    return true;
+    // fallback đổi thẳng
+    return Apply(index);
 }
 
 void WallpaperManager::EnableAutoRotate(bool enable, int interval_sec) {
@@ -130,14 +150,84 @@ void WallpaperManager::EnableAutoRotate(bool enable, int interval_sec) {
 void WallpaperManager::OnTick() {
     if (!auto_rotate_ || names_.size() < 2) return;
     elapsed_sec_++;
+    if (elapsed_sec_ == std::max(interval_sec_ - WALLPAPER_PREFETCH_LEAD_SEC, 1)) {
+        Prefetch((current_index_ + 1) % names_.size());
+    }
     if (elapsed_sec_ >= interval_sec_) {
+        // Không đổi nền giữa cuộc hội thoại, thử lại ở tick sau khi thiết bị rảnh
+        DeviceState state = Application::GetInstance().GetDeviceState();
+        if (state == kDeviceStateListening || state == kDeviceStateSpeaking) {
+            return;
+        }
         elapsed_sec_ = 0;
-		images_.clear();
-		images_.reserve(names_.size());
-    // chỉ dùng FadeBlack cho auto-rotate
-    ApplyWithEffect((current_index_ + 1) % names_.size(), TransitionEffect::FadeBlack);
-	 
-     
+        // chỉ dùng FadeBlack cho auto-rotate
+        ApplyWithEffect((current_index_ + 1) % names_.size(), TransitionEffect::FadeBlack);
+        ESP_LOGI(TAG, "Cache: %s", cache_.ToString().c_str());
+    }
+}
+
+void WallpaperManager::Prefetch(size_t index) {
+    if (names_.empty()) return;
+    // Cache chỉ giữ PNG, các định dạng khác LVGL tự decode khi áp nền
+    const std::string& name = names_[index % names_.size()];
+    if (name.size() < 4 || strcasecmp(name.c_str() + name.size() - 4, ".png") != 0) return;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        prefetch_name_ = name;
+    }
+    NotifyWorker();
+}
+
+bool WallpaperManager::NotifyWorker() {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    if (worker_task_ == nullptr) {
+        // Ưu tiên thấp: decode PNG chạy khi hệ thống rảnh, không chặn main loop
+        xTaskCreate([](void* arg) {
+            static_cast<WallpaperManager*>(arg)->WorkerTask();
+        }, "wallpaper_worker", 6144, this, 1, &worker_task_);
+        if (worker_task_ == nullptr) {
+            ESP_LOGW(TAG, "Failed to create wallpaper worker task");
+            return false;
+        }
+    }
+    xTaskNotifyGive(worker_task_);
+    return true;
+}
+
+void WallpaperManager::WorkerTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+#ifdef HAVE_LVGL
+        // Chuyển cảnh đang chạy sẽ gọi lại worker khi xong nếu còn yêu cầu chờ
+        int index = -1;
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex_);
+            if (!transition_active_) {
+                index = pending_transition_;
+                pending_transition_ = -1;
+            }
+        }
+        if (index >= 0) {
+            auto new_img = LoadImage(names_[index]);
+            if (!new_img) {
+                ESP_LOGE(TAG, "Failed to load image: %s", names_[index].c_str());
+            } else {
+                lvgl_port_lock(0);
+                StartFadeTransition(new_img, index);
+                lvgl_port_unlock();
+            }
+        }
+#endif
+
+        std::string name;
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex_);
+            name.swap(prefetch_name_);
+        }
+        if (!name.empty()) {
+            LoadImage(name);
+        }
     }
 }
 
@@ -152,51 +242,79 @@ static void set_theme_bg(const std::shared_ptr<LvglImage>& new_img) {
     display->SetTheme(theme);
 }
 
-bool WallpaperManager::do_fade_black_then_apply(const std::shared_ptr<LvglImage>& new_img) {
-    const uint32_t t1 = 220, t2 = 240;
+static void set_overlay_opa(void* obj, int32_t v) {
+    lv_obj_set_style_bg_opa((lv_obj_t*)obj, (lv_opa_t)v, 0);
+}
+
+void WallpaperManager::StartFadeTransition(const std::shared_ptr<LvglImage>& new_img, size_t index) {
+    transition_img_ = new_img;
+    transition_index_ = index;
+    transition_active_ = true;
 
     // tạo overlay đen trên screen hiện tại
-    lvgl_port_lock(0);
-    lv_obj_t* scr = lv_scr_act();
-    lv_obj_t* overlay = lv_obj_create(scr);
-    lv_obj_remove_style_all(overlay);
-    lv_obj_set_size(overlay, LV_PCT(100), LV_PCT(100));
-    lv_obj_set_style_bg_color(overlay, lv_color_black(), 0);
-    lv_obj_set_style_bg_opa(overlay, LV_OPA_TRANSP, 0);
+    overlay_ = lv_obj_create(lv_scr_act());
+    lv_obj_remove_style_all(overlay_);
+    lv_obj_set_size(overlay_, LV_PCT(100), LV_PCT(100));
+    lv_obj_set_style_bg_color(overlay_, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(overlay_, LV_OPA_TRANSP, 0);
+    // Overlay bị xoá (hết hiệu ứng hoặc screen bị thay) là kết thúc chuyển cảnh
+    lv_obj_add_event_cb(overlay_, OnOverlayDeleted, LV_EVENT_DELETE, nullptr);
 
     // fade to black
-    lv_anim_t a1; lv_anim_init(&a1);
-    lv_anim_set_var(&a1, overlay);
-    lv_anim_set_values(&a1, 0, LV_OPA_COVER);
-    lv_anim_set_exec_cb(&a1, [](void* obj, int32_t v){
-        lv_obj_set_style_bg_opa((lv_obj_t*)obj, (lv_opa_t)v, 0);
-    });
-    lv_anim_set_time(&a1, t1);
-    lv_anim_start(&a1);
-    lvgl_port_unlock();
-    vTaskDelay(pdMS_TO_TICKS(t1 + 30));   // để flush xong
-
-    // áp nền mới (chỉ đụng theme, không đổi screen)
-    set_theme_bg(new_img);
+    lv_anim_t a; lv_anim_init(&a);
+    lv_anim_set_var(&a, overlay_);
+    lv_anim_set_values(&a, LV_OPA_TRANSP, LV_OPA_COVER);
+    lv_anim_set_exec_cb(&a, set_overlay_opa);
+    lv_anim_set_time(&a, WALLPAPER_FADE_OUT_MS);
+    lv_anim_set_completed_cb(&a, OnFadeOutCompleted);
+    lv_anim_start(&a);
+}
+
+void WallpaperManager::OnFadeOutCompleted(lv_anim_t* anim) {
+    auto& wm = GetInstance();
+
+    // áp nền mới (chỉ đụng theme, không đổi screen) khi màn hình đang đen
+    set_theme_bg(wm.transition_img_);
+    wm.current_index_ = wm.transition_index_;
+    ESP_LOGI(TAG, "Applied wallpaper #%u with FadeBlack", (unsigned)wm.transition_index_);
 
     // fade in từ đen
-    lvgl_port_lock(0);
-    lv_anim_t a2; lv_anim_init(&a2);
-    lv_anim_set_var(&a2, overlay);
-    lv_anim_set_values(&a2, LV_OPA_COVER, 0);
-    lv_anim_set_exec_cb(&a2, [](void* obj, int32_t v){
-        lv_obj_set_style_bg_opa((lv_obj_t*)obj, (lv_opa_t)v, 0);
-    });
-    lv_anim_set_time(&a2, t2);
-    lv_anim_start(&a2);
-    lvgl_port_unlock();
-    vTaskDelay(pdMS_TO_TICKS(t2 + 40));
-
-    lvgl_port_lock(0);
-    lv_obj_del(overlay);
-    lvgl_port_unlock();
-    return true;
+    lv_anim_t a; lv_anim_init(&a);
+    lv_anim_set_var(&a, wm.overlay_);
+    lv_anim_set_values(&a, LV_OPA_COVER, LV_OPA_TRANSP);
+    lv_anim_set_exec_cb(&a, set_overlay_opa);
+    lv_anim_set_time(&a, WALLPAPER_FADE_IN_MS);
+    lv_anim_set_completed_cb(&a, OnFadeInCompleted);
+    lv_anim_start(&a);
+
+	// Hiển thị tên hình nền lên khung chat (khi dùng hiệu ứng)
+    char buf[64];
+    snprintf(buf, sizeof(buf), "Hình nền: %s", wm.names_[wm.transition_index_].c_str());
+    Board::GetInstance().GetDisplay()->SetChatMessage("system", buf);
 }
 
+void WallpaperManager::OnFadeInCompleted(lv_anim_t* anim) {
+    // Không xoá đối tượng của animation ngay trong callback của nó
+    auto& wm = GetInstance();
+    if (wm.overlay_) {
+        lv_obj_delete_async(wm.overlay_);
+    }
+}
+
+void WallpaperManager::OnOverlayDeleted(lv_event_t* e) {
+    auto& wm = GetInstance();
+    wm.overlay_ = nullptr;
+    wm.transition_img_.reset();
+
+    bool pending;
+    {
+        std::lock_guard<std::mutex> lock(wm.worker_mutex_);
+        wm.transition_active_ = false;
+        pending = wm.pending_transition_ >= 0;
+    }
+    if (pending) {
+        wm.NotifyWorker();
+    }
+}
 
 #endif // HAVE_LVGL
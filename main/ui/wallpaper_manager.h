@@ -3,10 +3,15 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "lvgl_display.h"
 #include "lvgl_theme.h"
 #include "assets.h"
+#include "ui/wallpaper_cache.h"
 
 class WallpaperManager {
 public:
@@ -25,34 +30,58 @@ public:
     // Đổi nền ngay lập tức theo index (0..n-1)
     bool Apply(size_t index);
 
-    // Đổi nền kèm hiệu ứng
+    // Đổi nền kèm hiệu ứng. Không chặn: ảnh được decode ở task nền, hiệu ứng chạy bằng
+    // animation LVGL; trả về ngay khi đã xếp yêu cầu (yêu cầu mới thay yêu cầu đang chờ)
     bool ApplyWithEffect(size_t index, TransitionEffect fx);
 
     // Bật/tắt auto-rotate, interval tính bằng giây // đổi mỗi 180 giây (3 phút)
     void EnableAutoRotate(bool enable, int interval_sec = 180);
 
-    // Gọi mỗi giây từ timer hệ thống
+    // Gọi mỗi giây từ main loop, không bao giờ chặn. Auto-rotate hoãn lại khi đang nghe/nói
     void OnTick();
 
     // Lấy index hiện tại (để lưu/khôi phục)
     size_t current_index() const { return current_index_; }
 
+    // Thống kê cache hình nền đã decode
+    std::string GetCacheStats() { return cache_.ToString(); }
+
 private:
     WallpaperManager() = default;
     ~WallpaperManager() = default;
 
-    // Thử lấy ảnh từ Assets (ưu tiên) hoặc SPIFFS
+    // Thử lấy ảnh từ cache, Assets (ưu tiên) hoặc SPIFFS
     std::shared_ptr<LvglImage> LoadImage(const std::string& name);
 
+    // Decode trước hình nền index ở task nền để lần đổi nền kế tiếp chỉ cần blit
+    void Prefetch(size_t index);
+    // Task nền: prefetch và nạp ảnh cho chuyển cảnh, tạo ở lần dùng đầu tiên
+    bool NotifyWorker();
+    void WorkerTask();
+
 #ifdef HAVE_LVGL
-    // Các hiệu ứng chuyển cảnh
-    bool do_fade_black_then_apply(const std::shared_ptr<LvglImage>& new_img);
+    // Fade đen chạy hoàn toàn trong task LVGL: fade-out, completion callback đổi nền,
+    // fade-in, completion callback xoá overlay. Gọi khi đang giữ khoá LVGL
+    void StartFadeTransition(const std::shared_ptr<LvglImage>& new_img, size_t index);
+    static void OnFadeOutCompleted(lv_anim_t* anim);
+    static void OnFadeInCompleted(lv_anim_t* anim);
+    static void OnOverlayDeleted(lv_event_t* e);
+
+    lv_obj_t* overlay_ = nullptr;                       // Chỉ dùng trong task LVGL
+    std::shared_ptr<LvglImage> transition_img_;
+    size_t transition_index_ = 0;
 #endif
 
     std::vector<std::string> names_;
-	// *** mới thêm: cache hình đã decode ***
-    std::vector<std::shared_ptr<LvglImage>> images_;
-    size_t current_index_ = 0;
+    // Cache hình đã decode sẵn RGB565 theo kích thước màn hình (PSRAM, LRU)
+    WallpaperCache cache_;
+    std::atomic<size_t> current_index_{0};
+
+    TaskHandle_t worker_task_ = nullptr;
+    std::mutex worker_mutex_;
+    std::string prefetch_name_;                         // Guarded by worker_mutex_
+    int pending_transition_ = -1;                       // Guarded by worker_mutex_
+    std::atomic<bool> transition_active_{false};
 
     bool auto_rotate_ = true;
     int interval_sec_ = 180; // đổi mỗi 180 giây (3 phút)
@@ -17,6 +17,7 @@ import shutil
 import sys
 import json
 import struct
+import zlib
 from datetime import datetime
 
 
@@ -215,6 +216,46 @@ def process_text_font(text_font_file, assets_dir):
     return None
 
 
+def collect_json_strings(node, out):
+    if isinstance(node, str):
+        out.append(node)
+    elif isinstance(node, dict):
+        for value in node.values():
+            collect_json_strings(value, out)
+    elif isinstance(node, list):
+        for value in node:
+            collect_json_strings(value, out)
+
+
+def process_text_font_warmup(corpus_files, assets_dir, out_name="text_font_warmup.bin"):
+    """
+    Write the codepoints of the corpus ordered by frequency (u32 LE, most frequent first).
+    The firmware renders them into its glyph cache when the font is loaded, so the glyphs
+    the UI uses most are served from RAM instead of scattered flash reads.
+    """
+    counts = {}
+    for corpus_file in corpus_files:
+        if not corpus_file or not os.path.isfile(corpus_file):
+            continue
+        with open(corpus_file, 'r', encoding='utf-8') as f:
+            text = f.read()
+        if corpus_file.endswith('.json'):
+            strings = []
+            collect_json_strings(json.load(io.StringIO(text)), strings)
+            text = '\n'.join(strings)
+        for char in text:
+            if char.isprintable() and not char.isspace():
+                counts[char] = counts.get(char, 0) + 1
+    if not counts:
+        return None
+
+    ordered = sorted(counts, key=lambda c: (-counts[c], ord(c)))
+    with open(os.path.join(assets_dir, out_name), 'wb') as f:
+        f.write(struct.pack(f'<{len(ordered)}I', *(ord(c) for c in ordered)))
+    print(f"Generated: {out_name} ({len(ordered)} glyphs, top: {''.join(ordered[:16])})")
+    return out_name
+
+
 def process_emoji_collection(emoji_collection_dir, assets_dir):
     """Process emoji_collection parameter"""
     if not emoji_collection_dir:
@@ -272,7 +313,7 @@ def process_extra_files(extra_files_dir, assets_dir):
     return extra_files_list
 
 
-def generate_index_json(assets_dir, srmodels, text_font, emoji_collection, extra_files=None, multinet_model_info=None):
+def generate_index_json(assets_dir, srmodels, text_font, emoji_collection, extra_files=None, multinet_model_info=None, text_font_warmup=None):
     """Generate index.json file"""
     index_data = {
         "version": 1
@@ -283,6 +324,8 @@ def generate_index_json(assets_dir, srmodels, text_font, emoji_collection, extra
     
     if text_font:
         index_data["text_font"] = text_font
+        if text_font_warmup:
+            index_data["text_font_warmup"] = text_font_warmup
     
     if emoji_collection:
         index_data["emoji_collection"] = emoji_collection
@@ -428,6 +471,70 @@ def pack_assets_simple(target_path, include_path, out_file, assets_path, max_nam
     print(f'All files have been merged into {os.path.basename(out_file)}')
 
 
+ASSETS_V2_MAGIC = 0x3253415A  # "ZAS2"
+
+
+def fnv1a_hash(name_bytes):
+    h = 0x811C9DC5
+    for b in name_bytes:
+        h ^= b
+        h = (h * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def pack_assets_v2(target_path, out_file):
+    """
+    Pack assets in the v2 format read by Assets::InitializeV2:
+
+        header (32 bytes) | entries (20 bytes each) | names | data
+
+    Entries are sorted by (FNV-1a hash, name) so the firmware can binary search the table
+    straight from flash. Each entry carries the CRC32 of its data, checked on first use;
+    the header and the index have their own CRC32, checked at boot.
+    """
+    skip_files = ['config.json']
+    os.makedirs(os.path.dirname(out_file), exist_ok=True)
+
+    files = []
+    for filename in sorted(os.listdir(target_path), key=sort_key):
+        file_path = os.path.join(target_path, filename)
+        if filename in skip_files or not os.path.isfile(file_path):
+            continue
+        with open(file_path, 'rb') as f:
+            files.append((filename.encode('utf-8'), f.read()))
+    if not files:
+        raise ValueError(f'No files to pack in {target_path}')
+
+    files.sort(key=lambda item: (fnv1a_hash(item[0]), item[0]))
+
+    names = bytearray()
+    data = bytearray()
+    entries = bytearray()
+    for name, content in files:
+        # Căn 4 byte để font/ảnh đọc trực tiếp từ mmap
+        data.extend(b'\0' * (-len(data) % 4))
+        entries.extend(struct.pack('<5I', fnv1a_hash(name), len(names), len(data), len(content),
+                                   zlib.crc32(content) & 0xFFFFFFFF))
+        names.extend(name + b'\0')
+        data.extend(content)
+
+    index = entries + names
+    header_size = 32
+    data_offset = header_size + len(index)
+    data_offset += -data_offset % 4
+    header = struct.pack('<7I', ASSETS_V2_MAGIC, 2, len(files), len(names), data_offset, len(data),
+                         zlib.crc32(index) & 0xFFFFFFFF)
+    header += struct.pack('<I', zlib.crc32(header) & 0xFFFFFFFF)
+
+    with open(out_file, 'wb') as output_bin:
+        output_bin.write(header)
+        output_bin.write(index)
+        output_bin.write(b'\0' * (data_offset - header_size - len(index)))
+        output_bin.write(data)
+
+    print(f'All {len(files)} files have been packed into {os.path.basename(out_file)} (assets v2)')
+
+
 # =============================================================================
 # Configuration and main functions
 # =============================================================================
@@ -507,6 +614,22 @@ def read_multinet_from_sdkconfig(sdkconfig_path):
     return models
 
 
+def read_language_from_sdkconfig(sdkconfig_path):
+    """
+    Read the UI language (e.g. CONFIG_LANGUAGE_VI_VN=y -> vi-VN) from sdkconfig
+    """
+    if not os.path.exists(sdkconfig_path):
+        return None
+    with io.open(sdkconfig_path, "r") as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith('CONFIG_LANGUAGE_') and line.endswith('=y'):
+                parts = line[len('CONFIG_LANGUAGE_'):-2].split('_')
+                if len(parts) == 2:
+                    return f"{parts[0].lower()}-{parts[1].upper()}"
+    return None
+
+
 def read_wake_word_type_from_sdkconfig(sdkconfig_path):
     """
     Read wake word type configuration from sdkconfig
@@ -698,7 +821,7 @@ def get_emoji_collection_path(default_emoji_collection, xiaozhi_fonts_path):
         return None
 
 
-def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, extra_files_path, output_path, multinet_model_info=None):
+def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, extra_files_path, output_path, multinet_model_info=None, assets_format="v2", text_font_corpus=None):
     """
     Build assets using integrated functions (no external dependencies)
     """
@@ -720,9 +843,10 @@ def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font
         text_font = process_text_font(text_font_path, assets_dir) if text_font_path else None
         emoji_collection = process_emoji_collection(emoji_collection_path, assets_dir) if emoji_collection_path else None
         extra_files = process_extra_files(extra_files_path, assets_dir) if extra_files_path else None
+        text_font_warmup = process_text_font_warmup(text_font_corpus, assets_dir) if text_font and text_font_corpus else None
         
         # Generate index.json
-        generate_index_json(assets_dir, srmodels, text_font, emoji_collection, extra_files, multinet_model_info)
+        generate_index_json(assets_dir, srmodels, text_font, emoji_collection, extra_files, multinet_model_info, text_font_warmup)
         
         # Generate config.json for packing
         config_path = generate_config_json(temp_build_dir, assets_dir)
@@ -734,7 +858,10 @@ def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font
         # Use simplified packing function
         include_path = config_data['include_path']
         image_file = config_data['image_file']
-        pack_assets_simple(assets_dir, include_path, image_file, "assets", int(config_data['name_length']))
+        if assets_format == "v1":
+            pack_assets_simple(assets_dir, include_path, image_file, "assets", int(config_data['name_length']))
+        else:
+            pack_assets_v2(assets_dir, image_file)
         
         # Copy final assets.bin to output location
         if os.path.exists(image_file):
@@ -768,6 +895,11 @@ def main():
     parser.add_argument('--esp_sr_model_path', help='Path to ESP-SR model directory')
     parser.add_argument('--xiaozhi_fonts_path', help='Path to xiaozhi-fonts component directory')
     parser.add_argument('--extra_files', help='Path to extra files directory to be included in assets')
+    parser.add_argument('--text_font_corpus', action='append', default=[],
+                        help='UTF-8 text or JSON whose characters are pre-rendered into the glyph cache, by frequency '
+                             '(default: UI strings of the configured language)')
+    parser.add_argument('--assets_format', choices=['v1', 'v2'], default='v2',
+                        help='Pack format, v1 for firmware without assets v2 support (default: v2)')
     
     args = parser.parse_args()
     
@@ -788,6 +920,7 @@ def main():
     print(f"  builtin_text_font: {args.builtin_text_font}")
     print(f"  emoji_collection: {args.emoji_collection}")
     print(f"  output: {args.output}")
+    print(f"  assets_format: {args.assets_format}")
     
     # Read wake word type configuration from sdkconfig
     wake_word_config = read_wake_word_type_from_sdkconfig(args.sdkconfig)
@@ -858,6 +991,14 @@ def main():
         print(f"  wake word language: {language}")
         print(f"  wake word threshold: {custom_wake_word_config['threshold']}")
     
+    # Glyphs to pre-render: the UI strings of the configured language unless given explicitly
+    text_font_corpus = list(args.text_font_corpus)
+    if not text_font_corpus:
+        ui_language = read_language_from_sdkconfig(args.sdkconfig)
+        if ui_language:
+            project_root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            text_font_corpus.append(os.path.join(project_root, "main", "assets", "locales", ui_language, "language.json"))
+
     # Check if we have anything to build
     if not wakenet_model_paths and not multinet_model_paths and not text_font_path and not emoji_collection_path and not extra_files_path and not multinet_model_info:
         print("Warning: No assets to build (no SR models, text font, emoji collection, extra files, or custom wake word)")
@@ -870,7 +1011,8 @@ def main():
     
     # Build the assets
     success = build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, 
-                                     extra_files_path, args.output, multinet_model_info)
+                                     extra_files_path, args.output, multinet_model_info, args.assets_format,
+                                     text_font_corpus)
     
     if not success:
         sys.exit(1)
@@ -0,0 +1,319 @@
+// AssetsV2Index on images packed the way pack_assets_v2() in scripts/build_default_assets.py
+// does: lookups with FNV-1a collisions, the lazy per-file CRC, and headers / indexes that
+// must be rejected at boot (corrupted, truncated, or sealed with sizes that do not fit).
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "assets_v2.h"
+#include "esp_rom_crc.h"
+#include "host_test.h"
+
+using Files = std::vector<std::pair<std::string, std::string>>;
+
+struct Image {
+    std::vector<uint8_t> bytes;
+
+    mmap_assets_v2_header& header() { return *(mmap_assets_v2_header*)bytes.data(); }
+    mmap_assets_v2_entry* entries() { return (mmap_assets_v2_entry*)(bytes.data() + sizeof(mmap_assets_v2_header)); }
+    char* names() { return (char*)(entries() + header().file_count); }
+    const char* root() const { return (const char*)bytes.data(); }
+    size_t size() const { return bytes.size(); }
+
+    // Recomputes both CRCs after a field was changed on purpose
+    void Reseal(size_t index_size) {
+        header().index_crc = esp_rom_crc32_le(0, bytes.data() + sizeof(mmap_assets_v2_header), index_size);
+        header().header_crc = esp_rom_crc32_le(0, bytes.data(), offsetof(mmap_assets_v2_header, header_crc));
+    }
+    void Reseal() { Reseal(header().file_count * sizeof(mmap_assets_v2_entry) + header().names_size); }
+};
+
+static uint32_t Hash(const std::string& name) {
+    return AssetsV2Index::HashName(name.data(), name.size());
+}
+
+// Same layout as pack_assets_v2()
+static Image Pack(Files files) {
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+        return std::make_pair(Hash(a.first), a.first) < std::make_pair(Hash(b.first), b.first);
+    });
+    std::vector<uint8_t> entries, names, data;
+    for (auto& [name, content] : files) {
+        data.resize((data.size() + 3) & ~(size_t)3);
+        mmap_assets_v2_entry entry = {
+            .name_hash = Hash(name),
+            .name_offset = (uint32_t)names.size(),
+            .offset = (uint32_t)data.size(),
+            .size = (uint32_t)content.size(),
+            .crc = esp_rom_crc32_le(0, (const uint8_t*)content.data(), content.size()),
+        };
+        entries.insert(entries.end(), (uint8_t*)&entry, (uint8_t*)(&entry + 1));
+        names.insert(names.end(), name.begin(), name.end());
+        names.push_back(0);
+        data.insert(data.end(), content.begin(), content.end());
+    }
+    std::vector<uint8_t> index = entries;
+    index.insert(index.end(), names.begin(), names.end());
+    size_t data_offset = (sizeof(mmap_assets_v2_header) + index.size() + 3) & ~(size_t)3;
+
+    Image image;
+    image.bytes.resize(data_offset + data.size());
+    memcpy(image.bytes.data() + sizeof(mmap_assets_v2_header), index.data(), index.size());
+    memcpy(image.bytes.data() + data_offset, data.data(), data.size());
+    image.header() = {
+        .magic = ASSETS_V2_MAGIC,
+        .version = 2,
+        .file_count = (uint32_t)files.size(),
+        .names_size = (uint32_t)names.size(),
+        .data_offset = (uint32_t)data_offset,
+        .data_size = (uint32_t)data.size(),
+        .index_crc = 0,
+        .header_crc = 0,
+    };
+    image.Reseal();
+    return image;
+}
+
+// "costarring"/"liquid" and "declinate"/"macallums" share their FNV-1a hash, so do
+// "altarage"/"zinke"
+static const Files kFiles = {
+    {"index.json", "{\"version\": 1}"},
+    {"costarring", "first of a colliding pair"},
+    {"liquid", "second of a colliding pair, longer"},
+    {"declinate", "abc"},
+    {"macallums", "abcdefg"},
+    {"altarage", std::string(5000, 'x')},
+    {"empty.bin", ""},
+    {"srmodels.bin", std::string(70000, '\x5a')},
+};
+
+static std::string Content(AssetsV2Index& index, const mmap_assets_v2_entry* entry) {
+    return std::string(index.data(entry), entry->size);
+}
+
+static void TestLookup() {
+    CHECK(Hash("costarring") == Hash("liquid"));
+    CHECK(Hash("declinate") == Hash("macallums"));
+    CHECK(Hash("altarage") == Hash("zinke"));
+
+    AssetsV2Index index;
+    CHECK(index.FindEntry("index.json") == nullptr);
+
+    auto image = Pack(kFiles);
+    CHECK(index.Initialize(image.root(), image.size()));
+    CHECK(index.valid());
+    CHECK_EQ(index.count(), (uint32_t)kFiles.size());
+    for (auto& [name, content] : kFiles) {
+        auto entry = index.FindEntry(name);
+        CHECK(entry != nullptr);
+        CHECK(entry->offset % 4 == 0);
+        CHECK(Content(index, entry) == content);
+        CHECK(index.VerifyEntry(entry));
+    }
+
+    // Both names of a colliding pair sit next to each other and resolve by name
+    auto a = index.FindEntry("costarring");
+    auto b = index.FindEntry("liquid");
+    CHECK(a != b && a->name_hash == b->name_hash);
+    CHECK(a + 1 == b || b + 1 == a);
+
+    // Same hash as a packed name, or a prefix of one: not found
+    CHECK(index.FindEntry("zinke") == nullptr);
+    CHECK(index.FindEntry("liqui") == nullptr);
+    CHECK(index.FindEntry("") == nullptr);
+
+    // A packer whose two colliding names came out of order still finds both: the index only
+    // requires hashes to be sorted
+    auto swapped = Pack(kFiles);
+    std::swap(swapped.entries()[a - image.entries()], swapped.entries()[b - image.entries()]);
+    swapped.Reseal();
+    AssetsV2Index swapped_index;
+    CHECK(swapped_index.Initialize(swapped.root(), swapped.size()));
+    CHECK(Content(swapped_index, swapped_index.FindEntry("costarring")) == kFiles[1].second);
+    CHECK(Content(swapped_index, swapped_index.FindEntry("liquid")) == kFiles[2].second);
+
+    index.Clear();
+    CHECK(!index.valid());
+    CHECK(index.FindEntry("index.json") == nullptr);
+}
+
+// Data is only checked on first use: a corrupted file passes Initialize, fails its own
+// VerifyEntry every time and does not affect its neighbours
+static void TestCorruptedEntry() {
+    auto image = Pack(kFiles);
+    AssetsV2Index index;
+    CHECK(index.Initialize(image.root(), image.size()));
+
+    auto liquid = index.FindEntry("liquid");
+    CHECK(index.VerifyEntry(liquid));
+
+    auto costarring = index.FindEntry("costarring");
+    image.bytes[image.header().data_offset + costarring->offset + 3] ^= 0x01;
+    CHECK(!index.VerifyEntry(costarring));
+    image.bytes[image.header().data_offset + costarring->offset + 3] ^= 0x01;
+    CHECK(!index.VerifyEntry(costarring));   // Remembered, not recomputed
+
+    // Verified once: later changes are not seen
+    image.bytes[image.header().data_offset + liquid->offset] ^= 0x80;
+    CHECK(index.VerifyEntry(liquid));
+
+    auto model = index.FindEntry("srmodels.bin");
+    image.bytes[image.header().data_offset + model->offset + model->size - 1] = 0;
+    CHECK(!index.VerifyEntry(model));
+    CHECK(index.VerifyEntry(index.FindEntry("index.json")));
+    CHECK(index.VerifyEntry(index.FindEntry("empty.bin")));
+
+    // A fresh index forgets what was verified
+    CHECK(index.Initialize(image.root(), image.size()));
+    CHECK(index.VerifyEntry(index.FindEntry("costarring")));
+    CHECK(!index.VerifyEntry(index.FindEntry("liquid")));
+}
+
+static void TestTruncated() {
+    auto image = Pack(kFiles);
+    const size_t index_end = sizeof(mmap_assets_v2_header) + image.header().file_count * sizeof(mmap_assets_v2_entry) +
+                             image.header().names_size;
+    AssetsV2Index index;
+    CHECK(!index.Initialize(image.root(), 0));
+    CHECK(!index.Initialize(image.root(), sizeof(mmap_assets_v2_header) - 1));
+    CHECK(!index.Initialize(image.root(), sizeof(mmap_assets_v2_header)));
+    CHECK(!index.Initialize(image.root(), sizeof(mmap_assets_v2_header) + 7));       // Inside the entries
+    CHECK(!index.Initialize(image.root(), index_end - 1));                           // Inside the names
+    CHECK(!index.Initialize(image.root(), image.size() - 1));                        // Last data byte missing
+    CHECK(!index.valid());
+    CHECK(index.Initialize(image.root(), image.size()));
+    CHECK(index.Initialize(image.root(), image.size() + 4096));                      // Partition larger than the pack
+
+    // A failed Initialize drops the previous index
+    CHECK(!index.Initialize(image.root(), image.size() - 1));
+    CHECK(!index.valid());
+    CHECK(index.FindEntry("index.json") == nullptr);
+
+    // Index cut short by the packer: names_size says less than what the entries point to
+    auto cut = Pack(kFiles);
+    cut.header().names_size -= 4;
+    cut.Reseal();
+    CHECK(!index.Initialize(cut.root(), cut.size()));
+}
+
+static void TestCorruptedIndex() {
+    AssetsV2Index index;
+    // Header or index bytes flipped without resealing
+    {
+        auto image = Pack(kFiles);
+        image.header().data_size ^= 1;
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    {
+        auto image = Pack(kFiles);
+        image.names()[2] ^= 0x20;
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    {
+        auto image = Pack(kFiles);
+        image.entries()[3].crc ^= 1;
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    // Sealed, but not version 2
+    {
+        auto image = Pack(kFiles);
+        image.header().version = 3;
+        image.Reseal();
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    // Sealed, entries out of hash order
+    {
+        auto image = Pack(kFiles);
+        std::swap(image.entries()[0], image.entries()[image.header().file_count - 1]);
+        image.Reseal();
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    // Sealed, an entry pointing past the names or the data
+    {
+        auto image = Pack(kFiles);
+        image.entries()[1].name_offset = image.header().names_size;
+        image.Reseal();
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    {
+        auto image = Pack(kFiles);
+        image.entries()[1].size = image.header().data_size - image.entries()[1].offset + 1;
+        image.Reseal();
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    {
+        auto image = Pack(kFiles);
+        image.entries()[1].offset = 0xFFFFFFF0;
+        image.Reseal();
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    // Sealed, the last name is not terminated
+    {
+        auto image = Pack(kFiles);
+        image.names()[image.header().names_size - 1] = 'x';
+        image.Reseal();
+        CHECK(!index.Initialize(image.root(), image.size()));
+    }
+    CHECK(!index.valid());
+}
+
+// Sizes that only fit once the sum wraps. On the 32-bit target file_count * 20 +
+// names_size is computed in size_t, so names_size is bounded by the partition before the
+// sum; file_count by partition / 20
+static void TestSizesPastPartition() {
+    AssetsV2Index index;
+    auto image = Pack(kFiles);
+    const uint32_t entries_size = image.header().file_count * sizeof(mmap_assets_v2_entry);
+    const uint32_t names_size = image.header().names_size;
+    {
+        auto bad = image;
+        // entries_size + names_size wraps to the real names size on 32 bit, sealed with the
+        // CRC the target would then compute
+        bad.header().names_size = (uint32_t)(0x100000000ull - entries_size + names_size);
+        bad.Reseal(names_size);
+        CHECK(!index.Initialize(bad.root(), bad.size()));
+    }
+    {
+        auto bad = image;
+        bad.header().names_size = 0xFFFFFFFF;
+        bad.Reseal(entries_size + names_size);
+        CHECK(!index.Initialize(bad.root(), bad.size()));
+    }
+    {
+        auto bad = image;
+        bad.header().names_size = bad.size() + 1;
+        bad.Reseal(entries_size + names_size);
+        CHECK(!index.Initialize(bad.root(), bad.size()));
+    }
+    {
+        auto bad = image;
+        bad.header().file_count = 0x0CCCCCCD;      // * 20 wraps to 4 on 32 bit
+        bad.Reseal(entries_size + names_size);
+        CHECK(!index.Initialize(bad.root(), bad.size()));
+    }
+    {
+        auto bad = image;
+        bad.header().data_offset = bad.size() + 4;
+        bad.header().data_size = 0;
+        bad.Reseal();
+        CHECK(!index.Initialize(bad.root(), bad.size()));
+    }
+    {
+        auto bad = image;
+        bad.header().data_size = 0xFFFFFFFF;
+        bad.Reseal();
+        CHECK(!index.Initialize(bad.root(), bad.size()));
+    }
+    CHECK(index.Initialize(image.root(), image.size()));
+}
+
+int main() {
+    RUN_TEST(TestLookup);
+    RUN_TEST(TestCorruptedEntry);
+    RUN_TEST(TestTruncated);
+    RUN_TEST(TestCorruptedIndex);
+    RUN_TEST(TestSizesPastPartition);
+    return 0;
+}
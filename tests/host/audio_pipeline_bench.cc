@@ -0,0 +1,215 @@
+// Replays captured Opus streams through AudioPipeline on std::thread, the same loops the
+// device runs on FreeRTOS tasks, and prints the pipeline report: per-stage latency
+// percentiles, frames per second and peak queue depths.
+//
+//   audio_pipeline_bench [--loops N] [--speed X] [--decode-us N] [--encode-us N]
+//                        [--output-rate HZ] [--pcm capture.raw] [file.ogg ...]
+//
+// Downlink: every Opus packet of the given .ogg files (default: main/assets/common/*.ogg)
+// is pushed into the decode queue as the network task would, waiting when it is full.
+// Uplink: 16 kHz mono PCM (--pcm, raw s16le; a tone otherwise) is fed to the encode queue
+// every 60 ms. There is no libopus on the host, so decode / encode burn --decode-us /
+// --encode-us of CPU, and the speaker consumes each frame in real time divided by --speed.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_pipeline.h"
+#include "audio_task_runner.h"
+#include "ogg_packets.h"
+
+struct Options {
+    int loops = 20;
+    double speed = 1.0;
+    int decode_us = 300;
+    int encode_us = 2000;
+    int output_rate = 24000;
+    std::string pcm_path;
+    std::vector<std::string> files;
+};
+
+static void Spin(int us) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--loops" && has_value) {
+            options.loops = atoi(argv[++i]);
+        } else if (arg == "--speed" && has_value) {
+            options.speed = atof(argv[++i]);
+        } else if (arg == "--decode-us" && has_value) {
+            options.decode_us = atoi(argv[++i]);
+        } else if (arg == "--encode-us" && has_value) {
+            options.encode_us = atoi(argv[++i]);
+        } else if (arg == "--output-rate" && has_value) {
+            options.output_rate = atoi(argv[++i]);
+        } else if (arg == "--pcm" && has_value) {
+            options.pcm_path = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+    if (options.files.empty()) {
+        for (auto name : {"popup.ogg", "success.ogg", "vibration.ogg", "exclamation.ogg", "low_battery.ogg"}) {
+            options.files.push_back(std::string(XIAOZHI_ASSETS_DIR) + "/" + name);
+        }
+    }
+    return options.loops > 0 && options.speed > 0 && options.output_rate > 0;
+}
+
+static std::vector<int16_t> LoadPcm(const std::string& path) {
+    std::vector<int16_t> pcm;
+    if (path.empty()) {
+        // 1 s of a 440 Hz tone
+        for (int i = 0; i < 16000; i++) {
+            pcm.push_back((int16_t)(8000 * sin(2 * M_PI * 440 * i / 16000)));
+        }
+        return pcm;
+    }
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        return pcm;
+    }
+    int16_t buffer[1024];
+    size_t n;
+    while ((n = fread(buffer, sizeof(int16_t), 1024, fp)) > 0) {
+        pcm.insert(pcm.end(), buffer, buffer + n);
+    }
+    fclose(fp);
+    return pcm;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--loops N] [--speed X] [--decode-us N] [--encode-us N] "
+            "[--output-rate HZ] [--pcm capture.raw] [file.ogg ...]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::vector<uint8_t>> packets;
+    for (auto& file : options.files) {
+        if (!ReadOggOpusPackets(file, packets)) {
+            fprintf(stderr, "Cannot read %s\n", file.c_str());
+            return 1;
+        }
+    }
+    auto pcm = LoadPcm(options.pcm_path);
+    const size_t frame_samples = 16000 * OPUS_FRAME_DURATION_MS / 1000;
+    if (packets.empty() || pcm.size() < frame_samples) {
+        fprintf(stderr, "Nothing to replay\n");
+        return 1;
+    }
+
+    AudioFramePool::GetInstance().Initialize(options.output_rate);
+
+    AudioPipeline pipeline;
+    AudioPipelineCodec codec;
+    codec.decode = [&](AudioStreamPacket& packet, std::vector<int16_t>& out) {
+        Spin(options.decode_us);
+        out.assign(options.output_rate * packet.frame_duration / 1000, 0);
+        return true;
+    };
+    codec.encode = [&](std::vector<int16_t>&& in, std::vector<uint8_t>& opus) {
+        Spin(options.encode_us);
+        opus.assign(in.size() / 8, 0);
+        return true;
+    };
+    codec.output = [&](std::vector<int16_t>& out) {
+        auto us = out.size() * 1000000.0 / options.output_rate / options.speed;
+        std::this_thread::sleep_for(std::chrono::microseconds((int64_t)us));
+    };
+    pipeline.SetCodec(codec);
+
+    std::atomic<uint32_t> sent{0};
+    pipeline.OnSendQueueAvailable([&]() {
+        while (pipeline.PopPacketFromSendQueue()) {
+            sent++;
+        }
+    });
+
+    StdThreadTaskRunner runner;
+    pipeline.Start();
+    pipeline.ResetReport();
+    runner.Start("audio_output", 0, 4, -1, [&]() { pipeline.RunOutputLoop(); });
+    runner.Start("opus_codec", 0, 2, -1, [&]() { pipeline.RunCodecLoop(); });
+
+    // Microphone: one 60 ms frame per period
+    std::atomic<bool> uplink_running{true};
+    uint32_t encoded_frames = 0;
+    std::thread uplink([&]() {
+        auto period = std::chrono::microseconds((int64_t)(OPUS_FRAME_DURATION_MS * 1000 / options.speed));
+        auto next = std::chrono::steady_clock::now();
+        size_t offset = 0;
+        while (uplink_running) {
+            if (offset + frame_samples > pcm.size()) {
+                offset = 0;
+            }
+            std::vector<int16_t> frame(pcm.begin() + offset, pcm.begin() + offset + frame_samples);
+            offset += frame_samples;
+            pipeline.PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(frame));
+            encoded_frames++;
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    });
+
+    // Network: push the downlink packets as they arrive, blocking while the decode queue is full
+    uint32_t pushed = 0;
+    int64_t audio_tenth_ms = 0;
+    for (int loop = 0; loop < options.loops; loop++) {
+        for (auto& payload : packets) {
+            auto packet = AudioFramePool::GetInstance().AcquirePacket(payload.size());
+            packet->sample_rate = options.output_rate;
+            packet->frame_duration = OpusPacketDurationTenthMs(payload) / 10;
+            packet->payload.assign(payload.begin(), payload.end());
+            audio_tenth_ms += OpusPacketDurationTenthMs(payload);
+            if (!pipeline.PushPacketToDecodeQueue(std::move(packet), true)) {
+                fprintf(stderr, "Decode queue rejected packet %u\n", (unsigned)pushed);
+                break;
+            }
+            pushed++;
+        }
+    }
+
+    // Wait for the speaker to drain
+    auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds((int64_t)(audio_tenth_ms / 10 / options.speed) + 5000);
+    while (pipeline.debug_statistics().playback_count < pushed && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    uplink_running = false;
+    uplink.join();
+
+    auto report = pipeline.GetReport();
+    uint32_t played = pipeline.debug_statistics().playback_count;
+    pipeline.Stop();
+    runner.Join();
+
+    printf("Replayed %u packets (%.1f s of audio) from %u files x %d loops at %.1fx\n",
+        (unsigned)pushed, audio_tenth_ms / 10000.0, (unsigned)options.files.size(), options.loops, options.speed);
+    printf("Uplink %u frames, %u packets sent\n", (unsigned)encoded_frames, (unsigned)sent.load());
+    printf("%s", report.ToString().c_str());
+    printf("Pool: %s\n", AudioFramePool::GetInstance().ToString().c_str());
+
+    if (played != pushed) {
+        fprintf(stderr, "Only %u of %u packets were played\n", (unsigned)played, (unsigned)pushed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Writes the animated GIFs used by gif_frame_cache_bench, shaped like the emoji the boards
+play: a looping NETSCAPE2.0 animation, 8-bit global palette, one full-canvas frame per step.
+
+  emoji_64.gif         64x64, 24 frames, transparent background (cached as RGB565A8)
+  emoji_64_opaque.gif  64x64, 24 frames, no transparency (cached as RGB565)
+
+A disc circles a fixed diamond, so consecutive frames differ only around the disc and the
+cache stores small dirty rectangles, as it does for real emoji.
+
+Run from this directory: python3 make_emoji_gif.py
+"""
+import math
+import struct
+
+SIZE = 64
+FRAMES = 24
+DELAY_CS = 6
+
+
+def lzw(pixels, min_size=8):
+    clear, eoi = 1 << min_size, (1 << min_size) + 1
+    table = {bytes([i]): i for i in range(clear)}
+    next_code, size = eoi + 1, min_size + 1
+    out, bitbuf, bits = bytearray(), 0, 0
+
+    def emit(code):
+        nonlocal bitbuf, bits
+        bitbuf |= code << bits
+        bits += size
+        while bits >= 8:
+            out.append(bitbuf & 0xFF)
+            bitbuf >>= 8
+            bits -= 8
+
+    emit(clear)
+    w = b""
+    for p in pixels:
+        wc = w + bytes([p])
+        if wc in table:
+            w = wc
+            continue
+        emit(table[w])
+        if next_code < 4096:
+            table[wc] = next_code
+            next_code += 1
+            if next_code > (1 << size) and size < 12:
+                size += 1
+        else:
+            emit(clear)
+            table = {bytes([i]): i for i in range(clear)}
+            next_code, size = eoi + 1, min_size + 1
+        w = bytes([p])
+    emit(table[w])
+    emit(eoi)
+    if bits:
+        out.append(bitbuf & 0xFF)
+    blocks = bytearray()
+    for i in range(0, len(out), 255):
+        blocks += bytes([len(out[i:i + 255])]) + out[i:i + 255]
+    return bytes([min_size]) + blocks + b"\0"
+
+
+def frame_pixels(f, background):
+    px = bytearray([background]) * (SIZE * SIZE)
+    cx = SIZE / 2 + SIZE / 4 * math.cos(2 * math.pi * f / FRAMES)
+    cy = SIZE / 2 + SIZE / 4 * math.sin(2 * math.pi * f / FRAMES)
+    r = SIZE / 6
+    for y in range(SIZE):
+        for x in range(SIZE):
+            d = math.hypot(x - cx, y - cy)
+            if d < r:
+                px[y * SIZE + x] = 1 + int(d / r * 200)
+            elif abs(x - SIZE / 2) + abs(y - SIZE / 2) < SIZE / 5:
+                px[y * SIZE + x] = 220 + (x * 3 + y) % 30
+    return px
+
+
+def write(path, transparent):
+    palette = bytearray()
+    for i in range(256):
+        palette += bytes([(i * 7) & 255, (i * 13) & 255, (i * 29) & 255])
+    background = 0 if transparent else 255
+    gif = bytearray(b"GIF89a" + struct.pack("<HHBBB", SIZE, SIZE, 0xF7, background, 0) + palette)
+    gif += b"\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00"
+    for f in range(FRAMES):
+        # Transparent: disposal 2 (restore background) + transparent index 0; opaque: disposal 1 (keep)
+        packed = (2 << 2) | 1 if transparent else (1 << 2)
+        gif += b"\x21\xF9\x04" + bytes([packed]) + struct.pack("<H", DELAY_CS) + b"\x00\x00"
+        gif += b"\x2C" + struct.pack("<HHHHB", 0, 0, SIZE, SIZE, 0) + lzw(frame_pixels(f, background))
+    gif += b";"
+    with open(path, "wb") as out:
+        out.write(gif)
+    print(path, len(gif), "bytes")
+
+
+write("emoji_64.gif", True)
+write("emoji_64_opaque.gif", False)
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Writes icy_adts_capture.bin: the body of an Icecast AAC stream as the radio downloader
+receives it with "Icy-MetaData: 1" and icy-metaint 2048.
+
+Layout of the audio bytes (before ICY blocks are inserted):
+  - 150 bytes of the tail of a frame the capture started in, with a false ADTS sync inside
+  - 48 ADTS frames, AAC-LC 44.1 kHz stereo, 160..560 bytes, pseudo-random payload
+  - the first 100 bytes of one more frame (the capture was cut there)
+
+Metadata blocks, in order: a UTF-8 title, two empty blocks, a Latin-1 title, the same
+Latin-1 title again, a title containing quotes followed by StreamUrl, then empty blocks.
+The payload is not real AAC, there is no encoder in the host tests; frame headers,
+sizes and the ICY framing are what IcyMetadataFilter and AacFrameSplitter look at.
+
+Run from this directory: python3 make_icy_adts_capture.py
+"""
+import random
+
+METAINT = 2048
+JUNK = 150
+FRAMES = 48
+
+rng = random.Random(20241017)
+
+
+def adts_frame(length):
+    # Sync, MPEG-4, layer 0, no CRC; AAC-LC, 44.1 kHz (index 4), 2 channels; buffer fullness 0x7FF
+    header = bytes([
+        0xFF, 0xF1,
+        (1 << 6) | (4 << 2) | (2 >> 2),
+        ((2 & 3) << 6) | (length >> 11),
+        (length >> 3) & 0xFF,
+        ((length & 7) << 5) | 0x1F,
+        0xFC,
+    ])
+    return header + bytes(rng.randrange(256) for _ in range(length - len(header)))
+
+
+audio = bytearray(rng.randrange(256) for _ in range(JUNK))
+# False sync in the junk: a valid looking header whose "next frame" is not one
+audio[40:47] = adts_frame(60)[:7]
+for _ in range(FRAMES):
+    audio += adts_frame(rng.randrange(160, 561))
+audio += adts_frame(400)[:100]
+
+
+def block(text):
+    if text is None:
+        return b"\x00"
+    data = text if isinstance(text, bytes) else text.encode("utf-8")
+    padded = data + b"\x00" * (-len(data) % 16)
+    return bytes([len(padded) // 16]) + padded
+
+
+blocks = [
+    "StreamTitle='Sơn Tùng M-TP - Lạc Trôi';",
+    None,
+    None,
+    "StreamTitle='Café Tacvba - Eres';".encode("latin-1"),
+    "StreamTitle='Café Tacvba - Eres';".encode("latin-1"),
+    "StreamTitle='Guns N' Roses - Don't Cry - ';StreamUrl='http://radio.example/now';",
+]
+
+out = bytearray()
+for i in range(0, len(audio), METAINT):
+    chunk = audio[i:i + METAINT]
+    out += chunk
+    if len(chunk) == METAINT:
+        n = i // METAINT
+        out += block(blocks[n] if n < len(blocks) else None)
+
+with open("icy_adts_capture.bin", "wb") as f:
+    f.write(out)
+print(len(audio), "audio bytes,", len(out), "bytes written")
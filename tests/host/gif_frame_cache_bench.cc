@@ -0,0 +1,192 @@
+// GifFrameCache: records the first loop of each GIF the way LvglGif does, checks that the
+// cached replay matches gifdec frame for frame, then times LZW decode + render against
+// the cached replay. Also checks that the cache key tells apart GIFs mapped at the same
+// address and that Clear() drops everything.
+//
+//   gif_frame_cache_bench [file.gif ...]   (default: fixtures/emoji_64*.gif)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gif_frame_cache.h"
+#include "gifdec.h"
+#include "host_test.h"
+
+static std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::vector<uint8_t> data;
+    FILE* fp = fopen(path.c_str(), "rb");
+    CHECK(fp != nullptr);
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(fp);
+    return data;
+}
+
+static lv_img_dsc_t Descriptor(const std::vector<uint8_t>& data) {
+    lv_img_dsc_t dsc = {};
+    dsc.data = data.data();
+    dsc.data_size = data.size();
+    return dsc;
+}
+
+static double NowUs() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Advances index to the next frame shown and returns the cached rectangle that gets there
+static const GifFrameCache::Frame& NextFrame(const GifFrameCache::Entry& entry, size_t& index) {
+    if (++index < entry.frames.size()) {
+        return entry.frames[index];
+    }
+    index = 0;
+    return entry.wrap;
+}
+
+// data stays alive until the end of main(), as a memory mapped partition would
+static void BenchGif(const std::string& path, const std::vector<uint8_t>& data) {
+    auto dsc = Descriptor(data);
+    auto key = GifFrameCache::MakeKey(&dsc);
+    auto& cache = GifFrameCache::GetInstance();
+
+    gd_GIF* gif = gd_open_gif_data(data.data());
+    CHECK(gif != nullptr);
+    CHECK_EQ(key.width, gif->width);
+    CHECK_EQ(key.height, gif->height);
+    const size_t canvas_bytes = (size_t)gif->width * gif->height * 4;
+
+    // First loop, stepped like LvglGif::NextFrame(): record every canvas, keep a copy for the
+    // comparison, finish on the first frame of the second loop
+    auto recorder = cache.StartRecording(key, gif->width, gif->height, gif->loop_count);
+    CHECK(recorder != nullptr);
+    std::vector<std::vector<uint8_t>> decoded;
+    std::shared_ptr<GifFrameCache::Entry> recorded;
+    while (true) {
+        uint32_t position = gif->f_rw_p;
+        int has_next = gd_get_frame(gif);
+        CHECK(has_next > 0);
+        bool wrapped = gif->f_rw_p < position;
+        gd_render_frame(gif, gif->canvas);
+        if (wrapped) {
+            recorded = recorder->Finish(gif->canvas, gif->gce.delay * 10);
+            break;
+        }
+        recorder->AddFrame(gif->canvas, gif->gce.delay * 10);
+        decoded.emplace_back(gif->canvas, gif->canvas + canvas_bytes);
+    }
+    CHECK(recorded != nullptr);
+    cache.Insert(recorded);
+    auto entry = cache.Find(key);
+    CHECK(entry == recorded);
+    CHECK_EQ(entry->frames.size(), decoded.size());
+
+    // Three cached loops must show exactly what gifdec rendered
+    std::vector<uint8_t> canvas(entry->canvas_size());
+    std::vector<uint8_t> expected(entry->canvas_size());
+    entry->Apply(entry->frames[0], canvas.data());
+    size_t index = 0;
+    for (size_t i = 0; i < decoded.size() * 3; i++) {
+        entry->Load(decoded[index].data(), expected.data());
+        CHECK(canvas == expected);
+        entry->Apply(NextFrame(*entry, index), canvas.data());
+    }
+
+    // Decode timing keeps looping past the loop count
+    gd_rewind(gif);
+    gif->loop_count = 0;
+    const size_t frames = decoded.size() * 20;
+    double start = NowUs();
+    for (size_t i = 0; i < frames; i++) {
+        gd_get_frame(gif);
+        gd_render_frame(gif, gif->canvas);
+    }
+    double decode_us = (NowUs() - start) / frames;
+
+    start = NowUs();
+    for (size_t i = 0; i < frames; i++) {
+        entry->Apply(NextFrame(*entry, index), canvas.data());
+    }
+    double cached_us = (NowUs() - start) / frames;
+
+    printf("%s: %ux%u, %u frames, %s, %u KB cached\n  decode + render %.1f us/frame, cached replay %.2f us/frame (%.0fx)\n",
+        path.c_str(), gif->width, gif->height, (unsigned)decoded.size(), entry->has_alpha ? "RGB565A8" : "RGB565",
+        (unsigned)(entry->bytes / 1024), decode_us, cached_us, decode_us / cached_us);
+    gd_close_gif(gif);
+}
+
+// An assets update can map another GIF at the same address: only the same pointer, size and
+// dimensions may hit, and Clear() (called by Assets::Apply) drops whatever is left
+static void TestKeyAfterAssetsUpdate(const std::vector<uint8_t>& first, const std::vector<uint8_t>& second) {
+    auto& cache = GifFrameCache::GetInstance();
+
+    // One mapping that both "partitions" are copied into, so the data pointer stays the same
+    std::vector<uint8_t> mapped(std::max(first.size(), second.size()) + 1);
+    memcpy(mapped.data(), first.data(), first.size());
+    lv_img_dsc_t dsc = {};
+    dsc.data = mapped.data();
+    dsc.data_size = first.size();
+    auto old_key = GifFrameCache::MakeKey(&dsc);
+    CHECK(cache.Find(old_key) == nullptr);   // Recorded from another buffer
+    auto recorder = cache.StartRecording(old_key, old_key.width, old_key.height, 0);
+    CHECK(recorder != nullptr);
+    std::vector<uint8_t> blank((size_t)old_key.width * old_key.height * 4, 0);
+    recorder->AddFrame(blank.data(), 60);
+    cache.Insert(recorder->Finish(blank.data(), 60));
+    CHECK(cache.Find(old_key) != nullptr);
+
+    // Another GIF at the same address with a different size
+    memcpy(mapped.data(), second.data(), second.size());
+    mapped[second.size()] = ';';
+    dsc.data_size = second.size() + 1;
+    auto resized = GifFrameCache::MakeKey(&dsc);
+    CHECK(resized.data == old_key.data);
+    CHECK(cache.Find(resized) == nullptr);
+
+    // Same address and size, different logical screen in the header
+    memcpy(mapped.data(), first.data(), first.size());
+    mapped[6] = (uint8_t)(old_key.width / 2);
+    mapped[7] = 0;
+    dsc.data_size = first.size();
+    auto narrower = GifFrameCache::MakeKey(&dsc);
+    CHECK_EQ(narrower.width, old_key.width / 2);
+    CHECK(cache.Find(narrower) == nullptr);
+
+    // Same address, size and dimensions cannot be told apart: Assets::Apply() clears the cache
+    mapped[6] = (uint8_t)old_key.width;
+    mapped[7] = (uint8_t)(old_key.width >> 8);
+    CHECK(cache.Find(GifFrameCache::MakeKey(&dsc)) != nullptr);
+    cache.Clear();
+    CHECK(cache.Find(old_key) == nullptr);
+    CHECK(cache.ToString().find("gifs=0 used=0KB") != std::string::npos);
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        files.push_back(XIAOZHI_FIXTURES_DIR "/emoji_64.gif");
+        files.push_back(XIAOZHI_FIXTURES_DIR "/emoji_64_opaque.gif");
+    }
+
+    std::vector<std::vector<uint8_t>> gifs;
+    for (auto& file : files) {
+        gifs.push_back(ReadFile(file));
+    }
+
+    GifFrameCache::GetInstance().SetBudget(4 * 1024 * 1024);
+    for (size_t i = 0; i < files.size(); i++) {
+        BenchGif(files[i], gifs[i]);
+    }
+    printf("%s\n", GifFrameCache::GetInstance().ToString().c_str());
+    CHECK(GifFrameCache::GetInstance().ToString().find("gifs=" + std::to_string(files.size())) == 0);
+    TestKeyAfterAssetsUpdate(gifs.front(), gifs.back());
+    printf("[ OK ] TestKeyAfterAssetsUpdate\n");
+    return 0;
+}
@@ -0,0 +1,254 @@
+// GlyphCache: rows copied by stride both ways, LRU order and eviction, the budget / 8 size
+// cap, Remove(font), shrinking the budget, and a cached glyph whose size no longer matches
+// the draw buffer. Built with ASan so a copy past a row or a leaked bitmap fails the test.
+#include <cstring>
+#include <vector>
+
+#include "glyph_cache.h"
+#include "host_test.h"
+
+static lv_font_t font_a;
+static lv_font_t font_b;
+
+static constexpr uint8_t kPadding = 0xEE;
+
+// An A8 draw buffer whose rows are stride bytes apart, padding filled with kPadding
+struct Glyph {
+    std::vector<uint8_t> pixels;
+    lv_draw_buf_t buf = {};
+
+    Glyph(int w, int h, int stride, lv_color_format_t cf = LV_COLOR_FORMAT_A8) : pixels((size_t)stride * h, kPadding) {
+        buf.header.cf = cf;
+        buf.header.w = w;
+        buf.header.h = h;
+        buf.header.stride = stride;
+        buf.data_size = pixels.size();
+        buf.data = pixels.data();
+    }
+
+    // What the font would render for glyph_id
+    Glyph& Render(uint32_t glyph_id) {
+        for (int y = 0; y < buf.header.h; y++) {
+            for (int x = 0; x < buf.header.w; x++) {
+                pixels[y * buf.header.stride + x] = (uint8_t)(glyph_id * 31 + y * 7 + x);
+            }
+        }
+        return *this;
+    }
+
+    bool Shows(uint32_t glyph_id) const {
+        for (int y = 0; y < buf.header.h; y++) {
+            for (int x = 0; x < buf.header.stride; x++) {
+                uint8_t expected = x < buf.header.w ? (uint8_t)(glyph_id * 31 + y * 7 + x) : kPadding;
+                if (pixels[y * buf.header.stride + x] != expected) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+static GlyphCache& Fresh(size_t budget) {
+    auto& cache = GlyphCache::GetInstance();
+    cache.SetBudget(0);
+    CHECK_EQ(cache.used(), 0u);
+    cache.SetBudget(budget);
+    return cache;
+}
+
+static void Insert(const lv_font_t* font, uint32_t glyph_id, int w = 10, int h = 10) {
+    Glyph glyph(w, h, w + 3);
+    GlyphCache::GetInstance().Insert(font, glyph_id, &glyph.Render(glyph_id).buf);
+}
+
+static bool Cached(const lv_font_t* font, uint32_t glyph_id, int w = 10, int h = 10) {
+    Glyph glyph(w, h, w + 5);
+    if (!GlyphCache::GetInstance().Lookup(font, glyph_id, &glyph.buf)) {
+        return false;
+    }
+    CHECK(glyph.Shows(glyph_id));
+    return true;
+}
+
+static void TestStrideCopy() {
+    auto& cache = Fresh(16 * 1024);
+    uint32_t hits = cache.hits();
+    uint32_t misses = cache.misses();
+
+    // Rendered with padded rows, stored packed
+    Glyph rendered(7, 5, 8);
+    cache.Insert(&font_a, 'A', &rendered.Render('A').buf);
+    CHECK_EQ(cache.used(), 7u * 5);
+
+    // Copied back into wider rows: padding left alone
+    Glyph wide(7, 5, 12);
+    CHECK(cache.Lookup(&font_a, 'A', &wide.buf));
+    CHECK(wide.Shows('A'));
+
+    // And into rows with no padding at all
+    Glyph tight(7, 5, 7);
+    CHECK(cache.Lookup(&font_a, 'A', &tight.buf));
+    CHECK(tight.Shows('A'));
+
+    Glyph missing(7, 5, 8);
+    CHECK(!cache.Lookup(&font_a, 'B', &missing.buf));
+    CHECK(missing.pixels == std::vector<uint8_t>(missing.pixels.size(), kPadding));
+    CHECK(!cache.Lookup(&font_b, 'A', &missing.buf));
+
+    CHECK_EQ(cache.hits() - hits, 2u);
+    CHECK_EQ(cache.misses() - misses, 2u);
+
+    // Inserting a glyph that is already cached changes nothing
+    Glyph again(7, 5, 8);
+    cache.Insert(&font_a, 'A', &again.buf);
+    CHECK_EQ(cache.used(), 7u * 5);
+    CHECK(Cached(&font_a, 'A', 7, 5));
+}
+
+// Eight 100 byte glyphs fill an 800 byte budget; a hit moves a glyph to the front
+static void TestLruEviction() {
+    auto& cache = Fresh(800);
+    for (uint32_t id = 0; id < 8; id++) {
+        Insert(&font_a, id);
+    }
+    CHECK_EQ(cache.used(), 800u);
+
+    CHECK(Cached(&font_a, 0));          // Order, oldest first: 1 2 3 4 5 6 7 0
+    Insert(&font_a, 8);                 // Evicts 1
+    CHECK_EQ(cache.used(), 800u);
+    CHECK(!Cached(&font_a, 1));
+
+    CHECK(Cached(&font_a, 2));          // 3 4 5 6 7 0 8 2
+    Insert(&font_a, 9);                 // Evicts 3
+    Insert(&font_a, 10);                // Evicts 4
+    CHECK(!Cached(&font_a, 3));
+    CHECK(!Cached(&font_a, 4));
+    for (uint32_t id : {0, 2, 5, 6, 7, 8, 9, 10}) {
+        CHECK(Cached(&font_a, id));
+    }
+
+    // A larger glyph evicts as many as it needs
+    Fresh(1600);
+    for (uint32_t id = 0; id < 16; id++) {
+        Insert(&font_a, id);
+    }
+    Insert(&font_a, 16, 15, 10);        // 150 bytes: evicts 0 and 1
+    CHECK(!Cached(&font_a, 0));
+    CHECK(!Cached(&font_a, 1));
+    CHECK(Cached(&font_a, 2));
+    CHECK(Cached(&font_a, 16, 15, 10));
+    CHECK_EQ(cache.used(), 14u * 100 + 150);
+}
+
+static void TestSizeCap() {
+    auto& cache = Fresh(800);
+
+    // budget / 8 = 100 bytes
+    Insert(&font_a, 1, 10, 10);
+    CHECK(Cached(&font_a, 1));
+    Insert(&font_a, 2, 101, 1);
+    Insert(&font_a, 3, 11, 10);
+    CHECK(!Cached(&font_a, 2, 101, 1));
+    CHECK(!Cached(&font_a, 3, 11, 10));
+    CHECK_EQ(cache.used(), 100u);
+
+    // Empty glyphs (space) and other formats are not cached
+    Insert(&font_a, ' ', 0, 12);
+    CHECK(!Cached(&font_a, ' ', 0, 12));
+    Glyph i1(8, 8, 1, LV_COLOR_FORMAT_I1);
+    cache.Insert(&font_a, 4, &i1.buf);
+    CHECK_EQ(cache.used(), 100u);
+
+    // Budget 0 disables the cache
+    cache.SetBudget(0);
+    Insert(&font_a, 5, 1, 1);
+    CHECK(!Cached(&font_a, 5, 1, 1));
+    CHECK_EQ(cache.used(), 0u);
+}
+
+static void TestRemoveFont() {
+    auto& cache = Fresh(16 * 1024);
+    for (uint32_t id = 0; id < 6; id++) {
+        Insert(&font_a, id);
+        Insert(&font_b, id, 8, 8);
+    }
+    CHECK_EQ(cache.used(), 6u * 100 + 6 * 64);
+
+    cache.Remove(&font_a);
+    CHECK_EQ(cache.used(), 6u * 64);
+    for (uint32_t id = 0; id < 6; id++) {
+        CHECK(!Cached(&font_a, id));
+        CHECK(Cached(&font_b, id, 8, 8));
+    }
+
+    // The same font pointer reused for a new font starts empty and can be filled again
+    Insert(&font_a, 0);
+    CHECK(Cached(&font_a, 0));
+    cache.Remove(&font_b);
+    cache.Remove(&font_b);
+    CHECK_EQ(cache.used(), 100u);
+}
+
+static void TestSetBudgetShrink() {
+    auto& cache = Fresh(800);
+    for (uint32_t id = 0; id < 8; id++) {
+        Insert(&font_a, id);
+    }
+    CHECK(Cached(&font_a, 1));          // Oldest first: 0 2 3 4 5 6 7 1
+
+    cache.SetBudget(350);
+    CHECK_EQ(cache.budget(), 350u);
+    CHECK_EQ(cache.used(), 300u);
+    for (uint32_t id : {0, 2, 3, 4, 5}) {
+        CHECK(!Cached(&font_a, id));
+    }
+    for (uint32_t id : {6, 7, 1}) {
+        CHECK(Cached(&font_a, id));
+    }
+
+    // The cap follows the budget: 43 bytes now
+    Insert(&font_a, 20, 6, 7);
+    Insert(&font_a, 21, 6, 8);
+    CHECK(Cached(&font_a, 20, 6, 7));
+    CHECK(!Cached(&font_a, 21, 6, 8));
+
+    // Growing back keeps what is cached
+    cache.SetBudget(800);
+    CHECK_EQ(cache.used(), 342u);
+}
+
+// The cached bitmap does not fit the buffer LVGL prepared (the font was reloaded with
+// other metrics under the same pointer): a miss, and the stale glyph is dropped
+static void TestSizeMismatch() {
+    auto& cache = Fresh(16 * 1024);
+    Insert(&font_a, 'x');
+    Insert(&font_a, 'y');
+    uint32_t misses = cache.misses();
+
+    Glyph taller(10, 11, 12);
+    CHECK(!cache.Lookup(&font_a, 'x', &taller.buf));
+    CHECK(taller.pixels == std::vector<uint8_t>(taller.pixels.size(), kPadding));
+    CHECK_EQ(cache.used(), 100u);
+    CHECK(!Cached(&font_a, 'x'));
+
+    Glyph narrower(9, 10, 12);
+    CHECK(!cache.Lookup(&font_a, 'y', &narrower.buf));
+    CHECK_EQ(cache.used(), 0u);
+    CHECK_EQ(cache.misses() - misses, 3u);
+
+    // Rendered again at the new size, cached again
+    Insert(&font_a, 'x', 10, 11);
+    CHECK(Cached(&font_a, 'x', 10, 11));
+}
+
+int main() {
+    RUN_TEST(TestStrideCopy);
+    RUN_TEST(TestLruEviction);
+    RUN_TEST(TestSizeCap);
+    RUN_TEST(TestRemoveFont);
+    RUN_TEST(TestSetBudgetShrink);
+    RUN_TEST(TestSizeMismatch);
+    GlyphCache::GetInstance().SetBudget(0);
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// Tiny assertion helpers for the host tests, a failed check prints where and exits 1
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                          \
+    do {                                                                                        \
+        auto _a = (a);                                                                          \
+        auto _b = (b);                                                                          \
+        if (!(_a == _b)) {                                                                      \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", __FILE__,      \
+                __LINE__, #a, #b, (long long)_a, (long long)_b);                                \
+            exit(1);                                                                            \
+        }                                                                                       \
+    } while (0)
+
+#define RUN_TEST(fn)                      \
+    do {                                  \
+        fn();                             \
+        printf("[ OK ] %s\n", #fn);       \
+    } while (0)
+
+#endif // HOST_TEST_H
@@ -0,0 +1,192 @@
+// IcyMetadataFilter + AacFrameSplitter on a captured Icecast AAC stream body
+// (fixtures/icy_adts_capture.bin, see make_icy_adts_capture.py for its layout), fed in
+// read sizes from 1 byte to the whole file like the radio downloader and play loop do
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "aac_frame_splitter.h"
+#include "host_test.h"
+#include "icy_metadata.h"
+
+static constexpr size_t kMetaint = 2048;
+static constexpr size_t kJunkBytes = 150;     // Tail of the frame the capture started in
+static constexpr size_t kFrames = 48;
+static constexpr size_t kCutFrameBytes = 100;  // Last frame, cut by the end of the capture
+static constexpr size_t kMaxFrameBytes = 2048;
+
+static const char* kTitles[] = {
+    "Sơn Tùng M-TP - Lạc Trôi",
+    "Café Tacvba - Eres",             // Sent as Latin-1
+    "Guns N' Roses - Don't Cry",
+};
+
+static std::vector<uint8_t> LoadCapture() {
+    std::vector<uint8_t> data;
+    FILE* fp = fopen(XIAOZHI_FIXTURES_DIR "/icy_adts_capture.bin", "rb");
+    CHECK(fp != nullptr);
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(fp);
+    return data;
+}
+
+// Runs the filter over the capture in reads of read_size bytes, collecting titles as the
+// downloader does after each read
+static std::vector<uint8_t> FilterCapture(const std::vector<uint8_t>& capture, size_t read_size,
+                                          std::vector<std::string>& titles) {
+    IcyMetadataFilter filter;
+    filter.Reset(kMetaint);
+    std::vector<uint8_t> audio;
+    for (size_t pos = 0; pos < capture.size(); pos += read_size) {
+        size_t n = std::min(read_size, capture.size() - pos);
+        std::vector<uint8_t> read(capture.begin() + pos, capture.begin() + pos + n);
+        size_t kept = filter.Filter(read.data(), read.size());
+        CHECK(kept <= n);
+        audio.insert(audio.end(), read.begin(), read.begin() + kept);
+        std::string title;
+        if (filter.TakeTitle(title)) {
+            titles.push_back(title);
+        }
+    }
+    return audio;
+}
+
+struct SplitResult {
+    std::vector<size_t> frames;    // Lengths
+    size_t skipped_before_first = 0;
+    size_t skipped_total = 0;
+    int sample_rate = 0;
+    int channels = 0;
+};
+
+// The play loop: the readable span grows by `step` bytes per wakeup, eos once everything
+// has arrived
+static SplitResult Split(const std::vector<uint8_t>& audio, size_t step) {
+    SplitResult result;
+    AacFrameSplitter splitter(kMaxFrameBytes);
+    size_t pos = 0;
+    size_t arrived = std::min(step, audio.size());
+    while (true) {
+        bool eos = arrived == audio.size();
+        size_t length = 0;
+        auto split = splitter.Next(audio.data() + pos, arrived - pos, eos, length);
+        if (split == AacFrameSplitter::Result::NeedMore) {
+            if (eos) {
+                break;
+            }
+            arrived = std::min(arrived + step, audio.size());
+            continue;
+        }
+        CHECK(length > 0 && pos + length <= arrived);
+        if (split == AacFrameSplitter::Result::Skip) {
+            if (result.frames.empty()) {
+                result.skipped_before_first += length;
+            }
+            result.skipped_total += length;
+        } else {
+            CHECK(splitter.locked());
+            result.frames.push_back(length);
+            result.sample_rate = splitter.sample_rate();
+            result.channels = splitter.channels();
+        }
+        pos += length;
+    }
+    CHECK_EQ(pos, audio.size());
+    return result;
+}
+
+static void TestIcyFilter() {
+    auto capture = LoadCapture();
+    std::vector<std::string> titles;
+    auto reference = FilterCapture(capture, 4096, titles);
+
+    // Every audio byte survives and no metadata byte does, whatever the read size
+    const size_t read_sizes[] = {1, 3, 16, 511, kMetaint, kMetaint + 1, 8192};
+    for (size_t read_size : read_sizes) {
+        std::vector<std::string> read_titles;
+        auto audio = FilterCapture(capture, read_size, read_titles);
+        CHECK(audio == reference);
+        // Reads no longer than metaint see every title change
+        if (read_size <= kMetaint + 1) {
+            CHECK_EQ(read_titles.size(), 3u);
+            for (size_t i = 0; i < read_titles.size(); i++) {
+                CHECK(read_titles[i] == kTitles[i]);
+            }
+        }
+    }
+
+    // One read of the whole capture still ends on the latest title
+    std::vector<std::string> whole_titles;
+    auto whole = FilterCapture(capture, capture.size(), whole_titles);
+    CHECK(whole == reference);
+    CHECK_EQ(whole_titles.size(), 1u);
+    CHECK(whole_titles[0] == kTitles[2]);
+
+    // No metaint: pass-through
+    IcyMetadataFilter passthrough;
+    passthrough.Reset(0);
+    std::vector<uint8_t> copy = capture;
+    CHECK_EQ(passthrough.Filter(copy.data(), copy.size()), capture.size());
+    CHECK(copy == capture);
+}
+
+static void TestAdtsSplit() {
+    auto capture = LoadCapture();
+    std::vector<std::string> titles;
+    auto audio = FilterCapture(capture, 4096, titles);
+
+    auto reference = Split(audio, audio.size());
+    CHECK_EQ(reference.frames.size(), kFrames);
+    // The false sync in the leading junk is rejected by the next-header check
+    CHECK_EQ(reference.skipped_before_first, kJunkBytes);
+    CHECK_EQ(reference.skipped_total, kJunkBytes + kCutFrameBytes);
+    CHECK_EQ(reference.sample_rate, 44100);
+    CHECK_EQ(reference.channels, 2);
+
+    const size_t steps[] = {1, 7, 100, 1000, 4096};
+    for (size_t step : steps) {
+        auto result = Split(audio, step);
+        CHECK(result.frames == reference.frames);
+        CHECK_EQ(result.skipped_total, reference.skipped_total);
+    }
+
+    // Joining mid-stream, e.g. after a reconnect: resync on the next confirmed frame
+    size_t cut = kJunkBytes + reference.frames[0] + reference.frames[1] / 2;
+    std::vector<uint8_t> joined(audio.begin() + cut, audio.end());
+    auto rejoined = Split(joined, 512);
+    CHECK_EQ(rejoined.frames.size(), kFrames - 2);
+    CHECK_EQ(rejoined.skipped_before_first, reference.frames[1] - reference.frames[1] / 2);
+}
+
+// LOAS/LATM sync (0x2B7) with 13-bit mux length, confirmed by the next header too
+static void TestLoasSplit() {
+    std::vector<uint8_t> stream = {0x12, 0x34};
+    for (int i = 0; i < 5; i++) {
+        size_t mux_length = 100 + i * 10;
+        stream.push_back(0x56);
+        stream.push_back(0xE0 | (uint8_t)(mux_length >> 8));
+        stream.push_back((uint8_t)mux_length);
+        stream.insert(stream.end(), mux_length, (uint8_t)i);
+    }
+    auto result = Split(stream, 64);
+    CHECK_EQ(result.frames.size(), 5u);
+    CHECK_EQ(result.skipped_before_first, 2u);
+    CHECK_EQ(result.frames[4], 3u + 140u);
+
+    AacFrameSplitter splitter(kMaxFrameBytes);
+    size_t length = 0;
+    CHECK(splitter.Next(stream.data() + 2, stream.size() - 2, true, length) == AacFrameSplitter::Result::Frame);
+    CHECK(splitter.framing() == AacFrameSplitter::Framing::Loas);
+}
+
+int main() {
+    RUN_TEST(TestIcyFilter);
+    RUN_TEST(TestAdtsSplit);
+    RUN_TEST(TestLoasSplit);
+    return 0;
+}
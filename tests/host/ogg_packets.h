@@ -0,0 +1,87 @@
+#ifndef HOST_OGG_PACKETS_H
+#define HOST_OGG_PACKETS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * Minimal Ogg page walker for the host benchmarks: returns the Opus audio packets of a
+ * captured .ogg / .opus file (OpusHead and OpusTags are dropped). Only the first logical
+ * stream is read, which is all the assets and capture fixtures contain.
+ */
+inline bool ReadOggOpusPackets(const std::string& path, std::vector<std::vector<uint8_t>>& packets) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(fp);
+
+    std::vector<uint8_t> packet;
+    size_t pos = 0;
+    int index = 0;
+    while (pos + 27 <= data.size()) {
+        if (memcmp(&data[pos], "OggS", 4) != 0) {
+            return false;
+        }
+        int segments = data[pos + 26];
+        size_t body = pos + 27 + segments;
+        if (body > data.size()) {
+            return false;
+        }
+        for (int i = 0; i < segments; i++) {
+            uint8_t lace = data[pos + 27 + i];
+            if (body + lace > data.size()) {
+                return false;
+            }
+            packet.insert(packet.end(), data.begin() + body, data.begin() + body + lace);
+            body += lace;
+            if (lace < 255) {
+                // Packet 0 = OpusHead, 1 = OpusTags
+                if (index++ >= 2) {
+                    packets.push_back(packet);
+                }
+                packet.clear();
+            }
+        }
+        pos = body;
+    }
+    return true;
+}
+
+// Duration of an Opus packet in 1/10 ms, from its TOC byte (RFC 6716 section 3.1)
+inline int OpusPacketDurationTenthMs(const std::vector<uint8_t>& packet) {
+    if (packet.empty()) {
+        return 0;
+    }
+    static const int kFrameTenthMs[32] = {
+        100, 200, 400, 600, 100, 200, 400, 600, 100, 200, 400, 600,     // SILK
+        100, 200, 100, 200,                                             // Hybrid
+        25, 50, 100, 200, 25, 50, 100, 200, 25, 50, 100, 200, 25, 50, 100, 200,  // CELT
+    };
+    uint8_t toc = packet[0];
+    int frames;
+    switch (toc & 3) {
+        case 0:
+            frames = 1;
+            break;
+        case 1:
+        case 2:
+            frames = 2;
+            break;
+        default:
+            frames = packet.size() > 1 ? packet[1] & 0x3F : 0;
+            break;
+    }
+    return kFrameTenthMs[toc >> 3] * frames;
+}
+
+#endif // HOST_OGG_PACKETS_H
@@ -0,0 +1,251 @@
+// OtaDownloader::Run against a scripted HTTP server (stubs/http.h, stubs/board.h): drops in
+// the middle of a block, 206 resumes, servers that ignore Range, a body that changes size
+// and giving up. What reaches the WriteCallback must be the body, byte for byte, at
+// consecutive offsets.
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "host_test.h"
+#include "ota_downloader.h"
+
+static constexpr size_t kBody = 700 * 1024;
+static constexpr size_t kBlock = OtaDownloader::kBlockSize;
+
+// How the server answers one connection; the last one repeats
+struct Reply {
+    bool open = true;              // false: connection refused
+    bool honour_range = true;      // false: 200 with the whole body even if Range was sent
+    size_t drop_after = SIZE_MAX;  // Body bytes sent before the connection drops
+    size_t body_length = 0;        // Reported length when not 0, e.g. a file that changed
+    size_t chunk = 1460;           // Largest Read() result
+};
+
+class FakeServer;
+
+class FakeHttp : public Http {
+public:
+    explicit FakeHttp(FakeServer& server) : server_(server) {}
+
+    void SetHeader(const std::string& key, const std::string& value) override {
+        if (key == "Range") {
+            range_ = value;
+        }
+    }
+    bool Open(const std::string& method, const std::string& url) override;
+    void Close() override {}
+    int Read(char* buffer, size_t buffer_size) override;
+    int GetStatusCode() override { return status_; }
+    size_t GetBodyLength() override { return body_length_; }
+
+private:
+    FakeServer& server_;
+    std::string range_;
+    Reply reply_;
+    int status_ = 0;
+    size_t body_length_ = 0;
+    size_t position_ = 0;          // Next body offset to send
+    size_t sent_ = 0;
+};
+
+class FakeServer : public NetworkInterface {
+public:
+    FakeServer(const std::vector<uint8_t>& body, std::deque<Reply> replies) : body(body), replies(replies) {}
+
+    std::unique_ptr<Http> CreateHttp(int) override { return std::make_unique<FakeHttp>(*this); }
+
+    Reply NextReply() {
+        Reply reply = replies.front();
+        if (replies.size() > 1) {
+            replies.pop_front();
+        }
+        return reply;
+    }
+
+    const std::vector<uint8_t>& body;
+    std::deque<Reply> replies;
+    std::vector<std::string> ranges;   // Range header of every open, "" if none
+    int opens = 0;
+};
+
+bool FakeHttp::Open(const std::string&, const std::string&) {
+    server_.opens++;
+    server_.ranges.push_back(range_);
+    reply_ = server_.NextReply();
+    if (!reply_.open) {
+        return false;
+    }
+    size_t start = 0;
+    if (!range_.empty() && reply_.honour_range) {
+        CHECK(range_.rfind("bytes=", 0) == 0 && range_.back() == '-');
+        start = std::stoul(range_.substr(6));
+        status_ = 206;
+    } else {
+        status_ = 200;
+    }
+    position_ = start;
+    body_length_ = reply_.body_length ? reply_.body_length - start : server_.body.size() - start;
+    return true;
+}
+
+int FakeHttp::Read(char* buffer, size_t buffer_size) {
+    if (sent_ >= reply_.drop_after) {
+        return -1;
+    }
+    size_t length = std::min({buffer_size, reply_.chunk, reply_.drop_after - sent_, server_.body.size() - position_});
+    if (length == 0) {
+        return 0;
+    }
+    memcpy(buffer, server_.body.data() + position_, length);
+    position_ += length;
+    sent_ += length;
+    return (int)length;
+}
+
+struct Result {
+    bool ok = false;
+    std::vector<uint8_t> flash;
+    int resumes = 0;
+};
+
+static std::vector<uint8_t> MakeBody(size_t size) {
+    std::vector<uint8_t> body(size);
+    uint32_t seed = 0x1234;
+    for (auto& byte : body) {
+        seed = seed * 1664525 + 1013904223;
+        byte = seed >> 24;
+    }
+    return body;
+}
+
+static Result Download(FakeServer& server, size_t max_size = 1024 * 1024) {
+    Board::GetInstance().SetNetwork(&server);
+    Result result;
+    OtaDownloader downloader("http://ota.example/firmware.bin", max_size);
+    downloader.OnWrite([&](size_t offset, const uint8_t* data, size_t length) {
+        // Flash is written strictly in order
+        CHECK_EQ(offset, result.flash.size());
+        CHECK(length > 0 && length <= kBlock);
+        result.flash.insert(result.flash.end(), data, data + length);
+        return true;
+    });
+    downloader.OnProgress([&](const DownloadProgress& progress) { result.resumes = progress.resumes; });
+    result.ok = downloader.Run();
+    return result;
+}
+
+static void TestStraightDownload() {
+    auto body = MakeBody(kBody);
+    FakeServer server(body, {{}});
+    auto result = Download(server);
+    CHECK(result.ok);
+    CHECK(result.flash == body);
+    CHECK_EQ(server.opens, 1);
+    CHECK(server.ranges[0].empty());
+}
+
+// The drop lands in the middle of the third block: the resume offset counts the bytes of
+// the partly filled block too, and the 206 body continues exactly there
+static void TestResumeFromPartialBlock() {
+    auto body = MakeBody(kBody);
+    const size_t drop = 2 * kBlock + 5000;
+    FakeServer server(body, {{.drop_after = drop}, {.drop_after = 3 * kBlock + 77}, {}});
+    auto result = Download(server);
+    CHECK(result.ok);
+    CHECK(result.flash == body);
+    CHECK_EQ(server.opens, 3);
+    CHECK(server.ranges[1] == "bytes=" + std::to_string(drop) + "-");
+    CHECK(server.ranges[2] == "bytes=" + std::to_string(drop + 3 * kBlock + 77) + "-");
+    CHECK_EQ(result.resumes, 2);
+}
+
+// A 200 to a Range request restarts the body: what was already received is dropped with
+// the memmove inside the block, across several reads and ending in the middle of one
+static void TestServerIgnoresRange() {
+    auto body = MakeBody(kBody);
+    const size_t drop = kBlock + 3333;
+    for (size_t chunk : {(size_t)1000, (size_t)1460, kBlock}) {
+        FakeServer server(body, {{.drop_after = drop, .chunk = chunk}, {.honour_range = false, .chunk = chunk}});
+        auto result = Download(server);
+        CHECK(result.ok);
+        CHECK(result.flash == body);
+        CHECK_EQ(server.opens, 2);
+        CHECK(server.ranges[1] == "bytes=" + std::to_string(drop) + "-");
+    }
+
+    // Dropped again while still skipping: the next attempt skips from the same offset
+    FakeServer server(body, {{.drop_after = drop}, {.honour_range = false, .drop_after = drop / 2}, {.honour_range = false}});
+    auto result = Download(server);
+    CHECK(result.ok);
+    CHECK(result.flash == body);
+    CHECK(server.ranges[2] == server.ranges[1]);
+}
+
+static void TestBodyLengthChanges() {
+    auto body = MakeBody(kBody);
+    // The full body after a drop reports another size: the file changed, abort
+    {
+        FakeServer server(body, {{.drop_after = 3 * kBlock}, {.honour_range = false, .body_length = kBody + 1}});
+        auto result = Download(server);
+        CHECK(!result.ok);
+        CHECK_EQ(server.opens, 2);
+        CHECK(result.flash.size() <= 3 * kBlock);
+        CHECK(memcmp(result.flash.data(), body.data(), result.flash.size()) == 0);
+    }
+    // The 206 range does not end where the first reply said the body ends
+    {
+        FakeServer server(body, {{.drop_after = 3 * kBlock}, {.body_length = kBody - 10}});
+        auto result = Download(server);
+        CHECK(!result.ok);
+        CHECK_EQ(server.opens, 2);
+    }
+    // Too large for the partition
+    {
+        FakeServer server(body, {{}});
+        auto result = Download(server, kBody - 1);
+        CHECK(!result.ok);
+        CHECK(result.flash.empty());
+    }
+}
+
+static void TestGiveUp() {
+    auto body = MakeBody(kBody);
+    // After a drop, kMaxFailures attempts in a row without a byte: give up
+    {
+        FakeServer server(body, {{.drop_after = 100000}, {.open = false}});
+        auto result = Download(server);
+        CHECK(!result.ok);
+        CHECK_EQ(server.opens, 1 + OtaDownloader::kMaxFailures);
+    }
+    // Connections that accept and drop without sending count the same
+    {
+        FakeServer server(body, {{.drop_after = 100000}, {.drop_after = 0}});
+        auto result = Download(server);
+        CHECK(!result.ok);
+        CHECK_EQ(server.opens, 1 + OtaDownloader::kMaxFailures);
+    }
+    // Any progress resets the count: a server that drops every 20 KB still finishes
+    {
+        std::deque<Reply> replies;
+        for (int i = 0; i < 3 * OtaDownloader::kMaxFailures; i++) {
+            replies.push_back({.drop_after = 20 * 1024});
+            replies.push_back({.open = false});
+        }
+        replies.push_back({});
+        FakeServer server(body, replies);
+        auto result = Download(server);
+        CHECK(result.ok);
+        CHECK(result.flash == body);
+    }
+}
+
+int main() {
+    RUN_TEST(TestStraightDownload);
+    RUN_TEST(TestResumeFromPartialBlock);
+    RUN_TEST(TestServerIgnoresRange);
+    RUN_TEST(TestBodyLengthChanges);
+    RUN_TEST(TestGiveUp);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// PcmResampler: tone SNR, length, block invariance and Reset(), plus speed against the
+// linear interpolation AddAudioData used before it
+//
+// OpusResampler (the silk resampler of the esp-opus-encoder component) is not available on
+// the host, the linear interpolator below is the code PcmResampler replaced for music.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+#include "host_test.h"
+#include "pcm_resampler.h"
+
+static std::vector<int16_t> Tone(int rate, double hz, size_t samples) {
+    std::vector<int16_t> pcm(samples);
+    for (size_t i = 0; i < samples; i++) {
+        pcm[i] = (int16_t)std::lround(16000 * sin(2 * M_PI * hz * i / rate));
+    }
+    return pcm;
+}
+
+// SNR of a resampled tone against the exact tone at the output rate, edges excluded
+static double ToneSnr(const std::vector<int16_t>& out, int rate, double hz, size_t skip) {
+    double signal = 0, noise = 0;
+    for (size_t i = skip; i + skip < out.size(); i++) {
+        double expected = 16000 * sin(2 * M_PI * hz * i / rate);
+        signal += expected * expected;
+        noise += (out[i] - expected) * (out[i] - expected);
+    }
+    return 10 * log10(signal / std::max(noise, 1e-9));
+}
+
+// The linear upsampler AddAudioData had before PcmResampler (integer ratios only)
+static void LinearUpsample(std::span<const int16_t> pcm, int in_rate, int out_rate, std::vector<int16_t>& resampled) {
+    float upsample_ratio = out_rate / static_cast<float>(in_rate);
+    int interpolation_count = static_cast<int>(upsample_ratio) - 1;
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        resampled.push_back(pcm[i]);
+        if (interpolation_count > 0 && i + 1 < pcm.size()) {
+            int16_t current = pcm[i];
+            int16_t next = pcm[i + 1];
+            for (int j = 1; j <= interpolation_count; ++j) {
+                float t = static_cast<float>(j) / (interpolation_count + 1);
+                resampled.push_back(static_cast<int16_t>(current + (next - current) * t));
+            }
+        } else if (interpolation_count > 0) {
+            for (int j = 1; j <= interpolation_count; ++j) {
+                resampled.push_back(pcm[i]);
+            }
+        }
+    }
+}
+
+static std::vector<int16_t> Resample(PcmResampler& resampler, const std::vector<int16_t>& in, size_t block) {
+    std::vector<int16_t> out;
+    out.reserve(resampler.GetOutputSamples(in.size()) + block);
+    for (size_t pos = 0; pos < in.size(); pos += block) {
+        size_t n = std::min(block, in.size() - pos);
+        resampler.Process(std::span<const int16_t>(in.data() + pos, n), out);
+    }
+    return out;
+}
+
+static void TestToneQuality() {
+    const int pairs[][2] = {
+        {16000, 24000}, {22050, 24000}, {44100, 48000}, {8000, 24000},
+        {24000, 16000}, {48000, 24000}, {44100, 16000},
+    };
+    printf("  %-14s %8s %10s %10s %12s\n", "pair", "taps", "SNR dB", "ns/sample", "linear dB/ns");
+    for (auto& pair : pairs) {
+        int in_rate = pair[0];
+        int out_rate = pair[1];
+        auto in = Tone(in_rate, 1000, in_rate * 2);
+
+        PcmResampler resampler;
+        CHECK(resampler.Configure(in_rate, out_rate));
+        auto start = std::chrono::steady_clock::now();
+        auto out = Resample(resampler, in, 1152);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        // Length follows the rate ratio exactly, apart from the filter delay still pending
+        double expected = (double)in.size() * out_rate / in_rate;
+        CHECK(std::fabs(out.size() - expected) <= resampler.taps() * (double)out_rate / in_rate + 1);
+        CHECK(out.size() <= resampler.GetOutputSamples(in.size()) + 1152);
+
+        double snr = ToneSnr(out, out_rate, 1000, resampler.taps() * 2);
+        CHECK(snr > 50);
+
+        char linear[32] = "-";
+        if (out_rate % in_rate == 0) {
+            std::vector<int16_t> reference;
+            auto linear_start = std::chrono::steady_clock::now();
+            for (size_t pos = 0; pos < in.size(); pos += 1152) {
+                size_t n = std::min<size_t>(1152, in.size() - pos);
+                LinearUpsample(std::span<const int16_t>(in.data() + pos, n), in_rate, out_rate, reference);
+            }
+            double linear_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - linear_start).count();
+            snprintf(linear, sizeof(linear), "%.1f / %.1f", ToneSnr(reference, out_rate, 1000, 64),
+                linear_ns / in.size());
+        }
+        printf("  %5d->%-6d %8d %10.1f %10.1f %12s\n", in_rate, out_rate, resampler.taps(), snr, ns / in.size(), linear);
+    }
+}
+
+static void TestBlockSizeInvariance() {
+    auto in = Tone(22050, 440, 22050);
+    PcmResampler a, b;
+    CHECK(a.Configure(22050, 24000));
+    CHECK(b.Configure(22050, 24000));
+    auto whole = Resample(a, in, in.size());
+    auto blocks = Resample(b, in, 37);
+    CHECK_EQ(whole.size(), blocks.size());
+    CHECK(whole == blocks);
+}
+
+// After Reset() a new stream must not carry any of the previous one
+static void TestResetDropsHistory() {
+    auto first = Tone(16000, 3000, 4000);
+    auto second = Tone(16000, 500, 4000);
+
+    PcmResampler reused;
+    CHECK(reused.Configure(16000, 24000));
+    Resample(reused, first, 960);
+    reused.Reset();
+    auto after_reset = Resample(reused, second, 960);
+
+    PcmResampler fresh;
+    CHECK(fresh.Configure(16000, 24000));
+    auto expected = Resample(fresh, second, 960);
+    CHECK(after_reset == expected);
+
+    // Configure() with the same rates keeps the history, which is why streams call Reset()
+    PcmResampler kept;
+    CHECK(kept.Configure(16000, 24000));
+    Resample(kept, first, 960);
+    CHECK(kept.Configure(16000, 24000));
+    CHECK(Resample(kept, second, 960) != expected);
+}
+
+int main() {
+    RUN_TEST(TestToneQuality);
+    RUN_TEST(TestBlockSizeInvariance);
+    RUN_TEST(TestResetDropsHistory);
+    return 0;
+}
@@ -0,0 +1,117 @@
+// SdMusicSearchIndex on a synthetic SD library: build time, query time against a linear
+// normalise-and-scan over every track, and identical match sets for both
+//
+//   sd_music_search_bench [tracks]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "host_test.h"
+#include "sd_music_search.h"
+
+static const char* kWords[] = {
+    "Hà Nội", "mùa thu", "Sài Gòn", "em ơi", "người yêu", "đêm", "biển", "nhớ", "mưa",
+    "love", "night", "summer", "dream", "river", "heart", "remix", "live", "acoustic",
+    "lạc trôi", "chạy ngay đi", "bên trên tầng lầu", "hoa nở", "không màu", "tình ca",
+};
+static const char* kArtists[] = {
+    "Sơn Tùng M-TP", "Đen Vâu", "Mỹ Tâm", "Hoàng Thùy Linh", "Trịnh Công Sơn", "Adele",
+    "Coldplay", "Taylor Swift", "Vũ.", "Bích Phương", "Noo Phước Thịnh", "Hồ Ngọc Hà",
+};
+static const char* kFolders[] = {
+    "Nhạc Việt", "Pop", "Rock", "Bolero", "Chill_Lofi", "Acoustic", "Nhạc Trịnh", "EDM",
+};
+
+static std::vector<SdMusicSearchIndex::Entry> MakeLibrary(size_t count) {
+    std::vector<SdMusicSearchIndex::Entry> tracks(count);
+    uint32_t seed = 2024;
+    auto next = [&](size_t n) {
+        seed = seed * 1664525 + 1013904223;
+        return (seed >> 8) % n;
+    };
+    const size_t words = sizeof(kWords) / sizeof(kWords[0]);
+    for (size_t i = 0; i < count; i++) {
+        auto& t = tracks[i];
+        t.name = std::string(kWords[next(words)]) + " " + kWords[next(words)] + " " + std::to_string(i % 97);
+        t.artist = kArtists[next(sizeof(kArtists) / sizeof(kArtists[0]))];
+        std::string folder = kFolders[next(sizeof(kFolders) / sizeof(kFolders[0]))];
+        t.path = "/sdcard/Music/" + folder + "/" + t.artist + "/" + t.name + (i % 5 ? ".mp3" : ".wav");
+    }
+    return tracks;
+}
+
+// What the player did before the index: normalise each field of every track per query
+static std::vector<uint32_t> LinearSearch(const std::vector<SdMusicSearchIndex::Entry>& tracks,
+                                          const std::string& keyword) {
+    std::vector<uint32_t> matches;
+    std::string kw = SdMusicSearchIndex::Normalize(keyword);
+    if (kw.empty()) {
+        return matches;
+    }
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const auto& t = tracks[i];
+        size_t slash = t.path.find_last_of('/');
+        std::string dir = slash == std::string::npos ? std::string() : t.path.substr(0, slash);
+        std::string file = slash == std::string::npos ? t.path : t.path.substr(slash + 1);
+        file = file.substr(0, file.find_last_of('.'));
+        if (SdMusicSearchIndex::Normalize(t.name).find(kw) != std::string::npos ||
+            SdMusicSearchIndex::Normalize(t.artist).find(kw) != std::string::npos ||
+            SdMusicSearchIndex::Normalize(file).find(kw) != std::string::npos ||
+            SdMusicSearchIndex::Normalize(dir).find(kw) != std::string::npos) {
+            matches.push_back((uint32_t)i);
+        }
+    }
+    return matches;
+}
+
+template <typename F>
+static double TimeUs(int repeat, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++) {
+        f();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeat;
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? (size_t)atol(argv[1]) : 10000;
+    auto tracks = MakeLibrary(count);
+
+    SdMusicSearchIndex index;
+    double build_us = TimeUs(1, [&]() {
+        index.Build(tracks.size(), [&](size_t i) { return tracks[i]; }, 1);
+    });
+    CHECK_EQ(index.size(), tracks.size());
+    CHECK_EQ(index.generation(), 1u);
+    printf("%u tracks: build %.1f ms\n%s\n", (unsigned)count, build_us / 1000, index.GetStats().c_str());
+
+    const char* queries[] = {
+        "ha noi", "Hà Nội", "mua thu", "son tung", "den vau", "nhac trinh", "love", "em", "xyz",
+        "chill lofi", "acoustic", "lạc trôi 4", "taylor", "bolero", "42",
+    };
+    printf("  %-14s %8s %12s %12s\n", "query", "matches", "index us", "linear us");
+    for (const char* query : queries) {
+        auto found = index.Search(query, 0);
+        auto expected = LinearSearch(tracks, query);
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+
+        double index_us = TimeUs(20, [&]() { index.Search(query, 5); });
+        double linear_us = TimeUs(2, [&]() { LinearSearch(tracks, query); });
+        printf("  %-14s %8u %12.1f %12.1f\n", query, (unsigned)expected.size(), index_us, linear_us);
+    }
+
+    // Ranking: a title prefix comes before a match further into the title
+    auto ranked = index.Search("mua", 0);
+    CHECK(!ranked.empty());
+    CHECK(SdMusicSearchIndex::Normalize(tracks[ranked[0]].name).rfind("mua", 0) == 0);
+
+    std::vector<uint32_t> play_counts(count, 0);
+    double similar_us = TimeUs(20, [&]() { index.Similar(0, play_counts, 10); });
+    CHECK_EQ(index.Similar(0, play_counts, 10).size(), std::min<size_t>(10, count - 1));
+    printf("Similar(): %.1f us\n", similar_us);
+    return 0;
+}
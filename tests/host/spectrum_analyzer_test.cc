@@ -0,0 +1,196 @@
+// SpectrumAnalyzer: power spectrum against the full-size complex FFT the displays ran before
+// it, bars of a pure tone, hop handling, and time per frame of both transforms
+//
+//   spectrum_analyzer_test [frames]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "host_test.h"
+#include "spectrum_analyzer.h"
+
+static constexpr int kFftSize = 512;
+// Keeps the benchmark loops from being optimised away
+static volatile float g_sink;
+
+// LcdDisplay::compute() before SpectrumAnalyzer: in-place radix-2 complex FFT, 1/N on forward
+static void ReferenceFft(float* real, float* imag, int n) {
+    int j = 0;
+    for (int i = 0; i < n; i++) {
+        if (j > i) {
+            std::swap(real[i], real[j]);
+            std::swap(imag[i], imag[j]);
+        }
+        int m = n >> 1;
+        while (m >= 1 && j >= m) {
+            j -= m;
+            m >>= 1;
+        }
+        j += m;
+    }
+    for (int s = 1; s <= (int)log2(n); s++) {
+        int m = 1 << s;
+        int m2 = m >> 1;
+        float w_real = 1.0f;
+        float w_imag = 0.0f;
+        float angle = -2.0f * M_PI / m;
+        float wm_real = cosf(angle);
+        float wm_imag = sinf(angle);
+        for (int j = 0; j < m2; j++) {
+            for (int k = j; k < n; k += m) {
+                int k2 = k + m2;
+                float t_real = w_real * real[k2] - w_imag * imag[k2];
+                float t_imag = w_real * imag[k2] + w_imag * real[k2];
+                real[k2] = real[k] - t_real;
+                imag[k2] = imag[k] - t_imag;
+                real[k] += t_real;
+                imag[k] += t_imag;
+            }
+            float w_temp = w_real;
+            w_real = w_real * wm_real - w_imag * wm_imag;
+            w_imag = w_temp * wm_imag + w_imag * wm_real;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        real[i] /= n;
+        imag[i] /= n;
+    }
+}
+
+// Windowed power spectrum of one frame the way the displays computed it
+static std::vector<float> ReferencePower(const int16_t* frame, int n) {
+    std::vector<float> real(n), imag(n, 0.0f);
+    for (int i = 0; i < n; i++) {
+        float window = 0.5 * (1.0 - cos(2.0 * M_PI * i / (n - 1)));
+        real[i] = frame[i] / 32768.0f * window;
+    }
+    ReferenceFft(real.data(), imag.data(), n);
+    std::vector<float> power(n / 2);
+    for (int i = 0; i < n / 2; i++) {
+        power[i] = real[i] * real[i] + imag[i] * imag[i];
+    }
+    return power;
+}
+
+static std::vector<int16_t> Music(size_t samples) {
+    // A few tones plus deterministic noise, loud enough to use most of the int16 range
+    std::vector<int16_t> pcm(samples);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < samples; i++) {
+        seed = seed * 1664525 + 1013904223;
+        double v = 9000 * sin(2 * M_PI * 220 * i / 16000) + 6000 * sin(2 * M_PI * 1870 * i / 16000) +
+            3000 * sin(2 * M_PI * 5100 * i / 16000) + (int)(seed >> 20) - 2048;
+        pcm[i] = (int16_t)std::clamp(v, -32768.0, 32767.0);
+    }
+    return pcm;
+}
+
+static void TestMatchesReferenceFft() {
+    auto pcm = Music(kFftSize);
+    SpectrumAnalyzer analyzer(kFftSize);
+    analyzer.Feed(pcm.data(), pcm.size());
+    CHECK(analyzer.Analyze());
+    CHECK_EQ(analyzer.bins(), kFftSize / 2);
+
+    auto expected = ReferencePower(pcm.data(), kFftSize);
+    float peak = *std::max_element(expected.begin(), expected.end());
+    double max_error = 0;
+    for (int k = 0; k < kFftSize / 2; k++) {
+        max_error = std::max(max_error, (double)std::fabs(analyzer.power_spectrum()[k] - expected[k]));
+    }
+    printf("  max |power error| %.2e of peak\n", max_error / peak);
+    CHECK(max_error / peak < 1e-5);
+}
+
+// A tone must land in the bar that holds its bin, with the other bars well below it
+static void TestToneBar() {
+    const int bar_count = 16;
+    const int bin = 40;
+    std::vector<int16_t> pcm(kFftSize);
+    for (int i = 0; i < kFftSize; i++) {
+        pcm[i] = (int16_t)(16000 * sin(2 * M_PI * bin * i / kFftSize));
+    }
+    SpectrumAnalyzer analyzer(kFftSize);
+    analyzer.Feed(pcm.data(), pcm.size());
+    CHECK(analyzer.Analyze());
+
+    float bars[bar_count];
+    analyzer.GetBars(bars, bar_count);
+    int loudest = std::max_element(bars, bars + bar_count) - bars;
+    // Same log spacing GetBars() uses: bar b (>= 1) ends at (N/2)^(b / (bars - 1))
+    int expected_bar = 1;
+    while (expected_bar < bar_count - 1 &&
+        lroundf(powf(kFftSize / 2.0f, (float)expected_bar / (bar_count - 1))) <= bin) {
+        expected_bar++;
+    }
+    CHECK_EQ(loudest, expected_bar);
+    CHECK(bars[0] < bars[loudest] * 0.01f);
+}
+
+// Analyze() runs once per hop (fft_size / 2 new samples) and a long Feed() keeps only the tail
+static void TestHop() {
+    SpectrumAnalyzer analyzer(kFftSize);
+    CHECK(!analyzer.Analyze());
+    std::vector<int16_t> chunk(kFftSize / 2 - 1, 1000);
+    analyzer.Feed(chunk.data(), chunk.size());
+    CHECK(!analyzer.Analyze());
+    analyzer.Feed(chunk.data(), 1);
+    CHECK(analyzer.Analyze());
+    CHECK(!analyzer.Analyze());
+
+    auto pcm = Music(kFftSize * 3 + 77);
+    analyzer.Feed(pcm.data(), pcm.size());
+    CHECK(analyzer.Analyze());
+    auto expected = ReferencePower(pcm.data() + pcm.size() - kFftSize, kFftSize);
+    float peak = *std::max_element(expected.begin(), expected.end());
+    for (int k = 0; k < kFftSize / 2; k++) {
+        CHECK(std::fabs(analyzer.power_spectrum()[k] - expected[k]) < peak * 1e-5f);
+    }
+
+    analyzer.Reset();
+    CHECK(!analyzer.Analyze());
+}
+
+static void BenchFrame(int frames) {
+    auto pcm = Music(kFftSize);
+    SpectrumAnalyzer analyzer(kFftSize);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        analyzer.Feed(pcm.data(), kFftSize / 2);
+        analyzer.Analyze();
+        g_sink = analyzer.power_spectrum()[i % (kFftSize / 2)];
+    }
+    double analyzer_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    // The old path: window on the fly and a full N-point complex FFT per frame
+    std::vector<float> window(kFftSize), real(kFftSize), imag(kFftSize);
+    for (int i = 0; i < kFftSize; i++) {
+        window[i] = 0.5 * (1.0 - cos(2.0 * M_PI * i / (kFftSize - 1)));
+    }
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        for (int n = 0; n < kFftSize; n++) {
+            real[n] = pcm[n] / 32768.0f * window[n];
+            imag[n] = 0.0f;
+        }
+        ReferenceFft(real.data(), imag.data(), kFftSize);
+        g_sink = real[i % kFftSize];
+    }
+    double reference_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("  %d-point frame: SpectrumAnalyzer %.0f ns, complex FFT %.0f ns (%.2fx)\n", kFftSize,
+        analyzer_ns / frames, reference_ns / frames, reference_ns / analyzer_ns);
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 20000;
+    RUN_TEST(TestMatchesReferenceFft);
+    RUN_TEST(TestToneBar);
+    RUN_TEST(TestHop);
+    BenchFrame(frames);
+    return 0;
+}
@@ -0,0 +1,96 @@
+// SpscRing against the mutex + std::deque queue it replaced, one producer and one consumer
+// thread passing queue entries (a pointer and a timestamp, like AudioPipeline::Queued).
+//
+//   spsc_ring_bench [items]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+
+struct Entry {
+    std::unique_ptr<int> item;
+    int64_t enqueued_us = 0;
+};
+
+static constexpr size_t kCapacity = 64;
+
+// The old queue: bounded deque behind one mutex
+class DequeQueue {
+public:
+    bool Push(Entry&& entry) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= kCapacity) {
+            return false;
+        }
+        queue_.push_back(std::move(entry));
+        return true;
+    }
+    bool Pop(Entry& entry) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+            return false;
+        }
+        entry = std::move(queue_.front());
+        queue_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<Entry> queue_;
+};
+
+template <typename Queue>
+static double Run(Queue& queue, int items) {
+    // Items are allocated up front so the loop only measures the queue
+    std::vector<std::unique_ptr<int>> source(items);
+    for (int i = 0; i < items; i++) {
+        source[i] = std::make_unique<int>(i);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&]() {
+        for (int i = 0; i < items; i++) {
+            Entry entry{std::move(source[i]), i};
+            while (!queue.Push(std::move(entry))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    Entry entry;
+    int64_t sum = 0;
+    for (int received = 0; received < items;) {
+        if (queue.Pop(entry)) {
+            sum += *entry.item;
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (sum != (int64_t)items * (items - 1) / 2) {
+        fprintf(stderr, "Lost entries\n");
+        exit(1);
+    }
+    return elapsed / items;
+}
+
+int main(int argc, char** argv) {
+    int items = argc > 1 ? atoi(argv[1]) : 2000000;
+    for (int round = 0; round < 3; round++) {
+        auto ring = std::make_unique<SpscRing<Entry, kCapacity>>();
+        DequeQueue deque;
+        double ring_ns = Run(*ring, items);
+        double deque_ns = Run(deque, items);
+        printf("round %d: %d entries, SpscRing %.1f ns/entry, mutex+deque %.1f ns/entry (%.1fx)\n",
+            round, items, ring_ns, deque_ns, deque_ns / ring_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+// SpscRing and AudioPipeline queue tests, in particular flushing a full ring
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "audio_pipeline.h"
+#include "audio_task_runner.h"
+#include "host_test.h"
+#include "spsc_ring.h"
+
+static void TestPushPop() {
+    SpscRing<int, 4> ring;
+    CHECK(ring.empty());
+    for (int i = 0; i < 4; i++) {
+        CHECK(ring.Push(int(i)));
+    }
+    CHECK(ring.full());
+    CHECK(!ring.Push(4));
+    int value = -1;
+    for (int i = 0; i < 4; i++) {
+        CHECK(ring.Pop(value));
+        CHECK_EQ(value, i);
+    }
+    CHECK(!ring.Pop(value));
+}
+
+// The producer must be able to refill a full ring right after a flush, without waiting for
+// the consumer to run (the consumer sleeps on !empty(), which a flush makes false)
+static void TestPushAfterFlushOfFullRing() {
+    SpscRing<std::unique_ptr<int>, 2> ring;
+    CHECK(ring.Push(std::make_unique<int>(1)));
+    CHECK(ring.Push(std::make_unique<int>(2)));
+    CHECK(!ring.Push(std::make_unique<int>(3)));
+
+    ring.Flush();
+    CHECK(ring.empty());
+    CHECK(ring.Push(std::make_unique<int>(10)));
+    CHECK(ring.Push(std::make_unique<int>(11)));
+    CHECK(!ring.Push(std::make_unique<int>(12)));
+    CHECK_EQ(ring.size(), 2u);
+
+    std::unique_ptr<int> value;
+    CHECK(ring.Pop(value));
+    CHECK_EQ(*value, 10);
+    CHECK(ring.Pop(value));
+    CHECK_EQ(*value, 11);
+    CHECK(!ring.Pop(value));
+}
+
+// Flushed entries are released by the producer when it reuses their slots
+static void TestFlushReleasesEntries() {
+    auto shared = std::make_shared<int>(0);
+    SpscRing<std::shared_ptr<int>, 2> ring;
+    CHECK(ring.Push(std::shared_ptr<int>(shared)));
+    CHECK(ring.Push(std::shared_ptr<int>(shared)));
+    CHECK_EQ(shared.use_count(), 3);
+    ring.Flush();
+    CHECK(ring.Push(std::make_shared<int>(1)));
+    CHECK_EQ(shared.use_count(), 1);
+}
+
+// Producer, consumer and a third thread flushing: the consumer must see strictly
+// increasing values and the producer must never be refused for longer than a flush
+static void TestConcurrentFlush() {
+    SpscRing<uint32_t, 8> ring;
+    std::atomic<bool> done{false};
+    const uint32_t total = 200000;
+
+    std::thread producer([&]() {
+        for (uint32_t i = 1; i <= total; i++) {
+            while (!ring.Push(uint32_t(i))) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    });
+    std::thread flusher([&]() {
+        while (!done) {
+            ring.Flush();
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+
+    uint32_t last = 0;
+    uint32_t received = 0;
+    while (!done || !ring.empty()) {
+        uint32_t value;
+        if (ring.Pop(value)) {
+            CHECK(value > last);
+            last = value;
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    flusher.join();
+    CHECK(received > 0);
+    CHECK(received <= total);
+}
+
+// Playback ring full when ResetDecodeQueues() runs: playback must resume with new packets
+static void TestPlaybackResumesAfterReset() {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool gate_open = false;
+    std::atomic<int> decoded{0};
+    std::atomic<int> played{0};
+
+    AudioPipeline pipeline;
+    AudioPipelineCodec codec;
+    codec.decode = [&](AudioStreamPacket&, std::vector<int16_t>& pcm) {
+        pcm.assign(16, 0);
+        decoded++;
+        return true;
+    };
+    codec.encode = [](std::vector<int16_t>&&, std::vector<uint8_t>&) {
+        return true;
+    };
+    codec.output = [&](std::vector<int16_t>&) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return gate_open; });
+        played++;
+    };
+    pipeline.SetCodec(codec);
+
+    StdThreadTaskRunner runner;
+    pipeline.Start();
+    runner.Start("audio_output", 0, 4, -1, [&]() { pipeline.RunOutputLoop(); });
+    runner.Start("opus_codec", 0, 2, -1, [&]() { pipeline.RunCodecLoop(); });
+
+    auto push = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            auto packet = AudioFramePool::GetInstance().AcquirePacket(16);
+            packet->sample_rate = 16000;
+            packet->frame_duration = 1;
+            packet->payload.assign(16, 0);
+            CHECK(pipeline.PushPacketToDecodeQueue(std::move(packet), true));
+        }
+    };
+    auto wait_for = [](auto condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (!condition() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return condition();
+    };
+
+    // One frame held by the blocked speaker + a full playback ring
+    push(1 + MAX_PLAYBACK_TASKS_IN_QUEUE);
+    CHECK(wait_for([&]() { return decoded == 1 + MAX_PLAYBACK_TASKS_IN_QUEUE; }));
+
+    pipeline.ResetDecodeQueues();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        gate_open = true;
+    }
+    cv.notify_all();
+    CHECK(wait_for([&]() { return played == 1; }));
+
+    push(5);
+    CHECK(wait_for([&]() { return played == 6; }));
+    CHECK_EQ(pipeline.GetReport().dropped, 0u);
+
+    pipeline.Stop();
+    runner.Join();
+}
+
+int main() {
+    RUN_TEST(TestPushPop);
+    RUN_TEST(TestPushAfterFlushOfFullRing);
+    RUN_TEST(TestFlushReleasesEntries);
+    RUN_TEST(TestConcurrentFlush);
+    RUN_TEST(TestPlaybackResumesAfterReset);
+    return 0;
+}
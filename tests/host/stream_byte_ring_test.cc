@@ -0,0 +1,209 @@
+// StreamByteRing: sizes, the guard mirror behind the end of the ring and a randomized
+// producer / consumer run (built with ASan + UBSan, see CMakeLists.txt)
+//
+//   stream_byte_ring_test [megabytes]
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "host_test.h"
+#include "stream_byte_ring.h"
+
+static uint8_t Pattern(size_t position) {
+    return (uint8_t)((position * 31 + (position >> 8) * 7 + 1) & 0xFF);
+}
+
+static void Write(StreamByteRing& ring, size_t count) {
+    size_t position = ring.total_written();
+    while (count > 0) {
+        size_t length = 0;
+        uint8_t* span = ring.WriteSpan(length);
+        CHECK(span != nullptr && length > 0);
+        length = std::min(length, count);
+        for (size_t i = 0; i < length; i++) {
+            span[i] = Pattern(position + i);
+        }
+        ring.CommitWrite(length);
+        position += length;
+        count -= length;
+    }
+}
+
+static void TestAllocate() {
+    StreamByteRing ring;
+    CHECK(!ring.allocated());
+    CHECK(!ring.Allocate(0, 0));
+    CHECK(!ring.Allocate(1000, 16));
+    CHECK(!ring.Allocate(3 * 1024, 16));
+    CHECK(!ring.Allocate(64, 65));       // Guard larger than the ring
+    CHECK(!ring.allocated());
+
+    CHECK(ring.Allocate(1024, 64));
+    CHECK(ring.allocated());
+    CHECK_EQ(ring.capacity(), 1024u);
+    CHECK_EQ(ring.guard(), 64u);
+
+    // Same sizes again keeps the storage and only resets the positions
+    Write(ring, 100);
+    size_t length = 0;
+    uint8_t* storage = ring.ReadSpan(length);
+    CHECK(ring.Allocate(1024, 64));
+    CHECK_EQ(ring.size(), 0u);
+    CHECK(ring.WriteSpan(length) == storage);
+
+    ring.Release();
+    CHECK(!ring.allocated());
+    CHECK(ring.WriteSpan(length) == nullptr);
+    CHECK_EQ(length, 0u);
+    CHECK(ring.ReadSpan(length) == nullptr);
+    CHECK_EQ(length, 0u);
+}
+
+static void TestFullAndEmpty() {
+    StreamByteRing ring;
+    CHECK(ring.Allocate(256, 32));
+    size_t length = 0;
+
+    CHECK_EQ(ring.size(), 0u);
+    CHECK_EQ(ring.free_space(), 256u);
+    ring.ReadSpan(length);
+    CHECK_EQ(length, 0u);
+    ring.WriteSpan(length);
+    CHECK_EQ(length, 256u);
+
+    Write(ring, 256);
+    CHECK_EQ(ring.size(), 256u);
+    CHECK_EQ(ring.free_space(), 0u);
+    ring.WriteSpan(length);
+    CHECK_EQ(length, 0u);
+    ring.ReadSpan(length);
+    CHECK_EQ(length, 256u);
+
+    // Consuming more than is buffered stops at empty
+    ring.Consume(1000);
+    CHECK_EQ(ring.size(), 0u);
+    CHECK_EQ(ring.free_space(), 256u);
+    CHECK_EQ(ring.total_written(), 256u);
+    CHECK_EQ(ring.total_read(), 256u);
+
+    // Full again, this time with the positions wrapped
+    Write(ring, 100);
+    ring.Consume(60);
+    Write(ring, ring.free_space());
+    CHECK_EQ(ring.size(), 256u);
+    CHECK_EQ(ring.free_space(), 0u);
+}
+
+// A frame written in two pieces around the end of the storage is read in one span through
+// the guard area
+static void TestFrameAcrossWrap() {
+    StreamByteRing ring;
+    CHECK(ring.Allocate(64, 16));
+    Write(ring, 56);
+    ring.Consume(56);
+
+    size_t length = 0;
+    uint8_t* span = ring.WriteSpan(length);
+    CHECK_EQ(length, 8u);                // Only up to the end of the storage
+    for (size_t i = 0; i < 8; i++) {
+        span[i] = Pattern(56 + i);
+    }
+    ring.CommitWrite(8);
+    span = ring.WriteSpan(length);
+    CHECK_EQ(length, 56u);               // From the start of the storage
+    for (size_t i = 0; i < 12; i++) {
+        span[i] = Pattern(64 + i);
+    }
+    ring.CommitWrite(12);
+
+    uint8_t* frame = ring.ReadSpan(length);
+    CHECK_EQ(length, 20u);
+    for (size_t i = 0; i < 20; i++) {
+        CHECK_EQ(frame[i], Pattern(56 + i));
+    }
+
+    // Past the guard the span is cut at min(size, guard) bytes beyond the end
+    ring.Consume(4);
+    Write(ring, 30);
+    frame = ring.ReadSpan(length);
+    CHECK_EQ(length, 64u + 16u - 60u);
+    for (size_t i = 0; i < length; i++) {
+        CHECK_EQ(frame[i], Pattern(60 + i));
+    }
+    ring.Consume(length);
+    frame = ring.ReadSpan(length);
+    CHECK_EQ(length, ring.size());
+    for (size_t i = 0; i < length; i++) {
+        CHECK_EQ(frame[i], Pattern(ring.total_read() + i));
+    }
+}
+
+// Producer writes random sized chunks, consumer reads random sized frames up to the guard
+// and checks every byte; any read span must hold at least min(size, guard) bytes
+static void TestRandomProducerConsumer(size_t total) {
+    StreamByteRing ring;
+    CHECK(ring.Allocate(4096, 1536));
+    std::atomic<bool> failed{false};
+
+    std::thread producer([&]() {
+        uint32_t seed = 1;
+        size_t position = 0;
+        while (position < total && !failed) {
+            size_t length = 0;
+            uint8_t* span = ring.WriteSpan(length);
+            if (length == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            seed = seed * 1664525 + 1013904223;
+            length = std::min({length, total - position, (size_t)(seed >> 20) % 3000 + 1});
+            for (size_t i = 0; i < length; i++) {
+                span[i] = Pattern(position + i);
+            }
+            ring.CommitWrite(length);
+            position += length;
+        }
+    });
+
+    uint32_t seed = 2;
+    size_t position = 0;
+    while (position < total && !failed) {
+        size_t buffered = ring.size();
+        size_t length = 0;
+        uint8_t* span = ring.ReadSpan(length);
+        if (length < std::min(buffered, ring.guard())) {
+            failed = true;
+            break;
+        }
+        if (length == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        seed = seed * 1664525 + 1013904223;
+        length = std::min(length, (size_t)(seed >> 20) % ring.guard() + 1);
+        for (size_t i = 0; i < length; i++) {
+            if (span[i] != Pattern(position + i)) {
+                failed = true;
+                break;
+            }
+        }
+        ring.Consume(length);
+        position += length;
+    }
+    producer.join();
+    CHECK(!failed);
+    CHECK_EQ(ring.total_read(), total);
+    CHECK_EQ(ring.size(), 0u);
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? (size_t)atol(argv[1]) : 16;
+    RUN_TEST(TestAllocate);
+    RUN_TEST(TestFullAndEmpty);
+    RUN_TEST(TestFrameAcrossWrap);
+    TestRandomProducerConsumer(megabytes << 20);
+    printf("[ OK ] TestRandomProducerConsumer (%u MB)\n", (unsigned)megabytes);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// StreamPreroll: byte rate measured from decoded audio, the pre-roll raised by a stall and
+// decaying with the half-life, and the clamp the radio uses (16..192 KB)
+#include <cmath>
+#include <cstdint>
+
+#include "host_test.h"
+#include "stream_preroll.h"
+
+static constexpr size_t kMinPreroll = 16 * 1024;    // Esp32Radio::MIN_PREROLL
+static constexpr size_t kMaxPreroll = 192 * 1024;   // Esp32Radio::MAX_PREROLL
+static constexpr int64_t kSecondUs = 1000000;
+
+static bool Near(double value, double expected, double tolerance) {
+    return std::fabs(value - expected) <= tolerance * expected;
+}
+
+// AAC frames of 1024 samples at sample_rate, sized for byte_rate bytes/s
+static void Decode(StreamPreroll& preroll, uint32_t byte_rate, int sample_rate, int frames) {
+    double carry = 0;
+    for (int i = 0; i < frames; i++) {
+        carry += (double)byte_rate * 1024 / sample_rate;
+        size_t bytes = (size_t)carry;
+        carry -= bytes;
+        preroll.OnDecoded(bytes, 1024, sample_rate);
+    }
+}
+
+// AAC frames that fill one 2 s measuring window
+static int WindowFrames(int sample_rate) {
+    return (2 * sample_rate + 1023) / 1024;
+}
+
+static void TestByteRate() {
+    StreamPreroll preroll(kMinPreroll, kMaxPreroll);
+    CHECK_EQ(preroll.byte_rate(), StreamPreroll::kDefaultByteRate);
+    CHECK_EQ(preroll.target_bytes(), (size_t)StreamPreroll::kDefaultByteRate * StreamPreroll::kBaseMs / 1000);
+
+    // Less than one 2 s window: still the default
+    Decode(preroll, 12000, 44100, 64);
+    CHECK_EQ(preroll.byte_rate(), StreamPreroll::kDefaultByteRate);
+
+    // First window is taken as is (96 kbps)
+    Decode(preroll, 12000, 44100, WindowFrames(44100) - 64);
+    CHECK(Near(preroll.byte_rate(), 12000, 0.01));
+    CHECK(Near(preroll.target_bytes(), 12000 * 1.5, 0.01));
+    CHECK(Near(preroll.BytesToMs(24000), 2000, 0.01));
+
+    // Later windows are smoothed: (3 * old + new) / 4
+    Decode(preroll, 20000, 44100, WindowFrames(44100));
+    CHECK(Near(preroll.byte_rate(), 14000, 0.01));
+
+    // A sample rate change restarts the window, nothing is mixed across it
+    Decode(preroll, 4000, 22050, WindowFrames(22050) / 2);
+    Decode(preroll, 8000, 24000, WindowFrames(24000) - 1);
+    CHECK(Near(preroll.byte_rate(), 14000, 0.01));
+    Decode(preroll, 8000, 24000, 1);
+    CHECK(Near(preroll.byte_rate(), 12500, 0.01));
+
+    // No frames, no rate: ignored
+    preroll.OnDecoded(1000, 0, 44100);
+    preroll.OnDecoded(1000, 1024, 0);
+    CHECK(Near(preroll.byte_rate(), 12500, 0.01));
+
+    preroll.Reset();
+    CHECK_EQ(preroll.byte_rate(), StreamPreroll::kDefaultByteRate);
+}
+
+static void TestStallAndDecay() {
+    StreamPreroll preroll(kMinPreroll, kMaxPreroll);
+    int64_t now = 10 * kSecondUs;
+
+    // Before the byte rate is known, slow reads say nothing about jitter
+    preroll.OnRead(8000, 5 * kSecondUs, now);
+    CHECK_EQ(preroll.jitter_ms(), 0u);
+
+    Decode(preroll, 16000, 48000, WindowFrames(48000));
+    CHECK(Near(preroll.byte_rate(), 16000, 0.01));
+    const double base = preroll.target_bytes();
+    CHECK(Near(base, 16000 * 1.5, 0.01));
+
+    // Reads that take just what their bytes are worth are not late
+    for (int i = 0; i < 10; i++) {
+        now += kSecondUs / 2;
+        preroll.OnRead(8000, kSecondUs / 2, now);
+    }
+    CHECK_EQ(preroll.jitter_ms(), 0u);
+    CHECK(preroll.target_bytes() == base);
+
+    // A read that blocks 4 s longer than its bytes are worth: 4000 ms late
+    now += 4 * kSecondUs + kSecondUs / 2;
+    preroll.OnRead(8000, 4 * kSecondUs + kSecondUs / 2, now);
+    CHECK(Near(preroll.jitter_ms(), 4000, 0.01));
+    CHECK(Near(preroll.target_bytes(), 16000 * (1.5 + 1.5 * 4.0), 0.01));
+
+    // Smooth reads for one half-life: the peak halves
+    int64_t half_life_us = (int64_t)StreamPreroll::kPeakHalfLifeMs * 1000;
+    for (int64_t t = 0; t < half_life_us; t += kSecondUs / 2) {
+        now += kSecondUs / 2;
+        preroll.OnRead(8000, kSecondUs / 2, now);
+    }
+    CHECK(Near(preroll.jitter_ms(), 2000, 0.02));
+    CHECK(Near(preroll.target_bytes(), 16000 * (1.5 + 1.5 * 2.0), 0.02));
+
+    // A stall smaller than the decayed peak leaves it alone
+    now += kSecondUs;
+    preroll.OnRead(8000, kSecondUs, now);
+    CHECK(Near(preroll.jitter_ms(), 2000, 0.02));
+
+    // A reconnect is reported as 0 bytes that waited the whole outage
+    now += 3 * kSecondUs;
+    preroll.OnRead(0, 3 * kSecondUs, now);
+    CHECK(Near(preroll.jitter_ms(), 3000, 0.01));
+
+    // Several half-lives later the pre-roll is back near the base
+    for (int64_t t = 0; t < 7 * half_life_us; t += kSecondUs) {
+        now += kSecondUs;
+        preroll.OnRead(16000, kSecondUs, now);
+    }
+    CHECK(preroll.jitter_ms() < 30);
+    CHECK(Near(preroll.target_bytes(), base, 0.05));
+}
+
+static void TestClamp() {
+    // Low bitrate stream: 24 kbps * 1.5 s is below the minimum
+    StreamPreroll low(kMinPreroll, kMaxPreroll);
+    Decode(low, 3000, 16000, WindowFrames(16000));
+    CHECK(Near(low.byte_rate(), 3000, 0.01));
+    CHECK_EQ(low.target_bytes(), kMinPreroll);
+
+    // A long outage on a 320 kbps stream would ask for more than the maximum
+    StreamPreroll high(kMinPreroll, kMaxPreroll);
+    Decode(high, 40000, 44100, WindowFrames(44100));
+    high.OnRead(0, 30 * kSecondUs, 60 * kSecondUs);
+    CHECK_EQ(high.target_bytes(), kMaxPreroll);
+
+    // max below min is raised to min
+    StreamPreroll inverted(kMinPreroll, 1024);
+    CHECK_EQ(inverted.target_bytes(), kMinPreroll);
+}
+
+int main() {
+    RUN_TEST(TestByteRate);
+    RUN_TEST(TestStallAndDecay);
+    RUN_TEST(TestClamp);
+    return 0;
+}
@@ -0,0 +1,181 @@
+// StreamReconnect against a scripted server, driven the way Esp32Radio::DownloadRadioStream
+// uses it: back off after every failed open and every dropped connection, reset only when
+// a connection delivered audio. Time is simulated.
+#include <deque>
+#include <vector>
+
+#include "host_test.h"
+#include "stream_reconnect.h"
+
+static constexpr int kMaxAttempts = 8;     // Esp32Radio::RECONNECT_MAX_ATTEMPTS
+static constexpr int kBaseMs = 500;        // Esp32Radio::RECONNECT_BASE_MS
+static constexpr int kMaxMs = 8000;        // Esp32Radio::RECONNECT_MAX_MS
+static constexpr int64_t kMsUs = 1000;
+
+// What the server does with each connection, in order; the last one repeats
+struct Connection {
+    enum class Kind { Refuse, AcceptThenClose, Stream } kind;
+    int reads = 0;                         // Stream: audio reads before the connection drops
+};
+
+struct Session {
+    int connections = 0;                   // Successful opens
+    int opens = 0;                         // Open attempts
+    int audio_reads = 0;
+    uint32_t reconnects = 0;
+    int64_t outage_ms = 0;
+    std::vector<int> delays;               // Backoff before each reopen
+    bool gave_up = false;
+};
+
+// The DownloadRadioStream loop on a fake clock: each read takes 100 ms, opening 50 ms.
+// Stops once the script is exhausted and the last connection is a stream, or on give up
+static Session Run(std::deque<Connection> script, int max_opens = 1000) {
+    StreamReconnect reconnect(kMaxAttempts, kBaseMs, kMaxMs);
+    Session session;
+    int64_t now = 0;
+
+    auto wait_backoff = [&](int64_t failed_at) {
+        int delay_ms = reconnect.OnFailure(failed_at);
+        if (delay_ms < 0) {
+            session.gave_up = true;
+            return false;
+        }
+        session.delays.push_back(delay_ms);
+        now += delay_ms * kMsUs;
+        return true;
+    };
+
+    while (session.opens < max_opens) {
+        Connection connection = script.front();
+        bool last = script.size() == 1;
+        if (!last) {
+            script.pop_front();
+        }
+        session.opens++;
+        now += 50 * kMsUs;
+        if (connection.kind == Connection::Kind::Refuse) {
+            if (!wait_backoff(now)) {
+                break;
+            }
+            continue;
+        }
+        session.connections++;
+
+        bool connection_has_audio = false;
+        int64_t lost_at = now;
+        for (int read = 0;; read++) {
+            int64_t read_start = now;
+            now += 100 * kMsUs;
+            if (connection.kind == Connection::Kind::AcceptThenClose || read == connection.reads) {
+                lost_at = read_start;      // bytes_read <= 0
+                break;
+            }
+            session.audio_reads++;
+            if (!connection_has_audio) {
+                connection_has_audio = true;
+                if (reconnect.OnAudio(now)) {
+                    session.reconnects++;
+                    session.outage_ms += reconnect.outage_us() / kMsUs;
+                }
+            }
+        }
+        if (last && connection.kind == Connection::Kind::Stream) {
+            break;
+        }
+        if (!wait_backoff(lost_at)) {
+            break;
+        }
+    }
+    CHECK_EQ(session.reconnects, reconnect.reconnects());
+    return session;
+}
+
+static const std::vector<int> kBackoff = {500, 1000, 2000, 4000, 8000, 8000, 8000, 8000};
+
+// Accepts and closes every connection: must back off and give up, never spin or count
+// reconnects
+static void TestAcceptThenCloseGivesUp() {
+    auto session = Run({{Connection::Kind::AcceptThenClose}});
+    CHECK(session.gave_up);
+    CHECK_EQ(session.opens, kMaxAttempts + 1);
+    CHECK_EQ(session.connections, kMaxAttempts + 1);
+    CHECK(session.delays == kBackoff);
+    CHECK_EQ(session.reconnects, 0u);
+
+    // Same after the stream played for a while
+    session = Run({{Connection::Kind::Stream, 20}, {Connection::Kind::AcceptThenClose}});
+    CHECK(session.gave_up);
+    CHECK_EQ(session.opens, 1 + kMaxAttempts);   // The drop was the first failed attempt
+    CHECK_EQ(session.audio_reads, 20);
+    CHECK(session.delays == kBackoff);
+    CHECK_EQ(session.reconnects, 0u);
+}
+
+static void TestRefusedGivesUp() {
+    auto session = Run({{Connection::Kind::Refuse}});
+    CHECK(session.gave_up);
+    CHECK_EQ(session.opens, kMaxAttempts + 1);
+    CHECK_EQ(session.connections, 0);
+    CHECK(session.delays == kBackoff);
+}
+
+// Drop, two refused opens, one accepted-and-closed, then audio again: every reopen waited,
+// the attempts kept counting across the empty connection, and only the audio ended the outage
+static void TestOutageEndsWithAudio() {
+    auto session = Run({
+        {Connection::Kind::Stream, 10},
+        {Connection::Kind::Refuse},
+        {Connection::Kind::Refuse},
+        {Connection::Kind::AcceptThenClose},
+        {Connection::Kind::Stream, 5},
+    });
+    CHECK(!session.gave_up);
+    CHECK_EQ(session.opens, 5);
+    CHECK((session.delays == std::vector<int>{500, 1000, 2000, 4000}));
+    CHECK_EQ(session.reconnects, 1u);
+    // From the failed read to the first audio read of the last connection:
+    // 100 (failed read) + 500 + 50 + 1000 + 50 + 2000 + 50 + 100 + 4000 + 50 + 100
+    CHECK_EQ(session.outage_ms, 8000);
+    CHECK_EQ(session.audio_reads, 15);
+}
+
+// A connection with audio resets the count: drops that each deliver audio never give up
+static void TestProgressResetsBackoff() {
+    std::deque<Connection> script;
+    for (int i = 0; i < 3 * kMaxAttempts; i++) {
+        script.push_back({Connection::Kind::Stream, 3});
+        script.push_back({Connection::Kind::AcceptThenClose});
+    }
+    script.push_back({Connection::Kind::Stream, 3});
+    auto session = Run(script);
+    CHECK(!session.gave_up);
+    CHECK_EQ(session.reconnects, (uint32_t)(3 * kMaxAttempts));
+    for (size_t i = 0; i < session.delays.size(); i++) {
+        CHECK_EQ(session.delays[i], i % 2 == 0 ? 500 : 1000);
+    }
+}
+
+// Failures before the first audio are a slow start, not an outage
+static void TestInitialFailuresAreNotReconnects() {
+    auto session = Run({{Connection::Kind::Refuse}, {Connection::Kind::AcceptThenClose}, {Connection::Kind::Stream, 4}});
+    CHECK(!session.gave_up);
+    CHECK_EQ(session.reconnects, 0u);
+    CHECK((session.delays == std::vector<int>{500, 1000}));
+
+    StreamReconnect reconnect(kMaxAttempts, kBaseMs, kMaxMs);
+    CHECK_EQ(reconnect.OnFailure(0), 500);
+    CHECK(!reconnect.OnAudio(1000));
+    CHECK_EQ(reconnect.attempt(), 0);
+    reconnect.Reset();
+    CHECK_EQ(reconnect.reconnects(), 0u);
+}
+
+int main() {
+    RUN_TEST(TestAcceptThenCloseGivesUp);
+    RUN_TEST(TestRefusedGivesUp);
+    RUN_TEST(TestOutageEndsWithAudio);
+    RUN_TEST(TestProgressResetsBackoff);
+    RUN_TEST(TestInitialFailuresAreNotReconnects);
+    return 0;
+}
@@ -0,0 +1,22 @@
+// Board reduced to GetNetwork() for host builds; a test installs its fake network with
+// SetNetwork()
+#ifndef HOST_STUB_BOARD_H
+#define HOST_STUB_BOARD_H
+
+#include "network_interface.h"
+
+class Board {
+public:
+    static Board& GetInstance() {
+        static Board instance;
+        return instance;
+    }
+
+    NetworkInterface* GetNetwork() { return network_; }
+    void SetNetwork(NetworkInterface* network) { network_ = network; }
+
+private:
+    NetworkInterface* network_ = nullptr;
+};
+
+#endif // HOST_STUB_BOARD_H
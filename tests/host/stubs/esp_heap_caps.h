@@ -0,0 +1,17 @@
+// heap_caps_* on the C library heap for host builds, PSRAM is reported as present
+#ifndef HOST_STUB_ESP_HEAP_CAPS_H
+#define HOST_STUB_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+static inline void* heap_caps_malloc(size_t size, int caps) { (void)caps; return malloc(size); }
+static inline void* heap_caps_realloc(void* p, size_t size, int caps) { (void)caps; return realloc(p, size); }
+static inline void heap_caps_free(void* p) { free(p); }
+static inline size_t heap_caps_get_free_size(int caps) { (void)caps; return 8u << 20; }
+
+#endif // HOST_STUB_ESP_HEAP_CAPS_H
@@ -0,0 +1,31 @@
+// Thread configuration is ignored in host builds, std::thread runs with the defaults
+#ifndef HOST_STUB_ESP_PTHREAD_H
+#define HOST_STUB_ESP_PTHREAD_H
+
+#include <stddef.h>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+typedef struct {
+    size_t stack_size;
+    size_t prio;
+    int inherit_cfg;
+    const char* thread_name;
+    int pin_to_core;
+    int stack_alloc_caps;
+} esp_pthread_cfg_t;
+
+static inline esp_pthread_cfg_t esp_pthread_get_default_config(void) {
+    esp_pthread_cfg_t cfg = {4096, 5, 0, NULL, -1, 0};
+    return cfg;
+}
+
+static inline esp_err_t esp_pthread_set_cfg(const esp_pthread_cfg_t* cfg) {
+    (void)cfg;
+    return ESP_OK;
+}
+
+#endif // HOST_STUB_ESP_PTHREAD_H
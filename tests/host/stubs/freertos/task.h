@@ -0,0 +1,12 @@
+// vTaskDelay() for host builds. It does not sleep: retry backoffs would only slow the tests
+// down, and the code under test must not rely on time passing for correctness
+#ifndef HOST_STUB_FREERTOS_TASK_H
+#define HOST_STUB_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+static inline void vTaskDelay(TickType_t ticks) {
+    (void)ticks;
+}
+
+#endif // HOST_STUB_FREERTOS_TASK_H
@@ -0,0 +1,25 @@
+// The part of the esp-ml307 Http interface the portable sources use, implemented by fakes
+// in the host tests
+#ifndef HOST_STUB_HTTP_H
+#define HOST_STUB_HTTP_H
+
+#include <cstddef>
+#include <string>
+
+class Http {
+public:
+    virtual ~Http() = default;
+    virtual void SetTimeout(int timeout_ms) { (void)timeout_ms; }
+    virtual void SetHeader(const std::string& key, const std::string& value) = 0;
+    virtual void SetContent(std::string&& content) { (void)content; }
+    virtual bool Open(const std::string& method, const std::string& url) = 0;
+    virtual void Close() = 0;
+    virtual int Read(char* buffer, size_t buffer_size) = 0;
+    virtual int Write(const char* buffer, size_t buffer_size) { (void)buffer; return (int)buffer_size; }
+    virtual int GetStatusCode() = 0;
+    virtual std::string GetResponseHeader(const std::string& key) const { (void)key; return std::string(); }
+    virtual size_t GetBodyLength() = 0;
+    virtual std::string ReadAll() { return std::string(); }
+};
+
+#endif // HOST_STUB_HTTP_H
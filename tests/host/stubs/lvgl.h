@@ -0,0 +1,71 @@
+// Minimal LVGL surface for building the GIF decoder, GifFrameCache and GlyphCache on the host
+#ifndef HOST_STUB_LVGL_H
+#define HOST_STUB_LVGL_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define LV_GIF_CACHE_DECODE_DATA 0
+#define LV_USE_DRAW_SW_ASM 0
+#define LV_DRAW_SW_ASM_HELIUM 2
+#define LV_IMAGE_HEADER_MAGIC 0x19
+
+typedef enum {
+    LV_COLOR_FORMAT_I1 = 0x07,
+    LV_COLOR_FORMAT_A8 = 0x0E,
+    LV_COLOR_FORMAT_ARGB8888 = 0x10,
+    LV_COLOR_FORMAT_RGB565 = 0x12,
+    LV_COLOR_FORMAT_RGB565A8 = 0x14,
+} lv_color_format_t;
+
+typedef struct {
+    uint32_t magic : 8;
+    uint32_t cf : 8;
+    uint32_t flags : 16;
+    uint32_t w : 16;
+    uint32_t h : 16;
+    uint32_t stride : 16;
+    uint32_t reserved : 16;
+} lv_image_header_t;
+
+typedef struct {
+    lv_image_header_t header;
+    uint32_t data_size;
+    const uint8_t* data;
+} lv_image_dsc_t;
+typedef lv_image_dsc_t lv_img_dsc_t;
+
+// Only the fields GlyphCache touches
+typedef struct {
+    lv_image_header_t header;
+    uint32_t data_size;
+    uint8_t* data;
+} lv_draw_buf_t;
+
+typedef struct {
+    int32_t line_height;
+} lv_font_t;
+
+static inline void* lv_malloc(size_t size) { return malloc(size); }
+static inline void* lv_realloc(void* p, size_t size) { return realloc(p, size); }
+static inline void lv_free(void* p) { free(p); }
+
+// gifdec only reads from memory here, the file system calls all fail
+typedef struct {
+    int unused;
+} lv_fs_file_t;
+typedef int lv_fs_res_t;
+typedef int lv_fs_whence_t;
+enum { LV_FS_RES_OK = 0, LV_FS_RES_UNKNOWN = 1 };
+enum { LV_FS_MODE_RD = 1 };
+enum { LV_FS_SEEK_SET = 0, LV_FS_SEEK_CUR = 1, LV_FS_SEEK_END = 2 };
+
+static inline lv_fs_res_t lv_fs_open(lv_fs_file_t* file, const char* path, int mode) { (void)file; (void)path; (void)mode; return LV_FS_RES_UNKNOWN; }
+static inline lv_fs_res_t lv_fs_close(lv_fs_file_t* file) { (void)file; return LV_FS_RES_OK; }
+static inline lv_fs_res_t lv_fs_read(lv_fs_file_t* file, void* buf, uint32_t btr, uint32_t* br) { (void)file; (void)buf; (void)btr; if (br) *br = 0; return LV_FS_RES_UNKNOWN; }
+static inline lv_fs_res_t lv_fs_seek(lv_fs_file_t* file, uint32_t pos, lv_fs_whence_t whence) { (void)file; (void)pos; (void)whence; return LV_FS_RES_UNKNOWN; }
+static inline lv_fs_res_t lv_fs_tell(lv_fs_file_t* file, uint32_t* pos) { (void)file; if (pos) *pos = 0; return LV_FS_RES_UNKNOWN; }
+
+#endif // HOST_STUB_LVGL_H
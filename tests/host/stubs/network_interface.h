@@ -0,0 +1,15 @@
+// NetworkInterface reduced to CreateHttp() for host builds
+#ifndef HOST_STUB_NETWORK_INTERFACE_H
+#define HOST_STUB_NETWORK_INTERFACE_H
+
+#include <memory>
+
+#include "http.h"
+
+class NetworkInterface {
+public:
+    virtual ~NetworkInterface() = default;
+    virtual std::unique_ptr<Http> CreateHttp(int connect_id = -1) = 0;
+};
+
+#endif // HOST_STUB_NETWORK_INTERFACE_H
@@ -0,0 +1,8 @@
+// Kconfig options the portable sources test with #if, set so that the host build compiles
+// every optional path instead of silently leaving it out
+#ifndef HOST_STUB_SDKCONFIG_H
+#define HOST_STUB_SDKCONFIG_H
+
+#define CONFIG_USE_SERVER_AEC 1
+
+#endif // HOST_STUB_SDKCONFIG_H
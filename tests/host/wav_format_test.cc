@@ -0,0 +1,261 @@
+// WavFormat: chunk walking in Parse() and the ToMono() conversion kernels
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "host_test.h"
+#include "wav_format.h"
+
+static void Put16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back(v & 0xFF);
+    out.push_back(v >> 8);
+}
+
+static void Put32(std::vector<uint8_t>& out, uint32_t v) {
+    Put16(out, v & 0xFFFF);
+    Put16(out, v >> 16);
+}
+
+static void PutChunk(std::vector<uint8_t>& out, const char* id, const std::vector<uint8_t>& body, uint32_t size) {
+    out.insert(out.end(), id, id + 4);
+    Put32(out, size);
+    out.insert(out.end(), body.begin(), body.end());
+    if (body.size() & 1) {
+        out.push_back(0);
+    }
+}
+
+static std::vector<uint8_t> Fmt(uint16_t tag, int channels, int rate, int bits, bool extensible = false) {
+    std::vector<uint8_t> fmt;
+    Put16(fmt, extensible ? 0xFFFE : tag);
+    Put16(fmt, channels);
+    Put32(fmt, rate);
+    Put32(fmt, rate * channels * bits / 8);
+    Put16(fmt, channels * bits / 8);
+    Put16(fmt, bits);
+    if (extensible) {
+        Put16(fmt, 22);
+        Put16(fmt, bits);
+        Put32(fmt, 0);
+        Put16(fmt, tag);  // First two bytes of the SubFormat GUID
+        fmt.resize(40, 0);
+    }
+    return fmt;
+}
+
+// RIFF header followed by the given chunks
+static std::vector<uint8_t> Riff(const std::vector<uint8_t>& chunks) {
+    std::vector<uint8_t> file = {'R', 'I', 'F', 'F'};
+    Put32(file, chunks.size() + 4);
+    file.insert(file.end(), {'W', 'A', 'V', 'E'});
+    file.insert(file.end(), chunks.begin(), chunks.end());
+    return file;
+}
+
+static bool ParseBytes(const std::vector<uint8_t>& bytes, WavFormat& format, int64_t file_size) {
+    FILE* fp = tmpfile();
+    CHECK(fp != nullptr);
+    fwrite(bytes.data(), 1, bytes.size(), fp);
+    bool ok = format.Parse(fp, file_size);
+    if (ok) {
+        // Parse() leaves the file at the first data byte
+        CHECK_EQ(ftell(fp), format.data_offset);
+    }
+    fclose(fp);
+    return ok;
+}
+
+static void TestCanonical() {
+    std::vector<uint8_t> chunks;
+    PutChunk(chunks, "fmt ", Fmt(1, 2, 44100, 16), 16);
+    PutChunk(chunks, "data", std::vector<uint8_t>(400, 0), 400);
+    auto file = Riff(chunks);
+
+    WavFormat format;
+    CHECK(ParseBytes(file, format, file.size()));
+    CHECK(format.encoding == WavFormat::Encoding::Pcm);
+    CHECK_EQ(format.sample_rate, 44100);
+    CHECK_EQ(format.channels, 2);
+    CHECK_EQ(format.block_align, 4);
+    CHECK_EQ(format.data_offset, 44);
+    CHECK_EQ(format.data_size, 400);
+    CHECK_EQ(format.frames(), 100);
+    CHECK(format.is_pcm16());
+}
+
+// LIST / odd-sized JUNK before fmt and a fact chunk between fmt and data are skipped
+static void TestSkipsChunks() {
+    std::vector<uint8_t> chunks;
+    PutChunk(chunks, "LIST", std::vector<uint8_t>(26, 'x'), 26);
+    PutChunk(chunks, "JUNK", std::vector<uint8_t>(3, 0), 3);
+    PutChunk(chunks, "fmt ", Fmt(3, 1, 48000, 32, true), 40);
+    PutChunk(chunks, "fact", std::vector<uint8_t>(4, 0), 4);
+    PutChunk(chunks, "data", std::vector<uint8_t>(64, 0), 64);
+    auto file = Riff(chunks);
+
+    WavFormat format;
+    CHECK(ParseBytes(file, format, file.size()));
+    CHECK(format.encoding == WavFormat::Encoding::Float);
+    CHECK_EQ(format.bits_per_sample, 32);
+    CHECK_EQ(format.data_offset, (int64_t)file.size() - 64);
+    CHECK_EQ(format.data_size, 64);
+}
+
+// Streaming writers leave the data size at 0 or 0xFFFFFFFF, the file size is used instead,
+// rounded down to whole frames
+static void TestDataSizeClamp() {
+    for (uint32_t size : {0u, 0xFFFFFFFFu}) {
+        std::vector<uint8_t> chunks;
+        PutChunk(chunks, "fmt ", Fmt(1, 2, 16000, 24), 16);
+        PutChunk(chunks, "data", std::vector<uint8_t>(61, 0), size);
+        auto file = Riff(chunks);
+        file.pop_back();  // Padding byte of the odd body
+
+        WavFormat format;
+        CHECK(ParseBytes(file, format, file.size()));
+        CHECK_EQ(format.data_size, 60);
+        CHECK_EQ(format.frames(), 10);
+    }
+}
+
+static void TestRejects() {
+    WavFormat format;
+    // data before fmt
+    {
+        std::vector<uint8_t> chunks;
+        PutChunk(chunks, "data", std::vector<uint8_t>(8, 0), 8);
+        PutChunk(chunks, "fmt ", Fmt(1, 1, 16000, 16), 16);
+        auto file = Riff(chunks);
+        CHECK(!ParseBytes(file, format, file.size()));
+    }
+    // Unsupported encodings and inconsistent fmt
+    for (auto fmt : {Fmt(2, 1, 16000, 16), Fmt(3, 1, 16000, 16), Fmt(1, 9, 16000, 16), Fmt(1, 1, 16000, 12)}) {
+        std::vector<uint8_t> chunks;
+        PutChunk(chunks, "fmt ", fmt, 16);
+        PutChunk(chunks, "data", std::vector<uint8_t>(8, 0), 8);
+        auto file = Riff(chunks);
+        CHECK(!ParseBytes(file, format, file.size()));
+    }
+    // No data chunk
+    {
+        std::vector<uint8_t> chunks;
+        PutChunk(chunks, "fmt ", Fmt(1, 1, 16000, 16), 16);
+        auto file = Riff(chunks);
+        CHECK(!ParseBytes(file, format, file.size()));
+    }
+    // The file is shorter than the chunk headers claim: data would start at or past its end
+    {
+        std::vector<uint8_t> chunks;
+        PutChunk(chunks, "fmt ", Fmt(1, 1, 16000, 16), 16);
+        PutChunk(chunks, "data", {}, 1000);
+        auto file = Riff(chunks);
+        CHECK(!ParseBytes(file, format, file.size()));
+        CHECK(!ParseBytes(file, format, file.size() - 4));
+    }
+}
+
+static WavFormat Format(WavFormat::Encoding encoding, int channels, int bits) {
+    WavFormat format;
+    format.encoding = encoding;
+    format.sample_rate = 16000;
+    format.channels = channels;
+    format.bits_per_sample = bits;
+    format.block_align = channels * bits / 8;
+    return format;
+}
+
+static void TestKernels() {
+    using E = WavFormat::Encoding;
+    int16_t out[4];
+
+    // 8 bit unsigned, mono
+    const uint8_t u8[] = {0, 128, 255, 64};
+    Format(E::Pcm, 1, 8).ToMono(u8, 4, out);
+    CHECK_EQ(out[0], -32768);
+    CHECK_EQ(out[1], 0);
+    CHECK_EQ(out[2], 32512);
+    CHECK_EQ(out[3], -16384);
+
+    // 16 bit stereo, averaged
+    std::vector<uint8_t> s16;
+    for (int16_t v : {1000, 3000, -32768, -32768, 32767, 32767, -5, 4}) {
+        Put16(s16, (uint16_t)v);
+    }
+    Format(E::Pcm, 2, 16).ToMono(s16.data(), 4, out);
+    CHECK_EQ(out[0], 2000);
+    CHECK_EQ(out[1], -32768);
+    CHECK_EQ(out[2], 32767);
+    CHECK_EQ(out[3], -1);
+
+    // 24 bit mono keeps the top 16 bits
+    const uint8_t s24[] = {0xFF, 0x34, 0x12, 0x00, 0x00, 0x80, 0xAB, 0xFF, 0x7F};
+    Format(E::Pcm, 1, 24).ToMono(s24, 3, out);
+    CHECK_EQ(out[0], 0x1234);
+    CHECK_EQ(out[1], -32768);
+    CHECK_EQ(out[2], 32767);
+
+    // 32 bit, 3 channels, summed then divided once per frame
+    std::vector<uint8_t> s32;
+    for (int32_t v : {100 << 16, 200 << 16, 300 << 16, INT32_MIN, INT32_MIN, INT32_MIN}) {
+        Put32(s32, (uint32_t)v);
+    }
+    Format(E::Pcm, 3, 32).ToMono(s32.data(), 2, out);
+    CHECK_EQ(out[0], 200);
+    CHECK_EQ(out[1], -32768);
+
+    // Float mono: scaled, clipped, NaN as silence
+    std::vector<uint8_t> f32;
+    for (float v : {0.5f, -2.0f, 1.5f, NAN}) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        Put32(f32, bits);
+    }
+    Format(E::Float, 1, 32).ToMono(f32.data(), 4, out);
+    CHECK_EQ(out[0], 16384);
+    CHECK_EQ(out[1], -32768);
+    CHECK_EQ(out[2], 32767);
+    CHECK_EQ(out[3], 0);
+}
+
+// Every kernel must give the same result in place (in == out) as into a separate buffer
+static void TestInPlace() {
+    using E = WavFormat::Encoding;
+    const std::pair<E, int> encodings[] = {{E::Pcm, 16}, {E::Pcm, 24}, {E::Pcm, 32}, {E::Float, 32}};
+    for (auto [encoding, bits] : encodings) {
+        for (int channels = 1; channels <= 8; channels++) {
+            auto format = Format(encoding, channels, bits);
+            const size_t frames = 257;
+            std::vector<uint8_t> in(frames * format.block_align);
+            uint32_t seed = channels * 131 + bits;
+            for (size_t i = 0; i < in.size(); i++) {
+                seed = seed * 1664525 + 1013904223;
+                in[i] = seed >> 24;
+            }
+            if (encoding == E::Float) {
+                for (size_t i = 0; i < in.size(); i += 4) {
+                    float v = (int8_t)in[i] / 128.0f;
+                    memcpy(&in[i], &v, sizeof(v));
+                }
+            }
+            std::vector<int16_t> expected(frames);
+            format.ToMono(in.data(), frames, expected.data());
+
+            std::vector<uint8_t> buffer = in;
+            format.ToMono(buffer.data(), frames, (int16_t*)buffer.data());
+            CHECK(memcmp(buffer.data(), expected.data(), frames * sizeof(int16_t)) == 0);
+        }
+    }
+}
+
+int main() {
+    RUN_TEST(TestCanonical);
+    RUN_TEST(TestSkipsChunks);
+    RUN_TEST(TestDataSizeClamp);
+    RUN_TEST(TestRejects);
+    RUN_TEST(TestKernels);
+    RUN_TEST(TestInPlace);
+    return 0;
+}